@@ -50,31 +50,46 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		}
 	}
 
-	void send_query (string sparql, UnixOutputStream output, Cancellable? cancellable, AsyncReadyCallback? callback) throws GLib.IOError {
-		var message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_STEROIDS, TRACKER_DBUS_INTERFACE_STEROIDS, "Query");
+	void send_query (string sparql, uint timeout, UnixOutputStream output, Cancellable? cancellable, AsyncReadyCallback? callback) throws GLib.IOError {
+		DBusMessage message;
 		var fd_list = new UnixFDList ();
-		message.set_body (new Variant ("(sh)", sparql, fd_list.append (output.fd)));
+
+		if (timeout > 0) {
+			message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_STEROIDS, TRACKER_DBUS_INTERFACE_STEROIDS, "QueryWithTimeout");
+			message.set_body (new Variant ("(suh)", sparql, timeout, fd_list.append (output.fd)));
+		} else {
+			message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_STEROIDS, TRACKER_DBUS_INTERFACE_STEROIDS, "Query");
+			message.set_body (new Variant ("(sh)", sparql, fd_list.append (output.fd)));
+		}
 		message.set_unix_fd_list (fd_list);
 
 		bus.send_message_with_reply.begin (message, DBusSendMessageFlags.NONE, int.MAX, null, cancellable, callback);
 	}
 
 	public override Sparql.Cursor query (string sparql, Cancellable? cancellable) throws Sparql.Error, IOError, DBusError {
+		return query_with_timeout (sparql, 0, cancellable);
+	}
+
+	public async override Sparql.Cursor query_async (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		return yield query_with_timeout_async (sparql, 0, cancellable);
+	}
+
+	public override Sparql.Cursor? query_with_timeout (string sparql, uint timeout, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
 		// use separate main context for sync operation
 		var context = new MainContext ();
 		var loop = new MainLoop (context, false);
 		context.push_thread_default ();
 		AsyncResult async_res = null;
-		query_async.begin (sparql, cancellable, (o, res) => {
+		query_with_timeout_async.begin (sparql, timeout, cancellable, (o, res) => {
 			async_res = res;
 			loop.quit ();
 		});
 		loop.run ();
 		context.pop_thread_default ();
-		return query_async.end (async_res);
+		return query_with_timeout_async.end (async_res);
 	}
 
-	public async override Sparql.Cursor query_async (string sparql, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+	public async override Sparql.Cursor? query_with_timeout_async (string sparql, uint timeout, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
 		UnixInputStream input;
 		UnixOutputStream output;
 		pipe (out input, out output);
@@ -82,10 +97,10 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		// send D-Bus request
 		AsyncResult dbus_res = null;
 		bool received_result = false;
-		send_query (sparql, output, cancellable, (o, res) => {
+		send_query (sparql, timeout, output, cancellable, (o, res) => {
 			dbus_res = res;
 			if (received_result) {
-				query_async.callback ();
+				query_with_timeout_async.callback ();
 			}
 		});
 
@@ -269,6 +284,107 @@ public class Tracker.Bus.Connection : Tracker.Sparql.Connection {
 		return reply.get_body ().get_child_value (0);
 	}
 
+	public override void update_uri_prefix (string old_prefix, string new_prefix, string? sparql = null, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		// use separate main context for sync operation
+		var context = new MainContext ();
+		var loop = new MainLoop (context, false);
+		context.push_thread_default ();
+		AsyncResult async_res = null;
+		update_uri_prefix_async.begin (old_prefix, new_prefix, sparql, priority, cancellable, (o, res) => {
+			async_res = res;
+			loop.quit ();
+		});
+		loop.run ();
+		context.pop_thread_default ();
+		update_uri_prefix_async.end (async_res);
+	}
+
+	public async override void update_uri_prefix_async (string old_prefix, string new_prefix, string? sparql = null, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		UnixInputStream input;
+		UnixOutputStream output;
+		pipe (out input, out output);
+
+		// send D-Bus request, through the same channel as updates so
+		// that it's handled after the updates sent before it
+		AsyncResult dbus_res = null;
+		bool sent_update = false;
+		send_update (priority <= GLib.Priority.DEFAULT ? "UpdateUriPrefix" : "BatchUpdateUriPrefix", input, cancellable, (o, res) => {
+			dbus_res = res;
+			if (sent_update) {
+				update_uri_prefix_async.callback ();
+			}
+		});
+
+		// send prefixes and sparql string via fd, an empty string
+		// stands for no update
+		var data_stream = new DataOutputStream (output);
+		data_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+		data_stream.put_int32 ((int32) old_prefix.length);
+		data_stream.put_string (old_prefix);
+		data_stream.put_int32 ((int32) new_prefix.length);
+		data_stream.put_string (new_prefix);
+		data_stream.put_int32 (sparql != null ? (int32) sparql.length : 0);
+		data_stream.put_string (sparql ?? "");
+		data_stream = null;
+
+		// wait for D-Bus reply
+		sent_update = true;
+		if (dbus_res == null) {
+			yield;
+		}
+
+		var reply = bus.send_message_with_reply.end (dbus_res);
+		handle_error_reply (reply);
+	}
+
+	public override void delete_descendants (string url, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		// use separate main context for sync operation
+		var context = new MainContext ();
+		var loop = new MainLoop (context, false);
+		context.push_thread_default ();
+		AsyncResult async_res = null;
+		delete_descendants_async.begin (url, priority, cancellable, (o, res) => {
+			async_res = res;
+			loop.quit ();
+		});
+		loop.run ();
+		context.pop_thread_default ();
+		delete_descendants_async.end (async_res);
+	}
+
+	public async override void delete_descendants_async (string url, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		UnixInputStream input;
+		UnixOutputStream output;
+		pipe (out input, out output);
+
+		// send D-Bus request, through the same channel as updates so
+		// that it's handled after the updates sent before it
+		AsyncResult dbus_res = null;
+		bool sent_update = false;
+		send_update (priority <= GLib.Priority.DEFAULT ? "DeleteDescendants" : "BatchDeleteDescendants", input, cancellable, (o, res) => {
+			dbus_res = res;
+			if (sent_update) {
+				delete_descendants_async.callback ();
+			}
+		});
+
+		// send url via fd
+		var data_stream = new DataOutputStream (output);
+		data_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+		data_stream.put_int32 ((int32) url.length);
+		data_stream.put_string (url);
+		data_stream = null;
+
+		// wait for D-Bus reply
+		sent_update = true;
+		if (dbus_res == null) {
+			yield;
+		}
+
+		var reply = bus.send_message_with_reply.end (dbus_res);
+		handle_error_reply (reply);
+	}
+
 	public override void load (File file, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
 		var message = new DBusMessage.method_call (TRACKER_DBUS_SERVICE, TRACKER_DBUS_OBJECT_RESOURCES, TRACKER_DBUS_INTERFACE_RESOURCES, "Load");
 		message.set_body (new Variant ("(s)", file.get_uri ()));
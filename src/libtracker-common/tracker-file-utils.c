@@ -809,7 +809,16 @@ tracker_file_unlock (GFile *file)
 gboolean
 tracker_file_is_locked (GFile *file)
 {
-	GFileInfo *file_info;
+	return tracker_file_is_locked_with_type (file, G_FILE_TYPE_UNKNOWN);
+}
+
+/* Same as tracker_file_is_locked(), for callers that already know
+ * the file type, the type is only queried if it's G_FILE_TYPE_UNKNOWN.
+ */
+gboolean
+tracker_file_is_locked_with_type (GFile     *file,
+                                  GFileType  file_type)
+{
 	gboolean retval = FALSE;
 	gchar *path;
 	gint fd;
@@ -820,23 +829,27 @@ tracker_file_is_locked (GFile *file)
 		return FALSE;
 	}
 
-	/* Handle regular files; skip pipes and alike */
-	file_info = g_file_query_info (file,
-	                               G_FILE_ATTRIBUTE_STANDARD_TYPE,
-	                               G_FILE_QUERY_INFO_NONE,
-	                               NULL,
-	                               NULL);
+	if (file_type == G_FILE_TYPE_UNKNOWN) {
+		GFileInfo *file_info;
 
-	if (!file_info) {
-		return FALSE;
-	}
+		file_info = g_file_query_info (file,
+		                               G_FILE_ATTRIBUTE_STANDARD_TYPE,
+		                               G_FILE_QUERY_INFO_NONE,
+		                               NULL,
+		                               NULL);
+
+		if (!file_info) {
+			return FALSE;
+		}
 
-	if (g_file_info_get_file_type (file_info) != G_FILE_TYPE_REGULAR) {
+		file_type = g_file_info_get_file_type (file_info);
 		g_object_unref (file_info);
-		return FALSE;
 	}
 
-	g_object_unref (file_info);
+	/* Handle regular files; skip pipes and alike */
+	if (file_type != G_FILE_TYPE_REGULAR) {
+		return FALSE;
+	}
 
 	path = g_file_get_path (file);
 
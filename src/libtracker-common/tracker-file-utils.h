@@ -43,6 +43,8 @@ gchar *  tracker_file_get_mime_type                         (GFile       *file);
 gboolean tracker_file_lock                                  (GFile       *file);
 gboolean tracker_file_unlock                                (GFile       *file);
 gboolean tracker_file_is_locked                             (GFile       *file);
+gboolean tracker_file_is_locked_with_type                   (GFile       *file,
+                                                             GFileType    file_type);
 gboolean tracker_file_is_hidden                             (GFile       *file);
 gint     tracker_file_cmp                                   (GFile       *file_a,
                                                              GFile       *file_b);
@@ -0,0 +1,274 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "tracker-mime-costs.h"
+
+/* Per MIME type extraction costs, recorded by tracker-extract and
+ * read by the miners to schedule files of cheap types first. Not
+ * thread safe, callers sharing a TrackerMimeCosts across threads
+ * must lock around it.
+ */
+
+/* A type needs this many samples before it's considered expensive */
+#define MIN_SAMPLES      5
+
+/* Average extraction time above which a type is expensive, in µs */
+#define EXPENSIVE_TIME   (250 * 1000)
+
+/* Totals are halved past this many samples, so the averages
+ * follow changes in the extractors or the data being indexed.
+ */
+#define MAX_SAMPLES      1000
+
+#define KEY_COUNT        "Count"
+#define KEY_TIME         "Time"
+#define KEY_BYTES        "Bytes"
+
+struct _TrackerMimeCosts {
+	GHashTable *costs;
+};
+
+TrackerMimeCosts *
+tracker_mime_costs_new (void)
+{
+	TrackerMimeCosts *costs;
+
+	costs = g_slice_new0 (TrackerMimeCosts);
+	costs->costs = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                      (GDestroyNotify) g_free,
+	                                      (GDestroyNotify) g_free);
+	return costs;
+}
+
+void
+tracker_mime_costs_free (TrackerMimeCosts *costs)
+{
+	g_return_if_fail (costs != NULL);
+
+	g_hash_table_unref (costs->costs);
+	g_slice_free (TrackerMimeCosts, costs);
+}
+
+/* Returns a snapshot of @costs, so it can be saved without holding
+ * the lock protecting the original.
+ */
+TrackerMimeCosts *
+tracker_mime_costs_copy (TrackerMimeCosts *costs)
+{
+	TrackerMimeCosts *copy;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_return_val_if_fail (costs != NULL, NULL);
+
+	copy = tracker_mime_costs_new ();
+	g_hash_table_iter_init (&iter, costs->costs);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		g_hash_table_insert (copy->costs,
+		                     g_strdup (key),
+		                     g_memdup (value, sizeof (TrackerMimeCost)));
+	}
+
+	return copy;
+}
+
+gchar *
+tracker_mime_costs_get_default_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+	                         "tracker",
+	                         "extract-costs",
+	                         NULL);
+}
+
+gboolean
+tracker_mime_costs_load (TrackerMimeCosts  *costs,
+                         const gchar       *filename,
+                         GError           **error)
+{
+	GKeyFile *key_file;
+	gchar **groups;
+	gint i;
+
+	g_return_val_if_fail (costs != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	key_file = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, error)) {
+		g_key_file_free (key_file);
+		return FALSE;
+	}
+
+	g_hash_table_remove_all (costs->costs);
+	groups = g_key_file_get_groups (key_file, NULL);
+
+	for (i = 0; groups[i]; i++) {
+		TrackerMimeCost *cost;
+
+		cost = g_new0 (TrackerMimeCost, 1);
+		cost->count = g_key_file_get_integer (key_file, groups[i], KEY_COUNT, NULL);
+		cost->time = g_key_file_get_uint64 (key_file, groups[i], KEY_TIME, NULL);
+		cost->bytes = g_key_file_get_uint64 (key_file, groups[i], KEY_BYTES, NULL);
+
+		if (cost->count == 0) {
+			g_free (cost);
+			continue;
+		}
+
+		g_hash_table_insert (costs->costs, g_strdup (groups[i]), cost);
+	}
+
+	g_strfreev (groups);
+	g_key_file_free (key_file);
+
+	return TRUE;
+}
+
+gboolean
+tracker_mime_costs_save (TrackerMimeCosts  *costs,
+                         const gchar       *filename,
+                         GError           **error)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	GKeyFile *key_file;
+	gchar *data, *dirname;
+	gsize length;
+	gboolean retval;
+
+	g_return_val_if_fail (costs != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	key_file = g_key_file_new ();
+	g_hash_table_iter_init (&iter, costs->costs);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		TrackerMimeCost *cost = value;
+
+		g_key_file_set_integer (key_file, key, KEY_COUNT, cost->count);
+		g_key_file_set_uint64 (key_file, key, KEY_TIME, cost->time);
+		g_key_file_set_uint64 (key_file, key, KEY_BYTES, cost->bytes);
+	}
+
+	data = g_key_file_to_data (key_file, &length, NULL);
+	g_key_file_free (key_file);
+
+	dirname = g_path_get_dirname (filename);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	retval = g_file_set_contents (filename, data, length, error);
+	g_free (data);
+
+	return retval;
+}
+
+void
+tracker_mime_costs_add (TrackerMimeCosts *costs,
+                        const gchar      *mime_type,
+                        guint64           time,
+                        guint64           bytes)
+{
+	TrackerMimeCost *cost;
+
+	g_return_if_fail (costs != NULL);
+	g_return_if_fail (mime_type != NULL);
+
+	cost = g_hash_table_lookup (costs->costs, mime_type);
+
+	if (!cost) {
+		cost = g_new0 (TrackerMimeCost, 1);
+		g_hash_table_insert (costs->costs, g_strdup (mime_type), cost);
+	} else if (cost->count >= MAX_SAMPLES) {
+		cost->count /= 2;
+		cost->time /= 2;
+		cost->bytes /= 2;
+	}
+
+	cost->count++;
+	cost->time += time;
+	cost->bytes += bytes;
+}
+
+const TrackerMimeCost *
+tracker_mime_costs_lookup (TrackerMimeCosts *costs,
+                           const gchar      *mime_type)
+{
+	g_return_val_if_fail (costs != NULL, NULL);
+	g_return_val_if_fail (mime_type != NULL, NULL);
+
+	return g_hash_table_lookup (costs->costs, mime_type);
+}
+
+gboolean
+tracker_mime_costs_is_expensive (TrackerMimeCosts *costs,
+                                 const gchar      *mime_type)
+{
+	const TrackerMimeCost *cost;
+
+	cost = tracker_mime_costs_lookup (costs, mime_type);
+
+	if (!cost || cost->count < MIN_SAMPLES) {
+		return FALSE;
+	}
+
+	return cost->time / cost->count >= EXPENSIVE_TIME;
+}
+
+static gint
+compare_average_time (gconstpointer a,
+                      gconstpointer b,
+                      gpointer      user_data)
+{
+	TrackerMimeCosts *costs = user_data;
+	const TrackerMimeCost *cost_a, *cost_b;
+	guint64 average_a, average_b;
+
+	cost_a = g_hash_table_lookup (costs->costs, a);
+	cost_b = g_hash_table_lookup (costs->costs, b);
+	average_a = cost_a->time / cost_a->count;
+	average_b = cost_b->time / cost_b->count;
+
+	if (average_a != average_b) {
+		return average_a > average_b ? -1 : 1;
+	}
+
+	return g_strcmp0 (a, b);
+}
+
+/* Returns the MIME types with recorded costs, most expensive first.
+ * The list must be freed with g_list_free(), its elements are owned
+ * by @costs.
+ */
+GList *
+tracker_mime_costs_get_mime_types (TrackerMimeCosts *costs)
+{
+	GList *mime_types;
+
+	g_return_val_if_fail (costs != NULL, NULL);
+
+	mime_types = g_hash_table_get_keys (costs->costs);
+
+	return g_list_sort_with_data (mime_types, compare_average_time, costs);
+}
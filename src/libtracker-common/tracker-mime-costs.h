@@ -0,0 +1,61 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_COMMON_MIME_COSTS_H__
+#define __LIBTRACKER_COMMON_MIME_COSTS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+#if !defined (__LIBTRACKER_COMMON_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-common/tracker-common.h> must be included directly."
+#endif
+
+typedef struct _TrackerMimeCosts TrackerMimeCosts;
+
+typedef struct {
+	guint   count;
+	guint64 time;  /* Microseconds spent extracting */
+	guint64 bytes; /* Size of the extracted files */
+} TrackerMimeCost;
+
+TrackerMimeCosts *     tracker_mime_costs_new                  (void);
+void                   tracker_mime_costs_free                 (TrackerMimeCosts *costs);
+TrackerMimeCosts *     tracker_mime_costs_copy                 (TrackerMimeCosts *costs);
+
+gchar *                tracker_mime_costs_get_default_filename (void);
+gboolean               tracker_mime_costs_load                 (TrackerMimeCosts  *costs,
+                                                                const gchar       *filename,
+                                                                GError           **error);
+gboolean               tracker_mime_costs_save                 (TrackerMimeCosts  *costs,
+                                                                const gchar       *filename,
+                                                                GError           **error);
+
+void                   tracker_mime_costs_add                  (TrackerMimeCosts *costs,
+                                                                const gchar      *mime_type,
+                                                                guint64           time,
+                                                                guint64           bytes);
+const TrackerMimeCost *tracker_mime_costs_lookup               (TrackerMimeCosts *costs,
+                                                                const gchar      *mime_type);
+gboolean               tracker_mime_costs_is_expensive         (TrackerMimeCosts *costs,
+                                                                const gchar      *mime_type);
+GList *                tracker_mime_costs_get_mime_types       (TrackerMimeCosts *costs);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_COMMON_MIME_COSTS_H__ */
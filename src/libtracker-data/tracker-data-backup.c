@@ -20,7 +20,11 @@
 #include "config.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -39,10 +43,48 @@ typedef struct {
 	gpointer user_data;
 	GDestroyNotify destroy;
 	GError *error;
+	GKeyFile *snapshot_state;
+	GArray *journal_files;
+	guint n_pending;
 } BackupSaveInfo;
 
+/* A journal file as it was when a backup started. It's kept open,
+ * so it can be copied while the store appends to it or rotates it.
+ */
+typedef struct {
+	gchar *name;
+	gint fd;
+	goffset size;
+} JournalFile;
+
 #ifndef DISABLE_JOURNAL
 
+/* Bytes copied at once when updating a directory backup */
+#define BACKUP_COPY_STEP	(1024 * 1024)
+
+/* Bytes compared at the end of a previously backed up journal file
+ * to tell whether it's still the start of the current one.
+ */
+#define BACKUP_COMPARE_SIZE	4096
+
+/* Directory backups also hold a database snapshot, so restoring only
+ * needs to replay the journal written after it. The state file tells
+ * which journal position and ontology the snapshot matches.
+ */
+#define SNAPSHOT_FILENAME		"meta.db"
+#define SNAPSHOT_STATE_FILENAME		"meta.db.state"
+
+#define SNAPSHOT_GROUP			"Snapshot"
+#define SNAPSHOT_KEY_JOURNAL_SIZE	"JournalSize"
+#define SNAPSHOT_KEY_JOURNAL_TAIL	"JournalTail"
+#define SNAPSHOT_KEY_ONTOLOGY_JOURNAL	"OntologyJournalSize"
+#define SNAPSHOT_KEY_ONTOLOGIES		"Ontologies"
+
+/* The snapshot is taken again once the journal written after it gets
+ * bigger than this fraction of its size, bounding the replay needed.
+ */
+#define SNAPSHOT_REFRESH_RATIO		4
+
 typedef struct {
 	GPid pid;
 	guint stdout_watch_id;
@@ -56,6 +98,21 @@ typedef struct {
 
 #endif /* DISABLE_JOURNAL */
 
+static void
+journal_files_free (GArray *files)
+{
+	guint i;
+
+	for (i = 0; i < files->len; i++) {
+		JournalFile *file = &g_array_index (files, JournalFile, i);
+
+		close (file->fd);
+		g_free (file->name);
+	}
+
+	g_array_free (files, TRUE);
+}
+
 static void
 free_backup_save_info (BackupSaveInfo *info)
 {
@@ -73,6 +130,14 @@ free_backup_save_info (BackupSaveInfo *info)
 
 	g_clear_error (&info->error);
 
+	if (info->snapshot_state) {
+		g_key_file_free (info->snapshot_state);
+	}
+
+	if (info->journal_files) {
+		journal_files_free (info->journal_files);
+	}
+
 	g_free (info);
 }
 
@@ -223,6 +288,589 @@ process_context_child_watch_cb (GPid     pid,
 
 	process_context_destroy (context, error);
 }
+
+/* Returns the names of the journal files in @directory, the
+ * journal and ontology journal first, then the rotated chunks.
+ */
+static GPtrArray *
+journal_get_file_names (const gchar *directory)
+{
+	GPtrArray *names;
+	const gchar *f_name;
+	GDir *journal_dir;
+
+	names = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_add (names, g_strdup (TRACKER_DB_JOURNAL_FILENAME));
+	g_ptr_array_add (names, g_strdup (TRACKER_DB_JOURNAL_ONTOLOGY_FILENAME));
+
+	journal_dir = g_dir_open (directory, 0, NULL);
+
+	if (!journal_dir) {
+		return names;
+	}
+
+	while ((f_name = g_dir_read_name (journal_dir)) != NULL) {
+		if (g_str_has_prefix (f_name, TRACKER_DB_JOURNAL_FILENAME ".")) {
+			g_ptr_array_add (names, g_strdup (f_name));
+		}
+	}
+
+	g_dir_close (journal_dir);
+
+	return names;
+}
+
+/* Opens the journal files in @directory, fixing the state they are
+ * backed up or restored in.
+ */
+static GArray *
+journal_files_open (const gchar *directory)
+{
+	GPtrArray *names;
+	GArray *files;
+	guint i;
+
+	names = journal_get_file_names (directory);
+	files = g_array_new (FALSE, FALSE, sizeof (JournalFile));
+
+	for (i = 0; i < names->len; i++) {
+		JournalFile file;
+		struct stat st;
+		gchar *path;
+
+		path = g_build_filename (directory, g_ptr_array_index (names, i), NULL);
+		file.fd = g_open (path, O_RDONLY, 0);
+		g_free (path);
+
+		if (file.fd == -1) {
+			/* Nothing to back up */
+			continue;
+		}
+
+		if (fstat (file.fd, &st) == -1) {
+			close (file.fd);
+			continue;
+		}
+
+		file.name = g_strdup (g_ptr_array_index (names, i));
+		file.size = st.st_size;
+		g_array_append_val (files, file);
+	}
+
+	g_ptr_array_unref (names);
+
+	return files;
+}
+
+static JournalFile *
+journal_files_lookup (GArray      *files,
+                      const gchar *name)
+{
+	guint i;
+
+	for (i = 0; i < files->len; i++) {
+		JournalFile *file = &g_array_index (files, JournalFile, i);
+
+		if (strcmp (file->name, name) == 0) {
+			return file;
+		}
+	}
+
+	return NULL;
+}
+
+static gboolean
+read_at (gint     fd,
+         goffset  offset,
+         gchar   *buffer,
+         gsize    size)
+{
+	gsize total = 0;
+
+	while (total < size) {
+		gssize bytes;
+
+		bytes = pread (fd, buffer + total, size - total, offset + total);
+
+		if (bytes < 0 && errno == EINTR) {
+			continue;
+		} else if (bytes <= 0) {
+			return FALSE;
+		}
+
+		total += bytes;
+	}
+
+	return TRUE;
+}
+
+/* Journal files are only appended to, so a previous copy that
+ * still matches the current file at its end only needs the data
+ * written since then.
+ */
+static goffset
+journal_file_get_copied_size (gint    src_fd,
+                              goffset src_size,
+                              gint    dest_fd,
+                              goffset dest_size)
+{
+	gchar src_buf[BACKUP_COMPARE_SIZE], dest_buf[BACKUP_COMPARE_SIZE];
+	gsize size;
+
+	if (dest_size == 0 || dest_size > src_size) {
+		return 0;
+	}
+
+	size = MIN (dest_size, BACKUP_COMPARE_SIZE);
+
+	if (!read_at (src_fd, dest_size - size, src_buf, size) ||
+	    !read_at (dest_fd, dest_size - size, dest_buf, size) ||
+	    memcmp (src_buf, dest_buf, size) != 0) {
+		return 0;
+	}
+
+	return dest_size;
+}
+
+static gboolean
+journal_file_copy (JournalFile  *src,
+                   const gchar  *dest_path,
+                   GError      **error)
+{
+	struct stat dest_st;
+	gint dest_fd;
+	goffset offset;
+	gchar *buffer;
+	gboolean retval = TRUE;
+
+	dest_fd = g_open (dest_path, O_RDWR | O_CREAT, 0600);
+
+	if (dest_fd == -1 ||
+	    fstat (dest_fd, &dest_st) == -1) {
+		g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+		             "Could not copy '%s' to '%s': %s",
+		             src->name, dest_path, g_strerror (errno));
+
+		if (dest_fd != -1) {
+			close (dest_fd);
+		}
+
+		return FALSE;
+	}
+
+	/* The journal may be growing while it's copied, only what
+	 * was there when the files were opened is copied.
+	 */
+	offset = journal_file_get_copied_size (src->fd, src->size,
+	                                       dest_fd, dest_st.st_size);
+
+	if (offset != dest_st.st_size &&
+	    ftruncate (dest_fd, offset) == -1) {
+		retval = FALSE;
+	}
+
+	g_debug ("Copying '%s', %" G_GOFFSET_FORMAT " of %" G_GOFFSET_FORMAT " bytes already copied",
+	         src->name, offset, src->size);
+
+	buffer = g_malloc (BACKUP_COPY_STEP);
+
+	while (retval && offset < src->size) {
+		gsize size;
+
+		size = MIN (BACKUP_COPY_STEP, src->size - offset);
+
+		if (!read_at (src->fd, offset, buffer, size) ||
+		    pwrite (dest_fd, buffer, size, offset) != (gssize) size) {
+			retval = FALSE;
+			break;
+		}
+
+		offset += size;
+	}
+
+	if (retval && fsync (dest_fd) == -1) {
+		retval = FALSE;
+	}
+
+	if (!retval) {
+		g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+		             "Could not copy '%s' to '%s': %s",
+		             src->name, dest_path, g_strerror (errno));
+	}
+
+	g_free (buffer);
+	close (dest_fd);
+
+	return retval;
+}
+
+static gboolean
+journal_files_copy (GArray       *files,
+                    const gchar  *dest_dir,
+                    GError      **error)
+{
+	gboolean retval = TRUE;
+	guint i;
+
+	for (i = 0; retval && i < files->len; i++) {
+		JournalFile *file = &g_array_index (files, JournalFile, i);
+		gchar *dest_path;
+
+		dest_path = g_build_filename (dest_dir, file->name, NULL);
+		retval = journal_file_copy (file, dest_path, error);
+		g_free (dest_path);
+	}
+
+	return retval;
+}
+
+static goffset
+file_get_size (const gchar *directory,
+               const gchar *name)
+{
+	struct stat st;
+	gchar *path;
+	goffset size = 0;
+
+	path = g_build_filename (directory, name, NULL);
+
+	if (g_stat (path, &st) == 0) {
+		size = st.st_size;
+	}
+
+	g_free (path);
+
+	return size;
+}
+
+/* Checksum of the journal data right before @size, telling whether
+ * the journal still starts like it did when the snapshot was taken.
+ */
+static gchar *
+journal_get_tail_checksum (JournalFile *journal,
+                           goffset      size)
+{
+	gchar buffer[BACKUP_COMPARE_SIZE];
+	gchar *checksum = NULL;
+	gsize length;
+
+	if (size > journal->size) {
+		return NULL;
+	}
+
+	length = MIN (size, BACKUP_COMPARE_SIZE);
+
+	if (read_at (journal->fd, size - length, buffer, length)) {
+		checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+		                                        (const guchar *) buffer,
+		                                        length);
+	}
+
+	return checksum;
+}
+
+static goffset
+journal_files_get_size (GArray      *files,
+                        const gchar *name)
+{
+	JournalFile *file;
+
+	file = journal_files_lookup (files, name);
+
+	return file ? file->size : 0;
+}
+
+/* The ontology cache is written next to the database */
+static gchar *
+ontologies_get_checksum (void)
+{
+	gchar *dirname, *filename, *contents, *checksum = NULL;
+	gsize length;
+
+	dirname = g_path_get_dirname (tracker_db_manager_get_file (TRACKER_DB_METADATA));
+	filename = g_build_filename (dirname, "ontologies.gvdb", NULL);
+	g_free (dirname);
+
+	if (g_file_get_contents (filename, &contents, &length, NULL)) {
+		checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+		                                        (const guchar *) contents,
+		                                        length);
+		g_free (contents);
+	}
+
+	g_free (filename);
+
+	return checksum;
+}
+
+/* Returns whether the snapshot in the backup @directory can be
+ * restored with the journal @files and the ontology whose cache has
+ * @ontologies_checksum, setting @journal_offset to the journal
+ * position it was taken at.
+ *
+ * The offset only points into the current journal file, the replay
+ * has no way to start halfway through the rotated chunks. A backup
+ * with rotated chunks always takes a full replay, its snapshot is
+ * never used.
+ */
+static gboolean
+snapshot_is_valid (const gchar *directory,
+                   GArray      *files,
+                   const gchar *ontologies_checksum,
+                   goffset     *journal_offset)
+{
+	GKeyFile *state;
+	JournalFile *journal;
+	gchar *path, *checksum, *tail;
+	goffset offset;
+	gboolean valid = FALSE;
+
+	journal = journal_files_lookup (files, TRACKER_DB_JOURNAL_FILENAME);
+
+	if (!journal || files->len > 2 || !ontologies_checksum ||
+	    file_get_size (directory, SNAPSHOT_FILENAME) <= 0) {
+		/* Rotated chunks can't be skipped on replay, full replay */
+		return FALSE;
+	}
+
+	state = g_key_file_new ();
+	path = g_build_filename (directory, SNAPSHOT_STATE_FILENAME, NULL);
+
+	if (g_key_file_load_from_file (state, path, G_KEY_FILE_NONE, NULL)) {
+		offset = g_key_file_get_int64 (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_JOURNAL_SIZE, NULL);
+		checksum = g_key_file_get_string (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_ONTOLOGIES, NULL);
+		tail = g_key_file_get_string (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_JOURNAL_TAIL, NULL);
+
+		if (offset > 0 &&
+		    offset <= journal->size &&
+		    g_key_file_get_int64 (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_ONTOLOGY_JOURNAL, NULL) ==
+		    journal_files_get_size (files, TRACKER_DB_JOURNAL_ONTOLOGY_FILENAME) &&
+		    g_strcmp0 (checksum, ontologies_checksum) == 0) {
+			gchar *current_tail;
+
+			current_tail = journal_get_tail_checksum (journal, offset);
+			valid = (g_strcmp0 (tail, current_tail) == 0);
+			g_free (current_tail);
+		}
+
+		if (valid && journal_offset) {
+			*journal_offset = offset;
+		}
+
+		g_free (checksum);
+		g_free (tail);
+	}
+
+	g_key_file_free (state);
+	g_free (path);
+
+	return valid;
+}
+
+/* Returns the state to save along a new snapshot of the database in
+ * the backup @directory, once the journal @files are copied there, or
+ * %NULL if the current snapshot is good enough.
+ */
+static GKeyFile *
+snapshot_state_new (const gchar *directory,
+                    GArray      *files)
+{
+	GKeyFile *state = NULL;
+	JournalFile *journal;
+	gchar *checksum, *tail;
+	goffset offset, journal_size;
+
+	journal = journal_files_lookup (files, TRACKER_DB_JOURNAL_FILENAME);
+
+	if (!journal || files->len > 2) {
+		return NULL;
+	}
+
+	checksum = ontologies_get_checksum ();
+	journal_size = journal->size;
+
+	if (checksum && journal_size > 0 &&
+	    (!snapshot_is_valid (directory, files, checksum, &offset) ||
+	     (journal_size - offset) * SNAPSHOT_REFRESH_RATIO >
+	     file_get_size (directory, SNAPSHOT_FILENAME))) {
+		tail = journal_get_tail_checksum (journal, journal_size);
+
+		if (tail) {
+			state = g_key_file_new ();
+			g_key_file_set_int64 (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_JOURNAL_SIZE,
+			                      journal_size);
+			g_key_file_set_string (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_JOURNAL_TAIL,
+			                       tail);
+			g_key_file_set_int64 (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_ONTOLOGY_JOURNAL,
+			                      journal_files_get_size (files, TRACKER_DB_JOURNAL_ONTOLOGY_FILENAME));
+			g_key_file_set_string (state, SNAPSHOT_GROUP, SNAPSHOT_KEY_ONTOLOGIES,
+			                       checksum);
+			g_free (tail);
+		}
+	}
+
+	g_free (checksum);
+
+	return state;
+}
+
+static void
+journal_tarball_extract (GFile   *tarball,
+                         GFile   *directory,
+                         GError **error)
+{
+	gchar *tmp_stdout = NULL;
+	gchar *tmp_stderr = NULL;
+	gchar **argv;
+	gint exit_status;
+
+	argv = g_new0 (char*, 6);
+
+	argv[0] = g_strdup ("tar");
+	argv[1] = g_strdup ("-zxf");
+	argv[2] = g_file_get_path (tarball);
+	argv[3] = g_strdup ("-C");
+	argv[4] = g_file_get_path (directory);
+
+	/* Synchronous: we don't want the mainloop to run while copying the
+	 * journal, as nobody should be writing anything at this point */
+
+	if (!tracker_spawn (argv, 0, &tmp_stdout, &tmp_stderr, &exit_status)) {
+		g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+		             "Error starting tar program");
+	} else if (tmp_stderr && strlen (tmp_stderr) > 0) {
+		g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+		             "%s", tmp_stderr);
+	} else if (exit_status != 0) {
+		g_set_error (error, TRACKER_DATA_BACKUP_ERROR,
+		             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
+		             "Unknown error, tar exited with exit status %d", exit_status);
+	}
+
+	g_free (tmp_stderr);
+	g_free (tmp_stdout);
+	g_strfreev (argv);
+}
+
+static void
+directory_backup_job (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+	BackupSaveInfo *info = task_data;
+	gchar *dest_dir;
+	GError *error = NULL;
+
+	dest_dir = g_file_get_path (info->destination);
+
+	if (journal_files_copy (info->journal_files, dest_dir, &error)) {
+		g_task_return_boolean (task, TRUE);
+	} else {
+		g_task_return_error (task, error);
+	}
+
+	g_free (dest_dir);
+}
+
+/* Called as the journal copy and the snapshot finish, in any order */
+static void
+directory_backup_part_finished (BackupSaveInfo *info,
+                                const GError   *error)
+{
+	if (error && !info->error) {
+		info->error = g_error_copy (error);
+	}
+
+	if (--info->n_pending > 0) {
+		return;
+	}
+
+	if (!info->error && info->snapshot_state) {
+		gchar *data, *path, *directory;
+		gsize length;
+
+		directory = g_file_get_path (info->destination);
+		path = g_build_filename (directory, SNAPSHOT_STATE_FILENAME, NULL);
+		data = g_key_file_to_data (info->snapshot_state, &length, NULL);
+
+		g_file_set_contents (path, data, length, &info->error);
+
+		g_free (data);
+		g_free (path);
+		g_free (directory);
+	}
+
+	on_journal_copied (info, info->error);
+}
+
+static void
+snapshot_finished_cb (GError   *error,
+                      gpointer  user_data)
+{
+	directory_backup_part_finished (user_data, error);
+}
+
+static void
+directory_backup_finished_cb (GObject      *object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+	GError *error = NULL;
+
+	g_task_propagate_boolean (G_TASK (result), &error);
+	directory_backup_part_finished (user_data, error);
+	g_clear_error (&error);
+}
+
+/* The journal files are opened and the database snapshot started
+ * right away, so both hold the same state even if updates go on
+ * while these are copied.
+ */
+static void
+directory_backup_save (BackupSaveInfo *info)
+{
+	GTask *task;
+	GFile *parent;
+	gchar *src_dir, *dest_dir;
+
+	parent = g_file_get_parent (info->journal);
+	src_dir = g_file_get_path (parent);
+	dest_dir = g_file_get_path (info->destination);
+	g_object_unref (parent);
+
+	info->journal_files = journal_files_open (src_dir);
+	info->snapshot_state = snapshot_state_new (dest_dir, info->journal_files);
+	info->n_pending = 1;
+
+	if (info->snapshot_state) {
+		GFile *snapshot, *state;
+
+		/* The stale state goes first, so a failed
+		 * snapshot is never restored from.
+		 */
+		state = g_file_get_child (info->destination, SNAPSHOT_STATE_FILENAME);
+		g_file_delete (state, NULL, NULL);
+		g_object_unref (state);
+
+		info->n_pending++;
+		snapshot = g_file_get_child (info->destination, SNAPSHOT_FILENAME);
+		tracker_db_backup_save (snapshot, snapshot_finished_cb, info, NULL);
+		g_object_unref (snapshot);
+	}
+
+	task = g_task_new (NULL, NULL, directory_backup_finished_cb, info);
+	g_task_set_task_data (task, info, NULL);
+	g_task_run_in_thread (task, directory_backup_job);
+	g_object_unref (task);
+
+	g_free (src_dir);
+	g_free (dest_dir);
+}
 #endif /* DISABLE_JOURNAL */
 
 
@@ -412,7 +1060,16 @@ restore_from_temp (void)
 	g_free (data_dir);
 }
 
-void
+/* If @destination is an existing directory, the journal files are
+ * copied there, and later backups into the same directory only copy
+ * what was added to the journal since. A snapshot of the database is
+ * kept along, so restoring doesn't need to replay the whole journal.
+ * Otherwise a tarball of the journal files is created.
+ *
+ * Returns %TRUE if what is backed up is fixed by the time this
+ * returns, so updates can go on without waiting for @callback.
+ */
+gboolean
 tracker_data_backup_save (GFile *destination,
                           TrackerDataBackupFinished callback,
                           gpointer user_data,
@@ -423,12 +1080,10 @@ tracker_data_backup_save (GFile *destination,
 	ProcessContext *context;
 	gchar **argv;
 	gchar *path, *directory;
-	GDir *journal_dir;
 	GFile *parent;
 	GIOChannel *stdin_channel, *stdout_channel, *stderr_channel;
 	GPid pid;
 	GPtrArray *files;
-	const gchar *f_name;
 	guint i;
 
 	info = g_new0 (BackupSaveInfo, 1);
@@ -438,42 +1093,31 @@ tracker_data_backup_save (GFile *destination,
 	info->user_data = user_data;
 	info->destroy = destroy;
 
+	if (g_file_query_file_type (destination, G_FILE_QUERY_INFO_NONE, NULL) == G_FILE_TYPE_DIRECTORY) {
+		directory_backup_save (info);
+		return TRUE;
+	}
+
 	parent = g_file_get_parent (info->journal);
 	directory = g_file_get_path (parent);
 	g_object_unref (parent);
 	path = g_file_get_path (destination);
 
-	journal_dir = g_dir_open (directory, 0, NULL);
-	f_name = g_dir_read_name (journal_dir);
-	files = g_ptr_array_new ();
-
-	while (f_name) {
-		if (f_name) {
-			if (!g_str_has_prefix (f_name, TRACKER_DB_JOURNAL_FILENAME ".")) {
-				f_name = g_dir_read_name (journal_dir);
-				continue;
-			}
-			g_ptr_array_add (files, g_strdup (f_name));
-		}
-		f_name = g_dir_read_name (journal_dir);
-	}
-
-	g_dir_close (journal_dir);
-
-	argv = g_new0 (gchar*, files->len + 8);
+	files = journal_get_file_names (directory);
+	argv = g_new0 (gchar*, files->len + 6);
 
 	argv[0] = g_strdup ("tar");
 	argv[1] = g_strdup ("-zcf");
 	argv[2] = path;
 	argv[3] = g_strdup ("-C");
 	argv[4] = directory;
-	argv[5] = g_strdup (TRACKER_DB_JOURNAL_FILENAME);
-	argv[6] = g_strdup (TRACKER_DB_JOURNAL_ONTOLOGY_FILENAME);
 
 	for (i = 0; i < files->len; i++) {
-		argv[i+7] = g_ptr_array_index (files, i);
+		argv[i+5] = g_strdup (g_ptr_array_index (files, i));
 	}
 
+	g_ptr_array_unref (files);
+
 	/* It's fine to untar this asynchronous: the journal replay code can or
 	 * should cope with unfinished entries at the end of the file, while
 	 * restoring a backup made this way. */
@@ -490,7 +1134,7 @@ tracker_data_backup_save (GFile *destination,
 		on_journal_copied (info, error);
 		g_strfreev (argv);
 		g_error_free (error);
-		return;
+		return FALSE;
 	}
 
 	context = g_new0 (ProcessContext, 1);
@@ -515,6 +1159,8 @@ tracker_data_backup_save (GFile *destination,
 	         pid, argv[0], argv[1], argv[2]);
 
 	g_strfreev (argv);
+
+	return FALSE;
 #else
 	BackupSaveInfo *info;
 
@@ -528,9 +1174,95 @@ tracker_data_backup_save (GFile *destination,
 	                        on_backup_finished, 
 	                        info,
 	                        NULL);
+
+	return TRUE;
 #endif /* DISABLE_JOURNAL */
 }
 
+#ifndef DISABLE_JOURNAL
+/* Copies the journal files of a directory backup in place, along with
+ * its database snapshot to @db_path if that's compatible with them and
+ * with the current ontology. Returns the journal position to replay from.
+ */
+static goffset
+directory_backup_restore (const gchar  *src_dir,
+                          const gchar  *dest_dir,
+                          const gchar  *db_path,
+                          const gchar  *ontologies_checksum,
+                          GError      **error)
+{
+	GFile *snapshot, *db_file;
+	gchar *snapshot_path;
+	GError *snapshot_error = NULL;
+	GArray *files;
+	goffset offset = 0;
+	gboolean valid;
+
+	/* The snapshot is checked against the very journal data
+	 * that is copied, not against the files as they are later.
+	 */
+	files = journal_files_open (src_dir);
+	valid = snapshot_is_valid (src_dir, files, ontologies_checksum, &offset);
+
+	if (!journal_files_copy (files, dest_dir, error) || !valid) {
+		journal_files_free (files);
+		return 0;
+	}
+
+	journal_files_free (files);
+
+	snapshot_path = g_build_filename (src_dir, SNAPSHOT_FILENAME, NULL);
+	snapshot = g_file_new_for_path (snapshot_path);
+	db_file = g_file_new_for_path (db_path);
+
+	if (!g_file_copy (snapshot, db_file, G_FILE_COPY_OVERWRITE,
+	                  NULL, NULL, NULL, &snapshot_error)) {
+		g_warning ("Could not restore database snapshot, replaying whole journal: %s",
+		           snapshot_error->message);
+		g_error_free (snapshot_error);
+		g_file_delete (db_file, NULL, NULL);
+		offset = 0;
+	} else {
+		g_message ("Restored database snapshot, replaying journal from offset %" G_GOFFSET_FORMAT,
+		           offset);
+	}
+
+	g_object_unref (snapshot);
+	g_object_unref (db_file);
+	g_free (snapshot_path);
+
+	return offset;
+}
+
+static void
+journal_replay_from_snapshot (goffset               offset,
+                              TrackerBusyCallback   busy_callback,
+                              gpointer              busy_user_data,
+                              GError              **error)
+{
+	GError *n_error = NULL;
+
+	/* The journal is opened for writing by the data manager, but
+	 * replaying may need to truncate a damaged end.
+	 */
+	tracker_db_journal_shutdown (NULL);
+
+	tracker_data_replay_journal_from (offset,
+	                                  busy_callback,
+	                                  busy_user_data,
+	                                  "Restoring backup - Replaying journal",
+	                                  &n_error);
+
+	if (!n_error) {
+		tracker_db_journal_init (NULL, FALSE, &n_error);
+	}
+
+	if (n_error) {
+		g_propagate_error (error, n_error);
+	}
+}
+#endif /* DISABLE_JOURNAL */
+
 void
 tracker_data_backup_restore (GFile                *journal,
                              const gchar         **test_schemas,
@@ -557,10 +1289,16 @@ tracker_data_backup_restore (GFile                *journal,
 #ifndef DISABLE_JOURNAL
 		GError *n_error = NULL;
 		GFile *parent = g_file_get_parent (info->destination);
-		gchar *tmp_stdout = NULL;
-		gchar *tmp_stderr = NULL;
-		gchar **argv;
-		gint exit_status;
+		gchar *ontologies_checksum, *db_path;
+		goffset snapshot_offset = 0;
+
+		/* Both have to be taken now: the ontology cache is moved
+		 * away with the database by move_to_temp(), and the
+		 * database manager can't be asked where the database is
+		 * once tracker_data_manager_shutdown() is done.
+		 */
+		ontologies_checksum = ontologies_get_checksum ();
+		db_path = g_strdup (tracker_db_manager_get_file (TRACKER_DB_METADATA));
 #endif /* DISABLE_JOURNAL */
 
 		flags = tracker_db_manager_get_flags (&select_cache_size, &update_cache_size);
@@ -570,42 +1308,26 @@ tracker_data_backup_restore (GFile                *journal,
 		move_to_temp ();
 
 #ifndef DISABLE_JOURNAL
-		argv = g_new0 (char*, 6);
-
-		argv[0] = g_strdup ("tar");
-		argv[1] = g_strdup ("-zxf");
-		argv[2] = g_file_get_path (info->journal);
-		argv[3] = g_strdup ("-C");
-		argv[4] = g_file_get_path (parent);
+		if (g_file_query_file_type (info->journal, G_FILE_QUERY_INFO_NONE, NULL) == G_FILE_TYPE_DIRECTORY) {
+			gchar *src_dir, *dest_dir;
 
-		g_object_unref (parent);
-
-		/* Synchronous: we don't want the mainloop to run while copying the
-		 * journal, as nobody should be writing anything at this point */
+			src_dir = g_file_get_path (info->journal);
+			dest_dir = g_file_get_path (parent);
 
-		if (!tracker_spawn (argv, 0, &tmp_stdout, &tmp_stderr, &exit_status)) {
-			g_set_error (&info->error, TRACKER_DATA_BACKUP_ERROR,
-			             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
-			             "Error starting tar program");
-		}
-
-		if (!info->error && tmp_stderr) {
-			if (strlen (tmp_stderr) > 0) {
-				g_set_error (&info->error, TRACKER_DATA_BACKUP_ERROR,
-				             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
-				             "%s", tmp_stderr);
-			}
-		}
+			snapshot_offset = directory_backup_restore (src_dir, dest_dir,
+			                                            db_path,
+			                                            ontologies_checksum,
+			                                            &info->error);
 
-		if (!info->error && exit_status != 0) {
-			g_set_error (&info->error, TRACKER_DATA_BACKUP_ERROR,
-			             TRACKER_DATA_BACKUP_ERROR_UNKNOWN,
-			             "Unknown error, tar exited with exit status %d", exit_status);
+			g_free (src_dir);
+			g_free (dest_dir);
+		} else {
+			journal_tarball_extract (info->journal, parent, &info->error);
 		}
 
-		g_free (tmp_stderr);
-		g_free (tmp_stdout);
-		g_strfreev (argv);
+		g_free (ontologies_checksum);
+		g_free (db_path);
+		g_object_unref (parent);
 #else
 		/* Turn off force-reindex here, no journal to replay so it wouldn't work */
 		flags &= ~TRACKER_DB_MANAGER_FORCE_REINDEX;
@@ -644,6 +1366,7 @@ tracker_data_backup_restore (GFile                *journal,
 
 		if (info->error) {
 			restore_from_temp ();
+			snapshot_offset = 0;
 		} else {
 			remove_temp ();
 		}
@@ -655,6 +1378,11 @@ tracker_data_backup_restore (GFile                *journal,
 			           n_error->message ? n_error->message : "No error given");
 			g_error_free (n_error);
 		}
+
+		if (snapshot_offset > 0) {
+			/* The snapshot would be wiped by a reindex */
+			flags &= ~TRACKER_DB_MANAGER_FORCE_REINDEX;
+		}
 #endif /* DISABLE_JOURNAL */
 
 		tracker_data_manager_init (flags, test_schemas, &is_first, TRUE, TRUE,
@@ -662,7 +1390,14 @@ tracker_data_backup_restore (GFile                *journal,
 		                           busy_callback, busy_user_data,
 		                           "Restoring backup", &internal_error);
 
-#ifdef DISABLE_JOURNAL
+#ifndef DISABLE_JOURNAL
+		if (!internal_error && snapshot_offset > 0) {
+			journal_replay_from_snapshot (snapshot_offset,
+			                              busy_callback,
+			                              busy_user_data,
+			                              &internal_error);
+		}
+#else
 		if (internal_error) {
 			restore_from_temp ();
 
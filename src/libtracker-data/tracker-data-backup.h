@@ -42,16 +42,16 @@ typedef enum {
 
 typedef void (*TrackerDataBackupFinished) (GError *error, gpointer user_data);
 
-GQuark tracker_data_backup_error_quark (void);
-void   tracker_data_backup_save        (GFile                     *destination,
-                                        TrackerDataBackupFinished  callback,
-                                        gpointer                   user_data,
-                                        GDestroyNotify             destroy);
-void   tracker_data_backup_restore     (GFile                     *journal,
-                                        const gchar              **test_schema,
-                                        TrackerBusyCallback        busy_callback,
-                                        gpointer                   busy_user_data,
-                                        GError                   **error);
+GQuark   tracker_data_backup_error_quark (void);
+gboolean tracker_data_backup_save        (GFile                     *destination,
+                                          TrackerDataBackupFinished  callback,
+                                          gpointer                   user_data,
+                                          GDestroyNotify             destroy);
+void     tracker_data_backup_restore     (GFile                     *journal,
+                                          const gchar              **test_schema,
+                                          TrackerBusyCallback        busy_callback,
+                                          gpointer                   busy_user_data,
+                                          GError                   **error);
 
 G_END_DECLS
 
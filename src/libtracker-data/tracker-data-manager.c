@@ -3412,6 +3412,252 @@ get_new_service_id (TrackerDBInterface *iface)
 	return ++max_service_id;
 }
 
+static gboolean
+load_class_counts (TrackerDBInterface *iface)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	TrackerClass **classes;
+	TrackerProperty **properties;
+	GHashTable *table_rows;
+	gboolean found = FALSE;
+	guint i, n_classes, n_props;
+	GError *error = NULL;
+
+	/* Class counts are stored as table row counts in sqlite_stat1,
+	 * which does not exist until write_statistics() ran once.
+	 */
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+	                                              "SELECT tbl, stat FROM sqlite_stat1 WHERE idx IS NULL");
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &error);
+		g_object_unref (stmt);
+	}
+
+	if (!cursor) {
+		g_clear_error (&error);
+		return FALSE;
+	}
+
+	table_rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	while (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+		g_hash_table_insert (table_rows,
+		                     g_strdup (tracker_db_cursor_get_string (cursor, 0, NULL)),
+		                     GINT_TO_POINTER (atoi (tracker_db_cursor_get_string (cursor, 1, NULL))));
+	}
+
+	if (error) {
+		g_warning ("Could not load class counts: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_object_unref (cursor);
+
+	classes = tracker_ontologies_get_classes (&n_classes);
+
+	for (i = 0; i < n_classes; i++) {
+		gpointer rows;
+
+		if (g_hash_table_lookup_extended (table_rows, tracker_class_get_name (classes[i]), NULL, &rows)) {
+			tracker_class_set_count (classes[i], GPOINTER_TO_INT (rows));
+			found = TRUE;
+		}
+	}
+
+	properties = tracker_ontologies_get_properties (&n_props);
+
+	for (i = 0; i < n_props; i++) {
+		gpointer rows;
+
+		if (tracker_property_get_multiple_values (properties[i]) &&
+		    g_hash_table_lookup_extended (table_rows, tracker_property_get_table_name (properties[i]), NULL, &rows)) {
+			tracker_property_set_count (properties[i], GPOINTER_TO_INT (rows));
+		}
+	}
+
+	g_hash_table_unref (table_rows);
+
+	return found;
+}
+
+static gint
+count_table_rows (TrackerDBInterface *iface,
+                  const gchar        *table_name)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	GError *error = NULL;
+	gint rows = 0;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_NONE, &error,
+	                                              "SELECT COUNT(1) FROM \"%s\"",
+	                                              table_name);
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		if (tracker_db_cursor_iter_next (cursor, NULL, &error)) {
+			rows = tracker_db_cursor_get_int (cursor, 0);
+		}
+		g_object_unref (cursor);
+	}
+
+	if (error) {
+		g_warning ("Unable to query row count for table %s: %s",
+		           table_name, error->message);
+		g_error_free (error);
+	}
+
+	return rows;
+}
+
+static void
+count_class_instances (TrackerDBInterface *iface)
+{
+	TrackerClass **classes;
+	TrackerProperty **properties;
+	guint i, n_classes, n_props;
+
+	classes = tracker_ontologies_get_classes (&n_classes);
+
+	for (i = 0; i < n_classes; i++) {
+		const gchar *class_name;
+
+		class_name = tracker_class_get_name (classes[i]);
+
+		/* xsd classes do not derive from rdfs:Resource and do not use separate tables */
+		if (g_str_has_prefix (class_name, "xsd:")) {
+			continue;
+		}
+
+		tracker_class_set_count (classes[i], count_table_rows (iface, class_name));
+	}
+
+	properties = tracker_ontologies_get_properties (&n_props);
+
+	for (i = 0; i < n_props; i++) {
+		if (tracker_property_get_multiple_values (properties[i])) {
+			tracker_property_set_count (properties[i],
+			                            count_table_rows (iface, tracker_property_get_table_name (properties[i])));
+		}
+	}
+}
+
+static void
+write_statistics (TrackerDBInterface *iface)
+{
+	TrackerClass **classes;
+	TrackerProperty **properties;
+	guint i, n_classes, n_props;
+	GError *error = NULL;
+
+	/* Without statistics the SQLite planner assumes the same size for
+	 * every table, which makes it pick bad join orders between big and
+	 * small classes. Store the maintained class counts as table row
+	 * counts, the value counts of multi-valued properties and the
+	 * uniqueness of inverse functional properties as index statistics,
+	 * ANALYZE of sqlite_master creates sqlite_stat1 if needed and makes
+	 * SQLite reload it without scanning any table.
+	 */
+	tracker_db_interface_execute_query (iface, &error, "ANALYZE sqlite_master");
+
+	if (error || !tracker_db_interface_start_transaction (iface)) {
+		g_warning ("Could not write statistics: %s",
+		           error ? error->message : "could not start transaction");
+		g_clear_error (&error);
+		return;
+	}
+
+	classes = tracker_ontologies_get_classes (&n_classes);
+
+	for (i = 0; !error && i < n_classes; i++) {
+		const gchar *class_name;
+
+		class_name = tracker_class_get_name (classes[i]);
+
+		if (g_str_has_prefix (class_name, "xsd:")) {
+			continue;
+		}
+
+		tracker_db_interface_execute_query (iface, &error,
+		                                    "DELETE FROM sqlite_stat1 WHERE tbl = '%s'",
+		                                    class_name);
+
+		if (!error) {
+			tracker_db_interface_execute_query (iface, &error,
+			                                    "INSERT INTO sqlite_stat1 (tbl, idx, stat) VALUES ('%s', NULL, '%d')",
+			                                    class_name,
+			                                    MAX (tracker_class_get_count (classes[i]), 1));
+		}
+	}
+
+	properties = tracker_ontologies_get_properties (&n_props);
+
+	for (i = 0; !error && i < n_props; i++) {
+		TrackerProperty *property = properties[i];
+		const gchar *class_name;
+
+		if (tracker_property_get_multiple_values (property)) {
+			tracker_db_interface_execute_query (iface, &error,
+			                                    "DELETE FROM sqlite_stat1 WHERE tbl = '%s'",
+			                                    tracker_property_get_table_name (property));
+
+			if (!error) {
+				tracker_db_interface_execute_query (iface, &error,
+				                                    "INSERT INTO sqlite_stat1 (tbl, idx, stat) VALUES ('%s', NULL, '%d')",
+				                                    tracker_property_get_table_name (property),
+				                                    MAX (tracker_property_get_count (property), 1));
+			}
+			continue;
+		}
+
+		if (!tracker_property_get_indexed (property) ||
+		    !tracker_property_get_is_inverse_functional_property (property) ||
+		    tracker_property_get_multiple_values (property) ||
+		    tracker_property_get_secondary_index (property)) {
+			continue;
+		}
+
+		class_name = tracker_class_get_name (tracker_property_get_domain (property));
+
+		tracker_db_interface_execute_query (iface, &error,
+		                                    "INSERT INTO sqlite_stat1 (tbl, idx, stat) VALUES ('%s', '%s_%s', '%d 1')",
+		                                    class_name,
+		                                    class_name,
+		                                    tracker_property_get_name (property),
+		                                    MAX (tracker_class_get_count (tracker_property_get_domain (property)), 1));
+	}
+
+	if (!error) {
+		tracker_db_interface_end_db_transaction (iface, &error);
+	}
+
+	if (error) {
+		tracker_db_interface_execute_query (iface, NULL, "ROLLBACK");
+	}
+
+	if (!error) {
+		tracker_db_interface_execute_query (iface, &error, "ANALYZE sqlite_master");
+	}
+
+	if (error) {
+		g_warning ("Could not write statistics: %s", error->message);
+		g_error_free (error);
+	}
+}
+
+/* Must be called outside of transactions */
+void
+tracker_data_manager_update_statistics (void)
+{
+	write_statistics (tracker_db_manager_get_db_interface ());
+}
+
 static void
 tracker_data_manager_recreate_indexes (TrackerBusyCallback    busy_callback,
                                        gpointer               busy_user_data,
@@ -4574,6 +4820,17 @@ tracker_data_manager_init (TrackerDBManagerFlags   flags,
 
 	if (!read_only) {
 		tracker_ontologies_sort ();
+
+		/* Class counts feed the SPARQL translator and SQLite planner,
+		 * the stored ones are outdated after an unclean shutdown as
+		 * the updates since they were last written are lost.
+		 */
+		iface = tracker_db_manager_get_db_interface ();
+		if (tracker_db_manager_get_unclean_shutdown () ||
+		    !load_class_counts (iface)) {
+			count_class_instances (iface);
+			write_statistics (iface);
+		}
 	}
 
 	initialized = TRUE;
@@ -4609,6 +4866,10 @@ tracker_data_manager_shutdown (void)
 	}
 #endif /* DISABLE_JOURNAL */
 
+	if (!(tracker_db_manager_get_flags (NULL, NULL) & TRACKER_DB_MANAGER_READONLY)) {
+		write_statistics (tracker_db_manager_get_db_interface ());
+	}
+
 	tracker_db_manager_shutdown ();
 	tracker_ontologies_shutdown ();
 	if (!reloading) {
@@ -65,6 +65,7 @@ gboolean tracker_data_manager_reload                 (TrackerBusyCallback     bu
 
 gboolean tracker_data_manager_init_fts               (TrackerDBInterface     *interface,
 						      gboolean                create);
+void     tracker_data_manager_update_statistics      (void);
 
 G_END_DECLS
 
@@ -32,6 +32,7 @@
 #include <libtracker-miner/tracker-miner-common.h>
 
 #include "tracker-class.h"
+#include "tracker-collation.h"
 #include "tracker-data-manager.h"
 #include "tracker-data-update.h"
 #include "tracker-data-query.h"
@@ -51,6 +52,10 @@
 #define RDF_PROPERTY RDF_PREFIX "Property"
 #define RDF_TYPE RDF_PREFIX "type"
 
+/* Class count changes after which the planner statistics are
+ * written again, at least, or a tenth of the resources */
+#define STATISTICS_MIN_CHANGES 1000
+
 typedef struct _TrackerDataUpdateBuffer TrackerDataUpdateBuffer;
 typedef struct _TrackerDataUpdateBufferResource TrackerDataUpdateBufferResource;
 typedef struct _TrackerDataUpdateBufferPredicate TrackerDataUpdateBufferPredicate;
@@ -68,9 +73,11 @@ struct _TrackerDataUpdateBuffer {
 	/* integer -> TrackerDataUpdateBufferResource */
 	GHashTable *resources_by_id;
 
-	/* the following two fields are valid per sqlite transaction, not just for same subject */
+	/* the following fields are valid per sqlite transaction, not just for same subject */
 	/* TrackerClass -> integer */
 	GHashTable *class_counts;
+	/* TrackerProperty -> integer, multi-valued properties only */
+	GHashTable *property_counts;
 
 #if HAVE_TRACKER_FTS
 	gboolean fts_ever_updated;
@@ -163,6 +170,7 @@ static GPtrArray *commit_callbacks = NULL;
 static GPtrArray *rollback_callbacks = NULL;
 static gint max_service_id = 0;
 static gint max_ontology_id = 0;
+static gint class_count_changes = 0;
 
 static gint         ensure_resource_id         (const gchar      *uri,
                                                 gboolean         *create);
@@ -468,6 +476,32 @@ tracker_data_update_shutdown (void)
 	max_service_id = 0;
 	max_ontology_id = 0;
 	transaction_modseq = 0;
+	class_count_changes = 0;
+}
+
+/* Whether the class counts changed enough since the planner statistics
+ * were last written, the statistics are written in batches by
+ * tracker_data_update_statistics() instead of in every commit */
+gboolean
+tracker_data_statistics_outdated (void)
+{
+	TrackerClass *resource_class;
+	gint threshold;
+
+	resource_class = tracker_ontologies_get_class_by_uri (RDFS_PREFIX "Resource");
+	threshold = MAX (STATISTICS_MIN_CHANGES, tracker_class_get_count (resource_class) / 10);
+
+	return class_count_changes > threshold;
+}
+
+/* Must be called outside of transactions */
+void
+tracker_data_update_statistics (void)
+{
+	g_return_if_fail (!in_transaction);
+
+	tracker_data_manager_update_statistics ();
+	class_count_changes = 0;
 }
 
 static gint
@@ -710,6 +744,24 @@ statement_bind_gvalue (TrackerDBStatement *stmt,
 	}
 }
 
+static void
+add_property_count (TrackerProperty *property,
+                    gint             count)
+{
+	gint old_count_entry;
+
+	tracker_property_set_count (property, tracker_property_get_count (property) + count);
+
+	/* update property_counts table so that the count change can be reverted in case of rollback */
+	if (!update_buffer.property_counts) {
+		update_buffer.property_counts = g_hash_table_new (g_direct_hash, g_direct_equal);
+	}
+
+	old_count_entry = GPOINTER_TO_INT (g_hash_table_lookup (update_buffer.property_counts, property));
+	g_hash_table_insert (update_buffer.property_counts, property,
+	                     GINT_TO_POINTER (old_count_entry + count));
+}
+
 static void
 add_class_count (TrackerClass *class,
                  gint          count)
@@ -718,6 +770,9 @@ add_class_count (TrackerClass *class,
 
 	tracker_class_set_count (class, tracker_class_get_count (class) + count);
 
+	/* one rdf:type row per instance */
+	add_property_count (tracker_ontologies_get_rdf_type (), count);
+
 	/* update class_counts table so that the count change can be reverted in case of rollback */
 	if (!update_buffer.class_counts) {
 		update_buffer.class_counts = g_hash_table_new (g_direct_hash, g_direct_equal);
@@ -1087,6 +1142,24 @@ tracker_data_update_buffer_clear (void)
 
 		g_hash_table_remove_all (update_buffer.class_counts);
 	}
+
+	if (update_buffer.property_counts) {
+		/* revert property count changes */
+
+		GHashTableIter iter;
+		TrackerProperty *property;
+		gpointer count_ptr;
+
+		g_hash_table_iter_init (&iter, update_buffer.property_counts);
+		while (g_hash_table_iter_next (&iter, (gpointer*) &property, &count_ptr)) {
+			gint count;
+
+			count = GPOINTER_TO_INT (count_ptr);
+			tracker_property_set_count (property, tracker_property_get_count (property) - count);
+		}
+
+		g_hash_table_remove_all (update_buffer.property_counts);
+	}
 }
 
 static void
@@ -1738,7 +1811,9 @@ cache_insert_metadata_decomposed (TrackerProperty  *property,
 		                    tracker_property_get_fulltext_indexed (property),
 		                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
 
-		if (!multiple_values) {
+		if (multiple_values) {
+			add_property_count (property, 1);
+		} else {
 			process_domain_indexes (property, &gvalue, field_name, graph, graph_id);
 		}
 
@@ -1946,7 +2021,9 @@ cache_update_metadata_decomposed (TrackerProperty  *property,
 	                    tracker_property_get_fulltext_indexed (property),
 	                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
 
-	if (!multiple_values) {
+	if (multiple_values) {
+		add_property_count (property, 1);
+	} else {
 		process_domain_indexes (property, &gvalue, field_name, graph, graph_id);
 	}
 
@@ -2001,6 +2078,10 @@ delete_metadata_decomposed (TrackerProperty  *property,
 		                    tracker_property_get_fulltext_indexed (property),
 		                    tracker_property_get_data_type (property) == TRACKER_PROPERTY_TYPE_DATETIME);
 
+		if (multiple_values) {
+			add_property_count (property, -1);
+		}
+
 		if (!multiple_values) {
 			TrackerClass **domain_index_classes;
 
@@ -2035,13 +2116,14 @@ delete_metadata_decomposed (TrackerProperty  *property,
 	return change;
 }
 
-static void
+static gint
 db_delete_row (TrackerDBInterface *iface,
                const gchar        *table_name,
                gint                id)
 {
 	TrackerDBStatement *stmt;
 	GError *error = NULL;
+	gint n_rows = 0;
 
 	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &error,
 	                                              "DELETE FROM \"%s\" WHERE ID = ?",
@@ -2057,7 +2139,11 @@ db_delete_row (TrackerDBInterface *iface,
 		g_warning ("%s", error->message);
 		g_error_free (error);
 		error = NULL;
+	} else {
+		n_rows = tracker_db_interface_sqlite_get_changes (iface);
 	}
+
+	return n_rows;
 }
 
 static void
@@ -2171,7 +2257,14 @@ cache_delete_resource_type_full (TrackerClass *class,
 
 		if (direct_delete) {
 			if (multiple_values) {
-				db_delete_row (iface, table_name, resource_buffer->id);
+				gint n_values;
+
+				n_values = db_delete_row (iface, table_name, resource_buffer->id);
+
+				if (prop != tracker_ontologies_get_rdf_type ()) {
+					/* rdf:type values are counted with the classes */
+					add_property_count (prop, -n_values);
+				}
 			}
 			/* single-valued property values are deleted right after the loop by deleting the row in the class table */
 			continue;
@@ -2194,6 +2287,10 @@ cache_delete_resource_type_full (TrackerClass *class,
 			                    tracker_property_get_fulltext_indexed (prop),
 			                    tracker_property_get_data_type (prop) == TRACKER_PROPERTY_TYPE_DATETIME);
 
+			if (multiple_values && prop != tracker_ontologies_get_rdf_type ()) {
+				/* counted with the classes */
+				add_property_count (prop, -1);
+			}
 
 			if (!multiple_values) {
 				TrackerClass **domain_index_classes;
@@ -3394,16 +3491,32 @@ tracker_data_commit_transaction (GError **error)
 		transaction_modseq++;
 	}
 
-	resource_time = 0;
-	in_transaction = FALSE;
-	in_ontology_transaction = FALSE;
-
 	if (update_buffer.class_counts) {
+		GHashTableIter iter;
+		gpointer count_ptr;
+
 		/* successful transaction, no need to rollback class counts,
 		   so remove them */
+		g_hash_table_iter_init (&iter, update_buffer.class_counts);
+		while (g_hash_table_iter_next (&iter, NULL, &count_ptr)) {
+			/* Counts are loaded or recounted once the ontology
+			 * is updated and the journal replayed */
+			if (!in_ontology_transaction && !in_journal_replay) {
+				class_count_changes += ABS (GPOINTER_TO_INT (count_ptr));
+			}
+		}
+
 		g_hash_table_remove_all (update_buffer.class_counts);
 	}
 
+	if (update_buffer.property_counts) {
+		g_hash_table_remove_all (update_buffer.property_counts);
+	}
+
+	resource_time = 0;
+	in_transaction = FALSE;
+	in_ontology_transaction = FALSE;
+
 #if HAVE_TRACKER_FTS
 	if (update_buffer.fts_ever_updated) {
 		update_buffer.fts_ever_updated = FALSE;
@@ -3482,192 +3595,1102 @@ tracker_data_rollback_transaction (void)
 	}
 }
 
-static GVariant *
-update_sparql (const gchar  *update,
-               gboolean      blank,
-               GError      **error)
+/* Returns the part of @prefix a BETWEEN range over a column with the
+ * locale aware collation can be used for, or %NULL if there is none,
+ * same as the SPARQL translation does for string prefixes. The range
+ * may include URLs not starting with @prefix, an exact comparison is
+ * still needed.
+ */
+static gchar *
+get_collation_safe_prefix (const gchar *prefix)
 {
-	GError *actual_error = NULL;
-	TrackerSparqlQuery *sparql_query;
-	GVariant *blank_nodes;
-
-	g_return_val_if_fail (update != NULL, NULL);
-
-	tracker_data_begin_transaction (&actual_error);
-	if (actual_error) {
-		g_propagate_error (error, actual_error);
-		return NULL;
-	}
+	gint i, end = 0;
 
-	sparql_query = tracker_sparql_query_new_update (update);
-	blank_nodes = tracker_sparql_query_execute_update (sparql_query, blank, &actual_error);
-	g_object_unref (sparql_query);
+	for (i = 0; prefix[i] != '\0'; i++) {
+		guchar c = prefix[i];
 
-	if (actual_error) {
-		tracker_data_rollback_transaction ();
-		g_propagate_error (error, actual_error);
-		return NULL;
+		if (c >= 0x80 || !g_ascii_isprint (c)) {
+			break;
+		} else if (g_ascii_ispunct (c)) {
+			end = i + 1;
+		}
 	}
 
-	tracker_data_commit_transaction (&actual_error);
-	if (actual_error) {
-		g_propagate_error (error, actual_error);
+	if (end == 0) {
 		return NULL;
 	}
 
-	return blank_nodes;
+	return g_strndup (prefix, end);
 }
 
-void
-tracker_data_update_sparql (const gchar  *update,
-                            GError      **error)
+static void
+update_uri_prefix_in_table (TrackerDBInterface  *iface,
+                            const gchar         *table_name,
+                            const gchar         *field_name,
+                            const gchar         *new_prefix,
+                            glong                old_len,
+                            GError             **error)
 {
-	update_sparql (update, FALSE, error);
-}
+	TrackerDBStatement *stmt;
 
-GVariant *
-tracker_data_update_sparql_blank (const gchar  *update,
-                                  GError      **error)
-{
-	return update_sparql (update, TRUE, error);
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, error,
+	                                              "UPDATE \"%s\" SET \"%s\" = ? || SUBSTR(\"%s\", ?) "
+	                                              "WHERE ID IN (SELECT ID FROM temp.\"RewrittenResources\")",
+	                                              table_name, field_name, field_name);
+
+	if (stmt) {
+		tracker_db_statement_bind_text (stmt, 0, new_prefix);
+		tracker_db_statement_bind_int (stmt, 1, old_len + 1);
+		tracker_db_statement_execute (stmt, error);
+		g_object_unref (stmt);
+	}
 }
 
-void
-tracker_data_load_turtle_file (GFile   *file,
-                               GError **error)
+/* Fills temp.RewrittenResources with the resources whose nie:url
+ * starts with @old_prefix, returns how many there are.
+ */
+static gint
+collect_uri_prefix_resources (TrackerDBInterface  *iface,
+                              const gchar         *table_name,
+                              const gchar         *field_name,
+                              const gchar         *old_prefix,
+                              GError             **error)
 {
-	gchar *path;
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	GError *actual_error = NULL;
+	gchar *range_prefix;
+	gint count = 0;
 
-	g_return_if_fail (G_IS_FILE (file) && g_file_is_native (file));
+	tracker_db_interface_execute_query (iface, &actual_error,
+	                                    "CREATE TEMPORARY TABLE IF NOT EXISTS \"RewrittenResources\" "
+	                                    "(ID INTEGER NOT NULL PRIMARY KEY)");
+	if (!actual_error) {
+		tracker_db_interface_execute_query (iface, &actual_error,
+		                                    "DELETE FROM temp.\"RewrittenResources\"");
+	}
 
-	path = g_file_get_path (file);
-	tracker_turtle_reader_load (path, error);
-	g_free (path);
-}
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return 0;
+	}
 
-void
-tracker_data_sync (void)
-{
-#ifndef DISABLE_JOURNAL
-	tracker_db_journal_fsync ();
-#endif
-}
+	range_prefix = get_collation_safe_prefix (old_prefix);
 
-#ifndef DISABLE_JOURNAL
+	/* The range is looked up through the nie:url index, only the
+	 * URLs in it are compared byte by byte with the prefix.
+	 */
+	if (range_prefix) {
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+		                                              "INSERT INTO temp.\"RewrittenResources\" (ID) "
+		                                              "SELECT ID FROM \"%s\" "
+		                                              "WHERE \"%s\" COLLATE " TRACKER_COLLATION_NAME " BETWEEN ? AND ? "
+		                                              "AND SUBSTR(\"%s\", 1, ?) = ?",
+		                                              table_name, field_name, field_name);
+	} else {
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+		                                              "INSERT INTO temp.\"RewrittenResources\" (ID) "
+		                                              "SELECT ID FROM \"%s\" "
+		                                              "WHERE SUBSTR(\"%s\", 1, ?) = ?",
+		                                              table_name, field_name);
+	}
 
-void
-tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
-                             gpointer              busy_user_data,
-                             const gchar          *busy_status,
-                             GError              **error)
-{
-	GError *journal_error = NULL;
-	TrackerProperty *rdf_type = NULL;
-	gint last_operation_type = 0;
-	const gchar *uri;
-	GError *n_error = NULL;
+	if (stmt) {
+		gint n = 0;
 
+		if (range_prefix) {
+			gchar last_char[7] = { 0 };
+			gchar *range_end;
 
-	rdf_type = tracker_ontologies_get_rdf_type ();
+			g_unichar_to_utf8 (TRACKER_COLLATION_LAST_CHAR, last_char);
+			range_end = g_strconcat (range_prefix, last_char, NULL);
 
-	tracker_db_journal_reader_init (NULL, &n_error);
-	if (n_error) {
-		/* This is fatal (doesn't happen when file doesn't exist, does happen
-		 * when for some other reason the reader can't be created) */
-		g_propagate_error (error, n_error);
-		return;
+			tracker_db_statement_bind_text (stmt, n++, range_prefix);
+			tracker_db_statement_bind_text (stmt, n++, range_end);
+			g_free (range_end);
+		}
+
+		tracker_db_statement_bind_int (stmt, n++, g_utf8_strlen (old_prefix, -1));
+		tracker_db_statement_bind_text (stmt, n++, old_prefix);
+		tracker_db_statement_execute (stmt, &actual_error);
+		g_object_unref (stmt);
 	}
 
-	while (tracker_db_journal_reader_next (&journal_error)) {
-		TrackerDBJournalEntryType type;
-		const gchar *object;
-		gint graph_id, subject_id, predicate_id, object_id;
+	g_free (range_prefix);
 
-		type = tracker_db_journal_reader_get_type ();
-		if (type == TRACKER_DB_JOURNAL_RESOURCE) {
-			GError *new_error = NULL;
-			TrackerDBInterface *iface;
-			TrackerDBStatement *stmt;
-			gint id;
+	if (!actual_error) {
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &actual_error,
+		                                              "SELECT COUNT(*) FROM temp.\"RewrittenResources\"");
 
-			tracker_db_journal_reader_get_resource (&id, &uri);
+		if (stmt) {
+			cursor = tracker_db_statement_start_cursor (stmt, &actual_error);
+			g_object_unref (stmt);
+		}
+	}
 
-			iface = tracker_db_manager_get_db_interface ();
+	if (cursor) {
+		if (tracker_db_cursor_iter_next (cursor, NULL, &actual_error)) {
+			count = tracker_db_cursor_get_int (cursor, 0);
+		}
 
-			stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &new_error,
-			                                              "INSERT INTO Resource (ID, Uri) VALUES (?, ?)");
+		g_object_unref (cursor);
+	}
 
-			if (stmt) {
-				tracker_db_statement_bind_int (stmt, 0, id);
-				tracker_db_statement_bind_text (stmt, 1, uri);
-				tracker_db_statement_execute (stmt, &new_error);
-				g_object_unref (stmt);
-			}
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return 0;
+	}
 
-			if (new_error) {
-				g_warning ("Journal replay error: '%s'", new_error->message);
-				g_error_free (new_error);
-			}
+	return count;
+}
 
-		} else if (type == TRACKER_DB_JOURNAL_START_TRANSACTION) {
-			tracker_data_begin_transaction_for_replay (tracker_db_journal_reader_get_time (), NULL);
-		} else if (type == TRACKER_DB_JOURNAL_END_TRANSACTION) {
-			GError *new_error = NULL;
-			tracker_data_update_buffer_might_flush (&new_error);
+/* Reports the nie:url change of the rewritten resources of @class, as
+ * the deletion of the old value and the insertion of the new one.
+ */
+static void
+notify_uri_prefix_of_class (TrackerDBInterface  *iface,
+                            TrackerClass        *class,
+                            TrackerProperty     *property,
+                            const gchar         *new_prefix,
+                            glong                old_len,
+                            GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	GError *actual_error = NULL;
+	GPtrArray *rdf_types;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &actual_error,
+	                                              "SELECT ID, (SELECT Uri FROM Resource WHERE ID = \"%s\".ID), "
+	                                              "(SELECT \"%s\" FROM \"%s\" AS u WHERE u.ID = \"%s\".ID) "
+	                                              "FROM \"%s\" "
+	                                              "WHERE ID IN (SELECT ID FROM temp.\"RewrittenResources\")",
+	                                              tracker_class_get_name (class),
+	                                              tracker_property_get_name (property),
+	                                              tracker_property_get_table_name (property),
+	                                              tracker_class_get_name (class),
+	                                              tracker_class_get_name (class));
 
-			tracker_data_commit_transaction (&new_error);
-			if (new_error) {
-				/* Out of disk is an unrecoverable fatal error */
-				if (g_error_matches (new_error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_NO_SPACE)) {
-					g_propagate_error (error, new_error);
-					return;
-				} else {
-					g_warning ("Journal replay error: '%s'", new_error->message);
-					g_clear_error (&new_error);
-				}
-			}
-		} else if (type == TRACKER_DB_JOURNAL_INSERT_STATEMENT ||
-		           type == TRACKER_DB_JOURNAL_UPDATE_STATEMENT) {
-			GError *new_error = NULL;
-			TrackerProperty *property = NULL;
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
 
-			tracker_db_journal_reader_get_statement (&graph_id, &subject_id, &predicate_id, &object);
+	rdf_types = g_ptr_array_new ();
+	g_ptr_array_add (rdf_types, class);
 
-			if (last_operation_type == -1) {
-				tracker_data_update_buffer_flush (&new_error);
-				if (new_error) {
-					g_warning ("Journal replay error: '%s'", new_error->message);
-					g_clear_error (&new_error);
-				}
-			}
-			last_operation_type = 1;
+	while (cursor && tracker_db_cursor_iter_next (cursor, NULL, &actual_error)) {
+		const gchar *subject, *old_url;
+		gchar *new_url;
+		gint subject_id;
+		guint n;
 
-			uri = tracker_ontologies_get_uri_by_id (predicate_id);
-			if (uri) {
-				property = tracker_ontologies_get_property_by_uri (uri);
-			}
+		subject_id = tracker_db_cursor_get_int (cursor, 0);
+		subject = tracker_db_cursor_get_string (cursor, 1, NULL);
+		old_url = tracker_db_cursor_get_string (cursor, 2, NULL);
 
-			if (property) {
-				resource_buffer_switch (NULL, graph_id, NULL, subject_id);
+		if (!old_url) {
+			continue;
+		}
 
-				if (type == TRACKER_DB_JOURNAL_UPDATE_STATEMENT) {
-					cache_update_metadata_decomposed (property, object, 0, NULL, graph_id, &new_error);
-				} else {
-					cache_insert_metadata_decomposed (property, object, 0, NULL, graph_id, &new_error);
-				}
-				if (new_error) {
-					g_warning ("Journal replay error: '%s'", new_error->message);
-					g_clear_error (&new_error);
-				}
+		new_url = g_strconcat (new_prefix, g_utf8_offset_to_pointer (old_url, old_len), NULL);
 
-			} else {
-				g_warning ("Journal replay error: 'property with ID %d doesn't exist'", predicate_id);
-			}
+		for (n = 0; delete_callbacks && n < delete_callbacks->len; n++) {
+			TrackerStatementDelegate *delegate;
 
-		} else if (type == TRACKER_DB_JOURNAL_INSERT_STATEMENT_ID ||
-		           type == TRACKER_DB_JOURNAL_UPDATE_STATEMENT_ID) {
-			GError *new_error = NULL;
-			TrackerClass *class = NULL;
+			delegate = g_ptr_array_index (delete_callbacks, n);
+			delegate->callback (0, NULL, subject_id, subject,
+			                    tracker_property_get_id (property),
+			                    0, old_url,
+			                    rdf_types,
+			                    delegate->user_data);
+		}
+
+		for (n = 0; insert_callbacks && n < insert_callbacks->len; n++) {
+			TrackerStatementDelegate *delegate;
+
+			delegate = g_ptr_array_index (insert_callbacks, n);
+			delegate->callback (0, NULL, subject_id, subject,
+			                    tracker_property_get_id (property),
+			                    0, new_url,
+			                    rdf_types,
+			                    delegate->user_data);
+		}
+
+		g_free (new_url);
+	}
+
+	g_ptr_array_unref (rdf_types);
+
+	if (cursor) {
+		g_object_unref (cursor);
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+	}
+}
+
+static void
+update_uri_prefix (const gchar  *old_prefix,
+                   const gchar  *new_prefix,
+                   GError      **error)
+{
+	TrackerDBInterface *iface;
+	TrackerDBStatement *stmt;
+	TrackerProperty *property;
+	TrackerClass **domain_indexes;
+	GError *actual_error = NULL;
+	const gchar *table_name, *field_name;
+	glong old_len;
+	gint count;
+
+	property = tracker_ontologies_get_property_by_uri (TRACKER_NIE_PREFIX "url");
+
+	if (!property) {
+		g_set_error (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_UNKNOWN_PROPERTY,
+		             "Property '%s' not found in the ontology", TRACKER_NIE_PREFIX "url");
+		return;
+	}
+
+	/* Statements applied so far must hit the database first */
+	tracker_data_update_buffer_flush (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+	table_name = tracker_property_get_table_name (property);
+	field_name = tracker_property_get_name (property);
+	old_len = g_utf8_strlen (old_prefix, -1);
+
+	count = collect_uri_prefix_resources (iface, table_name, field_name, old_prefix, &actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	g_debug ("Rewriting '%s' prefix to '%s' in %d URLs", old_prefix, new_prefix, count);
+
+	if (!in_journal_replay && (insert_callbacks || delete_callbacks)) {
+		TrackerClass **classes;
+		guint i, n_classes;
+
+		classes = tracker_ontologies_get_classes (&n_classes);
+
+		for (i = 0; i < n_classes; i++) {
+			if (!tracker_class_get_notify (classes[i])) {
+				continue;
+			}
+
+			notify_uri_prefix_of_class (iface, classes[i], property,
+			                            new_prefix, old_len,
+			                            &actual_error);
+			if (actual_error) {
+				g_propagate_error (error, actual_error);
+				return;
+			}
+		}
+	}
+
+	/* Same as the first modification of each resource in the update buffer */
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+	                                              "UPDATE \"rdfs:Resource\" SET \"tracker:modified\" = ? "
+	                                              "WHERE ID IN (SELECT ID FROM temp.\"RewrittenResources\")");
+
+	if (stmt) {
+		tracker_db_statement_bind_int (stmt, 0, get_transaction_modseq ());
+		tracker_db_statement_execute (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	domain_indexes = tracker_property_get_domain_indexes (property);
+
+	while (domain_indexes && *domain_indexes) {
+		update_uri_prefix_in_table (iface, tracker_class_get_name (*domain_indexes),
+		                            field_name, new_prefix, old_len,
+		                            &actual_error);
+		if (actual_error) {
+			g_propagate_error (error, actual_error);
+			return;
+		}
+
+		domain_indexes++;
+	}
+
+	update_uri_prefix_in_table (iface, table_name, field_name, new_prefix, old_len, &actual_error);
+	if (!actual_error) {
+		tracker_db_interface_execute_query (iface, &actual_error,
+		                                    "DELETE FROM temp.\"RewrittenResources\"");
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	has_persistent = TRUE;
+
+#ifndef DISABLE_JOURNAL
+	if (!in_journal_replay) {
+		tracker_db_journal_append_uri_prefix (old_prefix, new_prefix);
+	}
+#endif /* DISABLE_JOURNAL */
+}
+
+static gint
+count_deleted_resources (TrackerDBInterface  *iface,
+                         const gchar         *condition,
+                         gint                 arg,
+                         GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	gint count = 0;
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, error,
+	                                              "SELECT COUNT(*) FROM temp.\"DeletedResources\" %s",
+	                                              condition);
+
+	if (stmt) {
+		if (arg >= 0) {
+			tracker_db_statement_bind_int (stmt, 0, arg);
+		}
+
+		cursor = tracker_db_statement_start_cursor (stmt, error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		if (tracker_db_cursor_iter_next (cursor, NULL, error)) {
+			count = tracker_db_cursor_get_int (cursor, 0);
+		}
+
+		g_object_unref (cursor);
+	}
+
+	return count;
+}
+
+/* Fills temp.DeletedResources with the resources contained in the
+ * nfo:DataContainer with @url, walking the container chain one
+ * level at a time, plus the logical resources stored as them.
+ * Returns the number of resources found.
+ */
+static gint
+collect_descendants (TrackerDBInterface  *iface,
+                     const gchar         *url,
+                     GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	GError *actual_error = NULL;
+	gint root_id = 0, depth, count = 0;
+
+	tracker_db_interface_execute_query (iface, &actual_error,
+	                                    "CREATE TEMPORARY TABLE IF NOT EXISTS \"DeletedResources\" "
+	                                    "(ID INTEGER NOT NULL PRIMARY KEY, Depth INTEGER NOT NULL)");
+	if (!actual_error) {
+		tracker_db_interface_execute_query (iface, &actual_error,
+		                                    "CREATE INDEX IF NOT EXISTS temp.\"DeletedResources_Depth\" "
+		                                    "ON \"DeletedResources\" (Depth)");
+	}
+	if (!actual_error) {
+		tracker_db_interface_execute_query (iface, &actual_error,
+		                                    "DELETE FROM temp.\"DeletedResources\"");
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return 0;
+	}
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &actual_error,
+	                                              "SELECT ID FROM \"nie:DataObject\" WHERE \"nie:url\" = ?");
+
+	if (stmt) {
+		tracker_db_statement_bind_text (stmt, 0, url);
+		cursor = tracker_db_statement_start_cursor (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		if (tracker_db_cursor_iter_next (cursor, NULL, &actual_error)) {
+			root_id = tracker_db_cursor_get_int (cursor, 0);
+		}
+
+		g_object_unref (cursor);
+	}
+
+	if (actual_error || root_id == 0) {
+		if (actual_error) {
+			g_propagate_error (error, actual_error);
+		}
+		return 0;
+	}
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+	                                              "INSERT OR IGNORE INTO temp.\"DeletedResources\" (ID, Depth) "
+	                                              "SELECT ID, 1 FROM \"nie:DataObject\" "
+	                                              "WHERE \"nfo:belongsToContainer\" = ? AND ID != ?");
+
+	if (stmt) {
+		tracker_db_statement_bind_int (stmt, 0, root_id);
+		tracker_db_statement_bind_int (stmt, 1, root_id);
+		tracker_db_statement_execute (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	/* Each level is looked up through the nfo:belongsToContainer
+	 * index, so the cost follows the size of the subtree, not the
+	 * size of the database.
+	 */
+	for (depth = 1; !actual_error; depth++) {
+		count = count_deleted_resources (iface, "WHERE Depth = ?", depth, &actual_error);
+
+		if (actual_error || count == 0) {
+			break;
+		}
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+		                                              "INSERT OR IGNORE INTO temp.\"DeletedResources\" (ID, Depth) "
+		                                              "SELECT ID, ? FROM \"nie:DataObject\" "
+		                                              "WHERE \"nfo:belongsToContainer\" IN "
+		                                              "(SELECT ID FROM temp.\"DeletedResources\" WHERE Depth = ?) "
+		                                              "AND ID != ?");
+
+		if (stmt) {
+			tracker_db_statement_bind_int (stmt, 0, depth + 1);
+			tracker_db_statement_bind_int (stmt, 1, depth);
+			tracker_db_statement_bind_int (stmt, 2, root_id);
+			tracker_db_statement_execute (stmt, &actual_error);
+			g_object_unref (stmt);
+		}
+	}
+
+	if (!actual_error &&
+	    tracker_ontologies_get_property_by_uri (TRACKER_NIE_PREFIX "isStoredAs")) {
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+		                                              "INSERT OR IGNORE INTO temp.\"DeletedResources\" (ID, Depth) "
+		                                              "SELECT ID, 0 FROM \"nie:InformationElement\" "
+		                                              "WHERE \"nie:isStoredAs\" IN "
+		                                              "(SELECT ID FROM temp.\"DeletedResources\")");
+
+		if (stmt) {
+			tracker_db_statement_execute (stmt, &actual_error);
+			g_object_unref (stmt);
+		}
+	}
+
+	if (!actual_error) {
+		count = count_deleted_resources (iface, "", -1, &actual_error);
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return 0;
+	}
+
+	return count;
+}
+
+static void
+delete_descendants_of_class (TrackerDBInterface  *iface,
+                             TrackerClass        *class,
+                             GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	GError *actual_error = NULL;
+	const gchar *table_name;
+	gint count = 0;
+
+	table_name = tracker_class_get_name (class);
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &actual_error,
+	                                              "SELECT COUNT(*) FROM \"%s\" "
+	                                              "WHERE ID IN (SELECT ID FROM temp.\"DeletedResources\")",
+	                                              table_name);
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	if (cursor) {
+		if (tracker_db_cursor_iter_next (cursor, NULL, &actual_error)) {
+			count = tracker_db_cursor_get_int (cursor, 0);
+		}
+
+		g_object_unref (cursor);
+		cursor = NULL;
+	}
+
+	if (actual_error || count == 0) {
+		if (actual_error) {
+			g_propagate_error (error, actual_error);
+		}
+		return;
+	}
+
+	/* Only the rdf:type removal is reported, once per resource and
+	 * class, instead of every deleted property value.
+	 */
+	if (!in_journal_replay && delete_callbacks && tracker_class_get_notify (class)) {
+		GPtrArray *rdf_types;
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &actual_error,
+		                                              "SELECT ID, (SELECT Uri FROM Resource WHERE ID = \"%s\".ID) "
+		                                              "FROM \"%s\" "
+		                                              "WHERE ID IN (SELECT ID FROM temp.\"DeletedResources\")",
+		                                              table_name, table_name);
+
+		if (stmt) {
+			cursor = tracker_db_statement_start_cursor (stmt, &actual_error);
+			g_object_unref (stmt);
+		}
+
+		rdf_types = g_ptr_array_new ();
+		g_ptr_array_add (rdf_types, class);
+
+		while (cursor && tracker_db_cursor_iter_next (cursor, NULL, &actual_error)) {
+			guint n;
+
+			for (n = 0; n < delete_callbacks->len; n++) {
+				TrackerStatementDelegate *delegate;
+
+				delegate = g_ptr_array_index (delete_callbacks, n);
+				delegate->callback (0, NULL,
+				                    tracker_db_cursor_get_int (cursor, 0),
+				                    tracker_db_cursor_get_string (cursor, 1, NULL),
+				                    tracker_property_get_id (tracker_ontologies_get_rdf_type ()),
+				                    tracker_class_get_id (class),
+				                    tracker_class_get_uri (class),
+				                    rdf_types,
+				                    delegate->user_data);
+			}
+		}
+
+		g_ptr_array_unref (rdf_types);
+
+		if (cursor) {
+			g_object_unref (cursor);
+		}
+
+		if (actual_error) {
+			g_propagate_error (error, actual_error);
+			return;
+		}
+	}
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+	                                              "DELETE FROM \"%s\" "
+	                                              "WHERE ID IN (SELECT ID FROM temp.\"DeletedResources\")",
+	                                              table_name);
+
+	if (stmt) {
+		tracker_db_statement_execute (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	add_class_count (class, -count);
+}
+
+/* Returns the classes of the resources in temp.DeletedResources */
+static GPtrArray *
+get_descendant_classes (TrackerDBInterface  *iface,
+                        GError             **error)
+{
+	TrackerDBStatement *stmt;
+	TrackerDBCursor *cursor = NULL;
+	GError *actual_error = NULL;
+	GPtrArray *classes;
+
+	classes = g_ptr_array_new ();
+
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_SELECT, &actual_error,
+	                                              "SELECT DISTINCT (SELECT Uri FROM Resource WHERE ID = \"rdf:type\") "
+	                                              "FROM \"rdfs:Resource_rdf:type\" "
+	                                              "WHERE ID IN (SELECT ID FROM temp.\"DeletedResources\")");
+
+	if (stmt) {
+		cursor = tracker_db_statement_start_cursor (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	while (cursor && tracker_db_cursor_iter_next (cursor, NULL, &actual_error)) {
+		TrackerClass *class;
+
+		class = tracker_ontologies_get_class_by_uri (tracker_db_cursor_get_string (cursor, 0, NULL));
+
+		if (class) {
+			g_ptr_array_add (classes, class);
+		} else {
+			g_warning ("Class '%s' not found in the ontology",
+			           tracker_db_cursor_get_string (cursor, 0, NULL));
+		}
+	}
+
+	if (cursor) {
+		g_object_unref (cursor);
+	}
+
+	if (actual_error) {
+		g_ptr_array_unref (classes);
+		g_propagate_error (error, actual_error);
+		return NULL;
+	}
+
+	return classes;
+}
+
+static void
+delete_descendants (const gchar  *url,
+                    GError      **error)
+{
+	TrackerDBInterface *iface;
+	TrackerDBStatement *stmt;
+	GPtrArray *classes;
+	TrackerProperty **properties;
+	GError *actual_error = NULL;
+	guint i, n_props;
+	gint count;
+
+	if (!tracker_ontologies_get_property_by_uri (TRACKER_NFO_PREFIX "belongsToContainer")) {
+		g_set_error (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_UNKNOWN_PROPERTY,
+		             "Property '%s' not found in the ontology", TRACKER_NFO_PREFIX "belongsToContainer");
+		return;
+	}
+
+	/* Statements applied so far must hit the database first */
+	tracker_data_update_buffer_flush (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	iface = tracker_db_manager_get_db_interface ();
+
+	count = collect_descendants (iface, url, &actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	if (count == 0) {
+		return;
+	}
+
+	g_debug ("Deleting %d resources contained in '%s'", count, url);
+
+#if HAVE_TRACKER_FTS
+	/* fts reads the text to unindex from fts_view, this has to
+	 * happen while the property values are still there.
+	 */
+	stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+	                                              "DELETE FROM fts "
+	                                              "WHERE docid IN (SELECT ID FROM temp.\"DeletedResources\")");
+
+	if (stmt) {
+		tracker_db_statement_execute (stmt, &actual_error);
+		g_object_unref (stmt);
+	}
+
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+#endif
+
+	/* Class counts loaded from sqlite_stat1 can be stale, the types
+	 * of the resources tell which class tables have rows to delete.
+	 */
+	classes = get_descendant_classes (iface, &actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	for (i = 0; i < classes->len; i++) {
+		delete_descendants_of_class (iface, g_ptr_array_index (classes, i), &actual_error);
+		if (actual_error) {
+			g_ptr_array_unref (classes);
+			g_propagate_error (error, actual_error);
+			return;
+		}
+	}
+
+	g_ptr_array_unref (classes);
+
+	/* Single valued properties went away with the class rows */
+	properties = tracker_ontologies_get_properties (&n_props);
+
+	for (i = 0; i < n_props; i++) {
+		if (!tracker_property_get_multiple_values (properties[i])) {
+			continue;
+		}
+
+		stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &actual_error,
+		                                              "DELETE FROM \"%s\" "
+		                                              "WHERE ID IN (SELECT ID FROM temp.\"DeletedResources\")",
+		                                              tracker_property_get_table_name (properties[i]));
+
+		if (stmt) {
+			tracker_db_statement_execute (stmt, &actual_error);
+			g_object_unref (stmt);
+		}
+
+		if (actual_error) {
+			g_propagate_error (error, actual_error);
+			return;
+		}
+	}
+
+	tracker_db_interface_execute_query (iface, &actual_error,
+	                                    "DELETE FROM temp.\"DeletedResources\"");
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	has_persistent = TRUE;
+
+#ifndef DISABLE_JOURNAL
+	if (!in_journal_replay) {
+		tracker_db_journal_append_delete_descendants (url);
+	}
+#endif /* DISABLE_JOURNAL */
+}
+
+static GVariant *
+update_sparql (const gchar  *update,
+               gboolean      blank,
+               GError      **error)
+{
+	GError *actual_error = NULL;
+	TrackerSparqlQuery *sparql_query;
+	GVariant *blank_nodes;
+
+	g_return_val_if_fail (update != NULL, NULL);
+
+	tracker_data_begin_transaction (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return NULL;
+	}
+
+	sparql_query = tracker_sparql_query_new_update (update);
+	blank_nodes = tracker_sparql_query_execute_update (sparql_query, blank, &actual_error);
+	g_object_unref (sparql_query);
+
+	if (actual_error) {
+		tracker_data_rollback_transaction ();
+		g_propagate_error (error, actual_error);
+		return NULL;
+	}
+
+	tracker_data_commit_transaction (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return NULL;
+	}
+
+	return blank_nodes;
+}
+
+void
+tracker_data_update_sparql (const gchar  *update,
+                            GError      **error)
+{
+	update_sparql (update, FALSE, error);
+}
+
+GVariant *
+tracker_data_update_sparql_blank (const gchar  *update,
+                                  GError      **error)
+{
+	return update_sparql (update, TRUE, error);
+}
+
+/*
+ * tracker_data_update_uri_prefix:
+ *
+ * Runs @update, if not %NULL, and replaces @old_prefix with @new_prefix
+ * in every nie:url starting with it, in a single transaction. This is
+ * how a moved directory and the URLs of its contents are updated. The
+ * rewritten URLs are reported to statement callbacks as the deletion
+ * of the old nie:url and the insertion of the new one, once for each
+ * class with notifications enabled.
+ *
+ * Both prefixes must end with a "/", so only the contents of a
+ * directory are matched, not its siblings sharing the same beginning.
+ */
+void
+tracker_data_update_uri_prefix (const gchar  *old_prefix,
+                                const gchar  *new_prefix,
+                                const gchar  *update,
+                                GError      **error)
+{
+	GError *actual_error = NULL;
+
+	g_return_if_fail (old_prefix != NULL);
+	g_return_if_fail (new_prefix != NULL);
+
+	if (!g_utf8_validate (old_prefix, -1, NULL) ||
+	    !g_utf8_validate (new_prefix, -1, NULL)) {
+		g_set_error_literal (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_TYPE,
+		                     "URI prefixes must be valid UTF-8");
+		return;
+	}
+
+	if (!g_str_has_suffix (old_prefix, "/") ||
+	    !g_str_has_suffix (new_prefix, "/")) {
+		g_set_error_literal (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_TYPE,
+		                     "URI prefixes must end with '/'");
+		return;
+	}
+
+	tracker_data_begin_transaction (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	if (update) {
+		TrackerSparqlQuery *sparql_query;
+
+		sparql_query = tracker_sparql_query_new_update (update);
+		tracker_sparql_query_execute_update (sparql_query, FALSE, &actual_error);
+		g_object_unref (sparql_query);
+	}
+
+	if (!actual_error) {
+		update_uri_prefix (old_prefix, new_prefix, &actual_error);
+	}
+
+	if (actual_error) {
+		tracker_data_rollback_transaction ();
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	tracker_data_commit_transaction (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+}
+
+/*
+ * tracker_data_delete_descendants:
+ *
+ * Deletes every resource contained, directly or not, in the
+ * nfo:DataContainer with nie:url @url, and the logical resources
+ * stored as them, in a transaction of its own. The container itself
+ * is left alone. Statement callbacks are only called for the rdf:type
+ * of the deleted resources, for classes with notifications enabled.
+ */
+void
+tracker_data_delete_descendants (const gchar  *url,
+                                 GError      **error)
+{
+	GError *actual_error = NULL;
+
+	g_return_if_fail (url != NULL);
+
+	tracker_data_begin_transaction (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	delete_descendants (url, &actual_error);
+
+	if (actual_error) {
+		tracker_data_rollback_transaction ();
+		g_propagate_error (error, actual_error);
+		return;
+	}
+
+	tracker_data_commit_transaction (&actual_error);
+	if (actual_error) {
+		g_propagate_error (error, actual_error);
+		return;
+	}
+}
+
+void
+tracker_data_load_turtle_file (GFile   *file,
+                               GError **error)
+{
+	gchar *path;
+
+	g_return_if_fail (G_IS_FILE (file) && g_file_is_native (file));
+
+	path = g_file_get_path (file);
+	tracker_turtle_reader_load (path, error);
+	g_free (path);
+}
+
+void
+tracker_data_sync (void)
+{
+#ifndef DISABLE_JOURNAL
+	tracker_db_journal_fsync ();
+#endif
+}
+
+#ifndef DISABLE_JOURNAL
+
+void
+tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
+                             gpointer              busy_user_data,
+                             const gchar          *busy_status,
+                             GError              **error)
+{
+	tracker_data_replay_journal_from (0, busy_callback, busy_user_data,
+	                                  busy_status, error);
+}
+
+/* Replays the journal transactions after @offset, where the database
+ * is known to be up to date, e.g. when it was restored from a snapshot.
+ */
+void
+tracker_data_replay_journal_from (gsize                 offset,
+                                  TrackerBusyCallback   busy_callback,
+                                  gpointer              busy_user_data,
+                                  const gchar          *busy_status,
+                                  GError              **error)
+{
+	GError *journal_error = NULL;
+	TrackerProperty *rdf_type = NULL;
+	gint last_operation_type = 0;
+	const gchar *uri;
+	GError *n_error = NULL;
+
+
+	rdf_type = tracker_ontologies_get_rdf_type ();
+
+	if (tracker_db_journal_reader_init (NULL, &n_error) && offset > 0) {
+		tracker_db_journal_reader_skip_to (offset, &n_error);
+
+		if (n_error) {
+			tracker_db_journal_reader_shutdown ();
+		}
+	}
+
+	if (n_error) {
+		/* This is fatal (doesn't happen when file doesn't exist, does happen
+		 * when for some other reason the reader can't be created) */
+		g_propagate_error (error, n_error);
+		return;
+	}
+
+	while (tracker_db_journal_reader_next (&journal_error)) {
+		TrackerDBJournalEntryType type;
+		const gchar *object;
+		gint graph_id, subject_id, predicate_id, object_id;
+
+		type = tracker_db_journal_reader_get_type ();
+		if (type == TRACKER_DB_JOURNAL_RESOURCE) {
+			GError *new_error = NULL;
+			TrackerDBInterface *iface;
+			TrackerDBStatement *stmt;
+			gint id;
+
+			tracker_db_journal_reader_get_resource (&id, &uri);
+
+			iface = tracker_db_manager_get_db_interface ();
+
+			stmt = tracker_db_interface_create_statement (iface, TRACKER_DB_STATEMENT_CACHE_TYPE_UPDATE, &new_error,
+			                                              "INSERT INTO Resource (ID, Uri) VALUES (?, ?)");
+
+			if (stmt) {
+				tracker_db_statement_bind_int (stmt, 0, id);
+				tracker_db_statement_bind_text (stmt, 1, uri);
+				tracker_db_statement_execute (stmt, &new_error);
+				g_object_unref (stmt);
+			}
+
+			if (new_error) {
+				g_warning ("Journal replay error: '%s'", new_error->message);
+				g_error_free (new_error);
+			}
+
+		} else if (type == TRACKER_DB_JOURNAL_START_TRANSACTION) {
+			tracker_data_begin_transaction_for_replay (tracker_db_journal_reader_get_time (), NULL);
+		} else if (type == TRACKER_DB_JOURNAL_END_TRANSACTION) {
+			GError *new_error = NULL;
+			tracker_data_update_buffer_might_flush (&new_error);
+
+			tracker_data_commit_transaction (&new_error);
+			if (new_error) {
+				/* Out of disk is an unrecoverable fatal error */
+				if (g_error_matches (new_error, TRACKER_DB_INTERFACE_ERROR, TRACKER_DB_NO_SPACE)) {
+					g_propagate_error (error, new_error);
+					return;
+				} else {
+					g_warning ("Journal replay error: '%s'", new_error->message);
+					g_clear_error (&new_error);
+				}
+			}
+		} else if (type == TRACKER_DB_JOURNAL_INSERT_STATEMENT ||
+		           type == TRACKER_DB_JOURNAL_UPDATE_STATEMENT) {
+			GError *new_error = NULL;
+			TrackerProperty *property = NULL;
+
+			tracker_db_journal_reader_get_statement (&graph_id, &subject_id, &predicate_id, &object);
+
+			if (last_operation_type == -1) {
+				tracker_data_update_buffer_flush (&new_error);
+				if (new_error) {
+					g_warning ("Journal replay error: '%s'", new_error->message);
+					g_clear_error (&new_error);
+				}
+			}
+			last_operation_type = 1;
+
+			uri = tracker_ontologies_get_uri_by_id (predicate_id);
+			if (uri) {
+				property = tracker_ontologies_get_property_by_uri (uri);
+			}
+
+			if (property) {
+				resource_buffer_switch (NULL, graph_id, NULL, subject_id);
+
+				if (type == TRACKER_DB_JOURNAL_UPDATE_STATEMENT) {
+					cache_update_metadata_decomposed (property, object, 0, NULL, graph_id, &new_error);
+				} else {
+					cache_insert_metadata_decomposed (property, object, 0, NULL, graph_id, &new_error);
+				}
+				if (new_error) {
+					g_warning ("Journal replay error: '%s'", new_error->message);
+					g_clear_error (&new_error);
+				}
+
+			} else {
+				g_warning ("Journal replay error: 'property with ID %d doesn't exist'", predicate_id);
+			}
+
+		} else if (type == TRACKER_DB_JOURNAL_INSERT_STATEMENT_ID ||
+		           type == TRACKER_DB_JOURNAL_UPDATE_STATEMENT_ID) {
+			GError *new_error = NULL;
+			TrackerClass *class = NULL;
 			TrackerProperty *property = NULL;
 
 			tracker_db_journal_reader_get_statement_id (&graph_id, &subject_id, &predicate_id, &object_id);
@@ -3772,6 +4795,36 @@ tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
 				g_warning ("Journal replay error: 'property with ID %d doesn't exist'", predicate_id);
 			}
 
+		} else if (type == TRACKER_DB_JOURNAL_UPDATE_URI_PREFIX) {
+			GError *new_error = NULL;
+			const gchar *old_prefix, *new_prefix;
+
+			tracker_db_journal_reader_get_uri_prefix (&old_prefix, &new_prefix);
+
+			/* Flushes the update buffer itself */
+			update_uri_prefix (old_prefix, new_prefix, &new_error);
+			last_operation_type = 0;
+
+			if (new_error) {
+				g_warning ("Journal replay error: '%s'", new_error->message);
+				g_error_free (new_error);
+			}
+
+		} else if (type == TRACKER_DB_JOURNAL_DELETE_DESCENDANTS) {
+			GError *new_error = NULL;
+			const gchar *url;
+
+			tracker_db_journal_reader_get_descendants (&url);
+
+			/* Flushes the update buffer itself */
+			delete_descendants (url, &new_error);
+			last_operation_type = 0;
+
+			if (new_error) {
+				g_warning ("Journal replay error: '%s'", new_error->message);
+				g_error_free (new_error);
+			}
+
 		} else if (type == TRACKER_DB_JOURNAL_DELETE_STATEMENT_ID) {
 			GError *new_error = NULL;
 			TrackerClass *class = NULL;
@@ -3871,4 +4924,14 @@ tracker_data_replay_journal (TrackerBusyCallback   busy_callback,
 	g_critical ("Not good. We disabled the journal and yet replaying it got called");
 }
 
+void
+tracker_data_replay_journal_from (gsize                 offset,
+                                  TrackerBusyCallback   busy_callback,
+                                  gpointer              busy_user_data,
+                                  const gchar          *busy_status,
+                                  GError              **error)
+{
+	g_critical ("Not good. We disabled the journal and yet replaying it got called");
+}
+
 #endif /* DISABLE_JOURNAL */
@@ -92,16 +92,29 @@ void     tracker_data_update_sparql                 (const gchar               *
 GVariant *
          tracker_data_update_sparql_blank           (const gchar               *update,
                                                      GError                   **error);
+void     tracker_data_update_uri_prefix             (const gchar               *old_prefix,
+                                                     const gchar               *new_prefix,
+                                                     const gchar               *update,
+                                                     GError                   **error);
+void     tracker_data_delete_descendants            (const gchar               *url,
+                                                     GError                   **error);
 void     tracker_data_update_buffer_flush           (GError                   **error);
 void     tracker_data_update_buffer_might_flush     (GError                   **error);
 void     tracker_data_load_turtle_file              (GFile                     *file,
                                                      GError                   **error);
 
 void     tracker_data_sync                          (void);
+gboolean tracker_data_statistics_outdated           (void);
+void     tracker_data_update_statistics             (void);
 void     tracker_data_replay_journal                (TrackerBusyCallback        busy_callback,
                                                      gpointer                   busy_user_data,
                                                      const gchar               *busy_status,
                                                      GError                   **error);
+void     tracker_data_replay_journal_from           (gsize                      offset,
+                                                     TrackerBusyCallback        busy_callback,
+                                                     gpointer                   busy_user_data,
+                                                     const gchar               *busy_status,
+                                                     GError                   **error);
 
 /* Calling back */
 void     tracker_data_add_insert_statement_callback      (TrackerStatementCallback   callback,
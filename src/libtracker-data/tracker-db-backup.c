@@ -36,8 +36,15 @@
 
 #define TRACKER_DB_BACKUP_META_FILENAME_T	"meta-backup.db.tmp"
 
+/* Pages copied per backup step, for progress reporting */
+#define BACKUP_STEP_PAGES	256
+
+/* Milliseconds to wait before retrying a step on a locked database */
+#define BACKUP_BUSY_SLEEP	100
+
 typedef struct {
 	GFile *destination;
+	sqlite3 *src_db;
 	TrackerDBBackupFinished callback;
 	gpointer user_data;
 	GDestroyNotify destroy;
@@ -71,6 +78,10 @@ backup_info_free (gpointer user_data)
 		g_object_unref (info->destination);
 	}
 
+	if (info->src_db) {
+		sqlite3_close (info->src_db);
+	}
+
 	if (info->destroy) {
 		info->destroy (info->user_data);
 	}
@@ -92,7 +103,7 @@ backup_job (GTask        *task,
 	GFile *parent_file, *temp_file;
 	gchar *temp_path;
 
-	sqlite3 *src_db = NULL;
+	sqlite3 *src_db = info->src_db;
 	sqlite3 *temp_db = NULL;
 	sqlite3_backup *backup = NULL;
 
@@ -102,11 +113,6 @@ backup_job (GTask        *task,
 	g_file_delete (temp_file, NULL, NULL);
 	temp_path = g_file_get_path (temp_file);
 
-	if (sqlite3_open_v2 (src_path, &src_db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
-		g_set_error (&info->error, TRACKER_DB_BACKUP_ERROR, TRACKER_DB_BACKUP_ERROR_UNKNOWN,
-		             "Could not open sqlite3 database:'%s'", src_path);
-	}
-
 	if (!info->error && sqlite3_open (temp_path, &temp_db) != SQLITE_OK) {
 		g_set_error (&info->error, TRACKER_DB_BACKUP_ERROR, TRACKER_DB_BACKUP_ERROR_UNKNOWN,
 		             "Could not open sqlite3 database:'%s'", temp_path);
@@ -121,9 +127,35 @@ backup_job (GTask        *task,
 		}
 	}
 
-	if (!info->error && sqlite3_backup_step (backup, -1) != SQLITE_DONE) {
-		g_set_error (&info->error, TRACKER_DB_BACKUP_ERROR, TRACKER_DB_BACKUP_ERROR_UNKNOWN,
-		             "Unable to complete sqlite3 backup");
+	while (!info->error) {
+		gint rc, remaining, page_count;
+
+		rc = sqlite3_backup_step (backup, BACKUP_STEP_PAGES);
+
+		if (rc == SQLITE_DONE) {
+			break;
+		} else if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+			sqlite3_sleep (BACKUP_BUSY_SLEEP);
+			continue;
+		} else if (rc != SQLITE_OK) {
+			g_set_error (&info->error, TRACKER_DB_BACKUP_ERROR, TRACKER_DB_BACKUP_ERROR_UNKNOWN,
+			             "Unable to complete sqlite3 backup");
+			break;
+		}
+
+		remaining = sqlite3_backup_remaining (backup);
+		page_count = sqlite3_backup_pagecount (backup);
+
+		g_debug ("Backup progress: %d of %d pages copied",
+		         page_count - remaining, page_count);
+	}
+
+	/* Every page is in the copy now, end the read transaction
+	 * before the copy is synced and moved in place, so WAL
+	 * checkpoints don't wait for that.
+	 */
+	if (src_db) {
+		sqlite3_exec (src_db, "COMMIT", NULL, NULL, NULL);
 	}
 
 	if (backup) {
@@ -148,7 +180,7 @@ backup_job (GTask        *task,
 
 	if (src_db) {
 		sqlite3_close (src_db);
-		src_db = NULL;
+		info->src_db = NULL;
 	}
 
 	if (!info->error) {
@@ -166,6 +198,14 @@ backup_job (GTask        *task,
 	                 backup_info_free);
 }
 
+/* The copy is made from a read transaction started right away, so
+ * it holds the database as it is when this is called. Updates can go
+ * on meanwhile, in WAL mode they neither change the copy nor make it
+ * start over. The read transaction pins the WAL, so it only lasts
+ * until the pages are copied. A copy without it would restart on
+ * every update and hold a later state than the journal offset the
+ * caller recorded along with it.
+ */
 void
 tracker_db_backup_save (GFile                   *destination,
                         TrackerDBBackupFinished  callback,
@@ -174,6 +214,7 @@ tracker_db_backup_save (GFile                   *destination,
 {
 	GTask *task;
 	BackupInfo *info;
+	const gchar *src_path;
 
 	info = g_slice_new0 (BackupInfo);
 
@@ -183,6 +224,16 @@ tracker_db_backup_save (GFile                   *destination,
 	info->user_data = user_data;
 	info->destroy = destroy;
 
+	src_path = tracker_db_manager_get_file (TRACKER_DB_METADATA);
+
+	if (sqlite3_open_v2 (src_path, &info->src_db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK ||
+	    sqlite3_exec (info->src_db,
+	                  "BEGIN; SELECT COUNT(*) FROM sqlite_master",
+	                  NULL, NULL, NULL) != SQLITE_OK) {
+		g_set_error (&info->error, TRACKER_DB_BACKUP_ERROR, TRACKER_DB_BACKUP_ERROR_UNKNOWN,
+		             "Could not open sqlite3 database:'%s'", src_path);
+	}
+
 	task = g_task_new (NULL, NULL, NULL, NULL);
 
 	g_task_set_task_data (task, info, NULL);
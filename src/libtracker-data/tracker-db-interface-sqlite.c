@@ -54,6 +54,17 @@
 
 #define UNKNOWN_STATUS 0.5
 
+/* Milliseconds a statement waits on a locked database before failing */
+#define BUSY_TIMEOUT 100000
+
+/* SQLITE_STMTSTATUS_VM_STEP is only available with SQLite >= 3.20, older
+ * versions can at least tell how many rows were visited in full scans */
+#ifdef SQLITE_STMTSTATUS_VM_STEP
+#define STMT_STATUS_STEPS SQLITE_STMTSTATUS_VM_STEP
+#else
+#define STMT_STATUS_STEPS SQLITE_STMTSTATUS_FULLSCAN_STEP
+#endif
+
 typedef struct {
 	TrackerDBStatement *head;
 	TrackerDBStatement *tail;
@@ -105,6 +116,12 @@ struct TrackerDBCursor {
 	gchar **variable_names;
 	gint n_variable_names;
 
+	/* profiling counters, see tracker_db_cursor_get_n_rows() */
+	guint n_rows;
+	gint vm_steps_start;
+	gint vm_steps;
+	gint64 step_time;
+
 	/* used for direct access as libtracker-sparql is thread-safe and
 	   uses a single shared connection with SQLite mutex disabled */
 	gboolean threadsafe;
@@ -891,7 +908,7 @@ open_database (TrackerDBInterface  *db_interface,
 	                         NULL, NULL);
 
 	sqlite3_extended_result_codes (db_interface->db, 0);
-	sqlite3_busy_timeout (db_interface->db, 100000);
+	sqlite3_busy_timeout (db_interface->db, BUSY_TIMEOUT);
 }
 
 static gboolean
@@ -1202,6 +1219,57 @@ tracker_db_interface_sqlite_wal_hook (TrackerDBInterface   *interface,
 	sqlite3_wal_hook (interface->db, wal_hook, callback);
 }
 
+/* Full and restart checkpoints wait for readers, and block writers
+ * while doing so, for as long as the busy timeout lets them. Here that
+ * wait is bounded to @timeout milliseconds, past that the checkpoint
+ * copies back what it can and FALSE is returned, without setting
+ * @error, which is only set on actual failures.
+ */
+gboolean
+tracker_db_interface_sqlite_wal_checkpoint (TrackerDBInterface       *interface,
+                                            TrackerDBCheckpointMode   mode,
+                                            gint                      timeout,
+                                            gint                     *log_pages,
+                                            gint                     *checkpointed,
+                                            GError                  **error)
+{
+	static const gint sqlite_modes[] = {
+		SQLITE_CHECKPOINT_PASSIVE,
+		SQLITE_CHECKPOINT_FULL,
+		SQLITE_CHECKPOINT_RESTART
+	};
+	gint n_log = 0, n_checkpointed = 0;
+	gint result;
+
+	g_return_val_if_fail (mode <= TRACKER_DB_CHECKPOINT_RESTART, FALSE);
+
+	sqlite3_busy_timeout (interface->db, timeout);
+	result = sqlite3_wal_checkpoint_v2 (interface->db, NULL, sqlite_modes[mode],
+	                                    &n_log, &n_checkpointed);
+	sqlite3_busy_timeout (interface->db, BUSY_TIMEOUT);
+
+	if (log_pages) {
+		*log_pages = n_log;
+	}
+
+	if (checkpointed) {
+		*checkpointed = n_checkpointed;
+	}
+
+	if (result == SQLITE_BUSY) {
+		return FALSE;
+	} else if (result != SQLITE_OK) {
+		g_set_error (error,
+		             TRACKER_DB_INTERFACE_ERROR,
+		             TRACKER_DB_QUERY_ERROR,
+		             "%s",
+		             sqlite3_errmsg (interface->db));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 
 static void
 tracker_db_interface_sqlite_finalize (GObject *object)
@@ -1668,6 +1736,14 @@ tracker_db_interface_sqlite_get_last_insert_id (TrackerDBInterface *interface)
 	return (gint64) sqlite3_last_insert_rowid (interface->db);
 }
 
+gint
+tracker_db_interface_sqlite_get_changes (TrackerDBInterface *interface)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_INTERFACE (interface), 0);
+
+	return sqlite3_changes (interface->db);
+}
+
 static void
 tracker_db_statement_finalize (GObject *object)
 {
@@ -1734,6 +1810,9 @@ tracker_db_cursor_close (TrackerDBCursor *cursor)
 		tracker_db_manager_lock ();
 	}
 
+	/* the statement may be finalized along with ref_stmt */
+	cursor->vm_steps = sqlite3_stmt_status (cursor->stmt, STMT_STATUS_STEPS, FALSE) - cursor->vm_steps_start;
+
 	cursor->ref_stmt->stmt_is_sunk = FALSE;
 	tracker_db_statement_sqlite_reset (cursor->ref_stmt);
 	g_object_unref (cursor->ref_stmt);
@@ -1881,6 +1960,10 @@ tracker_db_cursor_sqlite_new (sqlite3_stmt        *sqlite_stmt,
 	ref_stmt->stmt_is_sunk = TRUE;
 	cursor->ref_stmt = g_object_ref (ref_stmt);
 
+	/* statement status counters accumulate over all uses of a cached
+	   statement, remember where this cursor started */
+	cursor->vm_steps_start = sqlite3_stmt_status (sqlite_stmt, STMT_STATUS_STEPS, FALSE);
+
 	if (types) {
 		gint i;
 
@@ -1996,12 +2079,20 @@ db_cursor_iter_next (TrackerDBCursor *cursor,
 			result = SQLITE_INTERRUPT;
 			sqlite3_reset (cursor->stmt);
 		} else {
+			gint64 start;
+
 			/* only one statement can be active at the same time per interface */
 			iface->cancellable = cancellable;
+			start = g_get_monotonic_time ();
 			result = stmt_step (cursor->stmt);
+			cursor->step_time += g_get_monotonic_time () - start;
 			iface->cancellable = NULL;
 		}
 
+		if (result == SQLITE_ROW) {
+			cursor->n_rows++;
+		}
+
 		if (result == SQLITE_INTERRUPT) {
 			g_set_error (error,
 			             TRACKER_DB_INTERFACE_ERROR,
@@ -2024,6 +2115,48 @@ db_cursor_iter_next (TrackerDBCursor *cursor,
 	return (!cursor->finished);
 }
 
+guint
+tracker_db_cursor_get_n_rows (TrackerDBCursor *cursor)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_CURSOR (cursor), 0);
+
+	return cursor->n_rows;
+}
+
+gint
+tracker_db_cursor_get_vm_steps (TrackerDBCursor *cursor)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_CURSOR (cursor), 0);
+
+	if (cursor->ref_stmt == NULL) {
+		/* already closed */
+		return cursor->vm_steps;
+	}
+
+	return sqlite3_stmt_status (cursor->stmt, STMT_STATUS_STEPS, FALSE) - cursor->vm_steps_start;
+}
+
+gint64
+tracker_db_cursor_get_step_time (TrackerDBCursor *cursor)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_CURSOR (cursor), 0);
+
+	return cursor->step_time;
+}
+
+const gchar *
+tracker_db_cursor_get_sql (TrackerDBCursor *cursor)
+{
+	g_return_val_if_fail (TRACKER_IS_DB_CURSOR (cursor), NULL);
+
+	if (cursor->ref_stmt == NULL) {
+		/* already closed */
+		return NULL;
+	}
+
+	return sqlite3_sql (cursor->stmt);
+}
+
 guint
 tracker_db_cursor_get_n_columns (TrackerDBCursor *cursor)
 {
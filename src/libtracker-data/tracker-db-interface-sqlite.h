@@ -34,11 +34,18 @@ G_BEGIN_DECLS
 
 typedef void (*TrackerDBWalCallback) (gint n_pages);
 
+typedef enum {
+	TRACKER_DB_CHECKPOINT_PASSIVE,
+	TRACKER_DB_CHECKPOINT_FULL,
+	TRACKER_DB_CHECKPOINT_RESTART
+} TrackerDBCheckpointMode;
+
 TrackerDBInterface *tracker_db_interface_sqlite_new                    (const gchar              *filename,
                                                                         GError                  **error);
 TrackerDBInterface *tracker_db_interface_sqlite_new_ro                 (const gchar              *filename,
                                                                         GError                  **error);
 gint64              tracker_db_interface_sqlite_get_last_insert_id     (TrackerDBInterface       *interface);
+gint                tracker_db_interface_sqlite_get_changes            (TrackerDBInterface       *interface);
 void                tracker_db_interface_sqlite_enable_shared_cache    (void);
 void                tracker_db_interface_sqlite_fts_init               (TrackerDBInterface       *interface,
                                                                         GHashTable               *properties,
@@ -47,6 +54,12 @@ void                tracker_db_interface_sqlite_fts_init               (TrackerD
 void                tracker_db_interface_sqlite_reset_collator         (TrackerDBInterface       *interface);
 void                tracker_db_interface_sqlite_wal_hook               (TrackerDBInterface       *interface,
                                                                         TrackerDBWalCallback      callback);
+gboolean            tracker_db_interface_sqlite_wal_checkpoint         (TrackerDBInterface       *interface,
+                                                                        TrackerDBCheckpointMode   mode,
+                                                                        gint                      timeout,
+                                                                        gint                     *log_pages,
+                                                                        gint                     *checkpointed,
+                                                                        GError                  **error);
 
 #if HAVE_TRACKER_FTS
 void                tracker_db_interface_sqlite_fts_alter_table        (TrackerDBInterface       *interface,
@@ -142,6 +142,10 @@ gboolean                tracker_db_cursor_iter_next                  (TrackerDBC
                                                                       GCancellable               *cancellable,
                                                                       GError                    **error);
 guint                   tracker_db_cursor_get_n_columns              (TrackerDBCursor            *cursor);
+guint                   tracker_db_cursor_get_n_rows                 (TrackerDBCursor            *cursor);
+gint                    tracker_db_cursor_get_vm_steps               (TrackerDBCursor            *cursor);
+gint64                  tracker_db_cursor_get_step_time              (TrackerDBCursor            *cursor);
+const gchar*            tracker_db_cursor_get_sql                    (TrackerDBCursor            *cursor);
 const gchar*            tracker_db_cursor_get_variable_name          (TrackerDBCursor            *cursor,
                                                                       guint                       column);
 TrackerSparqlValueType  tracker_db_cursor_get_value_type             (TrackerDBCursor            *cursor,
@@ -50,11 +50,14 @@
 /*
  * data_format:
  * #... 0000 0000 (total size is 4 bytes)
- *         | |||`- resource insert (all other bits must be 0 if 1)
- *         | ||`-- object type (1 = id, 0 = cstring)
- *         | |`--- operation type (0 = insert, 1 = delete)
- *         | `---- graph (0 = default graph, 1 = named graph)
- *         `------ update (0 = insert, 1 = update)
+ *        || |||`- resource insert (all other bits must be 0 if 1)
+ *        || ||`-- object type (1 = id, 0 = cstring)
+ *        || |`--- operation type (0 = insert, 1 = delete)
+ *        || `---- graph (0 = default graph, 1 = named graph)
+ *        |`------ update (0 = insert, 1 = update)
+ *        `------- uri prefix update or, with the delete bit, delete
+ *                 of the contents of a container (all other bits must
+ *                 be 0 if 1)
  */
 
 typedef enum {
@@ -62,7 +65,8 @@ typedef enum {
 	DATA_FORMAT_OBJECT_ID        = 1 << 1,
 	DATA_FORMAT_OPERATION_DELETE = 1 << 2,
 	DATA_FORMAT_GRAPH            = 1 << 3,
-	DATA_FORMAT_OPERATION_UPDATE = 1 << 4
+	DATA_FORMAT_OPERATION_UPDATE = 1 << 4,
+	DATA_FORMAT_URI_PREFIX       = 1 << 5
 } DataFormat;
 
 typedef enum {
@@ -1105,6 +1109,83 @@ tracker_db_journal_append_resource (gint         s_id,
 	return ret;
 }
 
+static gboolean
+db_journal_writer_append_uri_prefix (JournalWriter *jwriter,
+                                     const gchar   *old_prefix,
+                                     const gchar   *new_prefix)
+{
+	gint old_len, new_len;
+	DataFormat df;
+	gint size;
+
+	g_return_val_if_fail (jwriter->journal > 0, FALSE);
+	g_return_val_if_fail (old_prefix != NULL, FALSE);
+	g_return_val_if_fail (new_prefix != NULL, FALSE);
+
+	old_len = strlen (old_prefix);
+	new_len = strlen (new_prefix);
+	df = DATA_FORMAT_URI_PREFIX;
+	size = sizeof (guint32) + old_len + 1 + new_len + 1;
+
+	cur_block_maybe_expand (jwriter, size);
+
+	cur_setnum (jwriter->cur_block, &(jwriter->cur_pos), df);
+	cur_setstr (jwriter->cur_block, &(jwriter->cur_pos), old_prefix, old_len);
+	cur_setstr (jwriter->cur_block, &(jwriter->cur_pos), new_prefix, new_len);
+
+	jwriter->cur_entry_amount++;
+	jwriter->cur_block_len += size;
+
+	return TRUE;
+}
+
+gboolean
+tracker_db_journal_append_uri_prefix (const gchar *old_prefix,
+                                      const gchar *new_prefix)
+{
+	if (current_transaction_format == TRANSACTION_FORMAT_ONTOLOGY) {
+		return TRUE;
+	}
+
+	return db_journal_writer_append_uri_prefix (&writer, old_prefix, new_prefix);
+}
+
+static gboolean
+db_journal_writer_append_delete_descendants (JournalWriter *jwriter,
+                                             const gchar   *url)
+{
+	gint url_len;
+	DataFormat df;
+	gint size;
+
+	g_return_val_if_fail (jwriter->journal > 0, FALSE);
+	g_return_val_if_fail (url != NULL, FALSE);
+
+	url_len = strlen (url);
+	df = DATA_FORMAT_URI_PREFIX | DATA_FORMAT_OPERATION_DELETE;
+	size = sizeof (guint32) + url_len + 1;
+
+	cur_block_maybe_expand (jwriter, size);
+
+	cur_setnum (jwriter->cur_block, &(jwriter->cur_pos), df);
+	cur_setstr (jwriter->cur_block, &(jwriter->cur_pos), url, url_len);
+
+	jwriter->cur_entry_amount++;
+	jwriter->cur_block_len += size;
+
+	return TRUE;
+}
+
+gboolean
+tracker_db_journal_append_delete_descendants (const gchar *url)
+{
+	if (current_transaction_format == TRANSACTION_FORMAT_ONTOLOGY) {
+		return TRUE;
+	}
+
+	return db_journal_writer_append_delete_descendants (&writer, url);
+}
+
 gboolean
 tracker_db_journal_rollback_transaction (GError **error)
 {
@@ -1440,6 +1521,49 @@ tracker_db_journal_reader_ontology_init (const gchar  *filename,
 	return result;
 }
 
+/* Moves the reader to @offset in the journal file, which must be the
+ * end of a transaction, so replaying can resume from a database
+ * snapshot taken at that point. Only the active journal file can be
+ * skipped into, not rotated chunks.
+ */
+gboolean
+tracker_db_journal_reader_skip_to (gsize    offset,
+                                   GError **error)
+{
+	guint32 entry_size;
+
+	g_return_val_if_fail (reader.file != NULL || reader.stream != NULL, FALSE);
+
+	if (reader.stream || reader.current_file != 0 ||
+	    reader.type != TRACKER_DB_JOURNAL_START ||
+	    offset < (gsize) (reader.current - reader.start) ||
+	    offset > (gsize) (reader.end - reader.start)) {
+		g_set_error (error, TRACKER_DB_JOURNAL_ERROR,
+		             TRACKER_DB_JOURNAL_ERROR_UNKNOWN,
+		             "Can not skip to offset %" G_GSIZE_FORMAT " of journal '%s'",
+		             offset, reader.filename);
+		return FALSE;
+	}
+
+	if (offset > (gsize) (reader.current - reader.start)) {
+		/* The redundant entry size must point back past the header */
+		entry_size = read_uint32 (reader.start + offset - 4);
+
+		if (entry_size < 5 * sizeof (guint32) ||
+		    offset - entry_size < (gsize) (reader.current - reader.start)) {
+			g_set_error (error, TRACKER_DB_JOURNAL_ERROR,
+			             TRACKER_DB_JOURNAL_ERROR_DAMAGED_JOURNAL_ENTRY,
+			             "Damaged journal entry before offset %" G_GSIZE_FORMAT,
+			             offset);
+			return FALSE;
+		}
+	}
+
+	reader.current = reader.last_success = reader.start + offset;
+
+	return TRUE;
+}
+
 gsize
 tracker_db_journal_reader_get_size_of_correct (void)
 {
@@ -1779,6 +1903,28 @@ db_journal_reader_next (JournalReader *jreader, gboolean global_reader, GError *
 				return FALSE;
 			}
 
+			jreader->uri = journal_read_string (jreader, &inner_error);
+			if (inner_error) {
+				g_propagate_error (error, inner_error);
+				return FALSE;
+			}
+		} else if (df == DATA_FORMAT_URI_PREFIX) {
+			jreader->type = TRACKER_DB_JOURNAL_UPDATE_URI_PREFIX;
+
+			jreader->uri = journal_read_string (jreader, &inner_error);
+			if (inner_error) {
+				g_propagate_error (error, inner_error);
+				return FALSE;
+			}
+
+			jreader->object = journal_read_string (jreader, &inner_error);
+			if (inner_error) {
+				g_propagate_error (error, inner_error);
+				return FALSE;
+			}
+		} else if (df == (DATA_FORMAT_URI_PREFIX | DATA_FORMAT_OPERATION_DELETE)) {
+			jreader->type = TRACKER_DB_JOURNAL_DELETE_DESCENDANTS;
+
 			jreader->uri = journal_read_string (jreader, &inner_error);
 			if (inner_error) {
 				g_propagate_error (error, inner_error);
@@ -1955,6 +2101,30 @@ tracker_db_journal_reader_get_statement_id (gint *g_id,
 	return TRUE;
 }
 
+gboolean
+tracker_db_journal_reader_get_uri_prefix (const gchar **old_prefix,
+                                          const gchar **new_prefix)
+{
+	g_return_val_if_fail (reader.file != NULL || reader.stream != NULL, FALSE);
+	g_return_val_if_fail (reader.type == TRACKER_DB_JOURNAL_UPDATE_URI_PREFIX, FALSE);
+
+	*old_prefix = reader.uri;
+	*new_prefix = reader.object;
+
+	return TRUE;
+}
+
+gboolean
+tracker_db_journal_reader_get_descendants (const gchar **url)
+{
+	g_return_val_if_fail (reader.file != NULL || reader.stream != NULL, FALSE);
+	g_return_val_if_fail (reader.type == TRACKER_DB_JOURNAL_DELETE_DESCENDANTS, FALSE);
+
+	*url = reader.uri;
+
+	return TRUE;
+}
+
 gdouble
 tracker_db_journal_reader_get_progress (void)
 {
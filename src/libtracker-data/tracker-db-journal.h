@@ -52,6 +52,8 @@ typedef enum {
 	TRACKER_DB_JOURNAL_DELETE_STATEMENT_ID,
 	TRACKER_DB_JOURNAL_UPDATE_STATEMENT,
 	TRACKER_DB_JOURNAL_UPDATE_STATEMENT_ID,
+	TRACKER_DB_JOURNAL_UPDATE_URI_PREFIX,
+	TRACKER_DB_JOURNAL_DELETE_DESCENDANTS,
 } TrackerDBJournalEntryType;
 
 GQuark       tracker_db_journal_error_quark                  (void);
@@ -105,6 +107,9 @@ gboolean     tracker_db_journal_append_update_statement_id   (gint         g_id,
                                                               gint         o_id);
 gboolean     tracker_db_journal_append_resource              (gint         s_id,
                                                               const gchar *uri);
+gboolean     tracker_db_journal_append_uri_prefix            (const gchar *old_prefix,
+                                                              const gchar *new_prefix);
+gboolean     tracker_db_journal_append_delete_descendants    (const gchar *url);
 
 gboolean     tracker_db_journal_rollback_transaction         (GError **error);
 gboolean     tracker_db_journal_commit_db_transaction        (GError **error);
@@ -135,6 +140,11 @@ gboolean     tracker_db_journal_reader_get_statement_id      (gint         *g_id
                                                               gint         *s_id,
                                                               gint         *p_id,
                                                               gint         *o_id);
+gboolean     tracker_db_journal_reader_get_uri_prefix        (const gchar **old_prefix,
+                                                              const gchar **new_prefix);
+gboolean     tracker_db_journal_reader_get_descendants       (const gchar **url);
+gboolean     tracker_db_journal_reader_skip_to               (gsize         offset,
+                                                              GError      **error);
 gsize        tracker_db_journal_reader_get_size_of_correct   (void);
 gdouble      tracker_db_journal_reader_get_progress          (void);
 
@@ -159,6 +159,7 @@ static gchar                *user_data_dir = NULL;
 static gchar                *in_use_filename = NULL;
 static gpointer              db_type_enum_class_pointer;
 static TrackerDBManagerFlags old_flags = 0;
+static gboolean              unclean_shutdown = FALSE;
 static guint                 s_cache_size;
 static guint                 u_cache_size;
 
@@ -866,6 +867,8 @@ tracker_db_manager_init (TrackerDBManagerFlags   flags,
 	TrackerDBInterface *resources_iface;
 	GError *internal_error = NULL;
 
+	unclean_shutdown = FALSE;
+
 	/* First set defaults for return values */
 	if (first_time) {
 		*first_time = FALSE;
@@ -1043,6 +1046,7 @@ tracker_db_manager_init (TrackerDBManagerFlags   flags,
 			gsize size = 0;
 
 			g_message ("Didn't shut down cleanly last time, doing integrity checks");
+			unclean_shutdown = TRUE;
 
 			for (i = 1; i < G_N_ELEMENTS (dbs) && !must_recreate; i++) {
 				struct stat st;
@@ -1559,6 +1563,22 @@ tracker_db_manager_get_first_index_done (void)
 	return exists;
 }
 
+/**
+ * tracker_db_manager_get_unclean_shutdown:
+ *
+ * Check if the databases were left in use by a crash or any other
+ * uncontrolled shutdown, as found by the last tracker_db_manager_init().
+ *
+ * Returns: %TRUE if the last shutdown was unclean, %FALSE otherwise.
+ *
+ * Since: 0.18
+ **/
+gboolean
+tracker_db_manager_get_unclean_shutdown (void)
+{
+	return unclean_shutdown;
+}
+
 /**
  * tracker_db_manager_set_first_index_done:
  *
@@ -52,6 +52,7 @@ struct _TrackerPropertyPrivate {
 	TrackerClass   *domain_index;
 	TrackerClass   *range;
 	gint           weight;
+	gint           count;
 	gint           id;
 	gboolean       indexed;
 	TrackerProperty *secondary_index;
@@ -421,6 +422,18 @@ tracker_property_get_weight (TrackerProperty *property)
 	return priv->weight;
 }
 
+gint
+tracker_property_get_count (TrackerProperty *property)
+{
+	TrackerPropertyPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_PROPERTY (property), 0);
+
+	priv = GET_PRIV (property);
+
+	return priv->count;
+}
+
 gint
 tracker_property_get_id (TrackerProperty *property)
 {
@@ -831,6 +844,18 @@ tracker_property_set_weight (TrackerProperty *property,
 	priv->weight = value;
 }
 
+void
+tracker_property_set_count (TrackerProperty *property,
+                            gint             value)
+{
+	TrackerPropertyPrivate *priv;
+	g_return_if_fail (TRACKER_IS_PROPERTY (property));
+
+	priv = GET_PRIV (property);
+
+	priv->count = value;
+}
+
 
 void
 tracker_property_set_id (TrackerProperty *property,
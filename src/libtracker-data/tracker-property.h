@@ -82,6 +82,7 @@ TrackerClass *      tracker_property_get_domain              (TrackerProperty
 TrackerClass *      tracker_property_get_range               (TrackerProperty      *property);
 TrackerClass **     tracker_property_get_domain_indexes      (TrackerProperty      *property);
 gint                tracker_property_get_weight              (TrackerProperty      *property);
+gint                tracker_property_get_count               (TrackerProperty      *property);
 gint                tracker_property_get_id                  (TrackerProperty      *property);
 gboolean            tracker_property_get_indexed             (TrackerProperty      *property);
 TrackerProperty *   tracker_property_get_secondary_index     (TrackerProperty      *property);
@@ -112,6 +113,8 @@ void                tracker_property_set_range               (TrackerProperty
                                                               TrackerClass         *range);
 void                tracker_property_set_weight              (TrackerProperty      *property,
                                                               gint                  value);
+void                tracker_property_set_count               (TrackerProperty      *property,
+                                                              gint                  value);
 void                tracker_property_set_id                  (TrackerProperty      *property,
                                                               gint                  value);
 void                tracker_property_set_indexed             (TrackerProperty      *property,
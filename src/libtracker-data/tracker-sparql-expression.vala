@@ -60,6 +60,14 @@ class Tracker.Sparql.Expression : Object {
 		return query.get_error (msg);
 	}
 
+	SourceLocation get_location () {
+		return query.get_location ();
+	}
+
+	void set_location (SourceLocation location) {
+		query.set_location (location);
+	}
+
 	bool expect (SparqlTokenType type) throws Sparql.Error {
 		return query.expect (type);
 	}
@@ -287,27 +295,351 @@ class Tracker.Sparql.Expression : Object {
 		return type;
 	}
 
+	// Returns the string literal at the current position if it forms
+	// a complete function argument, without consuming it.
+	string? peek_string_literal_argument () throws Sparql.Error {
+		switch (current ()) {
+		case SparqlTokenType.STRING_LITERAL1:
+		case SparqlTokenType.STRING_LITERAL2:
+		case SparqlTokenType.STRING_LITERAL_LONG1:
+		case SparqlTokenType.STRING_LITERAL_LONG2:
+			break;
+		default:
+			return null;
+		}
+
+		var location = get_location ();
+		PropertyType type;
+		string literal = parse_string_literal (out type);
+		bool complete = (type == PropertyType.STRING
+		                 && (current () == SparqlTokenType.COMMA || current () == SparqlTokenType.CLOSE_PARENS));
+		set_location (location);
+
+		return complete ? literal : null;
+	}
+
+	// Returns the string variable at the current position if it forms
+	// a complete function argument, without consuming it.
+	Variable? peek_string_variable_argument () throws Sparql.Error {
+		if (current () != SparqlTokenType.VAR) {
+			return null;
+		}
+
+		var location = get_location ();
+		next ();
+		var variable = context.get_variable (get_last_string ().substring (1));
+		bool complete = (current () == SparqlTokenType.COMMA || current () == SparqlTokenType.CLOSE_PARENS);
+		set_location (location);
+
+		if (!complete || variable.binding == null || variable.binding.data_type != PropertyType.STRING) {
+			return null;
+		}
+
+		return variable;
+	}
+
+	// Restricts a URI hierarchy check to the index range of URIs below
+	// any of the given parents, the function only checks what is left
+	void append_uri_prefix_range (StringBuilder sql, Variable child, string[] parents) {
+		string[] prefixes = {};
+
+		foreach (string parent in parents) {
+			// same normalization as SparqlUriIsParent/SparqlUriIsDescendant
+			string prefix = parent;
+			while (prefix.has_suffix ("/")) {
+				prefix = prefix.substring (0, prefix.length - 1);
+			}
+
+			prefix = get_collation_safe_prefix (prefix + "/");
+			if (prefix == null) {
+				// no range covers all URIs below this parent
+				return;
+			}
+
+			prefixes += prefix;
+		}
+
+		sql.append (" AND (");
+		for (int i = 0; i < prefixes.length; i++) {
+			if (i > 0) {
+				sql.append (" OR ");
+			}
+
+			sql.append ("(");
+			sql.append (child.sql_expression);
+			append_collate (sql);
+			sql.append (" BETWEEN ? AND ?)");
+
+			var binding = new LiteralBinding ();
+			binding.literal = prefixes[i];
+			query.bindings.append (binding);
+
+			binding = new LiteralBinding ();
+			binding.literal = prefixes[i] + COLLATION_LAST_CHAR.to_string ();
+			query.bindings.append (binding);
+		}
+		sql.append (")");
+	}
+
+	// Decodes a token created by Sparql.Cursor.get_continuation_token,
+	// null values stand for unbound sort keys.
+	string?[] parse_continuation_token (string token) throws Sparql.Error {
+		string?[] values = {};
+
+		try {
+			uchar[] data = Base64.decode (token);
+			var variant = Variant.parse (new VariantType ("ams"), ((string) data).ndup (data.length));
+
+			for (size_t i = 0; i < variant.n_children (); i++) {
+				var value = variant.get_child_value (i).get_maybe ();
+				values += (value != null) ? value.get_string () : null;
+			}
+		} catch (VariantParseError e) {
+			throw get_error ("invalid continuation token");
+		}
+
+		return values;
+	}
+
+	PropertyType translate_continuation_key (StringBuilder sql, SourceLocation key) throws Sparql.Error {
+		set_location (key);
+		return translate_expression (sql);
+	}
+
+	void append_continuation_value (StringBuilder sql, string value, PropertyType type) {
+		var binding = new LiteralBinding ();
+		binding.literal = value;
+
+		switch (type) {
+		case PropertyType.RESOURCE:
+			// sort keys are compared by ID, the token holds the URI
+			sql.append ("(SELECT ID FROM Resource WHERE Uri = ?)");
+			break;
+		case PropertyType.INTEGER:
+		case PropertyType.BOOLEAN:
+		case PropertyType.DOUBLE:
+		case PropertyType.DATE:
+		case PropertyType.DATETIME:
+			binding.data_type = type;
+			sql.append ("?");
+			break;
+		default:
+			sql.append ("?");
+			break;
+		}
+
+		query.bindings.append (binding);
+	}
+
+	// (k1, ..., kn) > (v1, ..., vn) in ascending order with NULL first,
+	// written as k1 >= v1 AND (k1 > v1 OR ...) so that an index on the
+	// first key gives a range scan. Descending keys compare the other
+	// way, with NULL last.
+	void translate_continuation_condition (StringBuilder sql, SourceLocation[] keys, bool[] descending, string?[] values, int i) throws Sparql.Error {
+		bool last_key = (i == keys.length - 1);
+
+		sql.append ("(");
+		if (values[i] == null && !descending[i]) {
+			translate_continuation_key (sql, keys[i]);
+			sql.append (" IS NOT NULL");
+
+			if (!last_key) {
+				sql.append (" OR ");
+				translate_continuation_condition (sql, keys, descending, values, i + 1);
+			}
+		} else if (values[i] == null) {
+			if (last_key) {
+				// nothing sorts after NULL
+				sql.append ("0");
+			} else {
+				translate_continuation_key (sql, keys[i]);
+				sql.append (" IS NULL AND ");
+				translate_continuation_condition (sql, keys, descending, values, i + 1);
+			}
+		} else {
+			string op = descending[i] ? "<" : ">";
+
+			if (last_key) {
+				var type = translate_continuation_key (sql, keys[i]);
+				sql.append_printf (" %s ", op);
+				append_continuation_value (sql, values[i], type);
+			} else {
+				var type = translate_continuation_key (sql, keys[i]);
+				sql.append_printf (" %s= ", op);
+				append_continuation_value (sql, values[i], type);
+
+				sql.append (" AND (");
+				translate_continuation_key (sql, keys[i]);
+				sql.append_printf (" %s ", op);
+				append_continuation_value (sql, values[i], type);
+
+				sql.append (" OR ");
+				translate_continuation_condition (sql, keys, descending, values, i + 1);
+				sql.append (")");
+			}
+
+			if (descending[i]) {
+				sql.append (" OR ");
+				translate_continuation_key (sql, keys[i]);
+				sql.append (" IS NULL");
+			}
+		}
+		sql.append (")");
+	}
+
+	// Returns the literal text a regular expression anchored at the start
+	// must begin with, or null if there is none. exact is set if the
+	// expression is anchored at both ends and matches nothing but that text.
+	static string? get_regex_literal_prefix (string regex, out bool exact) {
+		exact = false;
+
+		if (!regex.has_prefix ("^") || "|" in regex) {
+			// alternatives may match without the anchor
+			return null;
+		}
+
+		var prefix = new StringBuilder ();
+		// prefix length before the last literal, dropped again if
+		// a quantifier makes that literal optional
+		ssize_t last_literal = 0;
+		int i = 1;
+
+		while (i < regex.length) {
+			char c = regex[i];
+
+			if (c == '\\') {
+				char escaped = regex[i + 1];
+				if (escaped == '\0' || escaped.isalnum () || (uchar) escaped >= 0x80) {
+					// character classes, back references, assertions
+					break;
+				}
+				last_literal = prefix.len;
+				prefix.append_c (escaped);
+				i += 2;
+			} else if (c == '$' && i == regex.length - 1) {
+				exact = true;
+				break;
+			} else if (c == '*' || c == '?' || c == '{') {
+				prefix.truncate (last_literal);
+				break;
+			} else if (".[]()+^$".index_of_char (c) >= 0) {
+				break;
+			} else {
+				unichar literal;
+				last_literal = prefix.len;
+				regex.get_next_char (ref i, out literal);
+				prefix.append_unichar (literal);
+			}
+		}
+
+		if (prefix.len == 0) {
+			exact = false;
+			return null;
+		}
+
+		return prefix.str;
+	}
+
+	// Returns the part of a literal prefix that a BETWEEN range over
+	// the collated column can be used for, or null if there is none.
+	// Locale collations may ignore punctuation and reorder or contract
+	// letters across the end of the prefix (e.g. "ch" in Czech), so
+	// strings starting with the prefix could fall outside the range.
+	// The prefix is cut back to its leading ASCII characters, ending
+	// right after a punctuation character, where no such interaction
+	// can happen.
+	static string? get_collation_safe_prefix (string prefix) {
+		int end = 0;
+
+		for (int i = 0; i < prefix.length; i++) {
+			char c = prefix[i];
+
+			if ((uchar) c >= 0x80 || !c.isprint ()) {
+				break;
+			} else if (c.ispunct ()) {
+				end = i + 1;
+			}
+		}
+
+		if (end == 0) {
+			return null;
+		}
+
+		return prefix.substring (0, end);
+	}
+
 	void translate_regex (StringBuilder sql) throws Sparql.Error {
 		expect (SparqlTokenType.REGEX);
 		expect (SparqlTokenType.OPEN_PARENS);
-		sql.append ("SparqlRegex(");
-		translate_expression_as_string (sql);
-		sql.append (", ");
+
+		// if the text is a plain variable, its column index can narrow
+		// down anchored patterns before the regex is run
+		var variable = peek_string_variable_argument ();
+
+		var text = new StringBuilder ();
+		translate_expression_as_string (text);
 		expect (SparqlTokenType.COMMA);
 		// SQLite's sqlite3_set_auxdata doesn't work correctly with bound
 		// strings for the regex in function_sparql_regex.
 		// translate_expression (sql);
-		sql.append (escape_sql_string_literal (parse_string_literal ()));
-		sql.append (", ");
+		string regex = parse_string_literal ();
+		string flags = "";
 		if (accept (SparqlTokenType.COMMA)) {
 			// Same as above
 			// translate_expression (sql);
-			sql.append (escape_sql_string_literal (parse_string_literal ()));
-		} else {
-			sql.append ("''");
+			flags = parse_string_literal ();
 		}
-		sql.append (")");
 		expect (SparqlTokenType.CLOSE_PARENS);
+
+		string prefix = null;
+		bool exact = false;
+		if (variable != null && !("i" in flags) && !("m" in flags) && !("x" in flags)) {
+			prefix = get_regex_literal_prefix (regex, out exact);
+		}
+
+		if (prefix != null && !exact) {
+			prefix = get_collation_safe_prefix (prefix);
+		}
+
+		if (prefix != null) {
+			// index friendly range, SparqlRegex only checks the rows
+			// within it as the collation may be less strict than the regex
+			sql.append ("(");
+			sql.append (variable.sql_expression);
+			append_collate (sql);
+
+			var binding = new LiteralBinding ();
+			binding.literal = prefix;
+			query.bindings.append (binding);
+
+			if (exact) {
+				// $ also matches before a final newline
+				sql.append (" IN (?, ?)");
+				binding = new LiteralBinding ();
+				binding.literal = prefix + "\n";
+				query.bindings.append (binding);
+			} else {
+				// same range as fn:starts-with, over the safe prefix
+				sql.append (" BETWEEN ? AND ?");
+				binding = new LiteralBinding ();
+				binding.literal = prefix + COLLATION_LAST_CHAR.to_string ();
+				query.bindings.append (binding);
+			}
+
+			sql.append (" AND ");
+		}
+
+		sql.append ("SparqlRegex(");
+		sql.append (text.str);
+		sql.append (", ");
+		sql.append (escape_sql_string_literal (regex));
+		sql.append (", ");
+		sql.append (escape_sql_string_literal (flags));
+		sql.append (")");
+
+		if (prefix != null) {
+			sql.append (")");
+		}
 	}
 
 	void translate_exists (StringBuilder sql) throws Sparql.Error {
@@ -781,28 +1113,96 @@ class Tracker.Sparql.Expression : Object {
 
 			return PropertyType.STRING;
 		} else if (uri == TRACKER_NS + "uri-is-parent") {
-			sql.append ("SparqlUriIsParent(");
+			sql.append ("(SparqlUriIsParent(");
+			string parent = peek_string_literal_argument ();
 			translate_expression_as_string (sql);
 			sql.append (", ");
 			expect (SparqlTokenType.COMMA);
 
+			var child = peek_string_variable_argument ();
 			translate_expression_as_string (sql);
 			sql.append (")");
 
+			if (parent != null && child != null) {
+				append_uri_prefix_range (sql, child, { parent });
+			}
+			sql.append (")");
+
 			return PropertyType.BOOLEAN;
 		} else if (uri == TRACKER_NS + "uri-is-descendant") {
-			sql.append ("SparqlUriIsDescendant(");
+			string[] parents = {};
+			bool literal_parents = true;
+
+			sql.append ("(SparqlUriIsDescendant(");
+			string literal = peek_string_literal_argument ();
 			translate_expression_as_string (sql);
-			sql.append (", ");
 			expect (SparqlTokenType.COMMA);
 
-                        translate_expression_as_string (sql);
-                        while (accept (SparqlTokenType.COMMA)) {
-			      sql.append (", ");
-			      translate_expression_as_string (sql);
+			// the last argument is the child, all others are parents
+			Variable child = null;
+			do {
+				if (literal != null) {
+					parents += literal;
+				} else {
+					literal_parents = false;
+				}
+
+				sql.append (", ");
+				literal = peek_string_literal_argument ();
+				child = peek_string_variable_argument ();
+				translate_expression_as_string (sql);
+			} while (accept (SparqlTokenType.COMMA));
+			sql.append (")");
+
+			if (literal_parents && child != null) {
+				append_uri_prefix_range (sql, child, parents);
 			}
 			sql.append (")");
 
+			return PropertyType.BOOLEAN;
+		} else if (uri == TRACKER_NS + "continues-after") {
+			// tracker:continues-after (token, key1, ..., keyN) matches rows
+			// sorting after the row the continuation token was created for,
+			// for use with ORDER BY key1 ... keyN instead of OFFSET, keys
+			// may be wrapped in ASC () or DESC () as in ORDER BY
+			string?[] values = parse_continuation_token (parse_string_literal ());
+
+			SourceLocation[] keys = {};
+			bool[] descending = {};
+			var old_bindings = (owned) query.bindings;
+			while (accept (SparqlTokenType.COMMA)) {
+				bool order = false;
+
+				if (accept (SparqlTokenType.DESC)) {
+					descending += true;
+					order = true;
+				} else {
+					order = accept (SparqlTokenType.ASC);
+					descending += false;
+				}
+
+				if (order) {
+					expect (SparqlTokenType.OPEN_PARENS);
+				}
+
+				// only check syntax here, keys are translated below
+				keys += get_location ();
+				translate_expression (new StringBuilder ());
+
+				if (order) {
+					expect (SparqlTokenType.CLOSE_PARENS);
+				}
+			}
+			query.bindings = (owned) old_bindings;
+
+			if (keys.length == 0 || keys.length != values.length) {
+				throw get_error ("continuation token does not match sort keys");
+			}
+
+			var end = get_location ();
+			translate_continuation_condition (sql, keys, descending, values, 0);
+			set_location (end);
+
 			return PropertyType.BOOLEAN;
 		} else if (uri == TRACKER_NS + "string-from-filename") {
 			sql.append ("SparqlStringFromFilename(");
@@ -241,6 +241,50 @@ class Tracker.Sparql.Pattern : Object {
 
 	TripleContext? triple_context;
 
+	// looks ahead from the WHERE clause of a select for ORDER BY
+	// in its solution modifiers
+	bool has_order_by () throws Sparql.Error {
+		var location = get_location ();
+		bool result = false;
+		int depth = 0;
+
+		while (true) {
+			switch (current ()) {
+			case SparqlTokenType.OPEN_BRACE:
+			case SparqlTokenType.OPEN_PARENS:
+				depth++;
+				next ();
+				continue;
+			case SparqlTokenType.CLOSE_BRACE:
+			case SparqlTokenType.CLOSE_PARENS:
+				if (depth == 0) {
+					// end of subquery
+					break;
+				}
+				depth--;
+				next ();
+				continue;
+			case SparqlTokenType.ORDER:
+				if (depth == 0) {
+					result = true;
+					break;
+				}
+				next ();
+				continue;
+			case SparqlTokenType.EOF:
+				break;
+			default:
+				next ();
+				continue;
+			}
+			break;
+		}
+
+		set_location (location);
+
+		return result;
+	}
+
 	internal SelectContext translate_select (StringBuilder sql, bool subquery = false, bool scalar_subquery = false) throws Sparql.Error {
 		SelectContext result;
 
@@ -275,6 +319,8 @@ class Tracker.Sparql.Pattern : Object {
 
 		accept (SparqlTokenType.WHERE);
 
+		result.ordered = has_order_by ();
+
 		var pattern = translate_group_graph_pattern (pattern_sql);
 		foreach (var key in pattern.var_set.get_keys ()) {
 			context.var_set.insert (key, VariableState.BOUND);
@@ -683,6 +729,14 @@ class Tracker.Sparql.Pattern : Object {
 		sql.truncate (sql.len - 2);
 
 		sql.append (" FROM ");
+		if (is_ordered ()) {
+			// list tables by the current class counts, SQLite prefers
+			// the order given here when its own statistics do not tell
+			// the tables apart, tables without estimate stay first.
+			// The join order may change the order of the results, keep
+			// it for queries that do not define one with ORDER BY
+			triple_context.tables.sort (compare_table_magnitude);
+		}
 		bool first = true;
 		foreach (DataTable table in triple_context.tables) {
 			if (!first) {
@@ -795,6 +849,34 @@ class Tracker.Sparql.Pattern : Object {
 		context = context.parent_context;
 	}
 
+	bool is_ordered () {
+		for (var c = context; c != null; c = c.parent_context) {
+			var select_context = c as SelectContext;
+			if (select_context != null) {
+				return select_context.ordered;
+			}
+		}
+		return false;
+	}
+
+	static int get_table_magnitude (DataTable table) {
+		if (table.estimated_rows < 0) {
+			return -1;
+		}
+
+		// only order of magnitude, counts are estimates and similar
+		// sized tables keep their order in the query
+		int magnitude = 0;
+		for (int rows = table.estimated_rows; rows >= 10; rows /= 10) {
+			magnitude++;
+		}
+		return magnitude;
+	}
+
+	static int compare_table_magnitude (DataTable a, DataTable b) {
+		return get_table_magnitude (a) - get_table_magnitude (b);
+	}
+
 	void parse_triples (StringBuilder sql, long group_graph_pattern_start, ref bool in_triples_block, ref bool first_where, ref bool in_group_graph_pattern, bool found_simple_optional) throws Sparql.Error {
 		while (true) {
 			if (current () != SparqlTokenType.VAR &&
@@ -1309,6 +1391,8 @@ class Tracker.Sparql.Pattern : Object {
 		Property prop = null;
 
 		Class subject_type = null;
+		// class whose table is used, to estimate its size
+		Class table_class = null;
 
 		if (!current_predicate_is_var) {
 			prop = Ontologies.get_property_by_uri (current_predicate);
@@ -1324,6 +1408,7 @@ class Tracker.Sparql.Pattern : Object {
 				}
 				db_table = cl.name;
 				subject_type = cl;
+				table_class = cl;
 			} else if (prop == null) {
 				if (current_predicate == "http://www.tracker-project.org/ontologies/fts#match") {
 					// fts:match
@@ -1362,6 +1447,7 @@ class Tracker.Sparql.Pattern : Object {
 							foreach (VariableBinding b in list.list) {
 								if (b.type == cl) {
 									db_table = cl.name;
+									table_class = cl;
 									stop = true;
 									break;
 								}
@@ -1382,6 +1468,9 @@ class Tracker.Sparql.Pattern : Object {
 					share_table = false;
 				}
 				subject_type = prop.domain;
+				if (table_class == null) {
+					table_class = prop.domain;
+				}
 
 				if (in_simple_optional && context.var_set.lookup (context.get_variable (current_subject)) == 0) {
 					// use subselect instead of join in simple optional where the subject is the unbound variable
@@ -1414,6 +1503,20 @@ class Tracker.Sparql.Pattern : Object {
 				}
 			}
 			table = get_table (current_subject, db_table, share_table, out newtable);
+
+			if (table_class != null) {
+				// a single subject matches only a few rows, keep the
+				// lowest estimate if several triples share the table
+				int rows = current_subject_is_var ? table_class.count : 1;
+				if (prop != null && prop.multiple_values && db_table == prop.table_name) {
+					// one row per value, the average number of values
+					// for a single subject
+					rows = current_subject_is_var ? prop.count : prop.count / int.max (table_class.count, 1);
+				}
+				if (table.estimated_rows < 0 || rows < table.estimated_rows) {
+					table.estimated_rows = rows;
+				}
+			}
 		} else {
 			// variable in predicate
 			newtable = true;
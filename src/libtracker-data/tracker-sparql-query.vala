@@ -29,6 +29,7 @@ namespace Tracker.Sparql {
 		public string sql_db_tablename; // as in db schema
 		public string sql_query_tablename; // temp. name, generated
 		public PredicateVariable predicate_variable;
+		public int estimated_rows = -1; // from class counts, -1 if unknown
 	}
 
 	abstract class DataBinding : Object {
@@ -158,6 +159,8 @@ namespace Tracker.Sparql {
 		public PropertyType type;
 		public PropertyType[] types = {};
 		public string[] variable_names = {};
+		// ORDER BY defines the order of the results, not the join order
+		public bool ordered;
 
 		public SelectContext (Query query, Context? parent_context = null) {
 			base (query, parent_context);
@@ -518,7 +521,9 @@ public class Tracker.Sparql.Query : Object {
 			} else if (binding.data_type == PropertyType.DATETIME) {
 				stmt.bind_double (i, string_to_date (binding.literal, null));
 			} else if (binding.data_type == PropertyType.INTEGER) {
-				stmt.bind_int (i, int.parse (binding.literal));
+				stmt.bind_int (i, int64.parse (binding.literal));
+			} else if (binding.data_type == PropertyType.DOUBLE) {
+				stmt.bind_double (i, double.parse (binding.literal));
 			} else {
 				stmt.bind_text (i, binding.literal);
 			}
@@ -546,6 +551,18 @@ public class Tracker.Sparql.Query : Object {
 		return sql.str;
 	}
 
+	// SQL translation of a SELECT query, to test the translator
+	public string get_select_sql () throws DBInterfaceError, Sparql.Error, DateError {
+		prepare_execute ();
+
+		if (current () != SparqlTokenType.SELECT) {
+			throw get_error ("expected SELECT");
+		}
+
+		SelectContext context;
+		return get_select_query (out context);
+	}
+
 	DBCursor? execute_select_cursor (bool threadsafe) throws DBInterfaceError, Sparql.Error, DateError {
 		SelectContext context;
 		string sql = get_select_query (out context);
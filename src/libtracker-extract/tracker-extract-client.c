@@ -35,428 +35,547 @@
 #define DBUS_PATH_EXTRACT          "/org/freedesktop/Tracker1/Extract"
 #define DBUS_INTERFACE_EXTRACT     "org.freedesktop.Tracker1.Extract"
 
-static GDBusConnection *connection = NULL;
+/* Requests issued within the same main loop iteration are sent as a
+ * single GetMetadataBatch call, sharing one pipe through which the
+ * extractor writes back each result as soon as it's done, see
+ * tracker-controller.c for the record layout.
+ */
+#define BATCH_MAX_ITEMS            32
+#define BATCH_HEADER_SIZE          (3 * sizeof (guint32))
 
-typedef void (* SendAndSpliceCallback) (void     *buffer,
-                                        gssize    buffer_size,
-                                        GError   *error, /* Don't free */
-                                        gpointer  user_data);
+/* Time in milliseconds given to each item of a batch, the D-Bus
+ * default timeout a single GetMetadata call used to get */
+#define BATCH_ITEM_TIMEOUT         25000
+
+enum {
+	BATCH_STATUS_OK,
+	BATCH_STATUS_ERROR
+};
 
 typedef struct {
-	GInputStream *unix_input_stream;
-	GInputStream *buffered_input_stream;
-	GOutputStream *output_stream;
-	SendAndSpliceCallback callback;
+	guint32 id;
+	TrackerExtractInfo *info;
+	GSimpleAsyncResult *res;
 	GCancellable *cancellable;
-	gpointer data;
-	gboolean splice_finished;
+	gulong cancelled_id;
+	gboolean sent;
+} BatchItem;
+
+typedef struct {
+	GInputStream *input_stream;
+	GByteArray *buffer;
+	guchar *read_buffer;
+	GArray *ids;
 	gboolean dbus_finished;
+	gboolean stream_finished;
 	GError *error;
-} SendAndSpliceData;
+} Batch;
 
-typedef struct {
-	TrackerExtractInfo *info;
-	GSimpleAsyncResult *res;
-} MetadataCallData;
-
-static SendAndSpliceData *
-send_and_splice_data_new (GInputStream          *unix_input_stream,
-                          GInputStream          *buffered_input_stream,
-                          GOutputStream         *output_stream,
-                          GCancellable          *cancellable,
-                          SendAndSpliceCallback  callback,
-                          gpointer               user_data)
-{
-	SendAndSpliceData *data;
+static GDBusConnection *connection = NULL;
 
-	data = g_slice_new0 (SendAndSpliceData);
-	data->unix_input_stream = unix_input_stream;
-	data->buffered_input_stream = buffered_input_stream;
-	data->output_stream = output_stream;
+/* Items not yet completed, by ID */
+static GHashTable *batch_items = NULL;
+/* IDs of the items waiting for the next batch to be sent */
+static GArray *queued_ids = NULL;
+static guint queue_flush_id = 0;
+static guint32 next_id = 1;
 
-	if (cancellable) {
-		data->cancellable = g_object_ref (cancellable);
-	} else {
-		data->cancellable = g_cancellable_new ();
+static void
+batch_item_free (BatchItem *item)
+{
+	if (item->cancelled_id != 0) {
+		g_cancellable_disconnect (item->cancellable, item->cancelled_id);
 	}
 
-	data->callback = callback;
-	data->data = user_data;
+	if (item->cancellable) {
+		g_object_unref (item->cancellable);
+	}
 
-	return data;
+	tracker_extract_info_unref (item->info);
+	g_object_unref (item->res);
+	g_slice_free (BatchItem, item);
 }
 
 static void
-send_and_splice_data_free (SendAndSpliceData *data)
+batch_item_complete (guint32             id,
+                     TrackerExtractInfo *info,
+                     const GError       *error)
 {
-	if (data->cancellable) {
-		g_object_unref (data->cancellable);
-	}
+	BatchItem *item;
 
-	g_output_stream_close (data->output_stream, NULL, NULL);
-	g_input_stream_close (data->buffered_input_stream, NULL, NULL);
+	item = g_hash_table_lookup (batch_items, GUINT_TO_POINTER (id));
 
-	g_object_unref (data->unix_input_stream);
-	g_object_unref (data->buffered_input_stream);
-	g_object_unref (data->output_stream);
+	if (!item) {
+		/* Already cancelled */
+		return;
+	}
 
-	if (data->error) {
-		g_error_free (data->error);
+	if (error) {
+		g_simple_async_result_set_from_error (item->res, error);
+	} else {
+		g_simple_async_result_set_op_res_gpointer (item->res,
+		                                           tracker_extract_info_ref (info),
+		                                           (GDestroyNotify) tracker_extract_info_unref);
 	}
 
-	g_slice_free (SendAndSpliceData, data);
+	g_simple_async_result_complete_in_idle (item->res);
+	g_hash_table_remove (batch_items, GUINT_TO_POINTER (id));
 }
 
-static MetadataCallData *
-metadata_call_data_new (TrackerExtractInfo *info,
-                        GSimpleAsyncResult *res)
+static void
+send_cancel_tasks (const gchar *uri)
 {
-	MetadataCallData *data;
+	GDBusMessage *message;
+	const gchar *uris[2] = { uri, NULL };
 
-	data = g_slice_new (MetadataCallData);
-	data->res = g_object_ref (res);
-	data->info = tracker_extract_info_ref (info);
+	message = g_dbus_message_new_method_call (DBUS_SERVICE_EXTRACT,
+	                                          DBUS_PATH_EXTRACT,
+	                                          DBUS_INTERFACE_EXTRACT,
+	                                          "CancelTasks");
+
+	g_dbus_message_set_body (message, g_variant_new ("(^as)", uris));
+	g_dbus_connection_send_message (connection, message,
+	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+	                                NULL, NULL);
+	g_object_unref (message);
+}
+
+static gboolean
+batch_item_cancelled_idle (gpointer user_data)
+{
+	guint32 id = GPOINTER_TO_UINT (user_data);
+	BatchItem *item;
+	GError *error;
+
+	item = g_hash_table_lookup (batch_items, GUINT_TO_POINTER (id));
 
-	return data;
+	if (!item) {
+		return FALSE;
+	}
+
+	if (item->sent) {
+		gchar *uri;
+
+		/* Let the extractor know, so it stops working on it,
+		 * the rest of the batch goes on normally.
+		 */
+		uri = g_file_get_uri (tracker_extract_info_get_file (item->info));
+		send_cancel_tasks (uri);
+		g_free (uri);
+	}
+
+	error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED,
+	                             "Operation was cancelled");
+	batch_item_complete (id, NULL, error);
+	g_error_free (error);
+
+	return FALSE;
 }
 
 static void
-metadata_call_data_free (MetadataCallData *data)
+batch_item_cancelled_cb (GCancellable *cancellable,
+                         gpointer      user_data)
 {
-	tracker_extract_info_unref (data->info);
-	g_object_unref (data->res);
-	g_slice_free (MetadataCallData, data);
+	/* This may be called from any thread, and within
+	 * g_cancellable_connect(), so defer the work.
+	 */
+	g_idle_add (batch_item_cancelled_idle, user_data);
 }
 
 static void
-dbus_send_and_splice_async_finish (SendAndSpliceData *data)
+batch_free (Batch *batch)
 {
-	if (!data->error) {
-		(* data->callback) (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (data->output_stream)),
-		                    g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (data->output_stream)),
-		                    NULL,
-		                    data->data);
-	} else {
-		(* data->callback) (NULL, -1, data->error, data->data);
+	g_input_stream_close (batch->input_stream, NULL, NULL);
+	g_object_unref (batch->input_stream);
+	g_byte_array_unref (batch->buffer);
+	g_free (batch->read_buffer);
+	g_array_unref (batch->ids);
+
+	if (batch->error) {
+		g_error_free (batch->error);
 	}
 
-	send_and_splice_data_free (data);
+	g_slice_free (Batch, batch);
 }
 
 static void
-send_and_splice_splice_callback (GObject      *source,
-                                 GAsyncResult *result,
-                                 gpointer      user_data)
+batch_finish (Batch *batch)
 {
-	SendAndSpliceData *data = user_data;
 	GError *error = NULL;
+	guint i;
 
-	g_output_stream_splice_finish (G_OUTPUT_STREAM (source), result, &error);
-
-	if (error) {
-		if (!data->error) {
-			data->error = error;
-		} else {
-			g_error_free (error);
-		}
-
-		/* Ensure the other operation is cancelled */
-		if (!data->dbus_finished) {
-			g_cancellable_cancel (data->cancellable);
-		}
+	/* Items the extractor didn't write a result for */
+	if (batch->error) {
+		error = g_error_copy (batch->error);
+	} else {
+		error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_FAILED,
+		                             "No metadata was returned by the extractor");
 	}
 
-	data->splice_finished = TRUE;
-
-	if (data->dbus_finished) {
-		dbus_send_and_splice_async_finish (data);
+	for (i = 0; i < batch->ids->len; i++) {
+		batch_item_complete (g_array_index (batch->ids, guint32, i), NULL, error);
 	}
+
+	g_error_free (error);
+	batch_free (batch);
 }
 
 static void
-send_and_splice_dbus_callback (GObject      *source,
-                               GAsyncResult *result,
-                               gpointer      user_data)
+batch_process_result (guint32      id,
+                      guint32      status,
+                      const gchar *payload,
+                      guint32      length)
 {
-	SendAndSpliceData *data = user_data;
-	GDBusMessage *reply;
-	GError *error = NULL;
+	BatchItem *item;
+	const gchar *strings[4] = { NULL, };
+	const gchar *p, *end;
+	gint n_strings = 0;
 
-	reply = g_dbus_connection_send_message_with_reply_finish (G_DBUS_CONNECTION (source),
-	                                                          result, &error);
+	item = g_hash_table_lookup (batch_items, GUINT_TO_POINTER (id));
 
-	if (reply) {
-		if (g_dbus_message_get_message_type (reply) == G_DBUS_MESSAGE_TYPE_ERROR) {
-			g_dbus_message_to_gerror (reply, &error);
+	if (!item) {
+		/* Cancelled while being extracted */
+		return;
+	}
+
+	/* Payload strings are NUL terminated, so they
+	 * can be used in place without copying.
+	 */
+	p = payload;
+	end = payload + length;
+
+	while (p < end && n_strings < 4) {
+		const gchar *nul = memchr (p, '\0', end - p);
+
+		if (!nul) {
+			break;
 		}
 
-		g_object_unref (reply);
+		strings[n_strings++] = p;
+		p = nul + 1;
 	}
 
-	if (error) {
-		if (!data->error) {
-			data->error = error;
-		} else {
-			g_error_free (error);
-		}
+	if (status == BATCH_STATUS_ERROR) {
+		GError *error;
 
-		/* Ensure the other operation is cancelled */
-		if (!data->splice_finished) {
-			g_cancellable_cancel (data->cancellable);
-		}
+		error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_FAILED,
+		                             strings[0] ? strings[0] : "Unknown error");
+		batch_item_complete (id, NULL, error);
+		g_error_free (error);
+		return;
 	}
 
-	data->dbus_finished = TRUE;
+	if (n_strings == 4) {
+		if (strings[3][0] != '\0') {
+			tracker_extract_info_set_where_clause (item->info, strings[3]);
+		}
 
-	if (data->splice_finished) {
-		dbus_send_and_splice_async_finish (data);
+		tracker_sparql_builder_prepend (tracker_extract_info_get_preupdate_builder (item->info),
+		                                strings[0]);
+		tracker_sparql_builder_prepend (tracker_extract_info_get_postupdate_builder (item->info),
+		                                strings[1]);
+		tracker_sparql_builder_prepend (tracker_extract_info_get_metadata_builder (item->info),
+		                                strings[2]);
 	}
+
+	batch_item_complete (id, item->info, NULL);
 }
 
 static void
-dbus_send_and_splice_async (GDBusConnection       *connection,
-                            GDBusMessage          *message,
-                            int                    fd,
-                            GCancellable          *cancellable,
-                            SendAndSpliceCallback  callback,
-                            gpointer               user_data)
+batch_process_buffer (Batch *batch)
 {
-	SendAndSpliceData *data;
-	GInputStream *unix_input_stream;
-	GInputStream *buffered_input_stream;
-	GOutputStream *output_stream;
-
-	unix_input_stream = g_unix_input_stream_new (fd, TRUE);
-	buffered_input_stream = g_buffered_input_stream_new_sized (unix_input_stream,
-	                                                           DBUS_PIPE_BUFFER_SIZE);
-	output_stream = g_memory_output_stream_new (NULL, 0, g_realloc, g_free);
-
-	data = send_and_splice_data_new (unix_input_stream,
-	                                 buffered_input_stream,
-	                                 output_stream,
-	                                 cancellable,
-	                                 callback,
-	                                 user_data);
+	guint offset = 0;
 
-	g_dbus_connection_send_message_with_reply (connection,
-	                                           message,
-	                                           G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-	                                           -1,
-	                                           NULL,
-	                                           cancellable,
-	                                           send_and_splice_dbus_callback,
-	                                           data);
-
-	g_output_stream_splice_async (data->output_stream,
-	                              data->buffered_input_stream,
-	                              G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
-	                              G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
-	                              0,
-	                              cancellable,
-	                              send_and_splice_splice_callback,
-	                              data);
-}
+	while (batch->buffer->len - offset >= BATCH_HEADER_SIZE) {
+		guint32 header[3];
 
-static inline gchar *
-get_metadata_fast_read (GDataInputStream *data_input_stream,
-                        gsize            *remaining,
-                        GError           *error)
-{
-	gchar *output;
-	gsize len_read;
+		memcpy (header, batch->buffer->data + offset, BATCH_HEADER_SIZE);
 
-	if (error) {
-		return NULL;
+		if (batch->buffer->len - offset - BATCH_HEADER_SIZE < header[2]) {
+			/* Partial result, wait for more data */
+			break;
+		}
+
+		batch_process_result (header[0], header[1],
+		                      (const gchar *) batch->buffer->data + offset + BATCH_HEADER_SIZE,
+		                      header[2]);
+		offset += BATCH_HEADER_SIZE + header[2];
 	}
 
-	g_return_val_if_fail (*remaining > 0, NULL);
+	if (offset > 0) {
+		g_byte_array_remove_range (batch->buffer, 0, offset);
+	}
+}
 
-	/* Read data */
-	output = g_data_input_stream_read_upto (data_input_stream, "\0", 1, &len_read, NULL, &error);
+static void
+batch_read_cb (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+	Batch *batch = user_data;
+	GError *error = NULL;
+	gssize len;
 
-	if (error) {
-		g_free (output);
-		return NULL;
-	}
+	len = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &error);
 
-	*remaining -= len_read;
+	if (len > 0) {
+		g_byte_array_append (batch->buffer, batch->read_buffer, len);
+		batch_process_buffer (batch);
 
-	if (*remaining <= 0) {
-		g_warning ("Expected remaining bytes to be > 0 when it wasn't after g_data_input_stream_read_upto() call");
-		g_free (output);
-		return NULL;
+		g_input_stream_read_async (batch->input_stream,
+		                           batch->read_buffer,
+		                           DBUS_PIPE_BUFFER_SIZE,
+		                           G_PRIORITY_DEFAULT,
+		                           NULL,
+		                           batch_read_cb,
+		                           batch);
+		return;
 	}
 
-	/* Read NUL terminating byte.
-	 *
-	 * The g_data_input_stream_read_upto() function doesn't
-	 * consume the bytes we read up to according to the
-	 * documentation unlike the _until() variant which is now
-	 * deprecated anyway.
-	 */
-	g_data_input_stream_read_byte (data_input_stream, NULL, &error);
-
 	if (error) {
-		g_free (output);
-		return NULL;
+		if (!batch->error) {
+			batch->error = error;
+		} else {
+			g_error_free (error);
+		}
 	}
 
-	*remaining -= 1;
+	batch->stream_finished = TRUE;
 
-	return output;
+	if (batch->dbus_finished) {
+		batch_finish (batch);
+	}
 }
 
 static void
-get_metadata_fast_cb (void     *buffer,
-                      gssize    buffer_size,
-                      GError   *error,
-                      gpointer  user_data)
+batch_dbus_cb (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
 {
-	MetadataCallData *data;
-
-	data = user_data;
-
-	if (G_UNLIKELY (error)) {
-		g_simple_async_result_set_from_error (data->res, error);
-	} else {
-		GInputStream *input_stream;
-		GDataInputStream *data_input_stream;
-		gchar *preupdate, *postupdate, *sparql, *where;
-		TrackerSparqlBuilder *builder;
-		gssize remaining;
-
-		/* So the structure is like this:
-		 *
-		 *   [buffer,'\0'][buffer,'\0'][...]
-		 *
-		 * We avoid strlen() using
-		 * g_data_input_stream_read_upto() and the
-		 * NUL-terminating byte given strlen() has a size_t
-		 * limitation and costs us time evaluating string
-		 * lengths.
-		 */
-		preupdate = postupdate = sparql = where = NULL;
-		remaining = buffer_size;
-
-		input_stream = g_memory_input_stream_new_from_data (buffer, buffer_size, NULL);
-		data_input_stream = g_data_input_stream_new (input_stream);
-		g_data_input_stream_set_byte_order (G_DATA_INPUT_STREAM (data_input_stream),
-		                                    G_DATA_STREAM_BYTE_ORDER_HOST_ENDIAN);
-
-		preupdate  = get_metadata_fast_read (data_input_stream, &remaining, error);
-		postupdate = get_metadata_fast_read (data_input_stream, &remaining, error);
-		sparql     = get_metadata_fast_read (data_input_stream, &remaining, error);
-		where      = get_metadata_fast_read (data_input_stream, &remaining, error);
+	Batch *batch = user_data;
+	GDBusMessage *reply;
+	GError *error = NULL;
 
-		g_object_unref (data_input_stream);
-		g_object_unref (input_stream);
+	reply = g_dbus_connection_send_message_with_reply_finish (G_DBUS_CONNECTION (source),
+	                                                          result, &error);
 
-		if (where) {
-			tracker_extract_info_set_where_clause (data->info, where);
-			g_free (where);
+	if (reply) {
+		if (g_dbus_message_get_message_type (reply) == G_DBUS_MESSAGE_TYPE_ERROR) {
+			g_dbus_message_to_gerror (reply, &error);
 		}
 
-		if (preupdate) {
-			builder = tracker_extract_info_get_preupdate_builder (data->info);
-			tracker_sparql_builder_prepend (builder, preupdate);
-			g_free (preupdate);
-		}
+		g_object_unref (reply);
+	}
 
-		if (postupdate) {
-			builder = tracker_extract_info_get_postupdate_builder (data->info);
-			tracker_sparql_builder_prepend (builder, postupdate);
-			g_free (postupdate);
+	if (error) {
+		/* The extractor errors are more meaningful
+		 * than a broken pipe, so they take over.
+		 */
+		if (batch->error) {
+			g_error_free (batch->error);
 		}
 
-		if (sparql) {
-			builder = tracker_extract_info_get_metadata_builder (data->info);
-			tracker_sparql_builder_prepend (builder, sparql);
-			g_free (sparql);
-		}
+		batch->error = error;
+	}
 
-		g_simple_async_result_set_op_res_gpointer (data->res,
-		                                           tracker_extract_info_ref (data->info),
-		                                           (GDestroyNotify) tracker_extract_info_unref);
+	batch->dbus_finished = TRUE;
+
+	if (batch->stream_finished) {
+		batch_finish (batch);
 	}
+}
 
-	g_simple_async_result_complete_in_idle (data->res);
-	metadata_call_data_free (data);
+static void
+batch_fail_items (GArray       *ids,
+                  const GError *error)
+{
+	guint i;
+
+	for (i = 0; i < ids->len; i++) {
+		batch_item_complete (g_array_index (ids, guint32, i), NULL, error);
+	}
 }
 
 static void
-get_metadata_fast_async (GDBusConnection    *connection,
-                         GFile              *file,
-                         const gchar        *mime_type,
-                         const gchar        *graph,
-                         GCancellable       *cancellable,
-                         GSimpleAsyncResult *res)
+batch_send (GArray *ids)
 {
-	MetadataCallData *data;
-	TrackerExtractInfo *info;
+	GVariantBuilder builder;
 	GDBusMessage *message;
 	GUnixFDList *fd_list;
+	Batch *batch;
 	int pipefd[2], fd_index;
 	GError *error = NULL;
-	gchar *uri;
+	guint i;
 
 	if (pipe (pipefd) < 0) {
 		gint err = errno;
 
-		g_critical ("Coudln't open pipe");
-		g_simple_async_result_set_error (res,
-		                                 G_IO_ERROR,
-		                                 g_io_error_from_errno (err),
-		                                 "Could not open pipe to extractor");
-		g_simple_async_result_complete_in_idle (res);
+		g_critical ("Couldn't open pipe");
+		error = g_error_new_literal (G_IO_ERROR,
+		                             g_io_error_from_errno (err),
+		                             "Could not open pipe to extractor");
+		batch_fail_items (ids, error);
+		g_error_free (error);
+		g_array_unref (ids);
 		return;
 	}
 
 	fd_list = g_unix_fd_list_new ();
+	fd_index = g_unix_fd_list_append (fd_list, pipefd[1], &error);
 
-	if ((fd_index = g_unix_fd_list_append (fd_list, pipefd[1], &error)) == -1) {
-		g_simple_async_result_set_from_error (res, error);
-		g_simple_async_result_complete_in_idle (res);
+	/* We need to close the fd as g_unix_fd_list_append duplicates the fd */
+	close (pipefd[1]);
 
-		g_object_unref (fd_list);
+	if (fd_index == -1) {
+		batch_fail_items (ids, error);
 		g_error_free (error);
+		g_object_unref (fd_list);
+		g_array_unref (ids);
+		close (pipefd[0]);
+		return;
+	}
 
-		/* FIXME: Close pipes? */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(usss)"));
 
-		return;
+	for (i = 0; i < ids->len; i++) {
+		guint32 id = g_array_index (ids, guint32, i);
+		BatchItem *item;
+		gchar *uri;
+
+		item = g_hash_table_lookup (batch_items, GUINT_TO_POINTER (id));
+		item->sent = TRUE;
+
+		uri = g_file_get_uri (tracker_extract_info_get_file (item->info));
+		g_variant_builder_add (&builder, "(usss)",
+		                       id,
+		                       uri,
+		                       tracker_extract_info_get_mimetype (item->info),
+		                       tracker_extract_info_get_graph (item->info));
+		g_free (uri);
 	}
 
 	message = g_dbus_message_new_method_call (DBUS_SERVICE_EXTRACT,
 	                                          DBUS_PATH_EXTRACT,
 	                                          DBUS_INTERFACE_EXTRACT,
-	                                          "GetMetadataFast");
-
-	uri = g_file_get_uri (file);
-
+	                                          "GetMetadataBatch");
 	g_dbus_message_set_body (message,
-	                         g_variant_new ("(sssh)",
-	                                        uri,
-	                                        mime_type,
-	                                        graph,
-	                                        fd_index));
+	                         g_variant_new ("(a(usss)h)", &builder, fd_index));
 	g_dbus_message_set_unix_fd_list (message, fd_list);
+	g_object_unref (fd_list);
 
-	/* We need to close the fd as g_unix_fd_list_append duplicates the fd */
+	batch = g_slice_new0 (Batch);
+	batch->input_stream = g_unix_input_stream_new (pipefd[0], TRUE);
+	batch->buffer = g_byte_array_new ();
+	batch->read_buffer = g_malloc (DBUS_PIPE_BUFFER_SIZE);
+	batch->ids = ids;
 
-	g_object_unref (fd_list);
-	close (pipefd[1]);
-	g_free (uri);
+	/* Results are streamed back as they are done, the call
+	 * itself returns when the whole batch is, so its timeout
+	 * grows with the number of items, in case the extractor
+	 * goes through them one at a time.
+	 */
+	g_dbus_connection_send_message_with_reply (connection,
+	                                           message,
+	                                           G_DBUS_SEND_MESSAGE_FLAGS_NONE,
+	                                           BATCH_ITEM_TIMEOUT * ids->len,
+	                                           NULL,
+	                                           NULL,
+	                                           batch_dbus_cb,
+	                                           batch);
 
-	info = tracker_extract_info_new (file, mime_type, graph);
-	data = metadata_call_data_new (info, res);
+	g_input_stream_read_async (batch->input_stream,
+	                           batch->read_buffer,
+	                           DBUS_PIPE_BUFFER_SIZE,
+	                           G_PRIORITY_DEFAULT,
+	                           NULL,
+	                           batch_read_cb,
+	                           batch);
 
-	dbus_send_and_splice_async (connection,
-	                            message,
-	                            pipefd[0],
-	                            cancellable,
-	                            get_metadata_fast_cb,
-	                            data);
 	g_object_unref (message);
-	tracker_extract_info_unref (info);
+}
+
+static void
+queue_flush (void)
+{
+	GArray *ids;
+	guint i;
+
+	if (queue_flush_id != 0) {
+		g_source_remove (queue_flush_id);
+		queue_flush_id = 0;
+	}
+
+	ids = g_array_sized_new (FALSE, FALSE, sizeof (guint32), queued_ids->len);
+
+	/* Leave out items cancelled while queued */
+	for (i = 0; i < queued_ids->len; i++) {
+		guint32 id = g_array_index (queued_ids, guint32, i);
+
+		if (g_hash_table_lookup (batch_items, GUINT_TO_POINTER (id))) {
+			g_array_append_val (ids, id);
+		}
+	}
+
+	g_array_set_size (queued_ids, 0);
+
+	if (ids->len == 0) {
+		g_array_unref (ids);
+		return;
+	}
+
+	batch_send (ids);
+}
+
+static gboolean
+queue_flush_idle (gpointer user_data)
+{
+	queue_flush_id = 0;
+	queue_flush ();
+
+	return FALSE;
+}
+
+static void
+queue_item (GFile              *file,
+            const gchar        *mime_type,
+            const gchar        *graph,
+            GCancellable       *cancellable,
+            GSimpleAsyncResult *res)
+{
+	BatchItem *item;
+
+	if (G_UNLIKELY (!batch_items)) {
+		batch_items = g_hash_table_new_full (NULL, NULL, NULL,
+		                                     (GDestroyNotify) batch_item_free);
+		queued_ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+	}
+
+	item = g_slice_new0 (BatchItem);
+	item->id = next_id++;
+	item->info = tracker_extract_info_new (file, mime_type, graph);
+	item->res = g_object_ref (res);
+
+	/* 0 is never a valid ID */
+	if (G_UNLIKELY (next_id == 0)) {
+		next_id = 1;
+	}
+
+	g_hash_table_insert (batch_items, GUINT_TO_POINTER (item->id), item);
+	g_array_append_val (queued_ids, item->id);
+
+	if (cancellable) {
+		item->cancellable = g_object_ref (cancellable);
+		item->cancelled_id = g_cancellable_connect (cancellable,
+		                                            G_CALLBACK (batch_item_cancelled_cb),
+		                                            GUINT_TO_POINTER (item->id),
+		                                            NULL);
+	}
+
+	if (queued_ids->len >= BATCH_MAX_ITEMS) {
+		queue_flush ();
+	} else if (queue_flush_id == 0) {
+		queue_flush_id = g_idle_add (queue_flush_idle, NULL);
+	}
 }
 
 /**
@@ -469,7 +588,9 @@ get_metadata_fast_async (GDBusConnection    *connection,
  * @user_data: (closure): data for the callback function
  *
  * Asynchronously requests metadata for @file, this request is sent to the
- * tracker-extract daemon.
+ * tracker-extract daemon. Requests issued in the same main loop iteration
+ * are sent together, and each of them completes as soon as its own result
+ * is available.
  *
  * When the request is finished, @callback will be executed. You can then
  * call tracker_extract_client_get_metadata_finish() to get the result of
@@ -506,8 +627,7 @@ tracker_extract_client_get_metadata (GFile               *file,
 	res = g_simple_async_result_new (G_OBJECT (file), callback, user_data, NULL);
 	g_simple_async_result_set_handle_cancellation (res, TRUE);
 
-	get_metadata_fast_async (connection, file, mime_type, graph,
-	                         cancellable, res);
+	queue_item (file, mime_type, graph, cancellable, res);
 	g_object_unref (res);
 }
 
@@ -550,8 +670,7 @@ tracker_extract_client_get_metadata_finish (GFile         *file,
 void
 tracker_extract_client_cancel_for_prefix (GFile *prefix)
 {
-	GDBusMessage *message;
-	gchar *uris[2];
+	gchar *uri;
 
 	if (G_UNLIKELY (!connection)) {
 		GError *error = NULL;
@@ -565,19 +684,7 @@ tracker_extract_client_cancel_for_prefix (GFile *prefix)
 		}
 	}
 
-	uris[0] = g_file_get_uri (prefix);
-	uris[1] = NULL;
-
-	message = g_dbus_message_new_method_call (DBUS_SERVICE_EXTRACT,
-	                                          DBUS_PATH_EXTRACT,
-	                                          DBUS_INTERFACE_EXTRACT,
-	                                          "CancelTasks");
-
-	g_dbus_message_set_body (message, g_variant_new ("(^as)", uris));
-	g_dbus_connection_send_message (connection, message,
-	                                G_DBUS_SEND_MESSAGE_FLAGS_NONE,
-	                                NULL, NULL);
-
-	g_free (uris[0]);
-	g_object_unref (message);
+	uri = g_file_get_uri (prefix);
+	send_cancel_tasks (uri);
+	g_free (uri);
 }
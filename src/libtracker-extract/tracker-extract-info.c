@@ -46,6 +46,8 @@ struct _TrackerExtractInfo
 	gchar *mimetype;
 	gchar *graph;
 
+	guint64 bytes_read;
+
 	gint ref_count;
 };
 
@@ -294,3 +296,42 @@ tracker_extract_info_set_where_clause (TrackerExtractInfo *info,
 	g_free (info->where_clause);
 	info->where_clause = g_strdup (where);
 }
+
+/**
+ * tracker_extract_info_get_bytes_read:
+ * @info: a #TrackerExtractInfo
+ *
+ * Returns the number of bytes the extractor read from the file,
+ * as reported through tracker_extract_info_add_bytes_read(). Files
+ * read through a #TrackerFileReader are accounted automatically.
+ *
+ * Returns: the number of bytes read
+ *
+ * Since: 0.18
+ **/
+guint64
+tracker_extract_info_get_bytes_read (TrackerExtractInfo *info)
+{
+	g_return_val_if_fail (info != NULL, 0);
+
+	return info->bytes_read;
+}
+
+/**
+ * tracker_extract_info_add_bytes_read:
+ * @info: a #TrackerExtractInfo
+ * @bytes: number of bytes read
+ *
+ * Accounts @bytes as read from the file being extracted, for
+ * extractors that do their own I/O.
+ *
+ * Since: 0.18
+ **/
+void
+tracker_extract_info_add_bytes_read (TrackerExtractInfo *info,
+                                     guint64             bytes)
+{
+	g_return_if_fail (info != NULL);
+
+	info->bytes_read += bytes;
+}
@@ -49,6 +49,9 @@ TrackerSparqlBuilder *tracker_extract_info_get_metadata_builder   (TrackerExtrac
 const gchar *         tracker_extract_info_get_where_clause       (TrackerExtractInfo *info);
 void                  tracker_extract_info_set_where_clause       (TrackerExtractInfo *info,
                                                                    const gchar        *where);
+guint64               tracker_extract_info_get_bytes_read         (TrackerExtractInfo *info);
+void                  tracker_extract_info_add_bytes_read         (TrackerExtractInfo *info,
+                                                                   guint64             bytes);
 
 G_END_DECLS
 
@@ -29,6 +29,7 @@
 #include "tracker-exif.h"
 #include "tracker-extract-client.h"
 #include "tracker-extract-info.h"
+#include "tracker-file-reader.h"
 #include "tracker-module-manager.h"
 #include "tracker-guarantee.h"
 #include "tracker-iptc.h"
@@ -0,0 +1,435 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef G_OS_WIN32
+#include <sys/mman.h>
+#endif /* G_OS_WIN32 */
+
+#include <glib.h>
+
+#include <libtracker-common/tracker-file-utils.h>
+
+#include "tracker-file-reader.h"
+
+/**
+ * SECTION:tracker-file-reader
+ * @title: File access
+ * @short_description: Windowed access to the file being extracted
+ * @stability: Unstable
+ * @include: libtracker-extract/tracker-extract.h
+ *
+ * #TrackerFileReader gives extractors read access to the file
+ * described by a #TrackerExtractInfo as a set of windows, typically
+ * the header and trailer of the file, so only the parts an extractor
+ * looks at are brought into memory.
+ *
+ * Closing the reader drops the file pages from the page cache, as
+ * the file is unlikely to be read again soon, and accounts the
+ * bytes handed out in the #TrackerExtractInfo.
+ **/
+
+typedef struct {
+	gpointer data;
+	gsize length;
+	gboolean mapped;
+} Window;
+
+struct _TrackerFileReader {
+	TrackerExtractInfo *info;
+	gchar *filename;
+	gint fd;
+	goffset size;
+
+	GArray *windows;
+	guint64 bytes_read;
+};
+
+/**
+ * tracker_file_reader_open:
+ * @info: a #TrackerExtractInfo
+ * @error: return location for a #GError, or %NULL
+ *
+ * Opens the file being extracted for reading.
+ *
+ * Returns: a newly created #TrackerFileReader, to be closed with
+ * tracker_file_reader_close(), or %NULL if the file could not be
+ * opened.
+ *
+ * Since: 0.18
+ **/
+TrackerFileReader *
+tracker_file_reader_open (TrackerExtractInfo  *info,
+                          GError             **error)
+{
+	TrackerFileReader *reader;
+	gchar *filename;
+	struct stat st;
+	gint fd;
+
+	g_return_val_if_fail (info != NULL, NULL);
+
+	filename = g_file_get_path (tracker_extract_info_get_file (info));
+
+	if (!filename) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		                     "File is not local");
+		return NULL;
+	}
+
+	fd = tracker_file_open_fd (filename);
+
+	if (fd == -1 || fstat (fd, &st) == -1) {
+		gint saved_errno = errno;
+
+		g_set_error (error, G_FILE_ERROR,
+		             g_file_error_from_errno (saved_errno),
+		             "Could not open '%s': %s",
+		             filename,
+		             g_strerror (saved_errno));
+
+		if (fd != -1) {
+			close (fd);
+		}
+
+		g_free (filename);
+		return NULL;
+	}
+
+	reader = g_slice_new0 (TrackerFileReader);
+	reader->info = tracker_extract_info_ref (info);
+	reader->filename = filename;
+	reader->fd = fd;
+	reader->size = st.st_size;
+	reader->windows = g_array_new (FALSE, FALSE, sizeof (Window));
+
+	return reader;
+}
+
+/**
+ * tracker_file_reader_close:
+ * @reader: a #TrackerFileReader
+ *
+ * Releases all windows obtained from @reader, evicts the file from
+ * the page cache and closes it.
+ *
+ * Since: 0.18
+ **/
+void
+tracker_file_reader_close (TrackerFileReader *reader)
+{
+	guint i;
+
+	g_return_if_fail (reader != NULL);
+
+	for (i = 0; i < reader->windows->len; i++) {
+		Window *window = &g_array_index (reader->windows, Window, i);
+
+#ifndef G_OS_WIN32
+		if (window->mapped) {
+			munmap (window->data, window->length);
+			continue;
+		}
+#endif /* G_OS_WIN32 */
+
+		g_free (window->data);
+	}
+
+#ifdef HAVE_POSIX_FADVISE
+	posix_fadvise (reader->fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif /* HAVE_POSIX_FADVISE */
+
+	close (reader->fd);
+
+	tracker_extract_info_add_bytes_read (reader->info, reader->bytes_read);
+	tracker_extract_info_unref (reader->info);
+
+	g_array_free (reader->windows, TRUE);
+	g_free (reader->filename);
+	g_slice_free (TrackerFileReader, reader);
+}
+
+/**
+ * tracker_file_reader_get_size:
+ * @reader: a #TrackerFileReader
+ *
+ * Returns: the size of the file, as of when it was opened
+ *
+ * Since: 0.18
+ **/
+goffset
+tracker_file_reader_get_size (TrackerFileReader *reader)
+{
+	g_return_val_if_fail (reader != NULL, 0);
+
+	return reader->size;
+}
+
+/**
+ * tracker_file_reader_get_fd:
+ * @reader: a #TrackerFileReader
+ *
+ * Returns the file descriptor, for libraries that need one. Data read
+ * through it directly is not accounted by the reader.
+ *
+ * Returns: the file descriptor, owned by @reader
+ *
+ * Since: 0.18
+ **/
+gint
+tracker_file_reader_get_fd (TrackerFileReader *reader)
+{
+	g_return_val_if_fail (reader != NULL, -1);
+
+	return reader->fd;
+}
+
+static gpointer
+read_window (TrackerFileReader *reader,
+             goffset            offset,
+             gsize             *length)
+{
+	guchar *data;
+	gsize total = 0;
+
+	data = g_try_malloc (*length);
+
+	if (!data) {
+		return NULL;
+	}
+
+	while (total < *length) {
+		gssize bytes;
+
+		bytes = pread (reader->fd, data + total, *length - total, offset + total);
+
+		if (bytes < 0 && errno == EINTR) {
+			continue;
+		} else if (bytes <= 0) {
+			break;
+		}
+
+		total += bytes;
+	}
+
+	if (total == 0) {
+		g_free (data);
+		return NULL;
+	}
+
+	/* The file may have been truncated since it was opened */
+	*length = total;
+
+	return data;
+}
+
+/**
+ * tracker_file_reader_get_window:
+ * @reader: a #TrackerFileReader
+ * @offset: offset of the window in the file
+ * @length: requested length of the window
+ * @length_out: (out): return location for the actual length
+ *
+ * Returns a read-only window on the file contents, starting at @offset
+ * and spanning @length bytes or up to the end of the file, whichever
+ * comes first. The window is mapped if possible, read otherwise.
+ *
+ * Returns: (transfer none): the window contents, valid until @reader
+ * is closed, or %NULL if @offset is past the end of the file or the
+ * contents could not be read.
+ *
+ * Since: 0.18
+ **/
+gconstpointer
+tracker_file_reader_get_window (TrackerFileReader *reader,
+                                goffset            offset,
+                                gsize              length,
+                                gsize             *length_out)
+{
+	Window window = { 0 };
+	gconstpointer retval = NULL;
+
+	g_return_val_if_fail (reader != NULL, NULL);
+	g_return_val_if_fail (length_out != NULL, NULL);
+
+	*length_out = 0;
+
+	if (offset < 0 || offset >= reader->size || length == 0) {
+		return NULL;
+	}
+
+	length = MIN (length, (gsize) (reader->size - offset));
+
+#ifndef G_OS_WIN32
+	{
+		goffset page_size, map_offset;
+		gpointer data;
+
+		/* mmap() offsets must be page aligned */
+		page_size = sysconf (_SC_PAGESIZE);
+		map_offset = offset - (offset % page_size);
+
+		data = mmap (NULL, length + (offset - map_offset),
+		             PROT_READ, MAP_PRIVATE,
+		             reader->fd, map_offset);
+
+		if (data != MAP_FAILED) {
+			window.data = data;
+			window.length = length + (offset - map_offset);
+			window.mapped = TRUE;
+			retval = (const guchar *) data + (offset - map_offset);
+		}
+	}
+#endif /* G_OS_WIN32 */
+
+	if (!window.data) {
+		window.data = read_window (reader, offset, &length);
+
+		if (!window.data) {
+			g_debug ("Could not read %" G_GSIZE_FORMAT " bytes at "
+			         "offset %" G_GOFFSET_FORMAT " from '%s'",
+			         length, offset, reader->filename);
+			return NULL;
+		}
+
+		window.length = length;
+		retval = window.data;
+	}
+
+	g_array_append_val (reader->windows, window);
+	reader->bytes_read += length;
+	*length_out = length;
+
+	return retval;
+}
+
+/**
+ * tracker_file_reader_get_head:
+ * @reader: a #TrackerFileReader
+ * @length: requested length of the window
+ * @length_out: (out): return location for the actual length
+ *
+ * Returns a window on the first @length bytes of the file, see
+ * tracker_file_reader_get_window().
+ *
+ * Returns: (transfer none): the window contents, or %NULL
+ *
+ * Since: 0.18
+ **/
+gconstpointer
+tracker_file_reader_get_head (TrackerFileReader *reader,
+                              gsize              length,
+                              gsize             *length_out)
+{
+	return tracker_file_reader_get_window (reader, 0, length, length_out);
+}
+
+/**
+ * tracker_file_reader_get_tail:
+ * @reader: a #TrackerFileReader
+ * @length: requested length of the window
+ * @length_out: (out): return location for the actual length
+ *
+ * Returns a window on the last @length bytes of the file, or on the
+ * whole file if it's smaller, see tracker_file_reader_get_window().
+ *
+ * Returns: (transfer none): the window contents, or %NULL
+ *
+ * Since: 0.18
+ **/
+gconstpointer
+tracker_file_reader_get_tail (TrackerFileReader *reader,
+                              gsize              length,
+                              gsize             *length_out)
+{
+	goffset offset;
+
+	g_return_val_if_fail (reader != NULL, NULL);
+
+	if (length < (gsize) reader->size) {
+		offset = reader->size - length;
+	} else {
+		offset = 0;
+	}
+
+	return tracker_file_reader_get_window (reader, offset, length, length_out);
+}
+
+/**
+ * tracker_file_reader_get_bytes_read:
+ * @reader: a #TrackerFileReader
+ *
+ * Returns the number of bytes in the windows obtained so far from
+ * @reader.
+ *
+ * Returns: the number of bytes read
+ *
+ * Since: 0.18
+ **/
+guint64
+tracker_file_reader_get_bytes_read (TrackerFileReader *reader)
+{
+	g_return_val_if_fail (reader != NULL, 0);
+
+	return reader->bytes_read;
+}
+
+/**
+ * tracker_file_readahead:
+ * @file: a #GFile
+ * @length: number of bytes to read ahead, or 0 for the whole file
+ *
+ * Hints the kernel that the first @length bytes of @file will be
+ * needed soon, so they can be read in the background while other
+ * files are being extracted.
+ *
+ * Since: 0.18
+ **/
+void
+tracker_file_readahead (GFile *file,
+                        gsize  length)
+{
+#ifdef HAVE_POSIX_FADVISE
+	gchar *filename;
+	gint fd;
+
+	g_return_if_fail (G_IS_FILE (file));
+
+	filename = g_file_get_path (file);
+
+	if (!filename) {
+		return;
+	}
+
+	fd = tracker_file_open_fd (filename);
+	g_free (filename);
+
+	if (fd == -1) {
+		return;
+	}
+
+	posix_fadvise (fd, 0, length, POSIX_FADV_WILLNEED);
+	close (fd);
+#endif /* HAVE_POSIX_FADVISE */
+}
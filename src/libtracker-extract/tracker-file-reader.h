@@ -0,0 +1,55 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __LIBTRACKER_EXTRACT_FILE_READER_H__
+#define __LIBTRACKER_EXTRACT_FILE_READER_H__
+
+#if !defined (__LIBTRACKER_EXTRACT_INSIDE__) && !defined (TRACKER_COMPILATION)
+#error "only <libtracker-extract/tracker-extract.h> must be included directly."
+#endif
+
+#include <gio/gio.h>
+
+#include "tracker-extract-info.h"
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerFileReader TrackerFileReader;
+
+TrackerFileReader *tracker_file_reader_open           (TrackerExtractInfo  *info,
+                                                       GError             **error);
+void               tracker_file_reader_close          (TrackerFileReader   *reader);
+goffset            tracker_file_reader_get_size       (TrackerFileReader   *reader);
+gint               tracker_file_reader_get_fd         (TrackerFileReader   *reader);
+gconstpointer      tracker_file_reader_get_window     (TrackerFileReader   *reader,
+                                                       goffset              offset,
+                                                       gsize                length,
+                                                       gsize               *length_out);
+gconstpointer      tracker_file_reader_get_head       (TrackerFileReader   *reader,
+                                                       gsize                length,
+                                                       gsize               *length_out);
+gconstpointer      tracker_file_reader_get_tail       (TrackerFileReader   *reader,
+                                                       gsize                length,
+                                                       gsize               *length_out);
+guint64            tracker_file_reader_get_bytes_read (TrackerFileReader   *reader);
+
+void               tracker_file_readahead             (GFile               *file,
+                                                       gsize                length);
+
+G_END_DECLS
+
+#endif /* __LIBTRACKER_EXTRACT_FILE_READER_H__ */
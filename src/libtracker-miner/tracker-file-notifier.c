@@ -1420,3 +1420,20 @@ tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
 
 	return iri;
 }
+
+/* Returns the type of @file as last known to the notifier, which
+ * is still available while the file-deleted signal is emitted.
+ */
+GFileType
+tracker_file_notifier_get_file_type (TrackerFileNotifier *notifier,
+                                     GFile               *file)
+{
+	TrackerFileNotifierPrivate *priv;
+
+	g_return_val_if_fail (TRACKER_IS_FILE_NOTIFIER (notifier), G_FILE_TYPE_UNKNOWN);
+	g_return_val_if_fail (G_IS_FILE (file), G_FILE_TYPE_UNKNOWN);
+
+	priv = notifier->priv;
+
+	return tracker_file_system_get_file_type (priv->file_system, file);
+}
@@ -83,6 +83,8 @@ gboolean      tracker_file_notifier_is_active (TrackerFileNotifier *notifier);
 
 const gchar * tracker_file_notifier_get_file_iri (TrackerFileNotifier *notifier,
                                                   GFile               *file);
+GFileType     tracker_file_notifier_get_file_type (TrackerFileNotifier *notifier,
+                                                   GFile               *file);
 
 G_END_DECLS
 
@@ -555,6 +555,27 @@ tracker_file_system_peek_file (TrackerFileSystem *file_system,
 	return NULL;
 }
 
+GFileType
+tracker_file_system_get_file_type (TrackerFileSystem *file_system,
+                                   GFile             *file)
+{
+	GNode *node;
+
+	g_return_val_if_fail (G_IS_FILE (file), G_FILE_TYPE_UNKNOWN);
+	g_return_val_if_fail (TRACKER_IS_FILE_SYSTEM (file_system), G_FILE_TYPE_UNKNOWN);
+
+	node = file_system_get_node (file_system, file);
+
+	if (node) {
+		FileNodeData *data;
+
+		data = node->data;
+		return data->file_type;
+	}
+
+	return G_FILE_TYPE_UNKNOWN;
+}
+
 GFile *
 tracker_file_system_peek_parent (TrackerFileSystem *file_system,
                                  GFile             *file)
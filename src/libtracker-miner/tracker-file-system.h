@@ -64,6 +64,8 @@ GFile *       tracker_file_system_peek_file      (TrackerFileSystem  *file_syste
                                                   GFile              *file);
 GFile *       tracker_file_system_peek_parent    (TrackerFileSystem  *file_system,
                                                   GFile              *file);
+GFileType     tracker_file_system_get_file_type  (TrackerFileSystem  *file_system,
+                                                  GFile              *file);
 
 void          tracker_file_system_traverse       (TrackerFileSystem             *file_system,
                                                   GFile                         *root,
@@ -19,6 +19,8 @@
  * Author: Carlos Garnacho  <carlos@lanedo.com>
  */
 
+#include <string.h>
+
 #include <libtracker-common/tracker-file-utils.h>
 #include "tracker-indexing-tree.h"
 
@@ -35,6 +37,8 @@ G_DEFINE_TYPE (TrackerIndexingTree, tracker_indexing_tree, G_TYPE_OBJECT)
 typedef struct _TrackerIndexingTreePrivate TrackerIndexingTreePrivate;
 typedef struct _NodeData NodeData;
 typedef struct _PatternData PatternData;
+typedef struct _FilterMatcher FilterMatcher;
+typedef struct _StringSlice StringSlice;
 typedef struct _FindNodeData FindNodeData;
 
 struct _NodeData
@@ -47,10 +51,34 @@ struct _NodeData
 struct _PatternData
 {
 	GPatternSpec *pattern;
+	gchar *glob_string;
 	TrackerFilterType type;
 	GFile *file; /* Only filled in in absolute paths */
 };
 
+/* Most filters are plain names ("lost+found"), suffixes ("*.o")
+ * or prefixes ("#*"). The matcher for a filter type looks these up
+ * in hash tables keyed by a slice of the basename, so the cost
+ * doesn't grow with the number of filters. Anything else falls
+ * back to GPatternSpec.
+ */
+struct _StringSlice
+{
+	const gchar *str;
+	gsize len;
+};
+
+struct _FilterMatcher
+{
+	GHashTable *literals;
+	GHashTable *prefixes;
+	GHashTable *suffixes;
+	GArray *prefix_lengths; /* Distinct key lengths in prefixes */
+	GArray *suffix_lengths; /* Distinct key lengths in suffixes */
+	GPtrArray *globs;       /* GPatternSpec, owned by PatternData */
+	GPtrArray *files;       /* GFile, owned by PatternData */
+};
+
 struct _FindNodeData
 {
 	GEqualFunc func;
@@ -64,6 +92,9 @@ struct _TrackerIndexingTreePrivate
 	GList *filter_patterns;
 	TrackerFilterPolicy policies[TRACKER_FILTER_PARENT_DIRECTORY + 1];
 
+	/* Built on demand from filter_patterns */
+	FilterMatcher *matchers[TRACKER_FILTER_PARENT_DIRECTORY + 1];
+
 	guint filter_hidden : 1;
 };
 
@@ -72,6 +103,7 @@ enum {
 	PROP_FILTER_HIDDEN
 };
 
+
 enum {
 	DIRECTORY_ADDED,
 	DIRECTORY_REMOVED,
@@ -118,6 +150,7 @@ pattern_data_new (const gchar *glob_string,
 
 	data = g_slice_new0 (PatternData);
 	data->pattern = g_pattern_spec_new (glob_string);
+	data->glob_string = g_strdup (glob_string);
 	data->type = type;
 
 	if (g_path_is_absolute (glob_string)) {
@@ -135,9 +168,231 @@ pattern_data_free (PatternData *data)
 	}
 
 	g_pattern_spec_free (data->pattern);
+	g_free (data->glob_string);
 	g_slice_free (PatternData, data);
 }
 
+static guint
+string_slice_hash (gconstpointer key)
+{
+	const StringSlice *slice = key;
+	guint32 h = 5381;
+	gsize i;
+
+	for (i = 0; i < slice->len; i++) {
+		h = (h << 5) + h + (guchar) slice->str[i];
+	}
+
+	return h;
+}
+
+static gboolean
+string_slice_equal (gconstpointer a,
+                    gconstpointer b)
+{
+	const StringSlice *slice_a = a;
+	const StringSlice *slice_b = b;
+
+	return (slice_a->len == slice_b->len &&
+	        memcmp (slice_a->str, slice_b->str, slice_a->len) == 0);
+}
+
+/* Allocates the slice and a copy of the string in one block */
+static StringSlice *
+string_slice_new (const gchar *str,
+                  gsize        len)
+{
+	StringSlice *slice;
+	gchar *copy;
+
+	slice = g_malloc (sizeof (StringSlice) + len + 1);
+	copy = (gchar *) (slice + 1);
+	memcpy (copy, str, len);
+	copy[len] = '\0';
+
+	slice->str = copy;
+	slice->len = len;
+
+	return slice;
+}
+
+static void
+filter_matcher_add_slice (GHashTable  *table,
+                          GArray      *lengths,
+                          const gchar *str,
+                          gsize        len)
+{
+	StringSlice *slice;
+	guint i;
+
+	slice = string_slice_new (str, len);
+	g_hash_table_add (table, slice);
+
+	if (!lengths) {
+		return;
+	}
+
+	for (i = 0; i < lengths->len; i++) {
+		if (g_array_index (lengths, gsize, i) == len) {
+			return;
+		}
+	}
+
+	g_array_append_val (lengths, len);
+}
+
+static FilterMatcher *
+filter_matcher_new (GList             *patterns,
+                    TrackerFilterType  type)
+{
+	FilterMatcher *matcher;
+	GList *l;
+
+	matcher = g_slice_new0 (FilterMatcher);
+	matcher->literals = g_hash_table_new_full (string_slice_hash,
+	                                           string_slice_equal,
+	                                           g_free, NULL);
+	matcher->prefixes = g_hash_table_new_full (string_slice_hash,
+	                                           string_slice_equal,
+	                                           g_free, NULL);
+	matcher->suffixes = g_hash_table_new_full (string_slice_hash,
+	                                           string_slice_equal,
+	                                           g_free, NULL);
+	matcher->prefix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->suffix_lengths = g_array_new (FALSE, FALSE, sizeof (gsize));
+	matcher->globs = g_ptr_array_new ();
+	matcher->files = g_ptr_array_new ();
+
+	for (l = patterns; l; l = l->next) {
+		PatternData *data = l->data;
+		const gchar *glob, *wildcard;
+		gsize len;
+
+		if (data->type != type) {
+			continue;
+		}
+
+		if (data->file) {
+			/* Basenames never contain '/', only the path may match */
+			g_ptr_array_add (matcher->files, data->file);
+			continue;
+		}
+
+		glob = data->glob_string;
+		len = strlen (glob);
+		wildcard = strpbrk (glob, "*?");
+
+		if (!wildcard) {
+			filter_matcher_add_slice (matcher->literals, NULL, glob, len);
+		} else if (wildcard == glob && *wildcard == '*' &&
+		           !strpbrk (glob + 1, "*?")) {
+			filter_matcher_add_slice (matcher->suffixes,
+			                          matcher->suffix_lengths,
+			                          glob + 1, len - 1);
+		} else if (wildcard == glob + len - 1 && *wildcard == '*') {
+			filter_matcher_add_slice (matcher->prefixes,
+			                          matcher->prefix_lengths,
+			                          glob, len - 1);
+		} else {
+			g_ptr_array_add (matcher->globs, data->pattern);
+		}
+	}
+
+	return matcher;
+}
+
+static void
+filter_matcher_free (FilterMatcher *matcher)
+{
+	g_hash_table_unref (matcher->literals);
+	g_hash_table_unref (matcher->prefixes);
+	g_hash_table_unref (matcher->suffixes);
+	g_array_free (matcher->prefix_lengths, TRUE);
+	g_array_free (matcher->suffix_lengths, TRUE);
+	g_ptr_array_free (matcher->globs, TRUE);
+	g_ptr_array_free (matcher->files, TRUE);
+	g_slice_free (FilterMatcher, matcher);
+}
+
+static gboolean
+filter_matcher_match (FilterMatcher *matcher,
+                      GFile         *file,
+                      const gchar   *basename)
+{
+	StringSlice slice;
+	gsize len;
+	guint i;
+
+	for (i = 0; i < matcher->files->len; i++) {
+		GFile *filter_file = g_ptr_array_index (matcher->files, i);
+
+		if (g_file_equal (file, filter_file) ||
+		    g_file_has_prefix (file, filter_file)) {
+			return TRUE;
+		}
+	}
+
+	if (!basename) {
+		return FALSE;
+	}
+
+	len = strlen (basename);
+	slice.str = basename;
+	slice.len = len;
+
+	if (g_hash_table_contains (matcher->literals, &slice)) {
+		return TRUE;
+	}
+
+	for (i = 0; i < matcher->suffix_lengths->len; i++) {
+		slice.len = g_array_index (matcher->suffix_lengths, gsize, i);
+
+		if (slice.len > len) {
+			continue;
+		}
+
+		slice.str = basename + len - slice.len;
+
+		if (g_hash_table_contains (matcher->suffixes, &slice)) {
+			return TRUE;
+		}
+	}
+
+	slice.str = basename;
+
+	for (i = 0; i < matcher->prefix_lengths->len; i++) {
+		slice.len = g_array_index (matcher->prefix_lengths, gsize, i);
+
+		if (slice.len <= len &&
+		    g_hash_table_contains (matcher->prefixes, &slice)) {
+			return TRUE;
+		}
+	}
+
+	for (i = 0; i < matcher->globs->len; i++) {
+		if (g_pattern_match (g_ptr_array_index (matcher->globs, i),
+		                     len, basename, NULL)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static void
+indexing_tree_invalidate_matcher (TrackerIndexingTree *tree,
+                                  TrackerFilterType    type)
+{
+	TrackerIndexingTreePrivate *priv;
+
+	priv = tree->priv;
+
+	if (priv->matchers[type]) {
+		filter_matcher_free (priv->matchers[type]);
+		priv->matchers[type] = NULL;
+	}
+}
+
 static void
 tracker_indexing_tree_get_property (GObject    *object,
                                     guint       prop_id,
@@ -184,10 +439,15 @@ tracker_indexing_tree_finalize (GObject *object)
 {
 	TrackerIndexingTreePrivate *priv;
 	TrackerIndexingTree *tree;
+	guint i;
 
 	tree = TRACKER_INDEXING_TREE (object);
 	priv = tree->priv;
 
+	for (i = 0; i < G_N_ELEMENTS (priv->matchers); i++) {
+		indexing_tree_invalidate_matcher (tree, i);
+	}
+
 	g_list_foreach (priv->filter_patterns, (GFunc) pattern_data_free, NULL);
 	g_list_free (priv->filter_patterns);
 
@@ -511,6 +771,8 @@ tracker_indexing_tree_add_filter (TrackerIndexingTree *tree,
 
 	data = pattern_data_new (glob_string, filter);
 	priv->filter_patterns = g_list_prepend (priv->filter_patterns, data);
+
+	indexing_tree_invalidate_matcher (tree, filter);
 }
 
 /**
@@ -531,6 +793,8 @@ tracker_indexing_tree_clear_filters (TrackerIndexingTree *tree,
 
 	priv = tree->priv;
 
+	indexing_tree_invalidate_matcher (tree, type);
+
 	for (l = priv->filter_patterns; l; l = l->next) {
 		PatternData *data = l->data;
 
@@ -545,6 +809,41 @@ tracker_indexing_tree_clear_filters (TrackerIndexingTree *tree,
 	}
 }
 
+static gboolean
+indexing_tree_file_matches_filter (TrackerIndexingTree *tree,
+                                   TrackerFilterType    type,
+                                   GFile               *file)
+{
+	TrackerIndexingTreePrivate *priv;
+	FilterMatcher *matcher;
+	gchar *basename = NULL;
+	gboolean match;
+
+	priv = tree->priv;
+
+	if (!priv->matchers[type]) {
+		priv->matchers[type] = filter_matcher_new (priv->filter_patterns,
+		                                           type);
+	}
+
+	matcher = priv->matchers[type];
+
+	/* Avoid fetching the basename if no filter looks at it,
+	 * otherwise it's fetched once for all the filters.
+	 */
+	if (g_hash_table_size (matcher->literals) > 0 ||
+	    g_hash_table_size (matcher->prefixes) > 0 ||
+	    g_hash_table_size (matcher->suffixes) > 0 ||
+	    matcher->globs->len > 0) {
+		basename = g_file_get_basename (file);
+	}
+
+	match = filter_matcher_match (matcher, file, basename);
+	g_free (basename);
+
+	return match;
+}
+
 /**
  * tracker_indexing_tree_file_matches_filter:
  * @tree: a #TrackerIndexingTree
@@ -560,40 +859,10 @@ tracker_indexing_tree_file_matches_filter (TrackerIndexingTree *tree,
                                            TrackerFilterType    type,
                                            GFile               *file)
 {
-	TrackerIndexingTreePrivate *priv;
-	GList *filters;
-	gchar *basename;
-
 	g_return_val_if_fail (TRACKER_IS_INDEXING_TREE (tree), FALSE);
 	g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
-	priv = tree->priv;
-	filters = priv->filter_patterns;
-	basename = g_file_get_basename (file);
-
-	while (filters) {
-		PatternData *data = filters->data;
-
-		filters = filters->next;
-
-		if (data->type != type)
-			continue;
-
-		if (data->file &&
-		    (g_file_equal (file, data->file) ||
-		     g_file_has_prefix (file, data->file))) {
-			g_free (basename);
-			return TRUE;
-		}
-
-		if (g_pattern_match_string (data->pattern, basename)) {
-			g_free (basename);
-			return TRUE;
-		}
-	}
-
-	g_free (basename);
-	return FALSE;
+	return indexing_tree_file_matches_filter (tree, type, file);
 }
 
 static gboolean
@@ -614,7 +883,7 @@ indexing_tree_file_is_filtered (TrackerIndexingTree *tree,
 
 	priv = tree->priv;
 
-	if (tracker_indexing_tree_file_matches_filter (tree, filter, file)) {
+	if (indexing_tree_file_matches_filter (tree, filter, file)) {
 		if (priv->policies[filter] == TRACKER_FILTER_POLICY_ACCEPT) {
 			/* Filter blocks otherwise accepted
 			 * (by the default policy) file
@@ -97,6 +97,18 @@ static gboolean miner_fs_queues_status_trace_timeout_cb (gpointer data);
 /* Default processing pool limits to be set */
 #define DEFAULT_WAIT_POOL_LIMIT 1
 #define DEFAULT_READY_POOL_LIMIT 1
+#define DEFAULT_LOW_PRIORITY_POOL_LIMIT 1
+
+/* Seconds before the queues are looked at again when low priority
+ * files were held back.
+ */
+#define LOW_PRIORITY_RECHECK_INTERVAL 1
+
+/* Number of queued files whose locks are checked at once, a new
+ * batch is started once less than half of that is left checked
+ * at the head of the queue.
+ */
+#define LOCK_CHECK_BATCH_SIZE 64
 
 /* Put tasks processing at a lower priority so other events
  * (timeouts, monitor events, etc...) are guaranteed to be
@@ -142,7 +154,6 @@ typedef struct {
 
 typedef struct {
 	GMainLoop *main_loop;
-	GString   *sparql;
 	const gchar *source_uri;
 	const gchar *uri;
 } RecursiveMoveData;
@@ -164,8 +175,12 @@ struct _TrackerMinerFSPrivate {
 
 	GQuark          quark_ignore_file;
 	GQuark          quark_attribute_updated;
+	GQuark          quark_directory_deleted;
 	GQuark          quark_directory_found_crawling;
 	GQuark          quark_reentry_counter;
+	GQuark          quark_file_type;
+	GQuark          quark_lock_state;
+	GQuark          quark_lock_generation;
 
 	GTimer         *timer;
 	GTimer         *extraction_timer;
@@ -185,6 +200,10 @@ struct _TrackerMinerFSPrivate {
 	TrackerSparqlBuffer *sparql_buffer;
 	guint sparql_buffer_limit;
 
+	/* Max number of low priority files in the task pool */
+	guint low_priority_pool_limit;
+	guint low_priority_recheck_id;
+
 	TrackerIndexingTree *indexing_tree;
 
 	/* Status */
@@ -200,6 +219,10 @@ struct _TrackerMinerFSPrivate {
 	guint           timer_stopped : 1;    /* TRUE if main timer is stopped */
 	guint           extraction_timer_stopped : 1; /* TRUE if the extraction
 						       * timer is stopped */
+	guint           lock_check_running : 1; /* TRUE if queued files are
+	                                         * being checked for locks */
+	guint           lock_generation;      /* Bumped each time a file is
+	                                       * queued, see item_queue_file_set_type() */
 
 	/* Statistics */
 	guint           total_directories_found;
@@ -225,15 +248,37 @@ typedef enum {
 	QUEUE_MOVED,
 	QUEUE_IGNORE_NEXT_UPDATE,
 	QUEUE_WAIT,
-	QUEUE_WRITEBACK
+	QUEUE_WRITEBACK,
+	QUEUE_LOCK_CHECK
 } QueueState;
 
+typedef enum {
+	LOCK_STATE_UNKNOWN,
+	LOCK_STATE_UNLOCKED,
+	LOCK_STATE_LOCKED
+} LockState;
+
+typedef struct {
+	GFile *file;
+	GFileType file_type;
+	guint generation;
+	gboolean locked;
+} LockCheck;
+
+typedef struct {
+	TrackerMinerFS *fs;
+	GArray *checks;
+	guint n_checked;
+	gboolean checked_head;
+} LockCheckCollectData;
+
 enum {
 	PROCESS_FILE,
 	PROCESS_FILE_ATTRIBUTES,
 	IGNORE_NEXT_UPDATE_FILE,
 	FINISHED,
 	WRITEBACK_FILE,
+	GET_FILE_PRIORITY,
 	LAST_SIGNAL
 };
 
@@ -242,6 +287,7 @@ enum {
 	PROP_THROTTLE,
 	PROP_WAIT_POOL_LIMIT,
 	PROP_READY_POOL_LIMIT,
+	PROP_LOW_PRIORITY_POOL_LIMIT,
 	PROP_MTIME_CHECKING,
 	PROP_INITIAL_CRAWLING
 };
@@ -299,7 +345,7 @@ static void           file_notifier_finished              (TrackerFileNotifier *
                                                            gpointer             user_data);
 
 static void           item_queue_handlers_set_up          (TrackerMinerFS       *fs);
-static void           item_update_children_uri            (TrackerMinerFS       *fs,
+static void           item_move_children_thumbnails       (TrackerMinerFS       *fs,
                                                            RecursiveMoveData    *data,
                                                            const gchar          *source_uri,
                                                            const gchar          *uri);
@@ -356,6 +402,15 @@ tracker_miner_fs_class_init (TrackerMinerFSClass *klass)
 	                                                    "in a single connection to the store",
 	                                                    1, G_MAXUINT, DEFAULT_READY_POOL_LIMIT,
 	                                                    G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
+	g_object_class_install_property (object_class,
+	                                 PROP_LOW_PRIORITY_POOL_LIMIT,
+	                                 g_param_spec_uint ("processing-pool-low-priority-limit",
+	                                                    "Processing pool limit for low priority tasks",
+	                                                    "Maximum number of files with a priority lower than "
+	                                                    "G_PRIORITY_DEFAULT that can be concurrently "
+	                                                    "processed by the upper layer",
+	                                                    1, G_MAXUINT, DEFAULT_LOW_PRIORITY_POOL_LIMIT,
+	                                                    G_PARAM_READWRITE | G_PARAM_CONSTRUCT));
 	g_object_class_install_property (object_class,
 	                                 PROP_MTIME_CHECKING,
 	                                 g_param_spec_boolean ("mtime-checking",
@@ -531,6 +586,35 @@ tracker_miner_fs_class_init (TrackerMinerFSClass *klass)
 		              G_TYPE_PTR_ARRAY,
 		              G_TYPE_CANCELLABLE);
 
+	/**
+	 * TrackerMinerFS::get-file-priority:
+	 * @miner_fs: the #TrackerMinerFS
+	 * @file: a #GFile
+	 *
+	 * The ::get-file-priority signal is emitted when @file is queued
+	 * for processing after being found created or updated.
+	 *
+	 * Implementations can return a priority lower than
+	 * %G_PRIORITY_DEFAULT for files known to be expensive to process.
+	 * Those are processed after any other file in the same queue, and
+	 * no more than #TrackerMinerFS:processing-pool-low-priority-limit
+	 * of them are processed at once.
+	 *
+	 * Returns: the priority for @file, 0 (%G_PRIORITY_DEFAULT)
+	 *          if there's no handler.
+	 *
+	 * Since: 0.18
+	 **/
+	signals[GET_FILE_PRIORITY] =
+		g_signal_new ("get-file-priority",
+		              G_OBJECT_CLASS_TYPE (object_class),
+		              G_SIGNAL_RUN_LAST,
+		              0,
+		              NULL, NULL,
+		              tracker_marshal_INT__OBJECT,
+		              G_TYPE_INT,
+		              1, G_TYPE_FILE);
+
 	g_type_class_add_private (object_class, sizeof (TrackerMinerFSPrivate));
 }
 
@@ -611,7 +695,11 @@ tracker_miner_fs_init (TrackerMinerFS *object)
 	priv->quark_ignore_file = g_quark_from_static_string ("tracker-ignore-file");
 	priv->quark_directory_found_crawling = g_quark_from_static_string ("tracker-directory-found-crawling");
 	priv->quark_attribute_updated = g_quark_from_static_string ("tracker-attribute-updated");
+	priv->quark_directory_deleted = g_quark_from_static_string ("tracker-directory-deleted");
 	priv->quark_reentry_counter = g_quark_from_static_string ("tracker-reentry-counter");
+	priv->quark_file_type = g_quark_from_static_string ("tracker-file-type");
+	priv->quark_lock_state = g_quark_from_static_string ("tracker-lock-state");
+	priv->quark_lock_generation = g_quark_from_static_string ("tracker-lock-generation");
 
 	priv->mtime_checking = TRUE;
 	priv->initial_crawling = TRUE;
@@ -663,6 +751,11 @@ fs_finalize (GObject *object)
 		priv->item_queues_handler_id = 0;
 	}
 
+	if (priv->low_priority_recheck_id) {
+		g_source_remove (priv->low_priority_recheck_id);
+		priv->low_priority_recheck_id = 0;
+	}
+
 	if (priv->item_queue_blocker) {
 		g_object_unref (priv->item_queue_blocker);
 	}
@@ -744,6 +837,9 @@ fs_set_property (GObject      *object,
 			                             fs->priv->sparql_buffer_limit);
 		}
 		break;
+	case PROP_LOW_PRIORITY_POOL_LIMIT:
+		fs->priv->low_priority_pool_limit = g_value_get_uint (value);
+		break;
 	case PROP_MTIME_CHECKING:
 		fs->priv->mtime_checking = g_value_get_boolean (value);
 		break;
@@ -777,6 +873,9 @@ fs_get_property (GObject    *object,
 	case PROP_READY_POOL_LIMIT:
 		g_value_set_uint (value, fs->priv->sparql_buffer_limit);
 		break;
+	case PROP_LOW_PRIORITY_POOL_LIMIT:
+		g_value_set_uint (value, fs->priv->low_priority_pool_limit);
+		break;
 	case PROP_MTIME_CHECKING:
 		g_value_set_boolean (value, fs->priv->mtime_checking);
 		break;
@@ -910,6 +1009,9 @@ process_print_stats (TrackerMinerFS *fs)
 		              fs->priv->total_files_processed,
 		              fs->priv->total_files_notified,
 		              fs->priv->total_files_notified_error);
+		tracker_info ("Total time        : %2.2f seconds (%2.2f processing)",
+		              g_timer_elapsed (fs->priv->timer, NULL),
+		              g_timer_elapsed (fs->priv->extraction_timer, NULL));
 		tracker_info ("--------------------------------------------------\n");
 	}
 }
@@ -1174,6 +1276,11 @@ item_add_or_update_cb (TrackerMinerFS *fs,
 
 	tracker_task_pool_remove (fs->priv->task_pool, extraction_task);
 
+	if (ctxt->priority > G_PRIORITY_DEFAULT) {
+		/* Low priority items might be waiting for this one */
+		item_queue_handlers_set_up (fs);
+	}
+
 	if (error) {
 		g_message ("Could not process '%s': %s", uri, error->message);
 
@@ -1343,6 +1450,7 @@ item_remove (TrackerMinerFS *fs,
 {
 	gchar *uri;
 	TrackerTask *task;
+	gboolean is_directory;
 	guint flags = 0;
 
 	uri = g_file_get_uri (file);
@@ -1350,6 +1458,11 @@ item_remove (TrackerMinerFS *fs,
 	g_debug ("Removing item: '%s' (Deleted from filesystem or no longer monitored)",
 	         uri);
 
+	/* Children are only removed from directories */
+	is_directory = only_children ||
+		GPOINTER_TO_INT (g_object_steal_qdata (G_OBJECT (file),
+		                                       fs->priv->quark_directory_deleted));
+
 	if (!only_children) {
 		flags = TRACKER_BULK_MATCH_EQUALS;
 	} else {
@@ -1357,46 +1470,61 @@ item_remove (TrackerMinerFS *fs,
 		tracker_media_art_queue_remove (uri, NULL);
 	}
 
-	/* FIRST:
-	 * Remove tracker:available for the resources we're going to remove.
-	 * This is done so that unavailability of the resources is marked as soon
-	 * as possible, as the actual delete may take reaaaally a long time
-	 * (removing resources for 30GB of files takes even 30minutes in a 1-CPU
-	 * device). */
+	if (is_directory) {
+		/* The store deletes the whole subtree in one go,
+		 * after what's buffered so far */
+		task = tracker_sparql_task_new_delete_descendants (file);
+		tracker_sparql_buffer_push (fs->priv->sparql_buffer,
+		                            task,
+		                            G_PRIORITY_DEFAULT,
+		                            sparql_buffer_task_finished_cb,
+		                            fs);
+	} else {
+		/* Not known to be a directory, match children just in case */
+		flags |= TRACKER_BULK_MATCH_CHILDREN;
+	}
 
-	/* Add new task to processing pool */
-	task = tracker_sparql_task_new_bulk (file,
-	                                     "DELETE { "
-	                                     "  ?f tracker:available true "
-	                                     "}",
-	                                     flags | TRACKER_BULK_MATCH_CHILDREN);
+	if (flags != 0) {
+		/* FIRST:
+		 * Remove tracker:available for the resources we're going to remove.
+		 * This is done so that unavailability of the resources is marked as soon
+		 * as possible, as the actual delete may take reaaaally a long time
+		 * (removing resources for 30GB of files takes even 30minutes in a 1-CPU
+		 * device). */
+
+		/* Add new task to processing pool */
+		task = tracker_sparql_task_new_bulk (file,
+		                                     "DELETE { "
+		                                     "  ?f tracker:available true "
+		                                     "}",
+		                                     flags);
 
-	tracker_sparql_buffer_push (fs->priv->sparql_buffer,
-	                            task,
-	                            G_PRIORITY_DEFAULT,
-	                            sparql_buffer_task_finished_cb,
-	                            fs);
+		tracker_sparql_buffer_push (fs->priv->sparql_buffer,
+		                            task,
+		                            G_PRIORITY_DEFAULT,
+		                            sparql_buffer_task_finished_cb,
+		                            fs);
 
-	/* SECOND:
-	 * Actually remove all resources. This operation is the one which may take
-	 * a long time.
-	 */
+		/* SECOND:
+		 * Actually remove all resources. This operation is the one which may take
+		 * a long time.
+		 */
 
-	/* Add new task to processing pool */
-	task = tracker_sparql_task_new_bulk (file,
-	                                     "DELETE { "
-	                                     "  ?f a rdfs:Resource . "
-	                                     "  ?ie a rdfs:Resource "
-	                                     "}",
-	                                     flags |
-	                                     TRACKER_BULK_MATCH_CHILDREN |
-	                                     TRACKER_BULK_MATCH_LOGICAL_RESOURCES);
+		/* Add new task to processing pool */
+		task = tracker_sparql_task_new_bulk (file,
+		                                     "DELETE { "
+		                                     "  ?f a rdfs:Resource . "
+		                                     "  ?ie a rdfs:Resource "
+		                                     "}",
+		                                     flags |
+		                                     TRACKER_BULK_MATCH_LOGICAL_RESOURCES);
 
-	tracker_sparql_buffer_push (fs->priv->sparql_buffer,
-	                            task,
-	                            G_PRIORITY_DEFAULT,
-	                            sparql_buffer_task_finished_cb,
-	                            fs);
+		tracker_sparql_buffer_push (fs->priv->sparql_buffer,
+		                            task,
+		                            G_PRIORITY_DEFAULT,
+		                            sparql_buffer_task_finished_cb,
+		                            fs);
+	}
 
 	if (!tracker_task_pool_limit_reached (TRACKER_TASK_POOL (fs->priv->sparql_buffer))) {
 		item_queue_handlers_set_up (fs);
@@ -1501,9 +1629,9 @@ item_ignore_next_update (TrackerMinerFS *fs,
 }
 
 static void
-item_update_children_uri_cb (GObject      *object,
-                             GAsyncResult *result,
-                             gpointer      user_data)
+item_move_children_thumbnails_cb (GObject      *object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
 {
 	RecursiveMoveData *data = user_data;
 	GError *error = NULL;
@@ -1518,12 +1646,11 @@ item_update_children_uri_cb (GObject      *object,
 		}
 	} else {
 		while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
-			const gchar *child_source_uri, *child_mime, *child_urn;
+			const gchar *child_source_uri, *child_mime;
 			gchar *child_uri;
 
-			child_urn = tracker_sparql_cursor_get_string (cursor, 0, NULL);
-			child_source_uri = tracker_sparql_cursor_get_string (cursor, 1, NULL);
-			child_mime = tracker_sparql_cursor_get_string (cursor, 2, NULL);
+			child_source_uri = tracker_sparql_cursor_get_string (cursor, 0, NULL);
+			child_mime = tracker_sparql_cursor_get_string (cursor, 1, NULL);
 
 			if (!g_str_has_prefix (child_source_uri, data->source_uri)) {
 				g_warning ("Child URI '%s' does not start with parent URI '%s'",
@@ -1534,20 +1661,6 @@ item_update_children_uri_cb (GObject      *object,
 
 			child_uri = g_strdup_printf ("%s%s", data->uri, child_source_uri + strlen (data->source_uri));
 
-			g_string_append_printf (data->sparql,
-			                        "DELETE { "
-			                        "  <%s> nie:url ?u "
-			                        "} WHERE { "
-			                        "  <%s> nie:url ?u "
-			                        "} ",
-			                        child_urn, child_urn);
-
-			g_string_append_printf (data->sparql,
-			                        "INSERT INTO <%s> {"
-			                        "  <%s> nie:url \"%s\" "
-			                        "} ",
-			                        child_urn, child_urn, child_uri);
-
 			tracker_thumbnailer_move_add (child_source_uri, child_mime, child_uri);
 
 			g_free (child_uri);
@@ -1560,14 +1673,14 @@ item_update_children_uri_cb (GObject      *object,
 }
 
 static void
-item_update_children_uri (TrackerMinerFS    *fs,
-                          RecursiveMoveData *move_data,
-                          const gchar       *source_uri,
-                          const gchar       *uri)
+item_move_children_thumbnails (TrackerMinerFS    *fs,
+                               RecursiveMoveData *move_data,
+                               const gchar       *source_uri,
+                               const gchar       *uri)
 {
 	gchar *sparql;
 
-	sparql = g_strdup_printf ("SELECT ?child ?url nie:mimeType(?child) WHERE { "
+	sparql = g_strdup_printf ("SELECT ?url nie:mimeType(?child) WHERE { "
 	                          "  ?child nie:url ?url . "
 	                          "  FILTER (tracker:uri-is-descendant (\"%s\", ?url)) "
 	                          "}",
@@ -1576,7 +1689,7 @@ item_update_children_uri (TrackerMinerFS    *fs,
 	tracker_sparql_connection_query_async (tracker_miner_get_connection (TRACKER_MINER (fs)),
 	                                       sparql,
 	                                       NULL,
-	                                       item_update_children_uri_cb,
+	                                       item_move_children_thumbnails_cb,
 	                                       move_data);
 
 	g_free (sparql);
@@ -1594,7 +1707,7 @@ item_move (TrackerMinerFS *fs,
 	TrackerTask *task;
 	const gchar *source_iri;
 	gchar *display_name;
-	gboolean source_exists;
+	gboolean source_exists, update_children = FALSE;
 	GFile *new_parent;
 	const gchar *new_parent_iri;
 	TrackerDirectoryFlags source_flags, flags;
@@ -1708,17 +1821,20 @@ item_move (TrackerMinerFS *fs,
 		                                file, &flags);
 
 		if ((flags & TRACKER_DIRECTORY_FLAG_RECURSE) != 0) {
-			/* Update children uris */
+			/* Move children thumbnails */
 			move_data.main_loop = g_main_loop_new (NULL, FALSE);
-			move_data.sparql = sparql;
 			move_data.source_uri = source_uri;
 			move_data.uri = uri;
 
-			item_update_children_uri (fs, &move_data, source_uri, uri);
+			item_move_children_thumbnails (fs, &move_data, source_uri, uri);
 
 			g_main_loop_run (move_data.main_loop);
 
 			g_main_loop_unref (move_data.main_loop);
+
+			/* Children URLs are rewritten by the store
+			 * in the same transaction as the move */
+			update_children = TRUE;
 		} else {
 			/* A directory is being moved from a recursive location to
 			 * a non-recursive one, mark all children as deleted.
@@ -1728,9 +1844,27 @@ item_move (TrackerMinerFS *fs,
 	}
 
 	/* Add new task to processing pool */
-	task = tracker_sparql_task_new_take_sparql_str (file,
-	                                                g_string_free (sparql,
-	                                                               FALSE));
+	if (update_children) {
+		gchar *source_prefix, *prefix;
+
+		source_prefix = g_strconcat (source_uri, "/", NULL);
+		prefix = g_strconcat (uri, "/", NULL);
+
+		/* Sent after the buffered tasks, so these
+		 * can't recreate URLs in the old location */
+		task = tracker_sparql_task_new_uri_prefix (file,
+		                                           source_prefix,
+		                                           prefix,
+		                                           sparql->str);
+		g_string_free (sparql, TRUE);
+		g_free (source_prefix);
+		g_free (prefix);
+	} else {
+		task = tracker_sparql_task_new_take_sparql_str (file,
+		                                                g_string_free (sparql,
+		                                                               FALSE));
+	}
+
 	tracker_sparql_buffer_push (fs->priv->sparql_buffer,
 	                            task,
 	                            G_PRIORITY_DEFAULT,
@@ -1840,6 +1974,238 @@ item_reenqueue (TrackerMinerFS       *fs,
 	return item_reenqueue_full (fs, item_queue, queue_file, queue_file, priority);
 }
 
+static void
+count_low_priority_tasks_foreach (gpointer data,
+                                  gpointer user_data)
+{
+	UpdateProcessingTaskContext *ctxt;
+	guint *n_tasks = user_data;
+
+	ctxt = tracker_task_get_data (data);
+
+	if (ctxt->priority > G_PRIORITY_DEFAULT) {
+		(*n_tasks)++;
+	}
+}
+
+static gboolean
+low_priority_recheck_cb (gpointer user_data)
+{
+	TrackerMinerFS *fs = user_data;
+
+	fs->priv->low_priority_recheck_id = 0;
+	item_queue_handlers_set_up (fs);
+
+	return FALSE;
+}
+
+/* Whether the next item in the queue is a low priority one,
+ * and the pool already has as many of those as allowed.
+ */
+static gboolean
+item_queue_is_throttled (TrackerMinerFS       *fs,
+                         TrackerPriorityQueue *item_queue)
+{
+	guint n_tasks = 0;
+	gint priority;
+
+	if (!tracker_priority_queue_peek (item_queue, &priority) ||
+	    priority <= G_PRIORITY_DEFAULT) {
+		return FALSE;
+	}
+
+	tracker_task_pool_foreach (fs->priv->task_pool,
+	                           count_low_priority_tasks_foreach,
+	                           &n_tasks);
+
+	if (n_tasks < fs->priv->low_priority_pool_limit) {
+		return FALSE;
+	}
+
+	/* Finishing low priority tasks set up the queue handlers
+	 * again, but they can also leave the pool on other paths,
+	 * so the held back items are looked at again anyway.
+	 */
+	if (fs->priv->low_priority_recheck_id == 0) {
+		fs->priv->low_priority_recheck_id =
+			g_timeout_add_seconds (LOW_PRIORITY_RECHECK_INTERVAL,
+			                       low_priority_recheck_cb,
+			                       fs);
+	}
+
+	return TRUE;
+}
+
+static void
+lock_checks_free (GArray *checks)
+{
+	guint i;
+
+	for (i = 0; i < checks->len; i++) {
+		g_object_unref (g_array_index (checks, LockCheck, i).file);
+	}
+
+	g_array_free (checks, TRUE);
+}
+
+static void
+lock_check_thread (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+	GArray *checks = task_data;
+	guint i;
+
+	for (i = 0; i < checks->len; i++) {
+		LockCheck *check = &g_array_index (checks, LockCheck, i);
+
+		check->locked = tracker_file_is_locked_with_type (check->file,
+		                                                  check->file_type);
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+lock_check_cb (GObject      *object,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+	TrackerMinerFS *fs = TRACKER_MINER_FS (object);
+	GArray *checks;
+	guint i;
+
+	checks = g_task_get_task_data (G_TASK (result));
+
+	for (i = 0; i < checks->len; i++) {
+		LockCheck *check = &g_array_index (checks, LockCheck, i);
+		guint generation;
+
+		/* The file was queued again meanwhile, its state was
+		 * cleared and this result may be outdated already.
+		 */
+		generation = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (check->file),
+		                                                   fs->priv->quark_lock_generation));
+		if (generation != check->generation) {
+			continue;
+		}
+
+		g_object_set_qdata (G_OBJECT (check->file),
+		                    fs->priv->quark_lock_state,
+		                    GINT_TO_POINTER (check->locked ?
+		                                     LOCK_STATE_LOCKED :
+		                                     LOCK_STATE_UNLOCKED));
+	}
+
+	fs->priv->lock_check_running = FALSE;
+	item_queue_handlers_set_up (fs);
+}
+
+static void
+lock_check_collect_foreach (gpointer data,
+                            gpointer user_data)
+{
+	LockCheckCollectData *collect = user_data;
+	TrackerMinerFSPrivate *priv = collect->fs->priv;
+	LockCheck check;
+
+	if (g_object_get_qdata (G_OBJECT (data), priv->quark_lock_state)) {
+		if (collect->checks->len == 0) {
+			collect->n_checked++;
+		}
+
+		return;
+	}
+
+	if (collect->checks->len == LOCK_CHECK_BATCH_SIZE) {
+		return;
+	}
+
+	check.file = g_object_ref (data);
+	check.file_type = GPOINTER_TO_INT (g_object_get_qdata (G_OBJECT (data), priv->quark_file_type));
+	check.generation = GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (data), priv->quark_lock_generation));
+	check.locked = FALSE;
+	g_array_append_val (collect->checks, check);
+}
+
+/* Files are checked for locks before being processed, so files that
+ * are still being written aren't indexed. This is done in batches in
+ * a thread ahead of the files being popped from @item_queue, using
+ * the file type the notifier found while crawling.
+ *
+ * Returns TRUE if the first file in @item_queue is still unchecked.
+ */
+static gboolean
+item_queue_check_locks (TrackerMinerFS       *fs,
+                        TrackerPriorityQueue *item_queue)
+{
+	LockCheckCollectData collect = { 0 };
+	GFile *file;
+	GTask *task;
+
+	file = tracker_priority_queue_peek (item_queue, NULL);
+
+	if (!file) {
+		return FALSE;
+	}
+
+	if (fs->priv->lock_check_running) {
+		return g_object_get_qdata (G_OBJECT (file), fs->priv->quark_lock_state) == NULL;
+	}
+
+	collect.fs = fs;
+	collect.checks = g_array_sized_new (FALSE, FALSE, sizeof (LockCheck),
+	                                    LOCK_CHECK_BATCH_SIZE);
+
+	tracker_priority_queue_foreach_n (item_queue,
+	                                  2 * LOCK_CHECK_BATCH_SIZE,
+	                                  lock_check_collect_foreach,
+	                                  &collect);
+
+	if (collect.checks->len == 0 ||
+	    collect.n_checked >= LOCK_CHECK_BATCH_SIZE / 2) {
+		/* Enough files are checked already */
+		lock_checks_free (collect.checks);
+		return FALSE;
+	}
+
+	fs->priv->lock_check_running = TRUE;
+
+	task = g_task_new (fs, NULL, lock_check_cb, NULL);
+	g_task_set_task_data (task, collect.checks, (GDestroyNotify) lock_checks_free);
+	g_task_run_in_thread (task, lock_check_thread);
+	g_object_unref (task);
+
+	return collect.n_checked == 0;
+}
+
+/* Returns whether @file is locked, for the file being popped from
+ * the queue. Files found unlocked by item_queue_check_locks() are
+ * trusted, files found locked or not checked yet (e.g. queued again
+ * while being checked) are looked at again, so a file is never
+ * skipped on an outdated result.
+ */
+static gboolean
+item_queue_file_is_locked (TrackerMinerFS *fs,
+                           GFile          *file)
+{
+	LockState state;
+	GFileType file_type;
+
+	state = GPOINTER_TO_INT (g_object_steal_qdata (G_OBJECT (file),
+	                                               fs->priv->quark_lock_state));
+
+	if (state == LOCK_STATE_UNLOCKED) {
+		return FALSE;
+	}
+
+	file_type = GPOINTER_TO_INT (g_object_get_qdata (G_OBJECT (file),
+	                                                 fs->priv->quark_file_type));
+
+	return tracker_file_is_locked_with_type (file, file_type);
+}
+
 static QueueState
 item_queue_get_next_file (TrackerMinerFS  *fs,
                           GFile          **file,
@@ -1917,8 +2283,15 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 	}
 
 	/* Created items next */
-	queue_file = tracker_priority_queue_pop (fs->priv->items_created,
-	                                         &priority);
+	if (item_queue_is_throttled (fs, fs->priv->items_created)) {
+		queue_file = NULL;
+	} else if (item_queue_check_locks (fs, fs->priv->items_created)) {
+		return QUEUE_LOCK_CHECK;
+	} else {
+		queue_file = tracker_priority_queue_pop (fs->priv->items_created,
+		                                         &priority);
+	}
+
 	if (queue_file) {
 		*source_file = NULL;
 
@@ -1972,8 +2345,15 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 	}
 
 	/* Updated items next */
-	queue_file = tracker_priority_queue_pop (fs->priv->items_updated,
-	                                         &priority);
+	if (item_queue_is_throttled (fs, fs->priv->items_updated)) {
+		queue_file = NULL;
+	} else if (item_queue_check_locks (fs, fs->priv->items_updated)) {
+		return QUEUE_LOCK_CHECK;
+	} else {
+		queue_file = tracker_priority_queue_pop (fs->priv->items_updated,
+		                                         &priority);
+	}
+
 	if (queue_file) {
 		*file = queue_file;
 		*source_file = NULL;
@@ -2065,14 +2445,18 @@ item_queue_get_next_file (TrackerMinerFS  *fs,
 
 	if (tracker_file_notifier_is_active (fs->priv->file_notifier) ||
 	    tracker_task_pool_limit_reached (fs->priv->task_pool) ||
-	    tracker_task_pool_limit_reached (TRACKER_TASK_POOL (fs->priv->sparql_buffer))) {
+	    tracker_task_pool_limit_reached (TRACKER_TASK_POOL (fs->priv->sparql_buffer)) ||
+	    !tracker_priority_queue_is_empty (fs->priv->items_created) ||
+	    !tracker_priority_queue_is_empty (fs->priv->items_updated)) {
 		if (tracker_task_pool_get_size (fs->priv->task_pool) == 0) {
 			fs->priv->extraction_timer_stopped = TRUE;
 			g_timer_stop (fs->priv->extraction_timer);
 		}
 
 		/* There are still pending items to crawl,
-		 * or extract pool limit is reached
+		 * extract pool limit is reached, or only low
+		 * priority items are left and enough of those
+		 * are being processed.
 		 */
 		return QUEUE_WAIT;
 	}
@@ -2158,8 +2542,16 @@ item_queue_handlers_cb (gpointer user_data)
 		return FALSE;
 	}
 
-	if (file && queue != QUEUE_DELETED &&
-	    tracker_file_is_locked (file)) {
+	if (queue == QUEUE_LOCK_CHECK) {
+		/* Handlers are set up again once the
+		 * next files have been checked for locks.
+		 */
+		fs->priv->item_queues_handler_id = 0;
+		return FALSE;
+	}
+
+	if (file && (queue == QUEUE_CREATED || queue == QUEUE_UPDATED) &&
+	    item_queue_file_is_locked (fs, file)) {
 		gchar *uri;
 
 		/* File is locked, ignore any updates on it */
@@ -2664,6 +3056,38 @@ check_item_queues (TrackerMinerFS *fs,
 	return TRUE;
 }
 
+static gint
+get_file_priority (TrackerMinerFS *fs,
+                   GFile          *file)
+{
+	gint priority = G_PRIORITY_DEFAULT;
+
+	g_signal_emit (fs, signals[GET_FILE_PRIORITY], 0, file, &priority);
+
+	return priority;
+}
+
+/* Keeps the file type found by the notifier for the lock checks,
+ * as regular files are forgotten by it after crawling.
+ */
+static void
+item_queue_file_set_type (TrackerMinerFS *fs,
+                          GFile          *file)
+{
+	GFileType file_type;
+
+	file_type = tracker_file_notifier_get_file_type (fs->priv->file_notifier, file);
+	g_object_set_qdata (G_OBJECT (file),
+	                    fs->priv->quark_file_type,
+	                    GINT_TO_POINTER (file_type));
+	g_object_set_qdata (G_OBJECT (file),
+	                    fs->priv->quark_lock_state,
+	                    NULL);
+	g_object_set_qdata (G_OBJECT (file),
+	                    fs->priv->quark_lock_generation,
+	                    GUINT_TO_POINTER (++fs->priv->lock_generation));
+}
+
 static void
 file_notifier_file_created (TrackerFileNotifier  *notifier,
                             GFile                *file,
@@ -2672,9 +3096,10 @@ file_notifier_file_created (TrackerFileNotifier  *notifier,
 	TrackerMinerFS *fs = user_data;
 
 	if (check_item_queues (fs, QUEUE_CREATED, file, NULL)) {
+		item_queue_file_set_type (fs, file);
 		tracker_priority_queue_add (fs->priv->items_created,
 		                            g_object_ref (file),
-		                            G_PRIORITY_DEFAULT);
+		                            get_file_priority (fs, file));
 		item_queue_handlers_set_up (fs);
 	}
 }
@@ -2686,6 +3111,13 @@ file_notifier_file_deleted (TrackerFileNotifier  *notifier,
 {
 	TrackerMinerFS *fs = user_data;
 
+	/* The notifier forgets about the file right after this */
+	if (tracker_file_notifier_get_file_type (notifier, file) == G_FILE_TYPE_DIRECTORY) {
+		g_object_set_qdata (G_OBJECT (file),
+		                    fs->priv->quark_directory_deleted,
+		                    GINT_TO_POINTER (TRUE));
+	}
+
 	if (check_item_queues (fs, QUEUE_DELETED, file, NULL)) {
 		tracker_priority_queue_add (fs->priv->items_deleted,
 		                            g_object_ref (file),
@@ -2714,15 +3146,23 @@ file_notifier_file_updated (TrackerFileNotifier  *notifier,
 	}
 
 	if (check_item_queues (fs, QUEUE_UPDATED, file, NULL)) {
+		gint priority;
+
 		if (attributes_only) {
 			g_object_set_qdata (G_OBJECT (file),
 			                    fs->priv->quark_attribute_updated,
 			                    GINT_TO_POINTER (TRUE));
+
+			/* No need to look into the file contents */
+			priority = G_PRIORITY_DEFAULT;
+		} else {
+			priority = get_file_priority (fs, file);
 		}
 
+		item_queue_file_set_type (fs, file);
 		tracker_priority_queue_add (fs->priv->items_updated,
 		                            g_object_ref (file),
-		                            G_PRIORITY_DEFAULT);
+		                            priority);
 		item_queue_handlers_set_up (fs);
 	}
 }
@@ -165,6 +165,28 @@ tracker_priority_queue_foreach (TrackerPriorityQueue *queue,
 	g_queue_foreach (&queue->queue, func, user_data);
 }
 
+/* Same as tracker_priority_queue_foreach(), only for the first
+ * @max_items elements, in priority order.
+ */
+void
+tracker_priority_queue_foreach_n (TrackerPriorityQueue *queue,
+                                  guint                 max_items,
+                                  GFunc                 func,
+                                  gpointer              user_data)
+{
+	GList *list;
+	guint i;
+
+	g_return_if_fail (queue != NULL);
+	g_return_if_fail (func != NULL);
+
+	for (list = queue->queue.head, i = 0;
+	     list && i < max_items;
+	     list = list->next, i++) {
+		(func) (list->data, user_data);
+	}
+}
+
 gboolean
 tracker_priority_queue_foreach_remove (TrackerPriorityQueue *queue,
                                        GEqualFunc            compare_func,
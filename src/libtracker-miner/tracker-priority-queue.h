@@ -45,6 +45,11 @@ void     tracker_priority_queue_foreach (TrackerPriorityQueue *queue,
                                          GFunc                 func,
                                          gpointer              user_data);
 
+void     tracker_priority_queue_foreach_n (TrackerPriorityQueue *queue,
+                                           guint                 max_items,
+                                           GFunc                 func,
+                                           gpointer              user_data);
+
 gboolean tracker_priority_queue_foreach_remove (TrackerPriorityQueue *queue,
                                                 GEqualFunc            compare_func,
                                                 gpointer              compare_user_data,
@@ -28,6 +28,18 @@
 /* Maximum time (seconds) before forcing a sparql buffer flush */
 #define MAX_SPARQL_BUFFER_TIME  15
 
+/* Maximum number of array updates sent to the store at once, so the
+ * next batch can be filled while the previous ones are committed.
+ * Tasks stay in the pool until their update is finished, so the
+ * pool limit still throttles the miner if the store falls behind.
+ */
+#define MAX_UPDATES_IN_FLIGHT   3
+
+/* The number of tasks per flush adapts so an array update takes
+ * about this long (ms) to be committed.
+ */
+#define TARGET_UPDATE_TIME      1000
+
 typedef struct _TrackerSparqlBufferPrivate TrackerSparqlBufferPrivate;
 typedef struct _SparqlTaskData SparqlTaskData;
 typedef struct _UpdateArrayData UpdateArrayData;
@@ -42,7 +54,9 @@ enum {
 enum {
 	TASK_TYPE_SPARQL_STR,
 	TASK_TYPE_SPARQL,
-	TASK_TYPE_BULK
+	TASK_TYPE_BULK,
+	TASK_TYPE_URI_PREFIX,
+	TASK_TYPE_DELETE_DESCENDANTS
 };
 
 struct _TrackerSparqlBufferPrivate
@@ -50,7 +64,11 @@ struct _TrackerSparqlBufferPrivate
 	TrackerSparqlConnection *connection;
 	guint flush_timeout_id;
 	GPtrArray *tasks;
-	gint n_updates;
+
+	/* UpdateArrayData, in the order they were flushed */
+	GQueue updates;
+	guint batch_size;
+	gint64 average_update_time;
 };
 
 struct _SparqlTaskData
@@ -65,6 +83,12 @@ struct _SparqlTaskData
 			gchar *str;
 			guint flags;
 		} bulk;
+
+		struct {
+			gchar *str;
+			gchar *old_prefix;
+			gchar *new_prefix;
+		} uri_prefix;
 	} data;
 
 	GSimpleAsyncResult *result;
@@ -82,6 +106,12 @@ struct _UpdateArrayData {
 	GArray *error_map;
 	GPtrArray *bulk_ops;
 	gint n_bulk_operations;
+
+	gint64 start_time;
+	gboolean ordered;
+	gboolean finished;
+	GPtrArray *errors;
+	GError *global_error;
 };
 
 struct _BulkOperationMerge {
@@ -177,8 +207,8 @@ flush_timeout_cb (gpointer user_data)
 	TrackerSparqlBuffer *buffer = user_data;
 	TrackerSparqlBufferPrivate *priv = buffer->priv;
 
-	tracker_sparql_buffer_flush (buffer, "Buffer time reached");
 	priv->flush_timeout_id = 0;
+	tracker_sparql_buffer_flush (buffer, "Buffer time reached");
 
 	return FALSE;
 }
@@ -247,37 +277,145 @@ update_array_data_free (UpdateArrayData *update_data)
 	                     update_data->buffer);
 	g_ptr_array_free (update_data->tasks, TRUE);
 
+	if (update_data->errors) {
+		g_ptr_array_unref (update_data->errors);
+	}
+
+	if (update_data->global_error) {
+		g_error_free (update_data->global_error);
+	}
+
 	g_array_free (update_data->error_map, TRUE);
 	g_slice_free (UpdateArrayData, update_data);
 }
 
+static guint
+get_batch_size (TrackerSparqlBuffer *buffer)
+{
+	TrackerSparqlBufferPrivate *priv;
+	guint max_size;
+
+	priv = buffer->priv;
+
+	/* Keep at least half of the pool for the updates in flight */
+	max_size = MAX (1, tracker_task_pool_get_limit (TRACKER_TASK_POOL (buffer)) / 2);
+
+	if (priv->batch_size == 0) {
+		return max_size;
+	}
+
+	return MIN (priv->batch_size, max_size);
+}
+
 static void
-tracker_sparql_buffer_update_array_cb (GObject      *object,
-                                       GAsyncResult *result,
-                                       gpointer      user_data)
+update_batch_size (TrackerSparqlBuffer *buffer,
+                   gint64               update_time)
 {
 	TrackerSparqlBufferPrivate *priv;
-	GError *global_error = NULL;
-	GPtrArray *sparql_array_errors;
-	UpdateArrayData *update_data;
-	gint i;
+	guint batch_size;
 
-	/* Get arrays of errors and queries */
-	update_data = user_data;
-	priv = TRACKER_SPARQL_BUFFER (update_data->buffer)->priv;
-	priv->n_updates--;
+	priv = buffer->priv;
 
-	g_debug ("(Sparql buffer) Finished array-update with %u tasks",
-	         update_data->tasks->len);
+	if (priv->average_update_time == 0) {
+		priv->average_update_time = update_time;
+	} else {
+		priv->average_update_time = (3 * priv->average_update_time + update_time) / 4;
+	}
 
-	sparql_array_errors = tracker_sparql_connection_update_array_finish (priv->connection,
-	                                                                     result,
-	                                                                     &global_error);
-	if (global_error) {
-		g_critical ("  (Sparql buffer) Error in array-update: %s",
-		            global_error->message);
+	batch_size = get_batch_size (buffer);
+
+	/* Send less per update if the store is taking too long to
+	 * commit these, and more if it keeps up, so there's fewer
+	 * commits.
+	 */
+	if (priv->average_update_time > TARGET_UPDATE_TIME * 1000) {
+		batch_size = MAX (1, 3 * batch_size / 4);
+	} else if (priv->average_update_time < TARGET_UPDATE_TIME * 1000 / 2) {
+		batch_size += MAX (1, batch_size / 4);
 	}
 
+	priv->batch_size = batch_size;
+}
+
+static gboolean
+task_is_ordered (TrackerTask *task)
+{
+	SparqlTaskData *task_data;
+
+	task_data = tracker_task_get_data (task);
+
+	return (task_data->type == TASK_TYPE_URI_PREFIX ||
+	        task_data->type == TASK_TYPE_DELETE_DESCENDANTS);
+}
+
+static gboolean
+ordered_task_affects_file (TrackerTask *task,
+                           GFile       *file,
+                           const gchar *uri)
+{
+	SparqlTaskData *task_data;
+	GFile *task_file;
+
+	task_file = tracker_task_get_file (task);
+
+	if (g_file_equal (file, task_file) ||
+	    g_file_has_prefix (file, task_file)) {
+		return TRUE;
+	}
+
+	task_data = tracker_task_get_data (task);
+
+	/* Files moved along with a directory, on either side */
+	return (task_data->type == TASK_TYPE_URI_PREFIX &&
+	        (g_str_has_prefix (uri, task_data->data.uri_prefix.old_prefix) ||
+	         g_str_has_prefix (uri, task_data->data.uri_prefix.new_prefix)));
+}
+
+/* Whether an ordered task waiting in the buffer or in flight
+ * concerns @file, tasks for it must then be sent after it.
+ */
+static gboolean
+file_has_pending_ordered_task (TrackerSparqlBuffer *buffer,
+                               GFile               *file)
+{
+	TrackerSparqlBufferPrivate *priv;
+	gboolean pending = FALSE;
+	gchar *uri;
+	GList *l;
+	guint i;
+
+	priv = buffer->priv;
+	uri = g_file_get_uri (file);
+
+	for (l = priv->updates.head; l && !pending; l = l->next) {
+		UpdateArrayData *update_data = l->data;
+
+		if (update_data->ordered) {
+			pending = ordered_task_affects_file (g_ptr_array_index (update_data->tasks, 0),
+			                                     file, uri);
+		}
+	}
+
+	for (i = 0; priv->tasks && i < priv->tasks->len && !pending; i++) {
+		TrackerTask *task = g_ptr_array_index (priv->tasks, i);
+
+		if (task_is_ordered (task)) {
+			pending = ordered_task_affects_file (task, file, uri);
+		}
+	}
+
+	g_free (uri);
+
+	return pending;
+}
+
+static void
+update_array_data_complete (UpdateArrayData *update_data)
+{
+	GError *global_error = update_data->global_error;
+	GPtrArray *sparql_array_errors = update_data->errors;
+	gint i;
+
 	/* Report status on each task of the batch update */
 	for (i = 0; i < update_data->tasks->len; i++) {
 		TrackerTask *task;
@@ -289,7 +427,7 @@ tracker_sparql_buffer_update_array_cb (GObject      *object,
 
 		if (global_error) {
 			error = global_error;
-		} else {
+		} else if (sparql_array_errors) {
 			gint error_pos;
 
 			error_pos = g_array_index (update_data->error_map, gint, i);
@@ -329,7 +467,7 @@ tracker_sparql_buffer_update_array_cb (GObject      *object,
 
 					g_debug ("    Sparql: %s", bulk->sparql);
 				} else {
-					const gchar *sparql;
+					const gchar *sparql = NULL;
 					gchar *uri;
 
 					uri = g_file_get_uri (tracker_task_get_file (task));
@@ -364,19 +502,163 @@ tracker_sparql_buffer_update_array_cb (GObject      *object,
 		g_simple_async_result_complete (task_data->result);
 
 		/* No need to deallocate the task here, it will be done when
-		 * unref-ing the UpdateArrayData below */
+		 * unref-ing the UpdateArrayData */
 	}
+}
 
-	/* Unref the arrays of errors and queries */
-	if (sparql_array_errors) {
-		g_ptr_array_unref (sparql_array_errors);
+static void
+update_array_data_finished (UpdateArrayData *update_data)
+{
+	TrackerSparqlBuffer *buffer;
+	TrackerSparqlBufferPrivate *priv;
+
+	buffer = update_data->buffer;
+	priv = buffer->priv;
+	update_data->finished = TRUE;
+
+	/* Tasks are completed in the order they were pushed, so
+	 * updates finished before older ones wait for these.
+	 */
+	while (!g_queue_is_empty (&priv->updates)) {
+		update_data = g_queue_peek_head (&priv->updates);
+
+		if (!update_data->finished) {
+			break;
+		}
+
+		g_queue_pop_head (&priv->updates);
+		update_array_data_complete (update_data);
+
+		/* Note that tasks are actually deallocated here */
+		update_array_data_free (update_data);
 	}
 
-	/* Note that tasks are actually deallocated here */
-	update_array_data_free (update_data);
+	/* Tasks left behind by a flush, either waiting for updates
+	 * in flight or for an ordered task, are sent as soon as
+	 * possible if nothing else would send them.
+	 */
+	if (priv->tasks &&
+	    (priv->tasks->len >= get_batch_size (buffer) ||
+	     priv->flush_timeout_id == 0 ||
+	     task_is_ordered (g_ptr_array_index (priv->tasks, 0)))) {
+		tracker_sparql_buffer_flush (buffer, "SPARQL buffer filled during update");
+	}
+}
 
-	if (global_error) {
-		g_error_free (global_error);
+static void
+tracker_sparql_buffer_update_array_cb (GObject      *object,
+                                       GAsyncResult *result,
+                                       gpointer      user_data)
+{
+	TrackerSparqlBuffer *buffer;
+	TrackerSparqlBufferPrivate *priv;
+	UpdateArrayData *update_data;
+
+	update_data = user_data;
+	buffer = update_data->buffer;
+	priv = buffer->priv;
+
+	g_debug ("(Sparql buffer) Finished array-update with %u tasks",
+	         update_data->tasks->len);
+
+	/* Get arrays of errors and queries */
+	update_data->errors = tracker_sparql_connection_update_array_finish (priv->connection,
+	                                                                     result,
+	                                                                     &update_data->global_error);
+	if (update_data->global_error) {
+		g_critical ("  (Sparql buffer) Error in array-update: %s",
+		            update_data->global_error->message);
+	}
+
+	update_batch_size (buffer, g_get_monotonic_time () - update_data->start_time);
+	update_array_data_finished (update_data);
+}
+
+static void
+tracker_sparql_buffer_ordered_cb (GObject      *object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
+{
+	TrackerSparqlBuffer *buffer;
+	TrackerSparqlBufferPrivate *priv;
+	UpdateArrayData *update_data;
+	SparqlTaskData *task_data;
+
+	update_data = user_data;
+	buffer = update_data->buffer;
+	priv = buffer->priv;
+	task_data = tracker_task_get_data (g_ptr_array_index (update_data->tasks, 0));
+
+	if (task_data->type == TASK_TYPE_URI_PREFIX) {
+		g_debug ("(Sparql buffer) Finished URI prefix update");
+		tracker_sparql_connection_update_uri_prefix_finish (priv->connection,
+		                                                    result,
+		                                                    &update_data->global_error);
+	} else {
+		g_debug ("(Sparql buffer) Finished deletion of container contents");
+		tracker_sparql_connection_delete_descendants_finish (priv->connection,
+		                                                     result,
+		                                                     &update_data->global_error);
+	}
+
+	if (update_data->global_error) {
+		g_critical ("  (Sparql buffer) Error in ordered update: %s",
+		            update_data->global_error->message);
+	}
+
+	update_array_data_finished (update_data);
+}
+
+/* Ordered tasks modify whatever the tasks pushed before them did,
+ * in ways the store can't merge into an array update, so they are
+ * sent on their own once every update in flight is finished, and
+ * nothing else is sent until they are.
+ */
+static void
+flush_ordered_task (TrackerSparqlBuffer *buffer)
+{
+	TrackerSparqlBufferPrivate *priv;
+	UpdateArrayData *update_data;
+	SparqlTaskData *task_data;
+	TrackerTask *task;
+
+	priv = buffer->priv;
+	task = tracker_task_ref (g_ptr_array_index (priv->tasks, 0));
+	task_data = tracker_task_get_data (task);
+
+	g_ptr_array_remove_index (priv->tasks, 0);
+
+	if (priv->tasks->len == 0) {
+		g_ptr_array_unref (priv->tasks);
+		priv->tasks = NULL;
+	}
+
+	update_data = g_slice_new0 (UpdateArrayData);
+	update_data->buffer = buffer;
+	update_data->tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_task_unref);
+	update_data->error_map = g_array_new (TRUE, TRUE, sizeof (gint));
+	update_data->ordered = TRUE;
+	update_data->start_time = g_get_monotonic_time ();
+
+	g_ptr_array_add (update_data->tasks, task);
+	g_queue_push_tail (&priv->updates, update_data);
+
+	if (task_data->type == TASK_TYPE_URI_PREFIX) {
+		tracker_sparql_connection_update_uri_prefix_async (priv->connection,
+		                                                   task_data->data.uri_prefix.old_prefix,
+		                                                   task_data->data.uri_prefix.new_prefix,
+		                                                   task_data->data.uri_prefix.str,
+		                                                   G_PRIORITY_DEFAULT,
+		                                                   NULL,
+		                                                   tracker_sparql_buffer_ordered_cb,
+		                                                   update_data);
+	} else if (task_data->type == TASK_TYPE_DELETE_DESCENDANTS) {
+		tracker_sparql_connection_delete_descendants_async (priv->connection,
+		                                                    task_data->data.str,
+		                                                    G_PRIORITY_DEFAULT,
+		                                                    NULL,
+		                                                    tracker_sparql_buffer_ordered_cb,
+		                                                    update_data);
 	}
 }
 
@@ -500,14 +782,14 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
                              const gchar         *reason)
 {
 	TrackerSparqlBufferPrivate *priv;
-	GPtrArray *bulk_ops = NULL;
+	GPtrArray *bulk_ops = NULL, *tasks;
 	GArray *sparql_array, *error_map;
 	UpdateArrayData *update_data;
 	gint i, j;
 
 	priv = buffer->priv;
 
-	if (priv->n_updates > 0) {
+	if (g_queue_get_length (&priv->updates) >= MAX_UPDATES_IN_FLIGHT) {
 		return FALSE;
 	}
 
@@ -516,6 +798,23 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 		return FALSE;
 	}
 
+	/* Nothing goes past an ordered task in flight */
+	update_data = g_queue_peek_tail (&priv->updates);
+	if (update_data && update_data->ordered) {
+		return FALSE;
+	}
+
+	if (task_is_ordered (g_ptr_array_index (priv->tasks, 0))) {
+		if (!g_queue_is_empty (&priv->updates)) {
+			/* Sent once the updates in flight are finished */
+			return FALSE;
+		}
+
+		g_debug ("Flushing SPARQL buffer ordered task, reason: %s", reason);
+		flush_ordered_task (buffer);
+		return TRUE;
+	}
+
 	g_debug ("Flushing SPARQL buffer, reason: %s", reason);
 
 	if (priv->flush_timeout_id != 0) {
@@ -523,16 +822,40 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 		priv->flush_timeout_id = 0;
 	}
 
+	/* Tasks up to the first ordered one go in this update, the
+	 * remaining ones are left in the buffer.
+	 */
+	tasks = g_ptr_array_new_with_free_func ((GDestroyNotify) tracker_task_unref);
+
+	for (i = 0; i < priv->tasks->len; i++) {
+		TrackerTask *task;
+
+		task = g_ptr_array_index (priv->tasks, i);
+
+		if (task_is_ordered (task)) {
+			break;
+		}
+
+		g_ptr_array_add (tasks, tracker_task_ref (task));
+	}
+
+	if (i < priv->tasks->len) {
+		g_ptr_array_remove_range (priv->tasks, 0, i);
+	} else {
+		g_ptr_array_unref (priv->tasks);
+		priv->tasks = NULL;
+	}
+
 	/* Loop buffer and construct array of strings */
 	sparql_array = g_array_new (FALSE, TRUE, sizeof (gchar *));
 	error_map = g_array_new (TRUE, TRUE, sizeof (gint));
 
-	for (i = 0; i < priv->tasks->len; i++) {
+	for (i = 0; i < tasks->len; i++) {
 		SparqlTaskData *task_data;
 		TrackerTask *task;
 		gint pos;
 
-		task = g_ptr_array_index (priv->tasks, i);
+		task = g_ptr_array_index (tasks, i);
 		task_data = tracker_task_get_data (task);
 
 		if (task_data->type == TASK_TYPE_SPARQL_STR) {
@@ -592,21 +915,19 @@ tracker_sparql_buffer_flush (TrackerSparqlBuffer *buffer,
 		}
 	}
 
+	/* update_data keeps references to
+	 * the tasks to keep these alive.
+	 */
 	update_data = g_slice_new0 (UpdateArrayData);
 	update_data->buffer = buffer;
-	update_data->tasks = g_ptr_array_ref (priv->tasks);
+	update_data->tasks = tasks;
 	update_data->bulk_ops = bulk_ops;
 	update_data->n_bulk_operations = bulk_ops ? bulk_ops->len : 0;
 	update_data->error_map = error_map;
 	update_data->sparql_array = sparql_array;
+	update_data->start_time = g_get_monotonic_time ();
 
-	/* Empty pool, update_data will keep
-	 * references to the tasks to keep
-	 * these alive.
-	 */
-	g_ptr_array_unref (priv->tasks);
-	priv->tasks = NULL;
-	priv->n_updates++;
+	g_queue_push_tail (&priv->updates, update_data);
 
 	/* Start the update */
 	tracker_sparql_connection_update_array_async (priv->connection,
@@ -669,8 +990,13 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
 	data->result = g_simple_async_result_new (G_OBJECT (buffer),
 	                                          cb, user_data, NULL);
 
+	/* High priority tasks skip the queue, unless it holds a
+	 * directory move or deletion they have to wait for.
+	 */
 	if (priority <= G_PRIORITY_HIGH &&
-	    data->type != TASK_TYPE_BULK) {
+	    (data->type == TASK_TYPE_SPARQL_STR ||
+	     data->type == TASK_TYPE_SPARQL) &&
+	    !file_has_pending_ordered_task (buffer, tracker_task_get_file (task))) {
 		UpdateData *update_data;
 		const gchar *sparql = NULL;
 
@@ -707,9 +1033,9 @@ tracker_sparql_buffer_push (TrackerSparqlBuffer *buffer,
 
 		if (tracker_task_pool_limit_reached (TRACKER_TASK_POOL (buffer))) {
 			tracker_sparql_buffer_flush (buffer, "SPARQL buffer limit reached");
-		} else if (priv->tasks->len > tracker_task_pool_get_limit (TRACKER_TASK_POOL (buffer)) / 2) {
-			/* We've filled half of the buffer, flush it as we receive more tasks */
-			tracker_sparql_buffer_flush (buffer, "SPARQL buffer half-full");
+		} else if (priv->tasks->len >= get_batch_size (buffer)) {
+			/* We've got a full batch, flush it as we receive more tasks */
+			tracker_sparql_buffer_flush (buffer, "SPARQL buffer batch full");
 		}
 	}
 }
@@ -753,6 +1079,14 @@ sparql_task_data_free (SparqlTaskData *data)
 	case TASK_TYPE_BULK:
 		/* nothing to free, the string is interned */
 		break;
+	case TASK_TYPE_DELETE_DESCENDANTS:
+		g_free (data->data.str);
+		break;
+	case TASK_TYPE_URI_PREFIX:
+		g_free (data->data.uri_prefix.str);
+		g_free (data->data.uri_prefix.old_prefix);
+		g_free (data->data.uri_prefix.new_prefix);
+		break;
 	}
 
 	if (data->result) {
@@ -809,3 +1143,41 @@ tracker_sparql_task_new_bulk (GFile                *file,
 	return tracker_task_new (file, data,
 	                         (GDestroyNotify) sparql_task_data_free);
 }
+
+/* The directory move in @sparql_str and the rewrite of the URLs of
+ * its contents are applied in the same store transaction, after the
+ * tasks pushed before it.
+ */
+TrackerTask *
+tracker_sparql_task_new_uri_prefix (GFile       *file,
+                                    const gchar *old_prefix,
+                                    const gchar *new_prefix,
+                                    const gchar *sparql_str)
+{
+	SparqlTaskData *data;
+
+	data = g_slice_new0 (SparqlTaskData);
+	data->type = TASK_TYPE_URI_PREFIX;
+	data->data.uri_prefix.str = g_strdup (sparql_str);
+	data->data.uri_prefix.old_prefix = g_strdup (old_prefix);
+	data->data.uri_prefix.new_prefix = g_strdup (new_prefix);
+
+	return tracker_task_new (file, data,
+	                         (GDestroyNotify) sparql_task_data_free);
+}
+
+/* Deletes the contents of the container @file from the store, after
+ * the tasks pushed before it, so these can't recreate any of them.
+ */
+TrackerTask *
+tracker_sparql_task_new_delete_descendants (GFile *file)
+{
+	SparqlTaskData *data;
+
+	data = g_slice_new0 (SparqlTaskData);
+	data->type = TASK_TYPE_DELETE_DESCENDANTS;
+	data->data.str = g_file_get_uri (file);
+
+	return tracker_task_new (file, data,
+	                         (GDestroyNotify) sparql_task_data_free);
+}
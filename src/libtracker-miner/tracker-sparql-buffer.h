@@ -82,6 +82,11 @@ TrackerTask *        tracker_sparql_task_new_with_sparql     (GFile
 TrackerTask *        tracker_sparql_task_new_bulk            (GFile                *file,
                                                               const gchar          *sparql_str,
                                                               TrackerBulkTaskFlags  flags);
+TrackerTask *        tracker_sparql_task_new_uri_prefix      (GFile                *file,
+                                                              const gchar          *old_prefix,
+                                                              const gchar          *new_prefix,
+                                                              const gchar          *sparql_str);
+TrackerTask *        tracker_sparql_task_new_delete_descendants (GFile             *file);
 
 G_END_DECLS
 
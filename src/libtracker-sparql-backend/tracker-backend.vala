@@ -89,6 +89,23 @@ class Tracker.Sparql.Backend : Connection {
 		}
 	}
 
+	// direct queries aren't queued, timeouts are only enforced by the store
+	public override Cursor? query_with_timeout (string sparql, uint timeout, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(timeout:%u): '%s'", Log.METHOD, timeout, sparql);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Query timeouts not available for direct-only connection");
+		}
+		return bus.query_with_timeout (sparql, timeout, cancellable);
+	}
+
+	public async override Cursor? query_with_timeout_async (string sparql, uint timeout, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(timeout:%u): '%s'", Log.METHOD, timeout, sparql);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Query timeouts not available for direct-only connection");
+		}
+		return yield bus.query_with_timeout_async (sparql, timeout, cancellable);
+	}
+
 	public override void update (string sparql, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
 		debug ("%s(priority:%d): '%s'", Log.METHOD, priority, sparql);
 		if (bus == null) {
@@ -146,6 +163,38 @@ class Tracker.Sparql.Backend : Connection {
 		yield bus.load_async (file, cancellable);
 	}
 
+	public override void update_uri_prefix (string old_prefix, string new_prefix, string? sparql = null, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(priority:%d): '%s' -> '%s'", Log.METHOD, priority, old_prefix, new_prefix);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Update support not available for direct-only connection");
+		}
+		bus.update_uri_prefix (old_prefix, new_prefix, sparql, priority, cancellable);
+	}
+
+	public async override void update_uri_prefix_async (string old_prefix, string new_prefix, string? sparql = null, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(priority:%d): '%s' -> '%s'", Log.METHOD, priority, old_prefix, new_prefix);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Update support not available for direct-only connection");
+		}
+		yield bus.update_uri_prefix_async (old_prefix, new_prefix, sparql, priority, cancellable);
+	}
+
+	public override void delete_descendants (string url, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(priority:%d): '%s'", Log.METHOD, priority, url);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Update support not available for direct-only connection");
+		}
+		bus.delete_descendants (url, priority, cancellable);
+	}
+
+	public async override void delete_descendants_async (string url, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		debug ("%s(priority:%d): '%s'", Log.METHOD, priority, url);
+		if (bus == null) {
+			throw new Sparql.Error.UNSUPPORTED ("Update support not available for direct-only connection");
+		}
+		yield bus.delete_descendants_async (url, priority, cancellable);
+	}
+
 	public override Cursor? statistics (Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
 		debug ("%s()", Log.METHOD);
 		if (bus == null) {
@@ -518,4 +518,184 @@ public abstract class Tracker.Sparql.Connection : Object {
 		warning ("Interface 'statistics_async' not implemented");
 		return null;
 	}
+
+	/**
+	 * tracker_sparql_connection_update_uri_prefix:
+	 * @self: a #TrackerSparqlConnection
+	 * @old_prefix: the prefix to replace, ending with "/"
+	 * @new_prefix: the replacement for @old_prefix, ending with "/"
+	 * @sparql: (allow-none): a string containing a SPARQL update to run
+	 *          first, or %NULL
+	 * @priority: the priority for the operation
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Runs @sparql and replaces @old_prefix with @new_prefix in the
+	 * nie:url of every resource whose URL starts with @old_prefix, as a
+	 * single operation in the store, either both or none are applied.
+	 * This is meant to move a directory along with its contents,
+	 * @sparql would then update the directory itself, and @old_prefix
+	 * and @new_prefix be the old and new directory URIs, followed by
+	 * a "/". Prefixes not ending with "/" are refused with
+	 * #TRACKER_SPARQL_ERROR_TYPE.
+	 *
+	 * Change notifications for the updated resources carry the
+	 * nie:url change only. The API call is completely synchronous, so
+	 * it may block.
+	 *
+	 * Since: 0.18
+	 */
+	public virtual void update_uri_prefix (string old_prefix, string new_prefix, string? sparql = null, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'update_uri_prefix' not implemented");
+	}
+
+	/**
+	 * tracker_sparql_connection_update_uri_prefix_async:
+	 * @self: a #TrackerSparqlConnection
+	 * @old_prefix: the prefix to replace, ending with "/"
+	 * @new_prefix: the replacement for @old_prefix, ending with "/"
+	 * @sparql: (allow-none): a string containing a SPARQL update to run
+	 *          first, or %NULL
+	 * @priority: the priority for the asynchronous operation
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @_callback_: user-defined #GAsyncReadyCallback to be called when
+	 *              asynchronous operation is finished.
+	 * @_user_data_: user-defined data to be passed to @_callback_
+	 *
+	 * Runs, asynchronously, @sparql and replaces @old_prefix with
+	 * @new_prefix in the nie:url of every resource whose URL starts
+	 * with @old_prefix. See tracker_sparql_connection_update_uri_prefix().
+	 *
+	 * Since: 0.18
+	 */
+
+	/**
+	 * tracker_sparql_connection_update_uri_prefix_finish:
+	 * @self: a #TrackerSparqlConnection
+	 * @_res_: a #GAsyncResult with the result of the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Finishes the asynchronous URI prefix update.
+	 *
+	 * Since: 0.18
+	 */
+	public async virtual void update_uri_prefix_async (string old_prefix, string new_prefix, string? sparql = null, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'update_uri_prefix_async' not implemented");
+	}
+
+	/**
+	 * tracker_sparql_connection_delete_descendants:
+	 * @self: a #TrackerSparqlConnection
+	 * @url: the nie:url of a container
+	 * @priority: the priority for the operation
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Deletes every resource whose nfo:belongsToContainer chain leads
+	 * to the resource with nie:url @url, along with the information
+	 * elements stored as them, as a single operation in the store. This
+	 * is meant to remove the contents of a deleted or unmounted
+	 * directory, the directory itself is not deleted.
+	 *
+	 * Change notifications only carry the rdf:type of the deleted
+	 * resources. The API call is completely synchronous, so it may block.
+	 *
+	 * Since: 0.18
+	 */
+	public virtual void delete_descendants (string url, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'delete_descendants' not implemented");
+	}
+
+	/**
+	 * tracker_sparql_connection_delete_descendants_async:
+	 * @self: a #TrackerSparqlConnection
+	 * @url: the nie:url of a container
+	 * @priority: the priority for the asynchronous operation
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @_callback_: user-defined #GAsyncReadyCallback to be called when
+	 *              asynchronous operation is finished.
+	 * @_user_data_: user-defined data to be passed to @_callback_
+	 *
+	 * Deletes, asynchronously, every resource contained in the
+	 * resource with nie:url @url. See
+	 * tracker_sparql_connection_delete_descendants().
+	 *
+	 * Since: 0.18
+	 */
+
+	/**
+	 * tracker_sparql_connection_delete_descendants_finish:
+	 * @self: a #TrackerSparqlConnection
+	 * @_res_: a #GAsyncResult with the result of the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Finishes the asynchronous deletion of the contents of a container.
+	 *
+	 * Since: 0.18
+	 */
+	public async virtual void delete_descendants_async (string url, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'delete_descendants_async' not implemented");
+	}
+
+	/**
+	 * tracker_sparql_connection_query_with_timeout:
+	 * @self: a #TrackerSparqlConnection
+	 * @sparql: string containing the SPARQL query
+	 * @timeout: the time in milliseconds the query is given, 0 for no limit
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Executes a SPARQL query like tracker_sparql_connection_query(),
+	 * unless it can't be started within @timeout milliseconds, e.g.
+	 * because the store is busy with queries from other clients, in
+	 * which case it fails with #G_DBUS_ERROR_TIMED_OUT. If it's still
+	 * running by then, it's cancelled and fails with
+	 * #G_IO_ERROR_CANCELLED. The API call is completely synchronous, so
+	 * it may block.
+	 *
+	 * Returns: a #TrackerSparqlCursor if results were found, #NULL otherwise.
+	 * On error, #NULL is returned and the @error is set accordingly.
+	 * Call g_object_unref() on the returned cursor when no longer needed.
+	 *
+	 * Since: 0.18
+	 */
+	public virtual Cursor? query_with_timeout (string sparql, uint timeout, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'query_with_timeout' not implemented");
+		return null;
+	}
+
+	/**
+	 * tracker_sparql_connection_query_with_timeout_finish:
+	 * @self: a #TrackerSparqlConnection
+	 * @_res_: a #GAsyncResult with the result of the operation
+	 * @error: #GError for error reporting.
+	 *
+	 * Finishes the asynchronous SPARQL query operation.
+	 *
+	 * Returns: a #TrackerSparqlCursor if results were found, #NULL otherwise.
+	 * On error, #NULL is returned and the @error is set accordingly.
+	 * Call g_object_unref() on the returned cursor when no longer needed.
+	 *
+	 * Since: 0.18
+	 */
+
+	/**
+	 * tracker_sparql_connection_query_with_timeout_async:
+	 * @self: a #TrackerSparqlConnection
+	 * @sparql: string containing the SPARQL query
+	 * @timeout: the time in milliseconds the query is given, 0 for no limit
+	 * @cancellable: a #GCancellable used to cancel the operation
+	 * @_callback_: user-defined #GAsyncReadyCallback to be called when
+	 *              asynchronous operation is finished.
+	 * @_user_data_: user-defined data to be passed to @_callback_
+	 *
+	 * Executes asynchronously a SPARQL query within @timeout milliseconds.
+	 * See tracker_sparql_connection_query_with_timeout().
+	 *
+	 * Since: 0.18
+	 */
+	public async virtual Cursor? query_with_timeout_async (string sparql, uint timeout, Cancellable? cancellable = null) throws Sparql.Error, IOError, DBusError {
+		warning ("Interface 'query_with_timeout_async' not implemented");
+		return null;
+	}
 }
@@ -291,4 +291,51 @@ public abstract class Tracker.Sparql.Cursor : Object {
 		}
 		return false;
 	}
+
+	/**
+	 * tracker_sparql_cursor_get_continuation_token:
+	 * @self: a #TrackerSparqlCursor
+	 * @columns: (array length=columns_length1): columns holding the sort
+	 * keys of the query, in ORDER BY order
+	 * @columns_length1: the number of columns in @columns
+	 *
+	 * Creates an opaque token for the current row, which allows fetching
+	 * the next page of a sorted query without OFFSET. The following query
+	 * passes it to <function>tracker:continues-after</function> together
+	 * with the sort key expressions:
+	 *
+	 * <programlisting>
+	 * SELECT ?title tracker:id(?song) { ?song a nmm:MusicPiece ; nie:title ?title .
+	 *   FILTER (tracker:continues-after ("token", ?title, tracker:id(?song))) }
+	 * ORDER BY ?title tracker:id(?song) LIMIT 50
+	 * </programlisting>
+	 *
+	 * Sort keys are compared in ascending order, keys sorted in descending
+	 * order are wrapped in <function>DESC</function> as in ORDER BY, e.g.
+	 * <literal>tracker:continues-after ("token", DESC(?date), tracker:id(?song))</literal>.
+	 * Unbound keys sort first in ascending and last in descending order,
+	 * the last key should be unique per row. Unlike OFFSET, the cost of
+	 * fetching a page does not grow with the number of pages before it.
+	 *
+	 * Returns: a newly allocated string. Free with g_free().
+	 *
+	 * Since: 0.18
+	 */
+	public string get_continuation_token (int[] columns) {
+		var builder = new VariantBuilder (new VariantType ("ams"));
+
+		foreach (int column in columns) {
+			if (!is_bound (column)) {
+				builder.add ("ms", null);
+			} else if (get_value_type (column) == ValueType.DOUBLE) {
+				// get_string () may round, keep every digit
+				char[] buffer = new char[double.DTOSTR_BUF_SIZE];
+				builder.add ("ms", get_double (column).to_str (buffer));
+			} else {
+				builder.add ("ms", get_string (column));
+			}
+		}
+
+		return Base64.encode ((uchar[]) builder.end ().print (false).data);
+	}
 }
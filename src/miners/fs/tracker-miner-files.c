@@ -21,6 +21,7 @@
 
 #include <sys/statvfs.h>
 #include <fcntl.h>
+#include <string.h>
 #ifdef __linux__
 #include <sys/ioctl.h>
 #include <linux/msdos_fs.h>
@@ -39,6 +40,7 @@
 #include <libtracker-common/tracker-type-utils.h>
 #include <libtracker-common/tracker-utils.h>
 #include <libtracker-common/tracker-file-utils.h>
+#include <libtracker-common/tracker-mime-costs.h>
 
 #include <libtracker-data/tracker-db-manager.h>
 
@@ -53,6 +55,14 @@
 #define DISK_SPACE_CHECK_FREQUENCY 10
 #define SECONDS_PER_DAY 86400
 
+/* Seconds before the extraction costs are read again */
+#define EXTRACT_COSTS_RELOAD_INTERVAL 60
+
+/* Any text after a dot counts as an extension, the guesses are
+ * forgotten past this many of them.
+ */
+#define EXTENSION_MIME_TYPES_MAX 256
+
 #define TRACKER_MINER_FILES_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), TRACKER_TYPE_MINER_FILES, TrackerMinerFilesPrivate))
 
 static GQuark miner_files_error_quark = 0;
@@ -105,6 +115,13 @@ struct TrackerMinerFilesPrivate {
 	GList *failed_extraction_queue;
 
 	gboolean failsafe_extraction;
+
+	TrackerMimeCosts *extract_costs;
+	gchar *extract_costs_filename;
+	gint64 extract_costs_load_time;
+
+	/* Mimetype guessed for each file extension */
+	GHashTable *extension_mime_types;
 };
 
 enum {
@@ -187,6 +204,9 @@ static gboolean    miner_files_ignore_next_update_file  (TrackerMinerFS       *f
                                                          TrackerSparqlBuilder *sparql,
                                                          GCancellable         *cancellable);
 static void        miner_files_finished                 (TrackerMinerFS       *fs);
+static gint        miner_files_get_file_priority        (TrackerMinerFS       *fs,
+                                                         GFile                *file,
+                                                         gpointer              user_data);
 
 static void        miner_finished_cb                    (TrackerMinerFS *fs,
                                                          gdouble         seconds_elapsed,
@@ -282,6 +302,17 @@ tracker_miner_files_init (TrackerMinerFiles *mf)
 	                  mf);
 
 	priv->quark_mount_point_uuid = g_quark_from_static_string ("tracker-mount-point-uuid");
+
+	priv->extract_costs = tracker_mime_costs_new ();
+	priv->extract_costs_filename = tracker_mime_costs_get_default_filename ();
+	priv->extension_mime_types = g_hash_table_new_full (g_str_hash,
+	                                                    g_str_equal,
+	                                                    (GDestroyNotify) g_free,
+	                                                    (GDestroyNotify) g_free);
+
+	g_signal_connect (mf, "get-file-priority",
+	                  G_CALLBACK (miner_files_get_file_priority),
+	                  NULL);
 }
 
 static void
@@ -657,6 +688,10 @@ miner_files_finalize (GObject *object)
 	g_list_free (priv->extraction_queue);
 	g_list_free (priv->failed_extraction_queue);
 
+	tracker_mime_costs_free (priv->extract_costs);
+	g_free (priv->extract_costs_filename);
+	g_hash_table_unref (priv->extension_mime_types);
+
 	G_OBJECT_CLASS (tracker_miner_files_parent_class)->finalize (object);
 }
 
@@ -2564,6 +2599,75 @@ miner_files_process_file_attributes (TrackerMinerFS       *fs,
 	return TRUE;
 }
 
+static gint
+miner_files_get_file_priority (TrackerMinerFS *fs,
+                               GFile          *file,
+                               gpointer        user_data)
+{
+	TrackerMinerFilesPrivate *priv;
+	const gchar *extension, *mime_type;
+	gint priority = G_PRIORITY_DEFAULT;
+	gchar *basename;
+	gint64 now;
+
+	priv = TRACKER_MINER_FILES (fs)->private;
+	now = g_get_monotonic_time ();
+
+	/* Pick up the costs tracker-extract recorded meanwhile */
+	if (priv->extract_costs_load_time == 0 ||
+	    now - priv->extract_costs_load_time >= EXTRACT_COSTS_RELOAD_INTERVAL * G_USEC_PER_SEC) {
+		tracker_mime_costs_load (priv->extract_costs,
+		                         priv->extract_costs_filename,
+		                         NULL);
+		priv->extract_costs_load_time = now;
+	}
+
+	/* The actual mimetype is queried when processing the file,
+	 * a guess from the file extension is enough to schedule it,
+	 * so it's only guessed once per extension.
+	 */
+	basename = g_file_get_basename (file);
+	extension = strrchr (basename, '.');
+
+	if (!extension) {
+		/* No known expensive mimetype goes without an extension */
+		g_free (basename);
+		return priority;
+	}
+
+	mime_type = g_hash_table_lookup (priv->extension_mime_types, extension);
+
+	if (!mime_type) {
+		gchar *content_type, *guessed;
+
+		content_type = g_content_type_guess (basename, NULL, 0, NULL);
+		guessed = g_content_type_get_mime_type (content_type);
+		g_free (content_type);
+
+		if (!guessed) {
+			guessed = g_strdup ("");
+		}
+
+		if (g_hash_table_size (priv->extension_mime_types) >= EXTENSION_MIME_TYPES_MAX) {
+			g_hash_table_remove_all (priv->extension_mime_types);
+		}
+
+		g_hash_table_insert (priv->extension_mime_types,
+		                     g_strdup (extension),
+		                     guessed);
+		mime_type = guessed;
+	}
+
+	if (mime_type[0] != '\0' &&
+	    tracker_mime_costs_is_expensive (priv->extract_costs, mime_type)) {
+		priority = G_PRIORITY_LOW;
+	}
+
+	g_free (basename);
+
+	return priority;
+}
+
 static gboolean
 miner_files_ignore_next_update_file (TrackerMinerFS       *fs,
                                      GFile                *file,
@@ -2654,6 +2758,7 @@ tracker_miner_files_new (TrackerConfig  *config,
 	                       "config", config,
 	                       "processing-pool-wait-limit", 10,
 	                       "processing-pool-ready-limit", 100,
+	                       "processing-pool-low-priority-limit", 2,
 	                       NULL);
 }
 
@@ -41,9 +41,13 @@ static gint paused_length = 0;
 static gboolean status;
 static gboolean follow;
 static gboolean list_common_statuses;
+static gboolean profile;
+static gboolean reset_profile;
+static gboolean extract_costs;
 
 #define STATUS_OPTIONS_ENABLED() \
-	(status || follow || list_common_statuses)
+	(status || follow || list_common_statuses || profile || reset_profile || \
+	 extract_costs)
 
 /* Make sure our statuses are translated (most from libtracker-miner) */
 static const gchar *statuses[8] = {
@@ -70,6 +74,18 @@ static GOptionEntry entries[] = {
 	  N_("List common statuses for miners and the store"),
 	  NULL
 	},
+	{ "profile", 'P', 0, G_OPTION_ARG_NONE, &profile,
+	  N_("Show the most expensive queries and updates run by the store"),
+	  NULL
+	},
+	{ "reset-profile", 0, 0, G_OPTION_ARG_NONE, &reset_profile,
+	  N_("Reset the query profile of the store"),
+	  NULL
+	},
+	{ "extract-costs", 'X', 0, G_OPTION_ARG_NONE, &extract_costs,
+	  N_("Show the time spent extracting metadata for each mimetype"),
+	  NULL
+	},
 	{ NULL }
 };
 
@@ -497,6 +513,234 @@ store_init (void)
 	return TRUE;
 }
 
+static void
+store_profile_checkpoints (GDBusConnection *bus)
+{
+	static const gchar *modes[] = { "passive", "full", "restart" };
+	GVariant *result, *checkpoints;
+	GError *error = NULL;
+	gint32 wal_pages = 0, max_wal_pages = 0;
+	guint32 deferred = 0;
+	guint i;
+
+	result = g_dbus_connection_call_sync (bus,
+	                                      "org.freedesktop.Tracker1",
+	                                      "/org/freedesktop/Tracker1/Profile",
+	                                      "org.freedesktop.Tracker1.Profile",
+	                                      "GetCheckpoints",
+	                                      NULL,
+	                                      G_VARIANT_TYPE ("(a{sv})"),
+	                                      G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                                      -1,
+	                                      NULL,
+	                                      &error);
+
+	if (error) {
+		g_printerr ("%s, %s\n",
+		            _("Could not get WAL checkpoints from the store"),
+		            error->message);
+		g_error_free (error);
+		return;
+	}
+
+	checkpoints = g_variant_get_child_value (result, 0);
+
+	g_variant_lookup (checkpoints, "wal-pages", "i", &wal_pages);
+	g_variant_lookup (checkpoints, "max-wal-pages", "i", &max_wal_pages);
+	g_variant_lookup (checkpoints, "deferred", "u", &deferred);
+
+	g_print ("%s\n", _("WAL checkpoints"));
+	g_print ("  %s: %d, %s: %d, %s: %u\n",
+	         _("WAL pages"), wal_pages,
+	         _("Largest"), max_wal_pages,
+	         _("Deferred"), deferred);
+
+	for (i = 0; i < G_N_ELEMENTS (modes); i++) {
+		guint32 count = 0;
+		guint64 pages = 0;
+		gint64 time = 0, max_time = 0;
+		gchar *key;
+
+		key = g_strdup_printf ("%s-count", modes[i]);
+		g_variant_lookup (checkpoints, key, "u", &count);
+		g_free (key);
+
+		if (count == 0) {
+			continue;
+		}
+
+		key = g_strdup_printf ("%s-pages", modes[i]);
+		g_variant_lookup (checkpoints, key, "t", &pages);
+		g_free (key);
+
+		key = g_strdup_printf ("%s-time", modes[i]);
+		g_variant_lookup (checkpoints, key, "x", &time);
+		g_free (key);
+
+		key = g_strdup_printf ("%s-max-time", modes[i]);
+		g_variant_lookup (checkpoints, key, "x", &max_time);
+		g_free (key);
+
+		g_print ("  %s: %u, %s: %" G_GUINT64_FORMAT ", %s: %.3f ms, %s: %.3f ms\n",
+		         modes[i], count,
+		         _("Pages"), pages,
+		         _("Total"), time / 1000.0,
+		         _("Longest"), max_time / 1000.0);
+	}
+
+	g_variant_unref (checkpoints);
+	g_variant_unref (result);
+}
+
+static gint
+store_profile (void)
+{
+	GDBusConnection *bus;
+	GVariant *result;
+	GError *error = NULL;
+
+	bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+
+	if (!bus) {
+		g_printerr ("%s, %s\n",
+		            _("Could not connect to the D-Bus session bus"),
+		            error ? error->message : _("No error given"));
+		g_clear_error (&error);
+		return EXIT_FAILURE;
+	}
+
+	result = g_dbus_connection_call_sync (bus,
+	                                      "org.freedesktop.Tracker1",
+	                                      "/org/freedesktop/Tracker1/Profile",
+	                                      "org.freedesktop.Tracker1.Profile",
+	                                      reset_profile ? "Reset" : "Get",
+	                                      NULL,
+	                                      reset_profile ? NULL : G_VARIANT_TYPE ("(aa{sv})"),
+	                                      G_DBUS_CALL_FLAGS_NO_AUTO_START,
+	                                      -1,
+	                                      NULL,
+	                                      &error);
+
+	if (error) {
+		g_printerr ("%s, %s\n",
+		            _("Could not get query profile from the store"),
+		            error->message);
+		g_error_free (error);
+		g_object_unref (bus);
+		return EXIT_FAILURE;
+	}
+
+	if (reset_profile) {
+		g_print ("%s\n", _("Query profile reset"));
+	} else {
+		GVariantIter *iter;
+		GVariant *entry;
+
+		g_variant_get (result, "(aa{sv})", &iter);
+
+		while ((entry = g_variant_iter_next_value (iter)) != NULL) {
+			const gchar *shape = NULL, *sql = NULL;
+			guint32 count = 0, errors = 0;
+			guint64 rows = 0, vm_steps = 0;
+			gint64 prepare_time = 0, execute_time = 0, serialize_time = 0;
+
+			g_variant_lookup (entry, "shape", "&s", &shape);
+			g_variant_lookup (entry, "sql", "&s", &sql);
+			g_variant_lookup (entry, "count", "u", &count);
+			g_variant_lookup (entry, "errors", "u", &errors);
+			g_variant_lookup (entry, "rows", "t", &rows);
+			g_variant_lookup (entry, "vm-steps", "t", &vm_steps);
+			g_variant_lookup (entry, "prepare-time", "x", &prepare_time);
+			g_variant_lookup (entry, "execute-time", "x", &execute_time);
+			g_variant_lookup (entry, "serialize-time", "x", &serialize_time);
+
+			g_print ("%s\n", shape);
+			g_print ("  %s: %u, %s: %u, %s: %" G_GUINT64_FORMAT ", %s: %" G_GUINT64_FORMAT "\n",
+			         _("Runs"), count,
+			         _("Errors"), errors,
+			         _("Rows"), rows,
+			         _("VM steps"), vm_steps);
+			g_print ("  %s: %.3f ms, %s: %.3f ms, %s: %.3f ms\n",
+			         _("Prepare"), prepare_time / 1000.0,
+			         _("Execute"), execute_time / 1000.0,
+			         _("Serialize"), serialize_time / 1000.0);
+			if (sql) {
+				g_print ("  SQL: %s\n", sql);
+			}
+			g_print ("\n");
+
+			g_variant_unref (entry);
+		}
+
+		g_variant_iter_free (iter);
+
+		store_profile_checkpoints (bus);
+	}
+
+	g_variant_unref (result);
+	g_object_unref (bus);
+
+	return EXIT_SUCCESS;
+}
+
+static gint
+show_extract_costs (void)
+{
+	TrackerMimeCosts *costs;
+	GList *mime_types, *l;
+	GError *error = NULL;
+	gchar *filename;
+
+	costs = tracker_mime_costs_new ();
+	filename = tracker_mime_costs_get_default_filename ();
+
+	if (!tracker_mime_costs_load (costs, filename, &error)) {
+		if (g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+			g_print ("%s\n", _("No extraction costs recorded yet"));
+			g_error_free (error);
+			tracker_mime_costs_free (costs);
+			g_free (filename);
+			return EXIT_SUCCESS;
+		}
+
+		g_printerr ("%s '%s', %s\n",
+		            _("Could not read extraction costs from"),
+		            filename,
+		            error->message);
+		g_error_free (error);
+		tracker_mime_costs_free (costs);
+		g_free (filename);
+		return EXIT_FAILURE;
+	}
+
+	mime_types = tracker_mime_costs_get_mime_types (costs);
+
+	for (l = mime_types; l; l = l->next) {
+		const TrackerMimeCost *cost;
+		gchar *size;
+
+		cost = tracker_mime_costs_lookup (costs, l->data);
+		size = g_format_size (cost->bytes / cost->count);
+
+		g_print ("%s%s\n",
+		         (const gchar *) l->data,
+		         tracker_mime_costs_is_expensive (costs, l->data) ?
+		         _(" (scheduled last)") : "");
+		g_print ("  %s: %u, %s: %.3f ms, %s: %s\n",
+		         _("Files"), cost->count,
+		         _("Average time"), (cost->time / cost->count) / 1000.0,
+		         _("Average size"), size);
+
+		g_free (size);
+	}
+
+	g_list_free (mime_types);
+	tracker_mime_costs_free (costs);
+	g_free (filename);
+
+	return EXIT_SUCCESS;
+}
+
 void
 tracker_control_status_run_default (void)
 {
@@ -528,6 +772,14 @@ tracker_control_status_run (void)
 		return EXIT_SUCCESS;
 	}
 
+	if (profile || reset_profile) {
+		return store_profile ();
+	}
+
+	if (extract_costs) {
+		return show_extract_costs ();
+	}
+
 	if (status) {
 		GError *error = NULL;
 		GSList *miners_available;
@@ -0,0 +1,220 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include "tracker-audio-sparql.h"
+
+gchar *
+tracker_audio_sparql_add_artist (TrackerSparqlBuilder *preupdate,
+                                 const gchar          *graph,
+                                 const gchar          *name)
+{
+	gchar *artist_uri;
+
+	artist_uri = tracker_sparql_escape_uri_printf ("urn:artist:%s", name);
+
+	tracker_sparql_builder_insert_open (preupdate, NULL);
+	if (graph) {
+		tracker_sparql_builder_graph_open (preupdate, graph);
+	}
+
+	tracker_sparql_builder_subject_iri (preupdate, artist_uri);
+	tracker_sparql_builder_predicate (preupdate, "a");
+	tracker_sparql_builder_object (preupdate, "nmm:Artist");
+	tracker_sparql_builder_predicate (preupdate, "nmm:artistName");
+	tracker_sparql_builder_object_unvalidated (preupdate, name);
+
+	if (graph) {
+		tracker_sparql_builder_graph_close (preupdate);
+	}
+	tracker_sparql_builder_insert_close (preupdate);
+
+	return artist_uri;
+}
+
+/* Album properties are shared by all tracks, replace any previous value */
+static void
+replace_album_property (TrackerSparqlBuilder *preupdate,
+                        const gchar          *graph,
+                        const gchar          *album_uri,
+                        const gchar          *predicate,
+                        const gchar          *value,
+                        gboolean              is_double)
+{
+	tracker_sparql_builder_delete_open (preupdate, NULL);
+	tracker_sparql_builder_subject_iri (preupdate, album_uri);
+	tracker_sparql_builder_predicate (preupdate, predicate);
+	tracker_sparql_builder_object_variable (preupdate, "unknown");
+	tracker_sparql_builder_delete_close (preupdate);
+
+	tracker_sparql_builder_where_open (preupdate);
+	tracker_sparql_builder_subject_iri (preupdate, album_uri);
+	tracker_sparql_builder_predicate (preupdate, predicate);
+	tracker_sparql_builder_object_variable (preupdate, "unknown");
+	tracker_sparql_builder_where_close (preupdate);
+
+	tracker_sparql_builder_insert_open (preupdate, NULL);
+	if (graph) {
+		tracker_sparql_builder_graph_open (preupdate, graph);
+	}
+
+	tracker_sparql_builder_subject_iri (preupdate, album_uri);
+	tracker_sparql_builder_predicate (preupdate, predicate);
+
+	if (is_double) {
+		tracker_sparql_builder_object_double (preupdate, atof (value));
+	} else {
+		tracker_sparql_builder_object_int64 (preupdate, atoi (value));
+	}
+
+	if (graph) {
+		tracker_sparql_builder_graph_close (preupdate);
+	}
+	tracker_sparql_builder_insert_close (preupdate);
+}
+
+gchar *
+tracker_audio_sparql_add_album (TrackerSparqlBuilder *preupdate,
+                                const gchar          *graph,
+                                const gchar          *title,
+                                const gchar          *album_artist,
+                                const gchar          *album_artist_uri,
+                                const gchar          *track_count,
+                                const gchar          *gain,
+                                const gchar          *peak_gain)
+{
+	gchar *album_uri;
+
+	if (album_artist) {
+		album_uri = tracker_sparql_escape_uri_printf ("urn:album:%s:%s", title, album_artist);
+	} else {
+		album_uri = tracker_sparql_escape_uri_printf ("urn:album:%s", title);
+	}
+
+	tracker_sparql_builder_insert_open (preupdate, NULL);
+	if (graph) {
+		tracker_sparql_builder_graph_open (preupdate, graph);
+	}
+
+	tracker_sparql_builder_subject_iri (preupdate, album_uri);
+	tracker_sparql_builder_predicate (preupdate, "a");
+	tracker_sparql_builder_object (preupdate, "nmm:MusicAlbum");
+	/* FIXME: nmm:albumTitle is now deprecated
+	 * tracker_sparql_builder_predicate (preupdate, "nie:title");
+	 */
+	tracker_sparql_builder_predicate (preupdate, "nmm:albumTitle");
+	tracker_sparql_builder_object_unvalidated (preupdate, title);
+
+	if (album_artist_uri) {
+		tracker_sparql_builder_predicate (preupdate, "nmm:albumArtist");
+		tracker_sparql_builder_object_iri (preupdate, album_artist_uri);
+	}
+
+	if (graph) {
+		tracker_sparql_builder_graph_close (preupdate);
+	}
+	tracker_sparql_builder_insert_close (preupdate);
+
+	if (track_count) {
+		replace_album_property (preupdate, graph, album_uri,
+		                        "nmm:albumTrackCount", track_count, FALSE);
+	}
+
+	if (gain) {
+		replace_album_property (preupdate, graph, album_uri,
+		                        "nmm:albumGain", gain, TRUE);
+	}
+
+	if (peak_gain) {
+		replace_album_property (preupdate, graph, album_uri,
+		                        "nmm:albumPeakGain", peak_gain, TRUE);
+	}
+
+	return album_uri;
+}
+
+gchar *
+tracker_audio_sparql_add_album_disc (TrackerSparqlBuilder *preupdate,
+                                     const gchar          *graph,
+                                     const gchar          *album_uri,
+                                     const gchar          *title,
+                                     const gchar          *album_artist,
+                                     const gchar          *disc_number)
+{
+	gchar *album_disc_uri;
+	gint set_number;
+
+	set_number = disc_number ? atoi (disc_number) : 0;
+	if (set_number <= 0) {
+		set_number = 1;
+	}
+
+	if (album_artist) {
+		album_disc_uri = tracker_sparql_escape_uri_printf ("urn:album-disc:%s:%s:Disc%d",
+		                                                   title, album_artist,
+		                                                   set_number);
+	} else {
+		album_disc_uri = tracker_sparql_escape_uri_printf ("urn:album-disc:%s:Disc%d",
+		                                                   title,
+		                                                   set_number);
+	}
+
+	tracker_sparql_builder_delete_open (preupdate, NULL);
+	tracker_sparql_builder_subject_iri (preupdate, album_disc_uri);
+	tracker_sparql_builder_predicate (preupdate, "nmm:setNumber");
+	tracker_sparql_builder_object_variable (preupdate, "unknown");
+	tracker_sparql_builder_delete_close (preupdate);
+	tracker_sparql_builder_where_open (preupdate);
+	tracker_sparql_builder_subject_iri (preupdate, album_disc_uri);
+	tracker_sparql_builder_predicate (preupdate, "nmm:setNumber");
+	tracker_sparql_builder_object_variable (preupdate, "unknown");
+	tracker_sparql_builder_where_close (preupdate);
+
+	tracker_sparql_builder_delete_open (preupdate, NULL);
+	tracker_sparql_builder_subject_iri (preupdate, album_disc_uri);
+	tracker_sparql_builder_predicate (preupdate, "nmm:albumDiscAlbum");
+	tracker_sparql_builder_object_variable (preupdate, "unknown");
+	tracker_sparql_builder_delete_close (preupdate);
+	tracker_sparql_builder_where_open (preupdate);
+	tracker_sparql_builder_subject_iri (preupdate, album_disc_uri);
+	tracker_sparql_builder_predicate (preupdate, "nmm:albumDiscAlbum");
+	tracker_sparql_builder_object_variable (preupdate, "unknown");
+	tracker_sparql_builder_where_close (preupdate);
+
+	tracker_sparql_builder_insert_open (preupdate, NULL);
+	if (graph) {
+		tracker_sparql_builder_graph_open (preupdate, graph);
+	}
+
+	tracker_sparql_builder_subject_iri (preupdate, album_disc_uri);
+	tracker_sparql_builder_predicate (preupdate, "a");
+	tracker_sparql_builder_object (preupdate, "nmm:MusicAlbumDisc");
+	tracker_sparql_builder_predicate (preupdate, "nmm:setNumber");
+	tracker_sparql_builder_object_int64 (preupdate, set_number);
+	tracker_sparql_builder_predicate (preupdate, "nmm:albumDiscAlbum");
+	tracker_sparql_builder_object_iri (preupdate, album_uri);
+
+	if (graph) {
+		tracker_sparql_builder_graph_close (preupdate);
+	}
+	tracker_sparql_builder_insert_close (preupdate);
+
+	return album_disc_uri;
+}
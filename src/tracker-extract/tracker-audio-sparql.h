@@ -0,0 +1,54 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_AUDIO_SPARQL_H__
+#define __TRACKER_AUDIO_SPARQL_H__
+
+#include <glib.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+G_BEGIN_DECLS
+
+/* Artists, albums and album discs are shared by the tracks of the
+ * audio tags extractor, these insert them into @preupdate and return
+ * their newly allocated URIs.
+ */
+
+gchar *tracker_audio_sparql_add_artist     (TrackerSparqlBuilder *preupdate,
+                                            const gchar          *graph,
+                                            const gchar          *name);
+
+gchar *tracker_audio_sparql_add_album      (TrackerSparqlBuilder *preupdate,
+                                            const gchar          *graph,
+                                            const gchar          *title,
+                                            const gchar          *album_artist,
+                                            const gchar          *album_artist_uri,
+                                            const gchar          *track_count,
+                                            const gchar          *gain,
+                                            const gchar          *peak_gain);
+
+gchar *tracker_audio_sparql_add_album_disc (TrackerSparqlBuilder *preupdate,
+                                            const gchar          *graph,
+                                            const gchar          *album_uri,
+                                            const gchar          *title,
+                                            const gchar          *album_artist,
+                                            const gchar          *disc_number);
+
+G_END_DECLS
+
+#endif /* __TRACKER_AUDIO_SPARQL_H__ */
@@ -0,0 +1,931 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stddef.h>
+
+#include "tracker-audio-tags.h"
+
+/* Reads the tags of FLAC, Ogg Vorbis/Opus and MP4 audio files straight
+ * from their headers: FLAC metadata blocks, the Ogg identification and
+ * comment packets, and the MP4 moov atom. No decoder is set up and, as
+ * the data is expected to be mapped, only the pages holding the headers
+ * (and the last Ogg page, for the duration) are ever read.
+ */
+
+#define READ_UINT16_BE(p) (((guint) (p)[0] << 8) | (p)[1])
+#define READ_UINT24_BE(p) (((guint32) (p)[0] << 16) | ((guint32) (p)[1] << 8) | (p)[2])
+#define READ_UINT32_BE(p) (((guint32) (p)[0] << 24) | ((guint32) (p)[1] << 16) | \
+                           ((guint32) (p)[2] << 8) | (p)[3])
+#define READ_UINT64_BE(p) (((guint64) READ_UINT32_BE (p) << 32) | READ_UINT32_BE ((p) + 4))
+#define READ_UINT16_LE(p) (((guint) (p)[1] << 8) | (p)[0])
+#define READ_UINT32_LE(p) (((guint32) (p)[3] << 24) | ((guint32) (p)[2] << 16) | \
+                           ((guint32) (p)[1] << 8) | (p)[0])
+#define READ_UINT64_LE(p) (((guint64) READ_UINT32_LE ((p) + 4) << 32) | READ_UINT32_LE (p))
+
+#define MP4_TYPE(a,b,c,d) (((guint32) (a) << 24) | ((guint32) (b) << 16) | \
+                           ((guint32) (c) << 8) | (guint32) (d))
+
+#define FLAC_BLOCK_STREAMINFO     0
+#define FLAC_BLOCK_VORBIS_COMMENT 4
+#define FLAC_BLOCK_PICTURE        6
+
+#define FLAC_PICTURE_FRONT_COVER  3
+
+#define OGG_PAGE_HEADER_SIZE      27
+/* How far from the end of the file the last Ogg page is looked for */
+#define OGG_LAST_PAGE_SEARCH      (64 * 1024)
+#define OPUS_SAMPLE_RATE          48000
+
+#define MP4_DATA_UTF8             1
+#define MP4_DATA_JPEG             13
+#define MP4_DATA_PNG              14
+
+#define TAG(field) G_STRUCT_OFFSET (TrackerAudioTags, field)
+
+static const struct {
+	const gchar *name;
+	glong offset;
+} vorbis_comment_fields[] = {
+	{ "TITLE", TAG (title) },
+	{ "ARTIST", TAG (artist) },
+	{ "ALBUM", TAG (album) },
+	{ "ALBUMARTIST", TAG (album_artist) },
+	{ "ALBUM ARTIST", TAG (album_artist) },
+	{ "PERFORMER", TAG (performer) },
+	{ "COMPOSER", TAG (composer) },
+	{ "TRACKNUMBER", TAG (track_number) },
+	{ "TRACKTOTAL", TAG (track_count) },
+	{ "TOTALTRACKS", TAG (track_count) },
+	{ "TRACKCOUNT", TAG (track_count) },
+	{ "DISCNUMBER", TAG (disc_number) },
+	{ "DISCNO", TAG (disc_number) },
+	{ "DATE", TAG (date) },
+	{ "GENRE", TAG (genre) },
+	{ "COMMENT", TAG (comment) },
+	{ "DESCRIPTION", TAG (comment) },
+	{ "LYRICS", TAG (lyrics) },
+	{ "UNSYNCEDLYRICS", TAG (lyrics) },
+	{ "COPYRIGHT", TAG (copyright) },
+	{ "LICENSE", TAG (license) },
+	{ "PUBLISHER", TAG (publisher) },
+	{ "ORGANIZATION", TAG (publisher) },
+	{ "REPLAYGAIN_ALBUM_GAIN", TAG (album_gain) },
+	{ "ALBUMGAIN", TAG (album_gain) },
+	{ "REPLAYGAIN_ALBUM_PEAK", TAG (album_peak_gain) },
+	{ "ALBUMPEAKGAIN", TAG (album_peak_gain) },
+};
+
+static const struct {
+	guint32 type;
+	glong offset;
+} mp4_text_items[] = {
+	{ MP4_TYPE (0xa9, 'n', 'a', 'm'), TAG (title) },
+	{ MP4_TYPE (0xa9, 'A', 'R', 'T'), TAG (artist) },
+	{ MP4_TYPE ('a', 'A', 'R', 'T'), TAG (album_artist) },
+	{ MP4_TYPE (0xa9, 'a', 'l', 'b'), TAG (album) },
+	{ MP4_TYPE (0xa9, 'w', 'r', 't'), TAG (composer) },
+	{ MP4_TYPE (0xa9, 'd', 'a', 'y'), TAG (date) },
+	{ MP4_TYPE (0xa9, 'g', 'e', 'n'), TAG (genre) },
+	{ MP4_TYPE (0xa9, 'c', 'm', 't'), TAG (comment) },
+	{ MP4_TYPE (0xa9, 'l', 'y', 'r'), TAG (lyrics) },
+	{ MP4_TYPE ('c', 'p', 'r', 't'), TAG (copyright) },
+};
+
+static void
+set_tag (TrackerAudioTags *tags,
+         glong             offset,
+         const gchar      *value,
+         gsize             length)
+{
+	gchar **tag = G_STRUCT_MEMBER_P (tags, offset);
+
+	/* First value wins */
+	if (*tag == NULL && length > 0) {
+		*tag = g_strndup (value, length);
+	}
+}
+
+static gsize
+skip_id3v2 (const guchar *data,
+            gsize         length)
+{
+	gsize size;
+
+	if (length < 10 || memcmp (data, "ID3", 3) != 0) {
+		return 0;
+	}
+
+	/* Syncsafe integer */
+	size = ((gsize) (data[6] & 0x7f) << 21) |
+	       ((gsize) (data[7] & 0x7f) << 14) |
+	       ((gsize) (data[8] & 0x7f) << 7) |
+	       (data[9] & 0x7f);
+	size += 10;
+
+	if (data[5] & 0x10) {
+		/* Footer present */
+		size += 10;
+	}
+
+	return MIN (size, length);
+}
+
+static void
+parse_vorbis_comment (const guchar     *data,
+                      gsize             length,
+                      TrackerAudioTags *tags)
+{
+	guint32 vendor_length, n_comments, i;
+	gsize pos;
+
+	if (length < 8) {
+		return;
+	}
+
+	vendor_length = READ_UINT32_LE (data);
+
+	if (vendor_length > length - 8) {
+		return;
+	}
+
+	pos = 4 + vendor_length;
+	n_comments = READ_UINT32_LE (data + pos);
+	pos += 4;
+
+	for (i = 0; i < n_comments && pos + 4 <= length; i++) {
+		const gchar *entry, *value;
+		guint32 entry_length;
+		gsize name_length;
+		guint j;
+
+		entry_length = READ_UINT32_LE (data + pos);
+		pos += 4;
+
+		if (entry_length > length - pos) {
+			break;
+		}
+
+		entry = (const gchar *) data + pos;
+		pos += entry_length;
+
+		/* Entries are NAME=value */
+		value = memchr (entry, '=', entry_length);
+
+		if (!value) {
+			continue;
+		}
+
+		name_length = value - entry;
+		value++;
+
+		for (j = 0; j < G_N_ELEMENTS (vorbis_comment_fields); j++) {
+			if (strlen (vorbis_comment_fields[j].name) == name_length &&
+			    g_ascii_strncasecmp (entry, vorbis_comment_fields[j].name, name_length) == 0) {
+				set_tag (tags, vorbis_comment_fields[j].offset,
+				         value, entry_length - name_length - 1);
+				break;
+			}
+		}
+	}
+}
+
+/* ---------------------------------- FLAC --------------------------------- */
+
+static void
+parse_flac_picture (const guchar     *data,
+                    gsize             length,
+                    TrackerAudioTags *tags)
+{
+	guint32 type, mime_length, description_length, picture_length;
+	const guchar *mime;
+	gsize pos;
+
+	/* Type, MIME type length and description length, with an
+	 * empty MIME type */
+	if (length < 12) {
+		return;
+	}
+
+	type = READ_UINT32_BE (data);
+
+	/* Take the front cover, or else the first picture */
+	if (tags->cover && type != FLAC_PICTURE_FRONT_COVER) {
+		return;
+	}
+
+	mime_length = READ_UINT32_BE (data + 4);
+	pos = 8;
+
+	if (mime_length > length - pos) {
+		return;
+	}
+
+	mime = data + pos;
+	pos += mime_length;
+
+	if (pos + 4 > length) {
+		return;
+	}
+
+	description_length = READ_UINT32_BE (data + pos);
+	pos += 4;
+
+	if (description_length > length - pos) {
+		return;
+	}
+
+	/* Skip description, then width, height, depth and colors */
+	pos += description_length;
+
+	if (pos + 20 > length) {
+		return;
+	}
+
+	pos += 16;
+
+	picture_length = READ_UINT32_BE (data + pos);
+	pos += 4;
+
+	if (picture_length == 0 || picture_length > length - pos) {
+		return;
+	}
+
+	g_free (tags->cover_mime);
+	tags->cover_mime = g_strndup ((const gchar *) mime, mime_length);
+	tags->cover = data + pos;
+	tags->cover_length = picture_length;
+}
+
+static gboolean
+scan_flac (const guchar     *data,
+           gsize             length,
+           TrackerAudioTags *tags)
+{
+	gboolean have_streaminfo = FALSE, last = FALSE;
+	guint64 total_samples = 0;
+	gsize pos;
+
+	pos = skip_id3v2 (data, length);
+
+	if (length - pos < 4 || memcmp (data + pos, "fLaC", 4) != 0) {
+		return FALSE;
+	}
+
+	pos += 4;
+
+	while (!last && length - pos >= 4) {
+		const guchar *block;
+		gsize block_length;
+		guint type;
+
+		last = (data[pos] & 0x80) != 0;
+		type = data[pos] & 0x7f;
+		block_length = READ_UINT24_BE (data + pos + 1);
+		pos += 4;
+
+		if (block_length > length - pos) {
+			/* Truncated file */
+			break;
+		}
+
+		block = data + pos;
+		pos += block_length;
+
+		switch (type) {
+		case FLAC_BLOCK_STREAMINFO:
+			if (block_length < 18) {
+				break;
+			}
+
+			/* After the min/max block and frame sizes come
+			 * 20 bits of sample rate, 3 of channels - 1,
+			 * 5 of bits per sample - 1 and 36 of samples.
+			 */
+			tags->sample_rate = ((guint) block[10] << 12) | ((guint) block[11] << 4) | (block[12] >> 4);
+			tags->channels = ((block[12] >> 1) & 0x07) + 1;
+			total_samples = ((guint64) (block[13] & 0x0f) << 32) | READ_UINT32_BE (block + 14);
+			have_streaminfo = TRUE;
+			break;
+		case FLAC_BLOCK_VORBIS_COMMENT:
+			parse_vorbis_comment (block, block_length, tags);
+			break;
+		case FLAC_BLOCK_PICTURE:
+			parse_flac_picture (block, block_length, tags);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (!have_streaminfo) {
+		return FALSE;
+	}
+
+	tags->codec = "FLAC";
+
+	if (tags->sample_rate > 0 && total_samples > 0) {
+		tags->duration = total_samples / tags->sample_rate;
+
+		if (tags->duration > 0 && length > pos) {
+			tags->bitrate = (length - pos) * 8 / tags->duration;
+		}
+	}
+
+	return TRUE;
+}
+
+/* ----------------------------------- Ogg --------------------------------- */
+
+static gboolean
+parse_ogg_packet (guint              index,
+                  const guchar      *packet,
+                  gsize              length,
+                  TrackerAudioTags  *tags,
+                  guint             *pre_skip)
+{
+	if (index == 0) {
+		if (length >= 28 && packet[0] == 0x01 && memcmp (packet + 1, "vorbis", 6) == 0) {
+			tags->codec = "Vorbis";
+			tags->channels = packet[11];
+			tags->sample_rate = READ_UINT32_LE (packet + 12);
+			tags->bitrate = READ_UINT32_LE (packet + 20);
+			return tags->sample_rate > 0;
+		} else if (length >= 19 && memcmp (packet, "OpusHead", 8) == 0) {
+			tags->codec = "Opus";
+			tags->channels = packet[9];
+			*pre_skip = READ_UINT16_LE (packet + 10);
+			/* The input rate is informative, Opus always
+			 * decodes at 48kHz.
+			 */
+			tags->sample_rate = READ_UINT32_LE (packet + 12);
+			if (tags->sample_rate == 0) {
+				tags->sample_rate = OPUS_SAMPLE_RATE;
+			}
+			return TRUE;
+		}
+
+		/* Theora, Speex... */
+		return FALSE;
+	}
+
+	if (g_strcmp0 (tags->codec, "Vorbis") == 0) {
+		if (length >= 7 && packet[0] == 0x03 && memcmp (packet + 1, "vorbis", 6) == 0) {
+			parse_vorbis_comment (packet + 7, length - 7, tags);
+		}
+	} else {
+		if (length >= 8 && memcmp (packet, "OpusTags", 8) == 0) {
+			parse_vorbis_comment (packet + 8, length - 8, tags);
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+ogg_get_last_granule (const guchar *data,
+                      gsize         length,
+                      guint32       serial,
+                      guint64      *granule)
+{
+	gsize pos, start;
+
+	if (length < OGG_PAGE_HEADER_SIZE) {
+		return FALSE;
+	}
+
+	start = length > OGG_LAST_PAGE_SEARCH ? length - OGG_LAST_PAGE_SEARCH : 0;
+
+	for (pos = length - OGG_PAGE_HEADER_SIZE + 1; pos-- > start; ) {
+		guint64 value;
+
+		if (data[pos] != 'O' ||
+		    memcmp (data + pos, "OggS", 4) != 0 ||
+		    READ_UINT32_LE (data + pos + 14) != serial) {
+			continue;
+		}
+
+		value = READ_UINT64_LE (data + pos + 6);
+
+		/* -1 means no packet finishes on this page */
+		if (value != G_MAXUINT64) {
+			*granule = value;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+scan_ogg (const guchar     *data,
+          gsize             length,
+          TrackerAudioTags *tags)
+{
+	GByteArray *packet;
+	guint n_packets = 0, pre_skip = 0;
+	guint32 serial = 0;
+	guint64 granule;
+	gsize pos = 0;
+	gboolean valid = TRUE;
+
+	packet = g_byte_array_new ();
+
+	/* Reassemble the two header packets of the first stream */
+	while (valid && n_packets < 2 && length - pos >= OGG_PAGE_HEADER_SIZE) {
+		const guchar *page = data + pos;
+		gsize body, body_length = 0, segment_pos;
+		guint n_segments, i;
+
+		if (memcmp (page, "OggS", 4) != 0) {
+			break;
+		}
+
+		n_segments = page[26];
+
+		if (length - pos - OGG_PAGE_HEADER_SIZE < n_segments) {
+			break;
+		}
+
+		for (i = 0; i < n_segments; i++) {
+			body_length += page[OGG_PAGE_HEADER_SIZE + i];
+		}
+
+		body = pos + OGG_PAGE_HEADER_SIZE + n_segments;
+
+		if (length - body < body_length) {
+			break;
+		}
+
+		if (pos == 0) {
+			serial = READ_UINT32_LE (page + 14);
+		}
+
+		if (READ_UINT32_LE (page + 14) == serial) {
+			segment_pos = body;
+
+			for (i = 0; i < n_segments && n_packets < 2; i++) {
+				guint lacing = page[OGG_PAGE_HEADER_SIZE + i];
+
+				g_byte_array_append (packet, data + segment_pos, lacing);
+				segment_pos += lacing;
+
+				if (lacing < 255) {
+					/* End of packet */
+					valid = parse_ogg_packet (n_packets, packet->data, packet->len,
+					                          tags, &pre_skip);
+					g_byte_array_set_size (packet, 0);
+					n_packets++;
+
+					if (!valid) {
+						break;
+					}
+				}
+			}
+		}
+
+		pos = body + body_length;
+	}
+
+	g_byte_array_unref (packet);
+
+	if (!valid || n_packets == 0) {
+		return FALSE;
+	}
+
+	if (ogg_get_last_granule (data, length, serial, &granule)) {
+		if (g_strcmp0 (tags->codec, "Opus") == 0) {
+			tags->duration = granule > pre_skip ? (granule - pre_skip) / OPUS_SAMPLE_RATE : 0;
+		} else {
+			tags->duration = granule / tags->sample_rate;
+		}
+	}
+
+	if (tags->bitrate == 0 && tags->duration > 0) {
+		tags->bitrate = length * 8 / tags->duration;
+	}
+
+	return TRUE;
+}
+
+/* ----------------------------------- MP4 --------------------------------- */
+
+static gboolean
+mp4_next_box (const guchar  *data,
+              gsize          length,
+              gsize         *pos,
+              guint32       *type,
+              const guchar **payload,
+              gsize         *payload_length)
+{
+	guint64 size;
+	gsize header = 8;
+
+	if (length - *pos < 8) {
+		return FALSE;
+	}
+
+	size = READ_UINT32_BE (data + *pos);
+	*type = READ_UINT32_BE (data + *pos + 4);
+
+	if (size == 1) {
+		/* 64 bit size */
+		if (length - *pos < 16) {
+			return FALSE;
+		}
+
+		size = READ_UINT64_BE (data + *pos + 8);
+		header = 16;
+	} else if (size == 0) {
+		/* Up to the end of the file */
+		size = length - *pos;
+	}
+
+	if (size < header || size > length - *pos) {
+		return FALSE;
+	}
+
+	*payload = data + *pos + header;
+	*payload_length = size - header;
+	*pos += size;
+
+	return TRUE;
+}
+
+static const guchar *
+mp4_find_box (const guchar *data,
+              gsize         length,
+              guint32       wanted,
+              gsize        *box_length)
+{
+	const guchar *payload;
+	gsize pos = 0, payload_length;
+	guint32 type;
+
+	while (mp4_next_box (data, length, &pos, &type, &payload, &payload_length)) {
+		if (type == wanted) {
+			*box_length = payload_length;
+			return payload;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+parse_mp4_item (guint32           item_type,
+                const guchar     *item,
+                gsize             item_length,
+                TrackerAudioTags *tags)
+{
+	const guchar *value;
+	gsize value_length;
+	guint32 data_type;
+	guint i;
+
+	value = mp4_find_box (item, item_length, MP4_TYPE ('d', 'a', 't', 'a'), &value_length);
+
+	/* Type indicator and locale */
+	if (!value || value_length < 8) {
+		return;
+	}
+
+	data_type = READ_UINT32_BE (value) & 0xffffff;
+	value += 8;
+	value_length -= 8;
+
+	if (item_type == MP4_TYPE ('t', 'r', 'k', 'n') ||
+	    item_type == MP4_TYPE ('d', 'i', 's', 'k')) {
+		guint number, total;
+
+		if (value_length < 6) {
+			return;
+		}
+
+		number = READ_UINT16_BE (value + 2);
+		total = READ_UINT16_BE (value + 4);
+
+		if (item_type == MP4_TYPE ('t', 'r', 'k', 'n')) {
+			if (number > 0 && !tags->track_number) {
+				tags->track_number = g_strdup_printf ("%u", number);
+			}
+			if (total > 0 && !tags->track_count) {
+				tags->track_count = g_strdup_printf ("%u", total);
+			}
+		} else if (number > 0 && !tags->disc_number) {
+			tags->disc_number = g_strdup_printf ("%u", number);
+		}
+
+		return;
+	}
+
+	if (item_type == MP4_TYPE ('c', 'o', 'v', 'r')) {
+		if (!tags->cover && value_length > 0 &&
+		    (data_type == MP4_DATA_JPEG || data_type == MP4_DATA_PNG)) {
+			tags->cover = value;
+			tags->cover_length = value_length;
+			tags->cover_mime = g_strdup (data_type == MP4_DATA_JPEG ? "image/jpeg" : "image/png");
+		}
+
+		return;
+	}
+
+	if (data_type != MP4_DATA_UTF8) {
+		return;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (mp4_text_items); i++) {
+		if (mp4_text_items[i].type == item_type) {
+			set_tag (tags, mp4_text_items[i].offset,
+			         (const gchar *) value, value_length);
+			break;
+		}
+	}
+}
+
+static void
+parse_mp4_udta (const guchar     *udta,
+                gsize             udta_length,
+                TrackerAudioTags *tags)
+{
+	const guchar *meta, *ilst, *item;
+	gsize meta_length, ilst_length, item_length, pos = 0;
+	guint32 type;
+
+	meta = mp4_find_box (udta, udta_length, MP4_TYPE ('m', 'e', 't', 'a'), &meta_length);
+
+	/* meta is a full box, skip version and flags */
+	if (!meta || meta_length < 4) {
+		return;
+	}
+
+	ilst = mp4_find_box (meta + 4, meta_length - 4, MP4_TYPE ('i', 'l', 's', 't'), &ilst_length);
+
+	if (!ilst) {
+		return;
+	}
+
+	while (mp4_next_box (ilst, ilst_length, &pos, &type, &item, &item_length)) {
+		parse_mp4_item (type, item, item_length, tags);
+	}
+}
+
+/* Returns the track handler type */
+static guint32
+parse_mp4_trak (const guchar     *trak,
+                gsize             trak_length,
+                TrackerAudioTags *tags)
+{
+	const guchar *mdia, *hdlr, *minf, *stbl, *stsd, *entry;
+	gsize mdia_length, hdlr_length, minf_length, stbl_length, stsd_length, entry_length, pos;
+	guint32 handler, entry_type;
+
+	mdia = mp4_find_box (trak, trak_length, MP4_TYPE ('m', 'd', 'i', 'a'), &mdia_length);
+	if (!mdia) {
+		return 0;
+	}
+
+	/* Version and flags, pre-defined, then the handler type */
+	hdlr = mp4_find_box (mdia, mdia_length, MP4_TYPE ('h', 'd', 'l', 'r'), &hdlr_length);
+	if (!hdlr || hdlr_length < 12) {
+		return 0;
+	}
+
+	handler = READ_UINT32_BE (hdlr + 8);
+
+	if (handler != MP4_TYPE ('s', 'o', 'u', 'n') || tags->codec) {
+		return handler;
+	}
+
+	minf = mp4_find_box (mdia, mdia_length, MP4_TYPE ('m', 'i', 'n', 'f'), &minf_length);
+	stbl = minf ? mp4_find_box (minf, minf_length, MP4_TYPE ('s', 't', 'b', 'l'), &stbl_length) : NULL;
+	stsd = stbl ? mp4_find_box (stbl, stbl_length, MP4_TYPE ('s', 't', 's', 'd'), &stsd_length) : NULL;
+
+	/* Version and flags, entry count, then the sample entries */
+	if (!stsd || stsd_length < 8) {
+		return handler;
+	}
+
+	pos = 8;
+
+	if (!mp4_next_box (stsd, stsd_length, &pos, &entry_type, &entry, &entry_length)) {
+		return handler;
+	}
+
+	if (entry_type == MP4_TYPE ('m', 'p', '4', 'a')) {
+		tags->codec = "AAC";
+	} else if (entry_type == MP4_TYPE ('a', 'l', 'a', 'c')) {
+		tags->codec = "ALAC";
+	} else {
+		return handler;
+	}
+
+	/* Audio sample entry: reserved, data reference index,
+	 * reserved, then channel count, sample size, reserved
+	 * and the sample rate as 16.16 fixed point.
+	 */
+	if (entry_length >= 28) {
+		tags->channels = READ_UINT16_BE (entry + 16);
+		tags->sample_rate = READ_UINT16_BE (entry + 24);
+	}
+
+	return handler;
+}
+
+static gboolean
+scan_mp4 (const guchar     *data,
+          gsize             length,
+          TrackerAudioTags *tags)
+{
+	const guchar *moov, *payload;
+	gsize moov_length, payload_length, pos = 0;
+	gboolean have_audio = FALSE;
+	guint32 type;
+
+	if (length < 8 || memcmp (data + 4, "ftyp", 4) != 0) {
+		return FALSE;
+	}
+
+	/* moov may be anywhere at the top level, often at the end */
+	moov = mp4_find_box (data, length, MP4_TYPE ('m', 'o', 'o', 'v'), &moov_length);
+	if (!moov) {
+		return FALSE;
+	}
+
+	while (mp4_next_box (moov, moov_length, &pos, &type, &payload, &payload_length)) {
+		if (type == MP4_TYPE ('m', 'v', 'h', 'd') && payload_length >= 20) {
+			guint64 duration;
+			guint32 timescale;
+
+			if (payload[0] == 1) {
+				if (payload_length < 32) {
+					continue;
+				}
+
+				timescale = READ_UINT32_BE (payload + 20);
+				duration = READ_UINT64_BE (payload + 24);
+			} else {
+				timescale = READ_UINT32_BE (payload + 12);
+				duration = READ_UINT32_BE (payload + 16);
+			}
+
+			if (timescale > 0) {
+				tags->duration = duration / timescale;
+			}
+		} else if (type == MP4_TYPE ('t', 'r', 'a', 'k')) {
+			guint32 handler;
+
+			handler = parse_mp4_trak (payload, payload_length, tags);
+
+			if (handler == MP4_TYPE ('v', 'i', 'd', 'e')) {
+				/* Not for us, leave it to the generic extractors */
+				return FALSE;
+			} else if (handler == MP4_TYPE ('s', 'o', 'u', 'n')) {
+				have_audio = TRUE;
+			}
+		} else if (type == MP4_TYPE ('u', 'd', 't', 'a')) {
+			parse_mp4_udta (payload, payload_length, tags);
+		}
+	}
+
+	if (!have_audio) {
+		return FALSE;
+	}
+
+	if (!tags->codec) {
+		tags->codec = "MPEG-4";
+	}
+
+	if (tags->duration > 0) {
+		tags->bitrate = length * 8 / tags->duration;
+	}
+
+	return TRUE;
+}
+
+/* --------------------------------- Public -------------------------------- */
+
+TrackerAudioFormat
+tracker_audio_tags_detect (const guchar *data,
+                           gsize         length)
+{
+	gsize pos;
+
+	if (!data || length < 12) {
+		return TRACKER_AUDIO_FORMAT_UNKNOWN;
+	}
+
+	if (memcmp (data, "OggS", 4) == 0) {
+		return TRACKER_AUDIO_FORMAT_OGG;
+	}
+
+	if (memcmp (data + 4, "ftyp", 4) == 0) {
+		return TRACKER_AUDIO_FORMAT_MP4;
+	}
+
+	pos = skip_id3v2 (data, length);
+
+	if (length - pos >= 4 && memcmp (data + pos, "fLaC", 4) == 0) {
+		return TRACKER_AUDIO_FORMAT_FLAC;
+	}
+
+	return TRACKER_AUDIO_FORMAT_UNKNOWN;
+}
+
+gboolean
+tracker_audio_tags_scan (const guchar     *data,
+                         gsize             length,
+                         TrackerAudioTags *tags)
+{
+	gboolean retval = FALSE;
+
+	g_return_val_if_fail (tags != NULL, FALSE);
+
+	memset (tags, 0, sizeof (TrackerAudioTags));
+
+	switch (tracker_audio_tags_detect (data, length)) {
+	case TRACKER_AUDIO_FORMAT_FLAC:
+		retval = scan_flac (data, length, tags);
+		break;
+	case TRACKER_AUDIO_FORMAT_OGG:
+		retval = scan_ogg (data, length, tags);
+		break;
+	case TRACKER_AUDIO_FORMAT_MP4:
+		retval = scan_mp4 (data, length, tags);
+		break;
+	case TRACKER_AUDIO_FORMAT_UNKNOWN:
+		break;
+	}
+
+	if (!retval) {
+		tracker_audio_tags_clear (tags);
+		return FALSE;
+	}
+
+	/* TRACKNUMBER is often given as number/total */
+	if (tags->track_number) {
+		gchar *slash = strchr (tags->track_number, '/');
+
+		if (slash) {
+			*slash = '\0';
+
+			if (!tags->track_count && slash[1] != '\0') {
+				tags->track_count = g_strdup (slash + 1);
+			}
+		}
+	}
+
+	if (tags->disc_number) {
+		gchar *slash = strchr (tags->disc_number, '/');
+
+		if (slash) {
+			*slash = '\0';
+		}
+	}
+
+	return TRUE;
+}
+
+void
+tracker_audio_tags_clear (TrackerAudioTags *tags)
+{
+	g_return_if_fail (tags != NULL);
+
+	g_free (tags->title);
+	g_free (tags->artist);
+	g_free (tags->album);
+	g_free (tags->album_artist);
+	g_free (tags->performer);
+	g_free (tags->composer);
+	g_free (tags->track_number);
+	g_free (tags->track_count);
+	g_free (tags->disc_number);
+	g_free (tags->date);
+	g_free (tags->genre);
+	g_free (tags->comment);
+	g_free (tags->lyrics);
+	g_free (tags->copyright);
+	g_free (tags->license);
+	g_free (tags->publisher);
+	g_free (tags->album_gain);
+	g_free (tags->album_peak_gain);
+	g_free (tags->cover_mime);
+
+	memset (tags, 0, sizeof (TrackerAudioTags));
+}
@@ -0,0 +1,78 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_AUDIO_TAGS_H__
+#define __TRACKER_AUDIO_TAGS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	TRACKER_AUDIO_FORMAT_UNKNOWN,
+	TRACKER_AUDIO_FORMAT_FLAC,
+	TRACKER_AUDIO_FORMAT_OGG,
+	TRACKER_AUDIO_FORMAT_MP4
+} TrackerAudioFormat;
+
+/* Tags found in the file headers, strings are newly allocated and
+ * UTF-8 as given by the file, the cover points into the scanned data.
+ */
+typedef struct {
+	const gchar *codec;
+
+	gchar *title;
+	gchar *artist;
+	gchar *album;
+	gchar *album_artist;
+	gchar *performer;
+	gchar *composer;
+	gchar *track_number;
+	gchar *track_count;
+	gchar *disc_number;
+	gchar *date;
+	gchar *genre;
+	gchar *comment;
+	gchar *lyrics;
+	gchar *copyright;
+	gchar *license;
+	gchar *publisher;
+	gchar *album_gain;
+	gchar *album_peak_gain;
+
+	guint sample_rate;
+	guint channels;
+	guint bitrate;
+	guint64 duration;
+
+	const guchar *cover;
+	gsize cover_length;
+	gchar *cover_mime;
+} TrackerAudioTags;
+
+TrackerAudioFormat tracker_audio_tags_detect (const guchar     *data,
+                                              gsize             length);
+
+gboolean           tracker_audio_tags_scan  (const guchar     *data,
+                                             gsize             length,
+                                             TrackerAudioTags *tags);
+
+void               tracker_audio_tags_clear (TrackerAudioTags *tags);
+
+G_END_DECLS
+
+#endif /* __TRACKER_AUDIO_TAGS_H__ */
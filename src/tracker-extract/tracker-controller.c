@@ -41,6 +41,7 @@
 
 typedef struct TrackerControllerPrivate TrackerControllerPrivate;
 typedef struct GetMetadataData GetMetadataData;
+typedef struct GetMetadataBatchData GetMetadataBatchData;
 
 struct TrackerControllerPrivate {
 	GMainContext *context;
@@ -76,9 +77,28 @@ struct GetMetadataData {
 	gchar *mimetype;
 	gint fd; /* Only for fast queries */
 
+	GetMetadataBatchData *batch; /* Only for batch queries */
+	guint32 batch_id;
+
 	GSource *watchdog_source;
 };
 
+struct GetMetadataBatchData {
+	TrackerController *controller;
+	GDBusMethodInvocation *invocation;
+	TrackerDBusRequest *request;
+	GOutputStream *unix_output_stream;
+	GOutputStream *buffered_output_stream;
+	GDataOutputStream *data_output_stream;
+	guint n_pending;
+	GError *error;
+};
+
+enum {
+	GET_METADATA_BATCH_OK,
+	GET_METADATA_BATCH_ERROR
+};
+
 #define TRACKER_EXTRACT_SERVICE   "org.freedesktop.Tracker1.Extract"
 #define TRACKER_EXTRACT_PATH      "/org/freedesktop/Tracker1/Extract"
 #define TRACKER_EXTRACT_INTERFACE "org.freedesktop.Tracker1.Extract"
@@ -106,6 +126,10 @@ static const gchar *introspection_xml =
 	"      <arg type='s' name='graph' direction='in' />"
 	"      <arg type='h' name='fd' direction='in' />"
 	"    </method>"
+	"    <method name='GetMetadataBatch'>"
+	"      <arg type='a(usss)' name='items' direction='in' />"
+	"      <arg type='h' name='fd' direction='in' />"
+	"    </method>"
 	"    <method name='CancelTasks'>"
 	"      <arg type='as' name='uri' direction='in' />"
 	"    </method>"
@@ -283,11 +307,22 @@ metadata_data_new (TrackerController     *controller,
 	data->mimetype = g_strdup (mime);
 	data->invocation = invocation;
 	data->request = request;
+	data->fd = -1;
+	data->batch = NULL;
+	data->batch_id = 0;
+	data->watchdog_source = NULL;
+
+	return data;
+}
 
+/* Extractions are expected to finish in WATCHDOG_TIMEOUT seconds from
+ * the moment they start */
+static void
+metadata_data_start_watchdog (GetMetadataData *data)
+{
 	data->watchdog_source = controller_timeout_source_new (WATCHDOG_TIMEOUT,
 	                                                       watchdog_timeout_cb,
 	                                                       data);
-	return data;
 }
 
 static void
@@ -299,7 +334,11 @@ metadata_data_free (GetMetadataData *data)
 	g_free (data->uri);
 	g_free (data->mimetype);
 	g_object_unref (data->cancellable);
-	g_source_destroy (data->watchdog_source);
+
+	if (data->watchdog_source) {
+		g_source_destroy (data->watchdog_source);
+	}
+
 	g_slice_free (GetMetadataData, data);
 }
 
@@ -506,6 +545,7 @@ handle_method_call_get_metadata (TrackerController     *controller,
 	request = tracker_dbus_request_begin (NULL, "%s (%s, %s)", __FUNCTION__, uri, mime);
 
 	data = metadata_data_new (controller, uri, mime, invocation, request);
+	metadata_data_start_watchdog (data);
 	tracker_extract_file (priv->extractor, uri, mime, graph,
 	                      data->cancellable,
 	                      get_metadata_cb, data);
@@ -705,6 +745,7 @@ handle_method_call_get_metadata_fast (TrackerController     *controller,
 
 		if (fd_list && (fd = g_unix_fd_list_get (fd_list, index_fd, &error)) != -1) {
 			data = metadata_data_new (controller, uri, mime, invocation, request);
+			metadata_data_start_watchdog (data);
 			data->fd = fd;
 
 			tracker_extract_file (priv->extractor, uri, mime, graph,
@@ -730,6 +771,259 @@ handle_method_call_get_metadata_fast (TrackerController     *controller,
 	}
 }
 
+/* Batch requests share a single FD for all items, results are written
+ * as soon as each extraction finishes, so they may come back in any
+ * order. Each result is laid out like:
+ *
+ *   [id][status][length][payload]
+ *
+ * Where the first three fields are host endian guint32 and the payload
+ * is made of the preupdate, postupdate, statements and where strings,
+ * each NUL terminated, or the error message if status is
+ * GET_METADATA_BATCH_ERROR. The payload is empty if nothing was
+ * extracted. The method call returns once all items are done.
+ */
+static void
+get_metadata_batch_write_string (GDataOutputStream  *data_output_stream,
+                                 const gchar        *string,
+                                 GError            **error)
+{
+	if (*error) {
+		return;
+	}
+
+	if (!g_data_output_stream_put_string (data_output_stream,
+	                                      string ? string : "",
+	                                      NULL,
+	                                      error)) {
+		return;
+	}
+
+	g_data_output_stream_put_byte (data_output_stream, 0, NULL, error);
+}
+
+static void
+get_metadata_batch_write (GetMetadataBatchData *batch,
+                          guint32               id,
+                          TrackerExtractInfo   *info,
+                          const GError         *extract_error)
+{
+	GDataOutputStream *stream = batch->data_output_stream;
+	const gchar *strings[4] = { NULL, };
+	guint32 status, length = 0;
+	gint n_strings = 0, i;
+
+	if (batch->error) {
+		/* Client went away, nothing else can be written */
+		return;
+	}
+
+	if (info) {
+		const gchar *statements;
+
+		statements = tracker_sparql_builder_get_result (tracker_extract_info_get_metadata_builder (info));
+
+		if (statements && *statements) {
+			strings[0] = tracker_sparql_builder_get_result (tracker_extract_info_get_preupdate_builder (info));
+			strings[1] = tracker_sparql_builder_get_result (tracker_extract_info_get_postupdate_builder (info));
+			strings[2] = statements;
+			strings[3] = tracker_extract_info_get_where_clause (info);
+			n_strings = 4;
+		}
+
+		status = GET_METADATA_BATCH_OK;
+	} else {
+		strings[0] = extract_error ? extract_error->message : "Unknown error";
+		n_strings = 1;
+		status = GET_METADATA_BATCH_ERROR;
+	}
+
+	for (i = 0; i < n_strings; i++) {
+		length += (strings[i] ? strlen (strings[i]) : 0) + 1;
+	}
+
+	if (g_data_output_stream_put_uint32 (stream, id, NULL, &batch->error) &&
+	    g_data_output_stream_put_uint32 (stream, status, NULL, &batch->error) &&
+	    g_data_output_stream_put_uint32 (stream, length, NULL, &batch->error)) {
+		for (i = 0; i < n_strings; i++) {
+			get_metadata_batch_write_string (stream, strings[i], &batch->error);
+		}
+	}
+
+	/* Let the client process this item before the next one is done */
+	if (!batch->error) {
+		g_output_stream_flush (G_OUTPUT_STREAM (stream), NULL, &batch->error);
+	}
+}
+
+static void
+get_metadata_batch_free (GetMetadataBatchData *batch)
+{
+	g_output_stream_close (G_OUTPUT_STREAM (batch->data_output_stream), NULL, NULL);
+	g_object_unref (batch->data_output_stream);
+	g_object_unref (batch->buffered_output_stream);
+	g_object_unref (batch->unix_output_stream);
+
+	if (batch->error) {
+		g_error_free (batch->error);
+	}
+
+	g_slice_free (GetMetadataBatchData, batch);
+}
+
+static void
+get_metadata_batch_item_done (GetMetadataBatchData *batch)
+{
+	batch->n_pending--;
+
+	if (batch->n_pending > 0) {
+		return;
+	}
+
+	if (batch->error) {
+		tracker_dbus_request_end (batch->request, batch->error);
+		g_dbus_method_invocation_return_gerror (batch->invocation, batch->error);
+	} else {
+		tracker_dbus_request_end (batch->request, NULL);
+		g_dbus_method_invocation_return_value (batch->invocation, NULL);
+	}
+
+	get_metadata_batch_free (batch);
+}
+
+static gboolean
+get_metadata_batch_started_cb (gpointer user_data)
+{
+	GetMetadataData *data = user_data;
+
+	if (!data->watchdog_source) {
+		metadata_data_start_watchdog (data);
+	}
+
+	return FALSE;
+}
+
+static void
+get_metadata_batch_cb (GObject      *object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+	TrackerControllerPrivate *priv;
+	GetMetadataData *data;
+	TrackerExtractInfo *info;
+	GError *error = NULL;
+
+	data = user_data;
+	priv = data->controller->priv;
+	priv->ongoing_tasks = g_list_remove (priv->ongoing_tasks, data);
+	info = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res));
+
+#ifdef THREAD_ENABLE_TRACE
+	g_debug ("Thread:%p (Controller) --> Got batch item %u back",
+	         g_thread_self (), data->batch_id);
+#endif /* THREAD_ENABLE_TRACE */
+
+	if (!info) {
+		g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (res), &error);
+	}
+
+	get_metadata_batch_write (data->batch, data->batch_id, info, error);
+	get_metadata_batch_item_done (data->batch);
+
+	if (error) {
+		g_error_free (error);
+	}
+
+	metadata_data_free (data);
+}
+
+static void
+handle_method_call_get_metadata_batch (TrackerController     *controller,
+                                       GDBusMethodInvocation *invocation,
+                                       GVariant              *parameters)
+{
+	TrackerControllerPrivate *priv;
+	GetMetadataBatchData *batch;
+	TrackerDBusRequest *request;
+	GDBusConnection *connection;
+	GDBusMessage *method_message;
+	GUnixFDList *fd_list;
+	GVariantIter *iter;
+	const gchar *uri, *mime, *graph;
+	guint32 id;
+	gint index_fd, fd = -1;
+	GError *error = NULL;
+
+	priv = controller->priv;
+	connection = g_dbus_method_invocation_get_connection (invocation);
+	method_message = g_dbus_method_invocation_get_message (invocation);
+
+	g_variant_get (parameters, "(a(usss)h)", &iter, &index_fd);
+
+	request = tracker_dbus_request_begin (NULL,
+	                                      "%s (items:%" G_GSIZE_FORMAT ", index_fd:%d)",
+	                                      __FUNCTION__,
+	                                      g_variant_iter_n_children (iter),
+	                                      index_fd);
+	reset_shutdown_timeout (controller);
+
+	if (!(g_dbus_connection_get_capabilities (connection) & G_DBUS_CAPABILITY_FLAGS_UNIX_FD_PASSING)) {
+		error = g_error_new_literal (TRACKER_DBUS_ERROR, 0,
+		                             "No FD passing capabilities");
+	} else if ((fd_list = g_dbus_message_get_unix_fd_list (method_message)) == NULL) {
+		error = g_error_new_literal (TRACKER_DBUS_ERROR, 0,
+		                             "No FD list");
+	} else {
+		fd = g_unix_fd_list_get (fd_list, index_fd, &error);
+	}
+
+	if (fd == -1) {
+		tracker_dbus_request_end (request, error);
+		g_dbus_method_invocation_return_dbus_error (invocation,
+		                                            TRACKER_EXTRACT_SERVICE ".GetMetadataBatchError",
+		                                            error->message);
+		g_variant_iter_free (iter);
+		g_error_free (error);
+		return;
+	}
+
+	batch = g_slice_new0 (GetMetadataBatchData);
+	batch->controller = controller;
+	batch->invocation = invocation;
+	batch->request = request;
+	batch->unix_output_stream = g_unix_output_stream_new (fd, TRUE);
+	batch->buffered_output_stream = g_buffered_output_stream_new_sized (batch->unix_output_stream,
+	                                                                    64 * 1024);
+	batch->data_output_stream = g_data_output_stream_new (batch->buffered_output_stream);
+	g_data_output_stream_set_byte_order (batch->data_output_stream,
+	                                     G_DATA_STREAM_BYTE_ORDER_HOST_ENDIAN);
+
+	/* Hold a pending item so the batch isn't finished
+	 * while items are still being queued.
+	 */
+	batch->n_pending = 1;
+
+	while (g_variant_iter_next (iter, "(u&s&s&s)", &id, &uri, &mime, &graph)) {
+		GetMetadataData *data;
+
+		data = metadata_data_new (controller, uri, mime, NULL, request);
+		data->batch = batch;
+		data->batch_id = id;
+		batch->n_pending++;
+
+		/* Items wait in the extractor queues behind the
+		 * others, the watchdog is armed once they start */
+		tracker_extract_file_full (priv->extractor, uri, mime, graph,
+		                           data->cancellable,
+		                           get_metadata_batch_started_cb,
+		                           get_metadata_batch_cb, data);
+		priv->ongoing_tasks = g_list_prepend (priv->ongoing_tasks, data);
+	}
+
+	g_variant_iter_free (iter);
+	get_metadata_batch_item_done (batch);
+}
+
 static void
 handle_method_call (GDBusConnection       *connection,
                     const gchar           *sender,
@@ -746,6 +1040,8 @@ handle_method_call (GDBusConnection       *connection,
 		handle_method_call_get_pid (controller, invocation, parameters);
 	} else if (g_strcmp0 (method_name, "GetMetadataFast") == 0) {
 		handle_method_call_get_metadata_fast (controller, invocation, parameters);
+	} else if (g_strcmp0 (method_name, "GetMetadataBatch") == 0) {
+		handle_method_call_get_metadata_batch (controller, invocation, parameters);
 	} else if (g_strcmp0 (method_name, "GetMetadata") == 0) {
 		handle_method_call_get_metadata (controller, invocation, parameters);
 	} else if (g_strcmp0 (method_name, "CancelTasks") == 0) {
@@ -24,18 +24,9 @@
 #define _GNU_SOURCE
 #endif
 
-#include <errno.h>
-#include <fcntl.h>
 #include <string.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <sys/mman.h>
 
 #include <glib.h>
-#include <glib/gstdio.h>
-
-#include <libtracker-common/tracker-file-utils.h>
 
 #include <libtracker-extract/tracker-extract.h>
 
@@ -167,58 +158,28 @@ G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
 	TrackerSparqlBuilder *preupdate, *metadata;
-	int fd;
-	gchar *filename, *contents;
+	TrackerFileReader *reader;
+	const gchar *contents;
 	gboolean retval = FALSE;
-	GFile *f;
+	GError *error = NULL;
 	gsize len;
-	struct stat st;
 
 	preupdate = tracker_extract_info_get_preupdate_builder (info);
 	metadata = tracker_extract_info_get_metadata_builder (info);
 
-	f = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (f);
-
-	fd = tracker_file_open_fd (filename);
-
-	if (fd == -1) {
-		g_warning ("Could not open abw file '%s': %s\n",
-		           filename,
-		           g_strerror (errno));
-		g_free (filename);
-		return retval;
-	}
+	reader = tracker_file_reader_open (info, &error);
 
-	if (fstat (fd, &st) == -1) {
-		g_warning ("Could not fstat abw file '%s': %s\n",
-		           filename,
-		           g_strerror (errno));
-		close (fd);
-		g_free (filename);
+	if (!reader) {
+		g_warning ("Could not open abw file: %s\n", error->message);
+		g_error_free (error);
 		return retval;
 	}
 
-	if (st.st_size == 0) {
-		contents = NULL;
-		len = 0;
-	} else {
-		contents = (gchar *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-		if (contents == NULL) {
-			g_warning ("Could not mmap abw file '%s': %s\n",
-			           filename,
-			           g_strerror (errno));
-			close (fd);
-			g_free (filename);
-			return retval;
-		}
-		len = st.st_size;
-	}
-
-	g_free (filename);
+	contents = tracker_file_reader_get_head (reader,
+	                                         tracker_file_reader_get_size (reader),
+	                                         &len);
 
 	if (contents) {
-		GError *error = NULL;
 		GMarkupParseContext *context;
 		AbwParserData data = { 0 };
 
@@ -247,12 +208,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		g_markup_parse_context_free (context);
 	}
 
-
-	if (contents) {
-		munmap (contents, len);
-	}
-
-	close (fd);
+	tracker_file_reader_close (reader);
 
 	return retval;
 }
@@ -0,0 +1,212 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Extracts FLAC, Ogg Vorbis/Opus and MP4 audio files from their headers
+ * alone. Anything the parser does not recognize (video tracks, other Ogg
+ * codecs, damaged headers) makes the module fail, so the next rule for
+ * the MIME type, usually GStreamer, gets the file.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <libtracker-common/tracker-common.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+#include "tracker-audio-sparql.h"
+#include "tracker-audio-tags.h"
+#include "tracker-media-art.h"
+
+static void
+add_tuple (TrackerSparqlBuilder *metadata,
+           const char           *predicate,
+           const char           *object)
+{
+	if (object) {
+		tracker_sparql_builder_predicate (metadata, predicate);
+		tracker_sparql_builder_object_unvalidated (metadata, object);
+	}
+}
+
+G_MODULE_EXPORT gboolean
+tracker_extract_get_metadata (TrackerExtractInfo *info)
+{
+	TrackerSparqlBuilder *preupdate, *metadata;
+	TrackerAudioTags tags;
+	TrackerFileReader *reader;
+	gconstpointer contents;
+	gsize length;
+	gchar *uri;
+	gchar *artist_uri = NULL, *composer_uri = NULL, *album_uri = NULL;
+	const gchar *creator, *graph;
+	GFile *file;
+
+	graph = tracker_extract_info_get_graph (info);
+	preupdate = tracker_extract_info_get_preupdate_builder (info);
+	metadata = tracker_extract_info_get_metadata_builder (info);
+
+	file = tracker_extract_info_get_file (info);
+	reader = tracker_file_reader_open (info, NULL);
+
+	if (!reader) {
+		return FALSE;
+	}
+
+	/* Tags are at both ends of the file, the mapping is only
+	 * paged in where they are looked for */
+	contents = tracker_file_reader_get_head (reader,
+	                                         tracker_file_reader_get_size (reader),
+	                                         &length);
+
+	if (!contents || !tracker_audio_tags_scan (contents, length, &tags)) {
+		/* Leave it to the next extractor */
+		tracker_file_reader_close (reader);
+		return FALSE;
+	}
+
+	uri = g_file_get_uri (file);
+
+	creator = tracker_coalesce_strip (3, tags.artist, tags.album_artist, tags.performer);
+
+	if (creator) {
+		artist_uri = tracker_audio_sparql_add_artist (preupdate, graph, creator);
+	}
+
+	if (tags.composer) {
+		composer_uri = tracker_audio_sparql_add_artist (preupdate, graph, tags.composer);
+	}
+
+	if (tags.album) {
+		album_uri = tracker_audio_sparql_add_album (preupdate, graph,
+		                                            tags.album,
+		                                            tags.album_artist,
+		                                            NULL,
+		                                            tags.track_count,
+		                                            tags.album_gain,
+		                                            tags.album_peak_gain);
+	}
+
+	tracker_sparql_builder_predicate (metadata, "a");
+	tracker_sparql_builder_object (metadata, "nmm:MusicPiece");
+	tracker_sparql_builder_object (metadata, "nfo:Audio");
+
+	if (artist_uri) {
+		tracker_sparql_builder_predicate (metadata, "nmm:performer");
+		tracker_sparql_builder_object_iri (metadata, artist_uri);
+	}
+
+	if (composer_uri) {
+		tracker_sparql_builder_predicate (metadata, "nmm:composer");
+		tracker_sparql_builder_object_iri (metadata, composer_uri);
+	}
+
+	if (album_uri) {
+		gchar *album_disc_uri;
+
+		tracker_sparql_builder_predicate (metadata, "nmm:musicAlbum");
+		tracker_sparql_builder_object_iri (metadata, album_uri);
+
+		album_disc_uri = tracker_audio_sparql_add_album_disc (preupdate, graph,
+		                                                      album_uri,
+		                                                      tags.album,
+		                                                      tags.album_artist,
+		                                                      tags.disc_number);
+
+		tracker_sparql_builder_predicate (metadata, "nmm:musicAlbumDisc");
+		tracker_sparql_builder_object_iri (metadata, album_disc_uri);
+		g_free (album_disc_uri);
+	}
+
+	tracker_guarantee_title_from_file (metadata, "nie:title", tags.title, uri, NULL);
+
+	if (tags.track_number && atoi (tags.track_number) > 0) {
+		tracker_sparql_builder_predicate (metadata, "nmm:trackNumber");
+		tracker_sparql_builder_object_int64 (metadata, atoi (tags.track_number));
+	}
+
+	if (tags.date) {
+		gchar *date;
+
+		date = tracker_date_guess (tags.date);
+		add_tuple (metadata, "nie:contentCreated", date);
+		g_free (date);
+	}
+
+	add_tuple (metadata, "nie:comment", tags.comment);
+	add_tuple (metadata, "nfo:genre", tags.genre);
+	add_tuple (metadata, "nie:plainTextContent", tags.lyrics);
+	add_tuple (metadata, "nie:copyright", tags.copyright);
+	add_tuple (metadata, "nie:license", tags.license);
+
+	if (tags.publisher) {
+		tracker_sparql_builder_predicate (metadata, "dc:publisher");
+
+		tracker_sparql_builder_object_blank_open (metadata);
+		tracker_sparql_builder_predicate (metadata, "a");
+		tracker_sparql_builder_object (metadata, "nco:Contact");
+
+		tracker_sparql_builder_predicate (metadata, "nco:fullname");
+		tracker_sparql_builder_object_unvalidated (metadata, tags.publisher);
+		tracker_sparql_builder_object_blank_close (metadata);
+	}
+
+	add_tuple (metadata, "nfo:codec", tags.codec);
+
+	if (tags.sample_rate > 0) {
+		tracker_sparql_builder_predicate (metadata, "nfo:sampleRate");
+		tracker_sparql_builder_object_int64 (metadata, tags.sample_rate);
+	}
+
+	if (tags.channels > 0) {
+		tracker_sparql_builder_predicate (metadata, "nfo:channels");
+		tracker_sparql_builder_object_int64 (metadata, tags.channels);
+	}
+
+	if (tags.bitrate > 0) {
+		tracker_sparql_builder_predicate (metadata, "nfo:averageBitrate");
+		tracker_sparql_builder_object_int64 (metadata, tags.bitrate);
+	}
+
+	if (tags.duration > 0) {
+		tracker_sparql_builder_predicate (metadata, "nfo:duration");
+		tracker_sparql_builder_object_int64 (metadata, tags.duration);
+	}
+
+	tracker_media_art_process (tags.cover,
+	                           tags.cover_length,
+	                           tags.cover_mime,
+	                           TRACKER_MEDIA_ART_ALBUM,
+	                           tags.album_artist ? tags.album_artist : tags.artist,
+	                           tags.album,
+	                           uri);
+
+	tracker_audio_tags_clear (&tags);
+
+	/* Not before, the cover points into the reader window */
+	tracker_file_reader_close (reader);
+
+	g_free (artist_uri);
+	g_free (composer_uri);
+	g_free (album_uri);
+	g_free (uri);
+
+	return TRUE;
+}
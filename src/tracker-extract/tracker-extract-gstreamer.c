@@ -138,7 +138,7 @@ typedef struct {
 
 #if defined(GSTREAMER_BACKEND_DISCOVERER) || \
     defined(GSTREAMER_BACKEND_GUPNP_DLNA)
-	GstDiscoverer  *discoverer;
+	GstDiscoverer  *discoverer; /* Taken from the pool */
 #endif
 
 #if defined(GSTREAMER_BACKEND_GUPNP_DLNA)
@@ -1359,13 +1359,76 @@ common_extract_stream_metadata (MetadataExtractor    *extractor,
 #if defined(GSTREAMER_BACKEND_DISCOVERER) || \
     defined(GSTREAMER_BACKEND_GUPNP_DLNA)
 
+/* Creating a discoverer means instantiating its uridecodebin and
+ * looking up plugins, so idle discoverers are kept in a small pool and
+ * reused for later files, discoverers are reset after every file
+ * already. Discoverers that failed on a file are dropped instead.
+ */
+#define DISCOVERER_POOL_SIZE 4
+
+static GQueue discoverer_pool = G_QUEUE_INIT;
+G_LOCK_DEFINE_STATIC (discoverer_pool);
+
+static GstDiscoverer *
+discoverer_pool_take (void)
+{
+	GstDiscoverer *discoverer;
+	GError *error = NULL;
+
+	G_LOCK (discoverer_pool);
+	discoverer = g_queue_pop_head (&discoverer_pool);
+	G_UNLOCK (discoverer_pool);
+
+	if (discoverer) {
+		return discoverer;
+	}
+
+	discoverer = gst_discoverer_new (5 * GST_SECOND, &error);
+	if (!discoverer) {
+		g_warning ("Couldn't create discoverer: %s",
+		           error ? error->message : "unknown error");
+		g_clear_error (&error);
+		return NULL;
+	}
+
+#if defined(GST_TYPE_DISCOVERER_FLAGS)
+	/* Tell the discoverer to use *only* Tagreadbin backend.
+	 *  See https://bugzilla.gnome.org/show_bug.cgi?id=656345
+	 */
+	g_debug ("Using Tagreadbin backend in the GStreamer discoverer...");
+	g_object_set (discoverer,
+	              "flags", GST_DISCOVERER_FLAGS_EXTRACT_LIGHTWEIGHT,
+	              NULL);
+#endif
+
+	return discoverer;
+}
+
+static void
+discoverer_pool_release (GstDiscoverer *discoverer)
+{
+	G_LOCK (discoverer_pool);
+
+	if (g_queue_get_length (&discoverer_pool) < DISCOVERER_POOL_SIZE) {
+		g_queue_push_head (&discoverer_pool, discoverer);
+		discoverer = NULL;
+	}
+
+	G_UNLOCK (discoverer_pool);
+
+	if (discoverer) {
+		g_object_unref (discoverer);
+	}
+}
+
 static void
 discoverer_shutdown (MetadataExtractor *extractor)
 {
 	if (extractor->streams)
 		gst_discoverer_stream_info_list_free (extractor->streams);
+
 	if (extractor->discoverer)
-		g_object_unref (extractor->discoverer);
+		discoverer_pool_release (extractor->discoverer);
 }
 
 static gboolean
@@ -1389,24 +1452,11 @@ discoverer_init_and_run (MetadataExtractor *extractor,
 	extractor->has_video = FALSE;
 	extractor->has_audio = FALSE;
 
-	extractor->discoverer = gst_discoverer_new (5 * GST_SECOND, &error);
+	extractor->discoverer = discoverer_pool_take ();
 	if (!extractor->discoverer) {
-		g_warning ("Couldn't create discoverer: %s",
-		           error ? error->message : "unknown error");
-		g_clear_error (&error);
 		return FALSE;
 	}
 
-#if defined(GST_TYPE_DISCOVERER_FLAGS)
-	/* Tell the discoverer to use *only* Tagreadbin backend.
-	 *  See https://bugzilla.gnome.org/show_bug.cgi?id=656345
-	 */
-	g_debug ("Using Tagreadbin backend in the GStreamer discoverer...");
-	g_object_set (extractor->discoverer,
-	              "flags", GST_DISCOVERER_FLAGS_EXTRACT_LIGHTWEIGHT,
-	              NULL);
-#endif
-
 	info = gst_discoverer_discover_uri (extractor->discoverer,
 	                                    uri,
 	                                    &error);
@@ -1414,6 +1464,13 @@ discoverer_init_and_run (MetadataExtractor *extractor,
 		g_warning ("Call to gst_discoverer_discover_uri() failed: %s",
 		           error->message);
 		g_error_free (error);
+
+		/* Don't risk reusing a discoverer left in a bad
+		 * state, e.g. after timing out on a broken file.
+		 */
+		g_object_unref (extractor->discoverer);
+		extractor->discoverer = NULL;
+
 		return FALSE;
 	}
 
@@ -1496,9 +1553,171 @@ discoverer_init_and_run (MetadataExtractor *extractor,
 		}
 	}
 
+	gst_discoverer_info_unref (info);
+
 	return TRUE;
 }
 
+#if defined(GSTREAMER_BACKEND_DISCOVERER)
+
+/* These formats keep their tags in an APEv2 container around the
+ * audio data, a tag demuxer reads them without the stream being
+ * parsed or decoded. Stream details (duration, channels, sample
+ * rate) are not known this way.
+ */
+static const struct {
+	const gchar *mimetype;
+	const gchar *demuxer;
+} tag_only_formats[] = {
+	{ "audio/x-ape", "apedemux" },
+	{ "audio/x-musepack", "apedemux" },
+	{ "audio/x-wavpack", "apedemux" }
+};
+
+static const gchar *
+tag_only_get_demuxer (const gchar *mimetype)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (tag_only_formats); i++) {
+		if (strcmp (mimetype, tag_only_formats[i].mimetype) == 0) {
+			return tag_only_formats[i].demuxer;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+tag_only_pad_added_cb (GstElement *demuxer,
+                       GstPad     *pad,
+                       gpointer    user_data)
+{
+	GstElement *sink = user_data;
+	GstPad *sinkpad;
+
+	sinkpad = gst_element_get_static_pad (sink, "sink");
+
+	if (!gst_pad_is_linked (sinkpad)) {
+		gst_pad_link (pad, sinkpad);
+	}
+
+	gst_object_unref (sinkpad);
+}
+
+static gboolean
+tag_only_init_and_run (MetadataExtractor *extractor,
+                       const gchar       *uri,
+                       const gchar       *demuxer_name)
+{
+	GstElement *pipeline, *source, *demuxer, *sink;
+	GstTagList *tags;
+	GstBus *bus;
+	gboolean success = FALSE, done = FALSE;
+
+	pipeline = gst_pipeline_new (NULL);
+	source = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+	demuxer = gst_element_factory_make (demuxer_name, NULL);
+	sink = gst_element_factory_make ("fakesink", NULL);
+
+	if (!source || !demuxer || !sink) {
+		g_debug ("Couldn't create tag-only pipeline, using the discoverer");
+
+		if (source)
+			gst_object_unref (source);
+		if (demuxer)
+			gst_object_unref (demuxer);
+		if (sink)
+			gst_object_unref (sink);
+		gst_object_unref (pipeline);
+
+		return FALSE;
+	}
+
+	gst_bin_add_many (GST_BIN (pipeline), source, demuxer, sink, NULL);
+	g_signal_connect (demuxer, "pad-added",
+	                  G_CALLBACK (tag_only_pad_added_cb), sink);
+
+	if (!gst_element_link (source, demuxer)) {
+		gst_object_unref (pipeline);
+		return FALSE;
+	}
+
+	tags = gst_tag_list_new_empty ();
+	bus = gst_element_get_bus (pipeline);
+
+	/* Nothing past the tag demuxer, the sink prerolls on the
+	 * first buffer of undecoded data, the tags were posted
+	 * before it.
+	 */
+	gst_element_set_state (pipeline, GST_STATE_PAUSED);
+
+	while (!done) {
+		GstMessage *message;
+		GstTagList *new_tags;
+
+		message = gst_bus_timed_pop_filtered (bus,
+		                                      5 * GST_SECOND,
+		                                      GST_MESSAGE_TAG |
+		                                      GST_MESSAGE_ASYNC_DONE |
+		                                      GST_MESSAGE_EOS |
+		                                      GST_MESSAGE_ERROR);
+
+		if (!message) {
+			g_debug ("Tag-only pipeline timed out");
+			break;
+		}
+
+		switch (GST_MESSAGE_TYPE (message)) {
+		case GST_MESSAGE_TAG:
+			/* Both the demuxer and the sink post the tags */
+			gst_message_parse_tag (message, &new_tags);
+			gst_tag_list_insert (tags, new_tags, GST_TAG_MERGE_KEEP);
+			gst_tag_list_free (new_tags);
+			break;
+		case GST_MESSAGE_ASYNC_DONE:
+		case GST_MESSAGE_EOS:
+			success = TRUE;
+			done = TRUE;
+			break;
+		default:
+			/* No tag container found, or a broken one */
+			done = TRUE;
+			break;
+		}
+
+		gst_message_unref (message);
+	}
+
+	gst_element_set_state (pipeline, GST_STATE_NULL);
+	gst_object_unref (bus);
+	gst_object_unref (pipeline);
+
+	if (success && !gst_tag_list_is_empty (tags)) {
+		gst_tag_list_insert (extractor->tagcache, tags, GST_TAG_MERGE_APPEND);
+	} else {
+		success = FALSE;
+	}
+
+	gst_tag_list_free (tags);
+
+	if (success) {
+		/* Keep the stream details unknown */
+		extractor->duration = -1;
+		extractor->audio_channels = -1;
+		extractor->audio_samplerate = -1;
+		extractor->height = -1;
+		extractor->width = -1;
+		extractor->video_fps = -1.0;
+		extractor->aspect_ratio = -1.0;
+		extractor->has_audio = TRUE;
+	}
+
+	return success;
+}
+
+#endif /* GSTREAMER_BACKEND_DISCOVERER */
+
 #endif /* defined(GSTREAMER_BACKEND_DISCOVERER) || \
           defined(GSTREAMER_BACKEND_GUPNP_DLNA) */
 
@@ -2016,6 +2235,7 @@ tagreadbin_init_and_run (MetadataExtractor *extractor,
 
 static void
 tracker_extract_gstreamer (const gchar          *uri,
+                           const gchar          *mimetype,
                            TrackerSparqlBuilder *preupdate,
                            TrackerSparqlBuilder *postupdate,
                            TrackerSparqlBuilder *metadata,
@@ -2046,8 +2266,25 @@ tracker_extract_gstreamer (const gchar          *uri,
 	g_debug ("  Decodebin2");
 	success = decodebin2_init_and_run (extractor, uri);
 #else /* DISCOVERER/GUPnP-DLNA */
-	g_debug ("  Discoverer/GUPnP-DLNA");
-	success = discoverer_init_and_run (extractor, uri);
+	success = FALSE;
+
+#if defined(GSTREAMER_BACKEND_DISCOVERER)
+	if (type == EXTRACT_MIME_AUDIO) {
+		const gchar *demuxer;
+
+		demuxer = tag_only_get_demuxer (mimetype);
+
+		if (demuxer) {
+			g_debug ("  Tag-only (%s)", demuxer);
+			success = tag_only_init_and_run (extractor, uri, demuxer);
+		}
+	}
+#endif
+
+	if (!success) {
+		g_debug ("  Discoverer/GUPnP-DLNA");
+		success = discoverer_init_and_run (extractor, uri);
+	}
 #endif
 
 	if (success) {
@@ -2128,23 +2365,23 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 #if defined(GSTREAMER_BACKEND_GUPNP_DLNA)
 	if (g_str_has_prefix (mimetype, "dlna/")) {
-		tracker_extract_gstreamer (uri, preupdate, postupdate, metadata, EXTRACT_MIME_GUESS, graph);
+		tracker_extract_gstreamer (uri, mimetype, preupdate, postupdate, metadata, EXTRACT_MIME_GUESS, graph);
 	} else
 #endif /* GSTREAMER_BACKEND_GUPNP_DLNA */
 
 	if (strcmp (mimetype, "image/svg+xml") == 0) {
-		tracker_extract_gstreamer (uri, preupdate, postupdate, metadata, EXTRACT_MIME_SVG, graph);
+		tracker_extract_gstreamer (uri, mimetype, preupdate, postupdate, metadata, EXTRACT_MIME_SVG, graph);
 	} else if (strcmp (mimetype, "video/3gpp") == 0 ||
 	           strcmp (mimetype, "video/mp4") == 0 ||
 	           strcmp (mimetype, "video/x-ms-asf") == 0 ||
 	           strcmp (mimetype, "application/vnd.rn-realmedia") == 0) {
-		tracker_extract_gstreamer (uri, preupdate, postupdate, metadata, EXTRACT_MIME_GUESS, graph);
+		tracker_extract_gstreamer (uri, mimetype, preupdate, postupdate, metadata, EXTRACT_MIME_GUESS, graph);
 	} else if (g_str_has_prefix (mimetype, "audio/")) {
-		tracker_extract_gstreamer (uri, preupdate, postupdate, metadata, EXTRACT_MIME_AUDIO, graph);
+		tracker_extract_gstreamer (uri, mimetype, preupdate, postupdate, metadata, EXTRACT_MIME_AUDIO, graph);
 	} else if (g_str_has_prefix (mimetype, "video/")) {
-		tracker_extract_gstreamer (uri, preupdate, postupdate, metadata, EXTRACT_MIME_VIDEO, graph);
+		tracker_extract_gstreamer (uri, mimetype, preupdate, postupdate, metadata, EXTRACT_MIME_VIDEO, graph);
 	} else if (g_str_has_prefix (mimetype, "image/")) {
-		tracker_extract_gstreamer (uri, preupdate, postupdate, metadata, EXTRACT_MIME_IMAGE, graph);
+		tracker_extract_gstreamer (uri, mimetype, preupdate, postupdate, metadata, EXTRACT_MIME_IMAGE, graph);
 	} else {
 		g_free (uri);
 		return FALSE;
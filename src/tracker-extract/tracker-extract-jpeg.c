@@ -20,36 +20,20 @@
 
 #include "config.h"
 
-#include <stdio.h>
-#include <setjmp.h>
-
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE /* strcasestr() */
 #endif
 
-#include <jpeglib.h>
-
 #include <libtracker-common/tracker-common.h>
 #include <libtracker-extract/tracker-extract.h>
 #include <libtracker-sparql/tracker-sparql.h>
 
 #include "tracker-main.h"
+#include "tracker-jpeg-scanner.h"
 
 #define CM_TO_INCH              0.393700787
 
-#ifdef HAVE_LIBEXIF
-#define EXIF_NAMESPACE          "Exif"
-#define EXIF_NAMESPACE_LENGTH   4
-#endif /* HAVE_LIBEXIF */
-
-#ifdef HAVE_EXEMPI
-#define XMP_NAMESPACE           "http://ns.adobe.com/xap/1.0/\x00"
-#define XMP_NAMESPACE_LENGTH    29
-#endif /* HAVE_EXEMPI */
-
 #ifdef HAVE_LIBIPTCDATA
-#define PS3_NAMESPACE           "Photoshop 3.0\0"
-#define PS3_NAMESPACE_LENGTH    14
 #include <libiptcdata/iptc-jpeg.h>
 #endif /* HAVE_LIBIPTCDATA */
 
@@ -81,19 +65,6 @@ typedef struct {
 	const gchar *gps_direction;
 } MergeData;
 
-struct tej_error_mgr {
-	struct jpeg_error_mgr jpeg;
-	jmp_buf setjmp_buffer;
-};
-
-static void
-extract_jpeg_error_exit (j_common_ptr cinfo)
-{
-	struct tej_error_mgr *h = (struct tej_error_mgr *) cinfo->err;
-	(*cinfo->err->output_message)(cinfo);
-	longjmp (h->setjmp_buffer, 1);
-}
-
 static gboolean
 guess_dlna_profile (gint          width,
                     gint          height,
@@ -136,18 +107,15 @@ guess_dlna_profile (gint          width,
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
-	struct jpeg_decompress_struct cinfo;
-	struct tej_error_mgr tejerr;
-	struct jpeg_marker_struct *marker;
+	TrackerJpegHeader header;
 	TrackerSparqlBuilder *preupdate, *metadata;
 	TrackerXmpData *xd = NULL;
 	TrackerExifData *ed = NULL;
 	TrackerIptcData *id = NULL;
 	MergeData md = { 0 };
 	GFile *file;
-	FILE *f;
-	goffset size;
-	gchar *filename, *uri;
+	TrackerFileReader *reader;
+	gchar *uri;
 	gchar *comment = NULL;
 	const gchar *dlna_profile, *dlna_mimetype, *graph;
 	GPtrArray *keywords;
@@ -160,19 +128,14 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	graph = tracker_extract_info_get_graph (info);
 
 	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
-
-	size = tracker_file_get_size (filename);
+	reader = tracker_file_reader_open (info, NULL);
 
-	if (size < 18) {
-		g_free (filename);
+	if (!reader) {
 		return FALSE;
 	}
 
-	f = tracker_file_open (filename);
-	g_free (filename);
-
-	if (!f) {
+	if (tracker_file_reader_get_size (reader) < 18) {
+		tracker_file_reader_close (reader);
 		return FALSE;
 	}
 
@@ -183,89 +146,40 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	tracker_sparql_builder_predicate (metadata, "a");
 	tracker_sparql_builder_object (metadata, "nmm:Photo");
 
-	cinfo.err = jpeg_std_error (&tejerr.jpeg);
-	tejerr.jpeg.error_exit = extract_jpeg_error_exit;
-	if (setjmp (tejerr.setjmp_buffer)) {
+	/* Only the markers preceding the image data are needed,
+	 * the entropy coded data is never touched. */
+	if (!tracker_jpeg_scan_file (reader, &header)) {
 		success = FALSE;
 		goto fail;
 	}
 
-	jpeg_create_decompress (&cinfo);
-
-	jpeg_save_markers (&cinfo, JPEG_COM, 0xFFFF);
-	jpeg_save_markers (&cinfo, JPEG_APP0 + 1, 0xFFFF);
-	jpeg_save_markers (&cinfo, JPEG_APP0 + 13, 0xFFFF);
-
-	jpeg_stdio_src (&cinfo, f);
-
-	jpeg_read_header (&cinfo, TRUE);
-
-	/* FIXME? It is possible that there are markers after SOS,
-	 * but there shouldn't be. Should we decompress the whole file?
-	 *
-	 * jpeg_start_decompress(&cinfo);
-	 * jpeg_finish_decompress(&cinfo);
-	 *
-	 * jpeg_calc_output_dimensions(&cinfo);
-	 */
-
-	marker = (struct jpeg_marker_struct *) &cinfo.marker_list;
-
-	while (marker) {
-		gchar *str;
-		gsize len;
-#ifdef HAVE_LIBIPTCDATA
-		gsize offset;
-		guint sublen;
-#endif /* HAVE_LIBIPTCDATA */
-
-		switch (marker->marker) {
-		case JPEG_COM:
-			g_free (comment);
-			comment = g_strndup ((gchar*) marker->data, marker->data_length);
-			break;
-
-		case JPEG_APP0 + 1:
-			str = (gchar*) marker->data;
-			len = marker->data_length;
+	if (header.comment) {
+		comment = g_strndup (header.comment, header.comment_length);
+	}
 
 #ifdef HAVE_LIBEXIF
-			if (strncmp (EXIF_NAMESPACE, str, EXIF_NAMESPACE_LENGTH) == 0) {
-				ed = tracker_exif_new ((guchar *) marker->data, len, uri);
-			}
+	if (header.exif) {
+		ed = tracker_exif_new ((guchar *) header.exif, header.exif_length, uri);
+	}
 #endif /* HAVE_LIBEXIF */
 
 #ifdef HAVE_EXEMPI
-			if (strncmp (XMP_NAMESPACE, str, XMP_NAMESPACE_LENGTH) == 0) {
-				xd = tracker_xmp_new (str + XMP_NAMESPACE_LENGTH,
-				                      len - XMP_NAMESPACE_LENGTH,
-				                      uri);
-			}
+	if (header.xmp) {
+		xd = tracker_xmp_new (header.xmp, header.xmp_length, uri);
+	}
 #endif /* HAVE_EXEMPI */
 
-			break;
-
-		case JPEG_APP0 + 13:
-			str = (gchar*) marker->data;
-			len = marker->data_length;
 #ifdef HAVE_LIBIPTCDATA
-			if (len > 0 && strncmp (PS3_NAMESPACE, str, PS3_NAMESPACE_LENGTH) == 0) {
-				offset = iptc_jpeg_ps3_find_iptc (str, len, &sublen);
-				if (offset > 0 && sublen > 0) {
-					id = tracker_iptc_new (str + offset, sublen, uri);
-				}
-			}
-#endif /* HAVE_LIBIPTCDATA */
-
-			break;
+	if (header.ps3) {
+		gint offset;
+		guint sublen;
 
-		default:
-			marker = marker->next;
-			continue;
+		offset = iptc_jpeg_ps3_find_iptc ((guchar *) header.ps3, header.ps3_length, &sublen);
+		if (offset > 0 && sublen > 0) {
+			id = tracker_iptc_new ((guchar *) header.ps3 + offset, sublen, uri);
 		}
-
-		marker = marker->next;
 	}
+#endif /* HAVE_LIBIPTCDATA */
 
 	if (!ed) {
 		ed = g_new0 (TrackerExifData, 1);
@@ -309,14 +223,14 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 	/* Prioritize on native dimention in all cases */
 	tracker_sparql_builder_predicate (metadata, "nfo:width");
-	tracker_sparql_builder_object_int64 (metadata, cinfo.image_width);
+	tracker_sparql_builder_object_int64 (metadata, header.width);
 
 	/* TODO: add ontology and store ed->software */
 
 	tracker_sparql_builder_predicate (metadata, "nfo:height");
-	tracker_sparql_builder_object_int64 (metadata, cinfo.image_height);
+	tracker_sparql_builder_object_int64 (metadata, header.height);
 
-	if (guess_dlna_profile (cinfo.image_width, cinfo.image_height, &dlna_profile, &dlna_mimetype)) {
+	if (guess_dlna_profile (header.width, header.height, &dlna_profile, &dlna_mimetype)) {
 		tracker_sparql_builder_predicate (metadata, "nmm:dlnaProfile");
 		tracker_sparql_builder_object_string (metadata, dlna_profile);
 		tracker_sparql_builder_predicate (metadata, "nmm:dlnaMime");
@@ -750,53 +664,51 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		tracker_sparql_builder_object_unvalidated (metadata, md.gps_direction);
 	}
 
-	if (cinfo.density_unit != 0 || ed->x_resolution) {
+	if (header.density_unit != 0 || ed->x_resolution) {
 		gdouble value;
 
-		if (cinfo.density_unit == 0) {
+		if (header.density_unit == 0) {
 			if (ed->resolution_unit != 3)
 				value = g_strtod (ed->x_resolution, NULL);
 			else
 				value = g_strtod (ed->x_resolution, NULL) * CM_TO_INCH;
 		} else {
-			if (cinfo.density_unit == 1)
-				value = cinfo.X_density;
+			if (header.density_unit == 1)
+				value = header.x_density;
 			else
-				value = cinfo.X_density * CM_TO_INCH;
+				value = header.x_density * CM_TO_INCH;
 		}
 
 		tracker_sparql_builder_predicate (metadata, "nfo:horizontalResolution");
 		tracker_sparql_builder_object_double (metadata, value);
 	}
 
-	if (cinfo.density_unit != 0 || ed->y_resolution) {
+	if (header.density_unit != 0 || ed->y_resolution) {
 		gdouble value;
 
-		if (cinfo.density_unit == 0) {
+		if (header.density_unit == 0) {
 			if (ed->resolution_unit != 3)
 				value = g_strtod (ed->y_resolution, NULL);
 			else
 				value = g_strtod (ed->y_resolution, NULL) * CM_TO_INCH;
 		} else {
-			if (cinfo.density_unit == 1)
-				value = cinfo.Y_density;
+			if (header.density_unit == 1)
+				value = header.y_density;
 			else
-				value = cinfo.Y_density * CM_TO_INCH;
+				value = header.y_density * CM_TO_INCH;
 		}
 
 		tracker_sparql_builder_predicate (metadata, "nfo:verticalResolution");
 		tracker_sparql_builder_object_double (metadata, value);
 	}
 
-	jpeg_destroy_decompress (&cinfo);
-
 	tracker_exif_free (ed);
 	tracker_xmp_free (xd);
 	tracker_iptc_free (id);
 	g_free (comment);
 
 fail:
-	tracker_file_close (f, FALSE);
+	tracker_file_reader_close (reader);
 	g_free (uri);
 
 	return success;
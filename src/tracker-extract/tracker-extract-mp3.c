@@ -36,10 +36,6 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 
-#ifndef G_OS_WIN32
-#include <sys/mman.h>
-#endif /* G_OS_WIN32 */
-
 #include <libtracker-common/tracker-common.h>
 
 #include <libtracker-extract/tracker-extract.h>
@@ -50,15 +46,13 @@
 #warning Frame traces enabled
 #endif /* FRAME_ENABLE_TRACE */
 
-/* We mmap the beginning of the file and read separately the last 128
- * bytes for id3v1 tags. While these are probably cornercases the
- * rationale is that we don't want to fault a whole page for the last
- * 128 bytes and on the other we don't want to mmap the whole file
- * with unlimited size (might need to create private copy in some
- * special cases, finding continuous space etc). We now take 5 first
- * MB of the file and assume that this is enough. In theory there is
- * no maximum size as someone could embed 50 gigabytes of album art
- * there.
+/* We map the beginning of the file and, for larger files, separately
+ * the last 128 bytes for id3v1 tags, as we don't want to map the
+ * whole file with unlimited size (might need to create private copy
+ * in some special cases, finding continuous space etc). We now take 5
+ * first MB of the file and assume that this is enough. In theory
+ * there is no maximum size as someone could embed 50 gigabytes of
+ * album art there.
  */
 
 #define MAX_FILE_READ     1024 * 1024 * 5
@@ -504,49 +498,6 @@ guess_dlna_profile (gint          bitrate,
 	return FALSE;
 }
 
-static char *
-read_id3v1_buffer (int     fd,
-                   goffset size)
-{
-	char *buffer;
-	guint bytes_read;
-	guint rc;
-
-	if (size < 128) {
-		return NULL;
-	}
-
-	if (lseek (fd, size - ID3V1_SIZE, SEEK_SET) < 0) {
-		return NULL;
-	}
-
-	buffer = g_malloc (ID3V1_SIZE);
-
-	if (!buffer) {
-		return NULL;
-	}
-
-	bytes_read = 0;
-
-	while (bytes_read < ID3V1_SIZE) {
-		rc = read (fd,
-		           buffer + bytes_read,
-		           ID3V1_SIZE - bytes_read);
-		if (rc == -1) {
-			if (errno != EINTR) {
-				g_free (buffer);
-				return NULL;
-			}
-		} else if (rc == 0) {
-			break;
-		} else {
-			bytes_read += rc;
-		}
-	}
-
-	return buffer;
-}
-
 /* Convert from UCS-2 to UTF-8 checking the BOM.*/
 static gchar *
 ucs2_to_utf8(const gchar *data, guint len)
@@ -2074,12 +2025,12 @@ parse_id3v2 (const gchar          *data,
 G_MODULE_EXPORT gboolean
 tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
-	gchar *filename, *uri;
-	int fd;
-	void *buffer;
-	void *id3v1_buffer;
+	TrackerFileReader *reader;
+	gchar *uri;
+	const gchar *buffer;
+	const gchar *id3v1_buffer = NULL;
 	goffset size;
-	goffset  buffer_size;
+	gsize buffer_size, id3v1_size;
 	goffset audio_offset;
 	MP3Data md = { 0 };
 	TrackerSparqlBuilder *metadata, *preupdate;
@@ -2091,53 +2042,36 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	preupdate = tracker_extract_info_get_preupdate_builder (info);
 
 	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
-
-	size = tracker_file_get_size (filename);
+	reader = tracker_file_reader_open (info, NULL);
 
-	if (size == 0) {
-		g_free (filename);
+	if (!reader) {
 		return FALSE;
 	}
 
+	size = tracker_file_reader_get_size (reader);
 	md.size = size;
-	buffer_size = MIN (size, MAX_FILE_READ);
 
-	fd = tracker_file_open_fd (filename);
+	buffer = tracker_file_reader_get_head (reader, MAX_FILE_READ, &buffer_size);
 
-	if (fd == -1) {
+	if (!buffer) {
+		tracker_file_reader_close (reader);
 		return FALSE;
 	}
 
-#ifndef G_OS_WIN32
-	/* We don't use GLib's mmap because size can not be specified */
-	buffer = mmap (NULL,
-	               buffer_size,
-	               PROT_READ,
-	               MAP_PRIVATE,
-	               fd,
-	               0);
-#endif
-
-	id3v1_buffer = read_id3v1_buffer (fd, size);
-
-#ifdef HAVE_POSIX_FADVISE
-	posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
-#endif /* HAVE_POSIX_FADVISE */
-
-	close (fd);
-
-	if (buffer == NULL || buffer == (void*) -1) {
-		g_free (filename);
-		return FALSE;
+	if (size >= ID3V1_SIZE) {
+		if (size <= MAX_FILE_READ) {
+			id3v1_buffer = buffer + size - ID3V1_SIZE;
+		} else {
+			id3v1_buffer = tracker_file_reader_get_tail (reader,
+			                                             ID3V1_SIZE,
+			                                             &id3v1_size);
+		}
 	}
 
 	if (!get_id3 (id3v1_buffer, ID3V1_SIZE, &md.id3v1)) {
 		/* Do nothing? */
 	}
 
-	g_free (id3v1_buffer);
-
 	/* Get other embedded tags */
 	uri = g_file_get_uri (file);
 	audio_offset = parse_id3v2 (buffer, buffer_size, &md.id3v1, uri, metadata, &md);
@@ -2500,11 +2434,8 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	id3v2tag_free (&md.id3v24);
 	id3tag_free (&md.id3v1);
 
-#ifndef G_OS_WIN32
-	munmap (buffer, buffer_size);
-#endif
+	tracker_file_reader_close (reader);
 
-	g_free (filename);
 	g_free (uri);
 
 	return TRUE;
@@ -19,26 +19,18 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <glib.h>
 
-#include <gsf/gsf.h>
-#include <gsf/gsf-doc-meta-data.h>
-#include <gsf/gsf-infile.h>
-#include <gsf/gsf-infile-msole.h>
-#include <gsf/gsf-input-stdio.h>
-#include <gsf/gsf-msole-utils.h>
-#include <gsf/gsf-utils.h>
-#include <gsf/gsf-infile-zip.h>
-
 #include <libtracker-common/tracker-utils.h>
 #include <libtracker-common/tracker-os-dependant.h>
 
 #include <libtracker-extract/tracker-extract.h>
 
 #include "tracker-main.h"
-#include "tracker-gsf.h"
+#include "tracker-zip.h"
 
 typedef enum {
 	MS_OFFICE_XML_TAG_INVALID,
@@ -73,6 +65,7 @@ typedef enum {
 typedef struct {
 	/* Common constant stuff */
 	const gchar *uri;
+	TrackerZip *zip;
 	MsOfficeXMLFileType file_type;
 
 	/* Tag type, reused by Content and Metadata parsers */
@@ -570,10 +563,10 @@ xml_read (MsOfficeXMLParserInfo *parser_info,
 
 		/* Load the internal XML file from the Zip archive, and parse it
 		 * using the given context */
-		tracker_gsf_parse_xml_in_zip (parser_info->uri,
-		                              xml_filename,
-		                              context,
-		                              &error);
+		tracker_zip_parse_xml (parser_info->zip,
+		                       xml_filename,
+		                       context,
+		                       &error);
 		g_markup_parse_context_free (context);
 
 		if (error) {
@@ -802,19 +795,26 @@ tracker_extract_get_metadata (TrackerExtractInfo *extract_info)
 	                                      NULL);
 
 	info.timer = g_timer_new ();
-	/* Load the internal XML file from the Zip archive, and parse it
-	 * using the given context */
-	tracker_gsf_parse_xml_in_zip (uri,
-	                              "[Content_Types].xml",
-	                              context,
-	                              &error);
-	if (error) {
-		g_debug ("Parsing the content-types file gave an error: '%s'",
-		         error->message);
-		g_error_free (error);
-	}
 
-	extract_content (&info);
+	/* The archive is only opened once, all parts are read from it */
+	info.zip = tracker_zip_open (extract_info);
+
+	if (info.zip) {
+		/* Load the internal XML file from the Zip archive, and parse it
+		 * using the given context */
+		tracker_zip_parse_xml (info.zip,
+		                       "[Content_Types].xml",
+		                       context,
+		                       &error);
+		if (error) {
+			g_debug ("Parsing the content-types file gave an error: '%s'",
+			         error->message);
+			g_error_free (error);
+		}
+
+		extract_content (&info);
+		tracker_zip_close (info.zip);
+	}
 
 	/* If we got any content, add it */
 	if (info.content) {
@@ -23,7 +23,7 @@
 #include <libtracker-extract/tracker-extract.h>
 
 #include "tracker-main.h"
-#include "tracker-gsf.h"
+#include "tracker-zip.h"
 #include "tracker-read.h"
 
 #include <unistd.h>
@@ -98,13 +98,13 @@ static void xml_text_handler_content           (GMarkupParseContext   *context,
                                                 gsize                  text_len,
                                                 gpointer               user_data,
                                                 GError               **error);
-static void extract_oasis_content              (const gchar           *uri,
+static void extract_oasis_content              (TrackerZip            *zip,
                                                 gulong                 total_bytes,
                                                 ODTFileType            file_type,
                                                 TrackerSparqlBuilder  *metadata);
 
 static void
-extract_oasis_content (const gchar          *uri,
+extract_oasis_content (TrackerZip           *zip,
                        gulong                total_bytes,
                        ODTFileType           file_type,
                        TrackerSparqlBuilder *metadata)
@@ -137,7 +137,7 @@ extract_oasis_content (const gchar          *uri,
 
 	/* Load the internal XML file from the Zip archive, and parse it
 	 * using the given context */
-	tracker_gsf_parse_xml_in_zip (uri, "content.xml", context, &error);
+	tracker_zip_parse_xml (zip, "content.xml", context, &error);
 
 	if (!error || g_error_matches (error, maximum_size_error_quark, 0)) {
 		content = g_string_free (info.content, FALSE);
@@ -166,6 +166,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *extract_info)
 	GFile *file;
 	gchar *uri;
 	const gchar *mime_used;
+	TrackerZip *zip;
 	GMarkupParseContext *context;
 	GMarkupParser parser = {
 		xml_start_element_handler_metadata,
@@ -201,12 +202,21 @@ tracker_extract_get_metadata (TrackerExtractInfo *extract_info)
 	info.uri = uri;
 	info.title_already_set = FALSE;
 
+	/* Both members are read from the same reader, metadata does
+	 * not need anything from content.xml */
+	zip = tracker_zip_open (extract_info);
+
+	if (!zip) {
+		g_free (uri);
+		return TRUE;
+	}
+
 	/* Create parsing context */
 	context = g_markup_parse_context_new (&parser, 0, &info, NULL);
 
 	/* Load the internal XML file from the Zip archive, and parse it
 	 * using the given context */
-	tracker_gsf_parse_xml_in_zip (uri, "meta.xml", context, NULL);
+	tracker_zip_parse_xml (zip, "meta.xml", context, NULL);
 	g_markup_parse_context_free (context);
 
 	if (g_ascii_strcasecmp (mime_used, "application/vnd.oasis.opendocument.text") == 0) {
@@ -223,11 +233,12 @@ tracker_extract_get_metadata (TrackerExtractInfo *extract_info)
 	}
 
 	/* Extract content with the given limitations */
-	extract_oasis_content (uri,
+	extract_oasis_content (zip,
 	                       tracker_config_get_max_bytes (config),
 	                       file_type,
 	                       metadata);
 
+	tracker_zip_close (zip);
 	g_free (uri);
 
 	return TRUE;
@@ -0,0 +1,215 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/poppler.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+#include "tracker-extract-pdf-worker.h"
+
+static gboolean
+write_all (gint          fd,
+           gconstpointer buffer,
+           gsize         length)
+{
+	const gchar *data = buffer;
+
+	while (length > 0) {
+		gssize written;
+
+		/* MSG_NOSIGNAL, we don't want SIGPIPE if tracker-extract died */
+		written = send (fd, data, length, MSG_NOSIGNAL);
+
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return FALSE;
+		}
+
+		data += written;
+		length -= written;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+read_all (gint      fd,
+          gpointer  buffer,
+          gsize     length)
+{
+	gchar *data = buffer;
+
+	while (length > 0) {
+		gssize bytes_read;
+
+		bytes_read = read (fd, data, length);
+
+		if (bytes_read == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return FALSE;
+		} else if (bytes_read == 0) {
+			/* tracker-extract closed the connection */
+			return FALSE;
+		}
+
+		data += bytes_read;
+		length -= bytes_read;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+send_chunk (gint         fd,
+            const gchar *text,
+            guint32      length)
+{
+	return (write_all (fd, &length, sizeof (length)) &&
+	        (length == 0 || write_all (fd, text, length)));
+}
+
+static void
+extract_text (gint                    fd,
+              const gchar            *uri,
+              const PdfWorkerRequest *request)
+{
+	PopplerDocument *document;
+	GError *error = NULL;
+	gint n_pages, i = 0;
+	GString *string;
+	GTimer *timer;
+	gsize remaining_bytes = request->max_bytes;
+
+	document = poppler_document_new_from_file (uri, NULL, &error);
+
+	if (!document) {
+		g_debug ("Worker: Could not open '%s', %s",
+		         uri,
+		         error ? error->message : "no error given");
+		g_clear_error (&error);
+		return;
+	}
+
+	n_pages = poppler_document_get_n_pages (document);
+	string = g_string_new ("");
+	timer = g_timer_new ();
+
+	/* Pages without text count against the page budget too, they
+	 * still have to be parsed */
+	while (i < n_pages &&
+	       (guint) i < request->max_pages &&
+	       remaining_bytes > 0 &&
+	       g_timer_elapsed (timer, NULL) < request->max_time) {
+		PopplerPage *page;
+		gsize written_bytes = 0;
+		gchar *text;
+
+		page = poppler_document_get_page (document, i);
+		i++;
+
+		text = poppler_page_get_text (page);
+
+		if (!text) {
+			g_object_unref (page);
+			continue;
+		}
+
+		g_string_truncate (string, 0);
+
+		if (tracker_text_validate_utf8 (text,
+		                                MIN (strlen (text), remaining_bytes),
+		                                &string,
+		                                &written_bytes)) {
+			g_string_append_c (string, ' ');
+		}
+
+		remaining_bytes -= written_bytes;
+
+		g_free (text);
+		g_object_unref (page);
+
+		/* Send what we have so far, tracker-extract keeps it even
+		 * if a later page makes us miss the deadline */
+		if (string->len > 0 &&
+		    !send_chunk (fd, string->str, string->len)) {
+			break;
+		}
+	}
+
+	g_debug ("Worker: Content extraction finished: %d/%d pages indexed in %2.2f seconds, "
+	         "%" G_GSIZE_FORMAT " bytes extracted",
+	         i,
+	         n_pages,
+	         g_timer_elapsed (timer, NULL),
+	         (gsize) (request->max_bytes - remaining_bytes));
+
+	g_timer_destroy (timer);
+	g_string_free (string, TRUE);
+	g_object_unref (document);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	PdfWorkerRequest request;
+
+	/* Serve requests until tracker-extract closes its end */
+	while (read_all (PDF_WORKER_FD, &request, sizeof (request))) {
+		gchar *uri;
+
+		uri = g_malloc (request.uri_length + 1);
+
+		if (!read_all (PDF_WORKER_FD, uri, request.uri_length)) {
+			g_free (uri);
+			break;
+		}
+
+		uri[request.uri_length] = '\0';
+
+		extract_text (PDF_WORKER_FD, uri, &request);
+		g_free (uri);
+
+		/* End of document */
+		if (!send_chunk (PDF_WORKER_FD, NULL, 0)) {
+			break;
+		}
+	}
+
+	close (PDF_WORKER_FD);
+
+	return 0;
+}
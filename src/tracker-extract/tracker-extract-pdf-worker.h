@@ -0,0 +1,44 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_EXTRACT_PDF_WORKER_H__
+#define __TRACKER_EXTRACT_PDF_WORKER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The PDF module talks to tracker-extract-pdf-worker over a socket
+ * pair, the worker finds its end at this descriptor.
+ *
+ * Each request is a PdfWorkerRequest followed by the document URI,
+ * the worker sends the text back one page at a time as
+ * (guint32 length, data) chunks terminated by an empty chunk.
+ */
+#define PDF_WORKER_FD 3
+
+typedef struct {
+	guint64 max_bytes;
+	guint32 max_pages;
+	guint32 max_time;
+	guint32 uri_length;
+	guint32 reserved;
+} PdfWorkerRequest;
+
+G_END_DECLS
+
+#endif /* __TRACKER_EXTRACT_PDF_WORKER_H__ */
@@ -25,13 +25,14 @@
 #define _GNU_SOURCE
 #endif
 
-#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/select.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -41,9 +42,6 @@
 #include <glib/gstdio.h>
 #include <glib/poppler.h>
 
-#include <gio/gunixoutputstream.h>
-#include <gio/gunixinputstream.h>
-
 #include <libtracker-common/tracker-date-time.h>
 #include <libtracker-common/tracker-utils.h>
 #include <libtracker-common/tracker-file-utils.h>
@@ -51,13 +49,18 @@
 #include <libtracker-extract/tracker-extract.h>
 
 #include "tracker-main.h"
+#include "tracker-extract-pdf-worker.h"
 
-/* Time in seconds before we kill the forked child process used for
- * content extraction */
+/* Time in seconds a document may take in the content extraction
+ * worker before we kill it */
 #define EXTRACTION_PROCESS_TIMEOUT 10
 
-/* Size of the buffer to use when reading, in bytes */
-#define BUFFER_SIZE 65535
+/* Time in seconds the worker spends extracting text from a document,
+ * it then sends what it has instead of running into the timeout above */
+#define EXTRACTION_TIME_BUDGET 8
+
+/* Pages the worker extracts text from at most per document */
+#define EXTRACTION_PAGE_BUDGET 1000
 
 typedef struct {
 	gchar *title;
@@ -201,317 +204,278 @@ read_outline (PopplerDocument      *document,
 	}
 }
 
-static GString *
-extract_content_text (PopplerDocument *document,
-                      gsize            n_bytes)
-{
-	gint n_pages, i = 0;
-	GString *string;
-	GTimer *timer;
-	gsize remaining_bytes = n_bytes;
+/* Content extraction runs in tracker-extract-pdf-worker, so a broken
+ * document can neither crash nor stall tracker-extract. Workers are
+ * spawned on demand, one per concurrent extraction, and kept idle for
+ * the following documents. A worker that dies or has to be killed
+ * because a document exceeded its deadline is not reused.
+ *
+ * The worker is exec'd rather than forked off tracker-extract, a forked
+ * copy of this multithreaded process could deadlock on locks other
+ * threads held while forking. */
 
-	n_pages = poppler_document_get_n_pages (document);
-	string = g_string_new ("");
-	timer = g_timer_new ();
+typedef struct {
+	GPid pid;
+	gint fd;
+} PdfWorker;
+
+/* Idle workers, the lock is only held to take or return one */
+static GQueue idle_workers = G_QUEUE_INIT;
+G_LOCK_DEFINE_STATIC (idle_workers);
+
+static gboolean
+write_all (gint          fd,
+           gconstpointer buffer,
+           gsize         length)
+{
+	const gchar *data = buffer;
 
-	while (i < n_pages &&
-	       remaining_bytes > 0) {
-		PopplerPage *page;
-		gsize written_bytes = 0;
-		gchar *text;
+	while (length > 0) {
+		gssize written;
 
-		page = poppler_document_get_page (document, i);
-		i++;
+		/* MSG_NOSIGNAL, we don't want SIGPIPE if the other end died */
+		written = send (fd, data, length, MSG_NOSIGNAL);
 
-		text = poppler_page_get_text (page);
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
 
-		if (!text) {
-			g_object_unref (page);
-			continue;
+			return FALSE;
 		}
 
-		if (tracker_text_validate_utf8 (text,
-		                                MIN (strlen (text), remaining_bytes),
-		                                &string,
-		                                &written_bytes)) {
-			g_string_append_c (string, ' ');
-		}
+		data += written;
+		length -= written;
+	}
 
-		remaining_bytes -= written_bytes;
+	return TRUE;
+}
 
-		g_debug ("Child: Extracted %" G_GSIZE_FORMAT " bytes from page %d, "
-		         "%" G_GSIZE_FORMAT " bytes remaining",
-		         written_bytes, i, remaining_bytes);
+static gboolean
+read_all (gint      fd,
+          gpointer  buffer,
+          gsize     length,
+          GTimer   *timer)
+{
+	gchar *data = buffer;
 
-		g_free (text);
-		g_object_unref (page);
-	}
+	while (length > 0) {
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		gssize bytes_read;
+		gint remaining_ms;
+		gint retval;
 
-	g_debug ("Child: Content extraction finished: %d/%d pages indexed in %2.2f seconds, "
-	         "%" G_GSIZE_FORMAT " bytes extracted",
-	         i,
-	         n_pages,
-	         g_timer_elapsed (timer, NULL),
-	         (n_bytes - remaining_bytes));
+		remaining_ms = (EXTRACTION_PROCESS_TIMEOUT - g_timer_elapsed (timer, NULL)) * 1000;
+		if (remaining_ms <= 0) {
+			return FALSE;
+		}
 
-	g_timer_destroy (timer);
+		retval = poll (&pfd, 1, remaining_ms);
 
-	return string;
-}
+		if (retval == -1 && errno == EINTR) {
+			continue;
+		} else if (retval <= 0) {
+			/* Timed out or failed */
+			return FALSE;
+		}
 
-static void
-extract_content_child_process (PopplerDocument *document,
-                               gsize            n_bytes,
-                               int              fd[2])
-{
-	GString *str;
-	gint64 size;
-	GOutputStream *output_stream;
-	GDataOutputStream *dataout_stream;
-
-	/* This is the child extracting the content, hopefully in time */
-
-	output_stream = g_unix_output_stream_new (fd[1], FALSE);
-	dataout_stream = g_data_output_stream_new (output_stream);
-	str = extract_content_text (document, n_bytes);
-	size = (gint64) str->len;
-
-	/* Write the results to the pipe */
-	if (g_data_output_stream_put_int64 (dataout_stream, size, NULL, NULL)) {
-		g_output_stream_write_all (output_stream,
-		                           str->str,
-		                           str->len,
-		                           NULL,
-		                           NULL,
-		                           NULL);
-	}
+		bytes_read = read (fd, data, length);
 
-	g_debug ("Child: Content extraction now finished in child process, "
-	         "written %" G_GSIZE_FORMAT " bytes to parent process",
-	         size);
+		if (bytes_read == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
 
-	g_string_free (str, TRUE);
-	g_object_unref (dataout_stream);
-	g_object_unref (output_stream);
+			return FALSE;
+		} else if (bytes_read == 0) {
+			/* The other end closed the connection */
+			return FALSE;
+		}
 
-	close (fd[1]);
+		data += bytes_read;
+		length -= bytes_read;
+	}
 
-	exit (0);
+	return TRUE;
 }
 
-static gchar *
-extract_content_parent_process (PopplerDocument *document,
-                                int              fd[2],
-                                pid_t            child_pid)
+static void
+worker_child_setup (gpointer user_data)
 {
-	GInputStream *input_stream;
-	GDataInputStream *datain_stream;
-	GString *content = NULL;
-	GError *error = NULL;
-	GTimer *timer = NULL;
-	gsize bytes_expected = -1;
-	gboolean timed_out = FALSE;
-	gboolean finished = FALSE;
-	struct timeval timeout;
-	fd_set rfds;
+	gint fd = GPOINTER_TO_INT (user_data);
 
-	/* This is the parent process waiting for the content extractor to
-	 * finish in time. */
+	/* Runs between fork() and exec(), the socket is close on exec
+	 * and only its copy at PDF_WORKER_FD is inherited */
+	if (fd == PDF_WORKER_FD) {
+		fcntl (fd, F_SETFD, 0);
+	} else {
+		dup2 (fd, PDF_WORKER_FD);
+	}
+}
 
-	g_debug ("Parent: Content extraction now starting in child process (pid = %d)", child_pid);
+static PdfWorker *
+worker_start (void)
+{
+	PdfWorker *worker;
+	GError *error = NULL;
+	gchar *argv[] = { LIBEXECDIR G_DIR_SEPARATOR_S "tracker-extract-pdf-worker", NULL };
+	gint fds[2];
+	GPid pid;
+
+	/* Close on exec right away, other threads may spawn processes
+	 * meanwhile and those mustn't keep the worker alive */
+	if (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+		g_warning ("Content extraction failed, call to socketpair() failed, %s",
+		           g_strerror (errno));
+		return NULL;
+	}
 
-	/* Set up gio streams */
-	input_stream = g_unix_input_stream_new (fd[0], FALSE);
-	datain_stream = g_data_input_stream_new (input_stream);
+	/* Reaped in worker_stop() */
+	if (!g_spawn_async (NULL,
+	                    argv,
+	                    NULL,
+	                    G_SPAWN_DO_NOT_REAP_CHILD,
+	                    worker_child_setup,
+	                    GINT_TO_POINTER (fds[1]),
+	                    &pid,
+	                    &error)) {
+		g_warning ("Content extraction failed, could not spawn worker, %s",
+		           error->message);
+		g_error_free (error);
+		close (fds[0]);
+		close (fds[1]);
+		return NULL;
+	}
 
-	/* Watch FD to see when it has input. */
-	FD_ZERO(&rfds);
-	FD_SET(fd[0], &rfds);
+	close (fds[1]);
 
-	/* We give the content extractor 10 seconds to do its job */
-	timeout.tv_sec = EXTRACTION_PROCESS_TIMEOUT;
-	timeout.tv_usec = 0;
+	worker = g_slice_new (PdfWorker);
+	worker->pid = pid;
+	worker->fd = fds[0];
 
-	/* We also use our own timer because timeouts in select()
-	 * can be inconsistent across UNIX platforms. Some update the
-	 * timeout and some don't.
-	 */
-	timer = g_timer_new ();
+	g_debug ("Parent: Content extraction worker started (pid = %d)", pid);
 
-	/* So, this is fairly simple, what we're doing here is using
-	 * select() to know when the child process has written some or
-	 * all the data and we then avoid the child blocking by
-	 * reading from that stream. We couple with this with a
-	 * timeout of 10 seconds so if we receive nothing then we know
-	 * we can kill the process because it is taking too long.
-	 *
-	 * We use waitpid() to know if the process quit because it has
-	 * finished or if it is still processing data and needs to be
-	 * killed.
-	 */
-	while (!finished) {
-		int retval;
+	return worker;
+}
 
-		/* 1a. Wait for data on the FD and limit by timeout */
-		retval = select (fd[0] + 1,  &rfds, NULL, NULL, &timeout);
+static void
+worker_stop (PdfWorker *worker)
+{
+	g_debug ("Parent: Stopping content extraction worker (pid = %d)", worker->pid);
 
-		/* 2. Did we error? Have data? or just timeout? */
-		if (retval == -1) {
-			perror ("select()");
-			finished = TRUE;
-		} else if (retval == 1) {
-			gsize bytes_remaining = bytes_expected;
-			gboolean read_finished = FALSE;
+	close (worker->fd);
+	kill (worker->pid, SIGKILL);
 
-			if (g_timer_elapsed (timer, NULL) >= EXTRACTION_PROCESS_TIMEOUT) {
-				finished = TRUE;
-				timed_out = TRUE;
-				continue;
-			}
+	while (waitpid (worker->pid, NULL, 0) == -1 && errno == EINTR)
+		;
 
-			/* 3. Start reading data */
-			if (bytes_expected == -1) {
-				/* We only need to read the size once before the data! */
-				bytes_expected = (gsize) g_data_input_stream_read_int64 (datain_stream,
-				                                                         NULL,
-				                                                         &error);
-				if (error) {
-					g_warning ("Call to g_data_input_stream_read_int64() failed, %s",
-					           error->message);
-					g_error_free (error);
-					finished = TRUE;
-					continue;
-				}
+	g_spawn_close_pid (worker->pid);
+	g_slice_free (PdfWorker, worker);
+}
 
-				g_debug ("Parent: Expected bytes to read is %" G_GSSIZE_FORMAT "", bytes_expected);
-				bytes_remaining = bytes_expected;
-				content = g_string_new ("");
-			}
+static PdfWorker *
+worker_get (void)
+{
+	PdfWorker *worker;
 
-			/* 4. Read until done from stream and concatenate data */
-			while (!read_finished) {
-				gchar buf[BUFFER_SIZE];
-				gsize bytes_read;
-
-				memset (buf, 0, BUFFER_SIZE);
-				bytes_read = g_input_stream_read (G_INPUT_STREAM (datain_stream),
-				                                  buf,
-				                                  MIN (BUFFER_SIZE, bytes_remaining),
-				                                  NULL,
-				                                  &error);
-
-				g_debug ("Parent:   Bytes read is %" G_GSSIZE_FORMAT ","
-				         "bytes remaining is %" G_GSSIZE_FORMAT "",
-				         bytes_read,
-				         MAX (bytes_remaining - bytes_read, 0));
-
-				if (bytes_read == -1 || error) {
-					g_warning ("Call to g_input_stream_read() failed, %s",
-					           error ? error->message : "no error given");
-					g_clear_error (&error);
-					read_finished = TRUE;
-					finished = TRUE;
-				} else {
-					content = g_string_append (content, buf);
-
-					bytes_remaining -= bytes_read;
-					bytes_remaining  = MAX (bytes_remaining, 0);
-
-					if (bytes_read == 0) {
-						/* We finished reading */
-						g_debug ("Parent:   Finished reading all bytes");
-						read_finished = TRUE;
-					}
-
-					/* Are we finished reading everything */
-					if (bytes_remaining < 1) {
-						finished = TRUE;
-					}
-				}
-			}
-		} else {
-			/* 3. We must have timed out with no data in select() */
-			finished = TRUE;
-			timed_out = TRUE;
-			g_debug ("Parent: Must have timed out with no data in select()");
-		}
-	}
+	G_LOCK (idle_workers);
+	worker = g_queue_pop_head (&idle_workers);
+	G_UNLOCK (idle_workers);
 
-	if (timed_out) {
-		g_debug ("Parent: Child process took too long. We waited %d seconds, so we're going to kill it!",
-		         EXTRACTION_PROCESS_TIMEOUT);
-		kill (child_pid, SIGKILL);
-	} else {
-		g_debug ("Parent: Data received in %2.2f seconds (timeout is %d seconds)",
-		         g_timer_elapsed (timer, NULL),
-		         EXTRACTION_PROCESS_TIMEOUT);
+	if (!worker) {
+		worker = worker_start ();
 	}
 
-	g_timer_destroy (timer);
-
-	g_object_unref (datain_stream);
-	g_object_unref (input_stream);
-
-	close (fd[0]);
-
-	return content ? g_string_free (content, FALSE) : NULL;
+	return worker;
 }
 
 static void
-extract_content_child_cleanup (int action)
+worker_release (PdfWorker *worker)
 {
-	pid_t child_pid;
-	int status;
-
-	while ((child_pid = waitpid (-1, &status, WNOHANG)) > 0)
-		;
+	G_LOCK (idle_workers);
+	g_queue_push_head (&idle_workers, worker);
+	G_UNLOCK (idle_workers);
 }
 
 static gchar *
-extract_content (PopplerDocument *document,
-                 gsize            n_bytes)
+extract_content (const gchar *uri,
+                 gsize        n_bytes)
 {
-	pid_t child_pid;
-	int fd[2];
-	sigset_t mask;
-	sigset_t orig_mask;
-	struct sigaction sa;
-
-	if (pipe (fd) == -1) {
-		g_warning ("Content extraction failed, call to pipe() failed");
+	PdfWorkerRequest request;
+	PdfWorker *worker;
+	GString *content;
+	GTimer *timer;
+	gboolean finished = FALSE;
+
+	/* Other documents are extracted by their own worker
+	 * meanwhile, if any */
+	worker = worker_get ();
+
+	if (!worker) {
 		return NULL;
 	}
 
-	/* Set sig mask before fork() to avoid race conditions */
-	sigemptyset (&mask);
-	sigaddset (&mask, SIGCHLD);
-
-	/* Add zombie handler */
-	sigfillset (&sa.sa_mask);
-	sa.sa_handler = extract_content_child_cleanup;
-	sa.sa_flags = 0;
-	sigaction (SIGCHLD, &sa, NULL);
+	request.max_bytes = n_bytes;
+	request.max_pages = EXTRACTION_PAGE_BUDGET;
+	request.max_time = EXTRACTION_TIME_BUDGET;
+	request.uri_length = strlen (uri);
+	request.reserved = 0;
 
-	if (sigprocmask (SIG_SETMASK, &mask, &orig_mask) == -1) {
-		g_warning ("Content extraction failed, call to sigprocmask() failed");
+	if (!write_all (worker->fd, &request, sizeof (request)) ||
+	    !write_all (worker->fd, uri, request.uri_length)) {
+		g_warning ("Content extraction failed, could not send request to worker");
+		worker_stop (worker);
 		return NULL;
 	}
 
-	child_pid = fork ();
+	content = g_string_new ("");
+	timer = g_timer_new ();
+
+	while (!finished) {
+		guint32 length;
+		gsize offset;
+
+		if (!read_all (worker->fd, &length, sizeof (length), timer)) {
+			break;
+		}
+
+		if (length == 0) {
+			finished = TRUE;
+			break;
+		}
+
+		offset = content->len;
+		g_string_set_size (content, offset + length);
 
-	if (child_pid == -1) {
-		g_warning ("Content extraction failed, call to fork() failed");
+		if (!read_all (worker->fd, content->str + offset, length, timer)) {
+			g_string_truncate (content, offset);
+			break;
+		}
+	}
 
-		close (fd[0]);
-		close (fd[1]);
+	if (finished) {
+		g_debug ("Parent: Data received in %2.2f seconds (timeout is %d seconds)",
+		         g_timer_elapsed (timer, NULL),
+		         EXTRACTION_PROCESS_TIMEOUT);
+		worker_release (worker);
+	} else {
+		/* The worker died or is stuck on a page, restart it for
+		 * the next document and keep the text we already have */
+		g_debug ("Parent: Worker did not finish in %d seconds, "
+		         "keeping %" G_GSIZE_FORMAT " bytes extracted so far",
+		         EXTRACTION_PROCESS_TIMEOUT,
+		         content->len);
+		worker_stop (worker);
 	}
 
-	if (child_pid == 0) {
-		extract_content_child_process (document, n_bytes, fd);
+	g_timer_destroy (timer);
+
+	if (content->len == 0) {
+		g_string_free (content, TRUE);
 		return NULL;
 	}
 
-	return extract_content_parent_process (document, fd, child_pid);
+	return g_string_free (content, FALSE);
 }
 
 static void
@@ -568,58 +532,30 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 	GString *where;
 	guint i;
 	GFile *file;
-	gchar *filename;
-	int fd;
-	gchar *contents = NULL;
+	TrackerFileReader *reader;
+	const gchar *contents;
 	gsize len;
-	struct stat st;
 
 	metadata = tracker_extract_info_get_metadata_builder (info);
 	preupdate = tracker_extract_info_get_preupdate_builder (info);
 	graph = tracker_extract_info_get_graph (info);
 
 	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
-
-	fd = tracker_file_open_fd (filename);
-
-	if (fd == -1) {
-		g_warning ("Could not open pdf file '%s': %s\n",
-		           filename,
-		           g_strerror (errno));
-		g_free (filename);
-		return FALSE;
-	}
+	reader = tracker_file_reader_open (info, &error);
 
-	if (fstat (fd, &st) == -1) {
-		g_warning ("Could not fstat pdf file '%s': %s\n",
-		           filename,
-		           g_strerror (errno));
-		close (fd);
-		g_free (filename);
+	if (!reader) {
+		g_warning ("Could not open pdf file: %s\n", error->message);
+		g_error_free (error);
 		return FALSE;
 	}
 
-	if (st.st_size == 0) {
-		contents = NULL;
-		len = 0;
-	} else {
-		contents = (gchar *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-		if (contents == NULL || contents == MAP_FAILED) {
-			g_warning ("Could not mmap pdf file '%s': %s\n",
-			           filename,
-			           g_strerror (errno));
-			close (fd);
-			g_free (filename);
-			return FALSE;
-		}
-		len = st.st_size;
-	}
+	contents = tracker_file_reader_get_head (reader,
+	                                         tracker_file_reader_get_size (reader),
+	                                         &len);
 
-	g_free (filename);
 	uri = g_file_get_uri (file);
 
-	document = poppler_document_new_from_data (contents, len, NULL, &error);
+	document = poppler_document_new_from_data ((gchar *) contents, len, NULL, &error);
 	
 	if (error) {
 		if (error->code == POPPLER_ERROR_ENCRYPTED) {
@@ -631,7 +567,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 			g_error_free (error);
 			g_free (uri);
-			close (fd);
+			tracker_file_reader_close (reader);
 
 			return TRUE;
 		} else {
@@ -641,7 +577,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 			g_error_free (error);
 			g_free (uri);
-			close (fd);
+			tracker_file_reader_close (reader);
 
 			return FALSE;
 		}
@@ -652,7 +588,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		           "NULL returned without an error",
 		           uri);
 		g_free (uri);
-		close (fd);
+		tracker_file_reader_close (reader);
 		return FALSE;
 	}
 
@@ -994,7 +930,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 	config = tracker_main_get_config ();
 	n_bytes = tracker_config_get_max_bytes (config);
-	content = extract_content (document, n_bytes);
+	content = extract_content (uri, n_bytes);
 
 	if (content) {
 		tracker_sparql_builder_predicate (metadata, "nie:plainTextContent");
@@ -1015,11 +951,7 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 
 	g_object_unref (document);
 
-	if (contents) {
-		munmap (contents, len);
-	}
-
-	close (fd);
+	tracker_file_reader_close (reader);
 
 	return TRUE;
 }
@@ -23,21 +23,13 @@
 #define _GNU_SOURCE
 #endif
 
-#include <errno.h>
-#include <fcntl.h>
 #include <string.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <sys/mman.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 
 #include <gio/gio.h>
 
-#include <libtracker-common/tracker-file-utils.h>
-
 #include <libtracker-extract/tracker-extract.h>
 
 /* This function is used to find the URI for a file.xmp file. The point here is
@@ -141,61 +133,37 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 {
 	TrackerSparqlBuilder *metadata, *preupdate;
 	TrackerXmpData *xd = NULL;
+	TrackerFileReader *reader;
 	gchar *filename, *uri;
-	gchar *contents;
+	const gchar *contents;
 	gsize length = 0;
 	GFile *file;
 	const gchar *graph;
-	int fd;
-	struct stat st;
+	GError *error = NULL;
 
 	file = tracker_extract_info_get_file (info);
-	filename = g_file_get_path (file);
 
 	graph = tracker_extract_info_get_graph (info);
 	preupdate = tracker_extract_info_get_preupdate_builder (info);
 	metadata = tracker_extract_info_get_metadata_builder (info);
 
-	fd = tracker_file_open_fd (filename);
-
-	if (fd == -1) {
-		g_warning ("Could not open xmp file '%s': %s\n",
-		           filename,
-		           g_strerror (errno));
-		g_free (filename);
-		return FALSE;
-	}
+	reader = tracker_file_reader_open (info, &error);
 
-	if (fstat (fd, &st) == -1) {
-		g_warning ("Could not fstat xmp file '%s': %s\n",
-		           filename,
-		           g_strerror (errno));
-		close (fd);
-		g_free (filename);
+	if (!reader) {
+		g_warning ("Could not open xmp file: %s\n", error->message);
+		g_error_free (error);
 		return FALSE;
 	}
 
-	if (st.st_size == 0) {
-		contents = NULL;
-		length = 0;
-	} else {
-		contents = (gchar *) mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-		if (contents == NULL) {
-			g_warning ("Could not mmap xmp file '%s': %s\n",
-			           filename,
-			           g_strerror (errno));
-			close (fd);
-			g_free (filename);
-			return FALSE;
-		}
-		length = st.st_size;
-	}
-
-	uri = g_file_get_uri (file);
+	contents = tracker_file_reader_get_head (reader,
+	                                         tracker_file_reader_get_size (reader),
+	                                         &length);
 
 	if (contents) {
 		gchar *original_uri;
 
+		filename = g_file_get_path (file);
+		uri = g_file_get_uri (file);
 		original_uri = find_orig_uri (filename);
 
 		/* If no orig file is found for the sidekick, we use the sidekick to
@@ -219,16 +187,12 @@ tracker_extract_get_metadata (TrackerExtractInfo *info)
 		g_free (filename);
 		g_free (uri);
 
-		munmap (contents, length);
-
-		close (fd);
+		tracker_file_reader_close (reader);
 
 		return TRUE;
 	}
 
-	close (fd);
-	g_free (filename);
-	g_free (uri);
+	tracker_file_reader_close (reader);
 
 	return FALSE;
 }
@@ -22,6 +22,8 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <glib/gstdio.h>
+
 #include <gmodule.h>
 #include <gio/gio.h>
 
@@ -49,9 +51,20 @@
 
 extern gboolean debug;
 
+/* Seconds to wait after a task finishes before saving the MIME type
+ * costs, so they're written once for a whole batch of files.
+ */
+#define MIME_COSTS_SAVE_TIMEOUT 30
+
+/* Bytes read ahead for files queued behind other tasks, enough for
+ * the headers most extractors look at.
+ */
+#define READAHEAD_SIZE (128 * 1024)
+
 typedef struct {
 	gint extracted_count;
 	gint failed_count;
+	guint64 bytes_read;
 } StatisticsData;
 
 typedef struct {
@@ -78,6 +91,13 @@ typedef struct {
 	gchar *force_module;
 
 	gint unhandled_count;
+
+	/* Time spent and bytes extracted per mimetype, persisted
+	 * for the miners to schedule expensive files last.
+	 */
+	TrackerMimeCosts *mime_costs;
+	gchar *mime_costs_filename;
+	guint mime_costs_save_id;
 } TrackerExtractPrivate;
 
 typedef struct {
@@ -90,16 +110,30 @@ typedef struct {
 
 	TrackerMimetypeInfo *mimetype_handlers;
 
+	/* Called in the caller context once a module starts on the file */
+	GMainContext *context;
+	GSourceFunc started_cb;
+	gpointer started_data;
+
 	/* to be fed from mimetype_handlers */
 	TrackerExtractMetadataFunc cur_func;
 	GModule *cur_module;
 
+	/* Accumulated over all modules tried */
+	gint64 extraction_time;
+	goffset size;
+	guint64 bytes_read;
+
 	guint signal_id;
+	guint started : 1;
 	guint success : 1;
+	guint measured : 1;
+	guint read_ahead : 1;
 } TrackerExtractTask;
 
 static void tracker_extract_finalize (GObject *object);
 static void report_statistics        (GObject *object);
+static void save_mime_costs          (TrackerExtract *extract);
 static gboolean get_metadata         (TrackerExtractTask *task);
 static gboolean dispatch_task_cb     (TrackerExtractTask *task);
 
@@ -137,6 +171,8 @@ tracker_extract_init (TrackerExtract *object)
 	priv->statistics_data = g_hash_table_new_full (NULL, NULL, NULL,
 	                                               (GDestroyNotify) statistics_data_free);
 	priv->single_thread_extractors = g_hash_table_new (NULL, NULL);
+	priv->mime_costs = tracker_mime_costs_new ();
+	priv->mime_costs_filename = tracker_mime_costs_get_default_filename ();
 	priv->thread_pool = g_thread_pool_new ((GFunc) get_metadata,
 	                                       NULL, 10, TRUE, NULL);
 
@@ -159,6 +195,15 @@ tracker_extract_finalize (GObject *object)
 		report_statistics (object);
 	}
 
+	if (priv->mime_costs_save_id != 0) {
+		/* Costs recorded since the last save */
+		g_source_remove (priv->mime_costs_save_id);
+		save_mime_costs (TRACKER_EXTRACT (object));
+	}
+
+	tracker_mime_costs_free (priv->mime_costs);
+	g_free (priv->mime_costs_filename);
+
 #ifdef HAVE_LIBSTREAMANALYZER
 	tracker_topanalyzer_shutdown ();
 #endif /* HAVE_STREAMANALYZER */
@@ -196,10 +241,11 @@ report_statistics (GObject *object)
 			name = g_module_name (module);
 			name_without_path = strrchr (name, G_DIR_SEPARATOR) + 1;
 
-			g_message ("    Module:'%s', extracted:%d, failures:%d",
+			g_message ("    Module:'%s', extracted:%d, failures:%d, bytes read:%" G_GUINT64_FORMAT,
 			           name_without_path,
 			           data->extracted_count,
-			           data->failed_count);
+			           data->failed_count,
+			           data->bytes_read);
 		}
 	}
 
@@ -215,6 +261,49 @@ report_statistics (GObject *object)
 	g_mutex_unlock (&priv->task_mutex);
 }
 
+static void
+save_mime_costs (TrackerExtract *extract)
+{
+	TrackerExtractPrivate *priv;
+	TrackerMimeCosts *costs;
+	GError *error = NULL;
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	/* Don't hold extraction threads back while writing the file */
+	g_mutex_lock (&priv->task_mutex);
+	costs = tracker_mime_costs_copy (priv->mime_costs);
+	g_mutex_unlock (&priv->task_mutex);
+
+	if (!tracker_mime_costs_save (costs,
+	                              priv->mime_costs_filename,
+	                              &error)) {
+		g_message ("Could not save mimetype costs to '%s': %s",
+		           priv->mime_costs_filename,
+		           error->message);
+		g_error_free (error);
+	}
+
+	tracker_mime_costs_free (costs);
+}
+
+static gboolean
+save_mime_costs_cb (gpointer user_data)
+{
+	TrackerExtract *extract = user_data;
+	TrackerExtractPrivate *priv;
+
+	priv = TRACKER_EXTRACT_GET_PRIVATE (extract);
+
+	g_mutex_lock (&priv->task_mutex);
+	priv->mime_costs_save_id = 0;
+	g_mutex_unlock (&priv->task_mutex);
+
+	save_mime_costs (extract);
+
+	return FALSE;
+}
+
 TrackerExtract *
 tracker_extract_new (gboolean     disable_shutdown,
                      gboolean     force_internal_extractors,
@@ -236,6 +325,11 @@ tracker_extract_new (gboolean     disable_shutdown,
 	priv->force_internal_extractors = force_internal_extractors;
 	priv->force_module = g_strdup (force_module);
 
+	/* Keep adding to the costs recorded by previous runs */
+	tracker_mime_costs_load (priv->mime_costs,
+	                         priv->mime_costs_filename,
+	                         NULL);
+
 	return object;
 }
 
@@ -266,11 +360,26 @@ notify_task_finish (TrackerExtractTask *task,
 	}
 
 	stats_data->extracted_count++;
+	stats_data->bytes_read += task->bytes_read;
 
 	if (!success) {
 		stats_data->failed_count++;
 	}
 
+	if (task->measured) {
+		tracker_mime_costs_add (priv->mime_costs,
+		                        task->mimetype,
+		                        task->extraction_time,
+		                        task->size);
+
+		if (priv->mime_costs_save_id == 0) {
+			priv->mime_costs_save_id =
+				g_timeout_add_seconds (MIME_COSTS_SAVE_TIMEOUT,
+				                       save_mime_costs_cb,
+				                       extract);
+		}
+	}
+
 	priv->running_tasks = g_list_remove (priv->running_tasks, task);
 
 	g_mutex_unlock (&priv->task_mutex);
@@ -341,10 +450,32 @@ get_file_metadata (TrackerExtractTask  *task,
 	if (mime_used) {
 		if (task->cur_func) {
 			TrackerSparqlBuilder *statements;
+			gint64 start_time;
 
 			g_debug ("  Using %s...", g_module_name (task->cur_module));
 
+			if (!task->measured) {
+				gchar *path;
+				GStatBuf st;
+
+				path = g_filename_from_uri (task->file, NULL, NULL);
+
+				if (path && g_stat (path, &st) == 0) {
+					task->size = st.st_size;
+				}
+
+				g_free (path);
+				task->measured = TRUE;
+			}
+
+			start_time = g_get_monotonic_time ();
 			(task->cur_func) (info);
+			task->extraction_time += g_get_monotonic_time () - start_time;
+			task->bytes_read += tracker_extract_info_get_bytes_read (info);
+
+			g_debug ("  Read %" G_GUINT64_FORMAT " of %" G_GOFFSET_FORMAT " bytes",
+			         tracker_extract_info_get_bytes_read (info),
+			         task->size);
 
 			statements = tracker_extract_info_get_metadata_builder (info);
 			items = tracker_sparql_builder_get_length (statements);
@@ -471,6 +602,10 @@ extract_task_free (TrackerExtractTask *task)
 		tracker_mimetype_info_free (task->mimetype_handlers);
 	}
 
+	if (task->context) {
+		g_main_context_unref (task->context);
+	}
+
 	g_free (task->graph);
 	g_free (task->mimetype);
 	g_free (task->file);
@@ -548,6 +683,18 @@ get_metadata (TrackerExtractTask *task)
 		return FALSE;
 	}
 
+	if (task->started_cb && !task->started) {
+		/* Higher priority than the completion of the
+		 * result, so it can't be notified after that */
+		g_main_context_invoke_full (task->context,
+		                            G_PRIORITY_HIGH,
+		                            task->started_cb,
+		                            task->started_data,
+		                            NULL);
+	}
+
+	task->started = TRUE;
+
 	if (!filter_module (task->extract, task->cur_module) &&
 	    get_file_metadata (task, &info)) {
 		g_simple_async_result_set_op_res_gpointer ((GSimpleAsyncResult *) task->res,
@@ -592,6 +739,25 @@ single_thread_get_metadata (GAsyncQueue *queue)
 	}
 }
 
+/* Tasks queued behind others get their file read ahead, so the
+ * data is likely in the page cache by the time a thread gets to it.
+ */
+static void
+task_readahead (TrackerExtractTask *task)
+{
+	GFile *file;
+
+	if (task->read_ahead) {
+		return;
+	}
+
+	file = g_file_new_for_uri (task->file);
+	tracker_file_readahead (file, READAHEAD_SIZE);
+	g_object_unref (file);
+
+	task->read_ahead = TRUE;
+}
+
 /* This function is executed in the main thread, decides the
  * module that's going to be run for a given task, and dispatches
  * the task according to the threading strategy of that module.
@@ -707,12 +873,22 @@ dispatch_task_cb (TrackerExtractTask *task)
 			g_hash_table_insert (priv->single_thread_extractors, module, async_queue);
 		}
 
+		/* A negative length means the thread is waiting for tasks */
+		if (g_async_queue_length (async_queue) >= 0) {
+			task_readahead (task);
+		}
+
 		g_async_queue_push (async_queue, task);
 		break;
 	}
 	case TRACKER_MODULE_MULTI_THREAD:
 		/* Put task in thread pool */
 		g_message ("Dispatching '%s' in thread pool", task->file);
+
+		if (g_thread_pool_unprocessed (priv->thread_pool) > 0) {
+			task_readahead (task);
+		}
+
 		g_thread_pool_push (priv->thread_pool, task, &error);
 
 		if (error) {
@@ -739,6 +915,23 @@ tracker_extract_file (TrackerExtract      *extract,
                       GCancellable        *cancellable,
                       GAsyncReadyCallback  cb,
                       gpointer             user_data)
+{
+	tracker_extract_file_full (extract, file, mimetype, graph,
+	                           cancellable, NULL, cb, user_data);
+}
+
+/* Like tracker_extract_file(), @started_cb is called with @user_data
+ * in the thread default context of the caller once the extraction
+ * actually starts, tasks may wait in a queue for a while before. */
+void
+tracker_extract_file_full (TrackerExtract      *extract,
+                           const gchar         *file,
+                           const gchar         *mimetype,
+                           const gchar         *graph,
+                           GCancellable        *cancellable,
+                           GSourceFunc          started_cb,
+                           GAsyncReadyCallback  cb,
+                           gpointer             user_data)
 {
 	GSimpleAsyncResult *res;
 	GError *error = NULL;
@@ -765,6 +958,12 @@ tracker_extract_file (TrackerExtract      *extract,
 		g_simple_async_result_complete_in_idle (res);
 		g_error_free (error);
 	} else {
+		if (started_cb) {
+			task->context = g_main_context_ref_thread_default ();
+			task->started_cb = started_cb;
+			task->started_data = user_data;
+		}
+
 		g_idle_add ((GSourceFunc) dispatch_task_cb, task);
 	}
 
@@ -60,6 +60,14 @@ void            tracker_extract_file                    (TrackerExtract
                                                          GCancellable           *cancellable,
                                                          GAsyncReadyCallback     cb,
                                                          gpointer                user_data);
+void            tracker_extract_file_full               (TrackerExtract         *extract,
+                                                         const gchar            *file,
+                                                         const gchar            *mimetype,
+                                                         const gchar            *graph,
+                                                         GCancellable           *cancellable,
+                                                         GSourceFunc             started_cb,
+                                                         GAsyncReadyCallback     cb,
+                                                         gpointer                user_data);
 
 void            tracker_extract_dbus_start              (TrackerExtract         *extract);
 void            tracker_extract_dbus_stop               (TrackerExtract         *extract);
@@ -0,0 +1,198 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "tracker-jpeg-scanner.h"
+
+/* Walks the JPEG markers from SOI up to SOS, which is all we need for
+ * metadata extraction. Unlike jpeg_read_header() this does not set up
+ * a decompressor nor copy the saved markers, and as the file window is
+ * mapped only the pages holding the header are ever read. */
+
+#define MARKER_SOF0  0xC0
+#define MARKER_SOF15 0xCF
+#define MARKER_DHT   0xC4
+#define MARKER_JPG   0xC8
+#define MARKER_DAC   0xCC
+#define MARKER_RST0  0xD0
+#define MARKER_RST7  0xD7
+#define MARKER_SOI   0xD8
+#define MARKER_EOI   0xD9
+#define MARKER_SOS   0xDA
+#define MARKER_APP0  0xE0
+#define MARKER_APP1  0xE1
+#define MARKER_APP13 0xED
+#define MARKER_COM   0xFE
+#define MARKER_TEM   0x01
+
+#define JFIF_NAMESPACE          "JFIF\0"
+#define JFIF_NAMESPACE_LENGTH   5
+#define EXIF_NAMESPACE          "Exif"
+#define EXIF_NAMESPACE_LENGTH   4
+#define XMP_NAMESPACE           "http://ns.adobe.com/xap/1.0/\x00"
+#define XMP_NAMESPACE_LENGTH    29
+#define PS3_NAMESPACE           "Photoshop 3.0\0"
+#define PS3_NAMESPACE_LENGTH    14
+
+#define READ_UINT16(p) (((guint) (p)[0] << 8) | (p)[1])
+
+static gboolean
+segment_has_namespace (const guchar *segment,
+                       gsize         length,
+                       const gchar  *ns,
+                       gsize         ns_length)
+{
+	return length >= ns_length && memcmp (segment, ns, ns_length) == 0;
+}
+
+gboolean
+tracker_jpeg_scan (const guchar      *data,
+                   gsize              length,
+                   TrackerJpegHeader *header)
+{
+	gboolean have_sof = FALSE;
+	gsize pos;
+
+	g_return_val_if_fail (header != NULL, FALSE);
+
+	memset (header, 0, sizeof (TrackerJpegHeader));
+
+	if (!data || length < 4 ||
+	    data[0] != 0xFF || data[1] != MARKER_SOI) {
+		return FALSE;
+	}
+
+	pos = 2;
+
+	while (pos < length) {
+		const guchar *segment;
+		gsize segment_length;
+		guint marker;
+
+		if (data[pos] != 0xFF) {
+			/* Extraneous bytes before a marker, libjpeg
+			 * skips them with a warning, so do we. */
+			pos++;
+			continue;
+		}
+
+		/* Any number of fill bytes may precede a marker */
+		while (pos < length && data[pos] == 0xFF) {
+			pos++;
+		}
+
+		if (pos >= length) {
+			break;
+		}
+
+		marker = data[pos++];
+
+		if (marker == 0 || marker == MARKER_TEM || marker == MARKER_SOI ||
+		    (marker >= MARKER_RST0 && marker <= MARKER_RST7)) {
+			/* Standalone markers, no segment follows */
+			continue;
+		}
+
+		if (marker == MARKER_EOI || pos + 2 > length) {
+			break;
+		}
+
+		segment_length = READ_UINT16 (data + pos);
+
+		if (segment_length < 2 || pos + segment_length > length) {
+			/* Truncated file */
+			break;
+		}
+
+		segment = data + pos + 2;
+		segment_length -= 2;
+
+		if (marker >= MARKER_SOF0 && marker <= MARKER_SOF15 &&
+		    marker != MARKER_DHT && marker != MARKER_JPG && marker != MARKER_DAC) {
+			if (segment_length >= 5) {
+				header->height = READ_UINT16 (segment + 1);
+				header->width = READ_UINT16 (segment + 3);
+				have_sof = TRUE;
+			}
+		} else if (marker == MARKER_APP0) {
+			if (segment_length >= 12 &&
+			    segment_has_namespace (segment, segment_length,
+			                           JFIF_NAMESPACE, JFIF_NAMESPACE_LENGTH)) {
+				header->density_unit = segment[7];
+				header->x_density = READ_UINT16 (segment + 8);
+				header->y_density = READ_UINT16 (segment + 10);
+			}
+		} else if (marker == MARKER_APP1) {
+			if (!header->exif &&
+			    segment_has_namespace (segment, segment_length,
+			                           EXIF_NAMESPACE, EXIF_NAMESPACE_LENGTH)) {
+				header->exif = (const gchar *) segment;
+				header->exif_length = segment_length;
+			} else if (!header->xmp &&
+			           segment_has_namespace (segment, segment_length,
+			                                  XMP_NAMESPACE, XMP_NAMESPACE_LENGTH)) {
+				header->xmp = (const gchar *) segment + XMP_NAMESPACE_LENGTH;
+				header->xmp_length = segment_length - XMP_NAMESPACE_LENGTH;
+			}
+		} else if (marker == MARKER_APP13) {
+			if (!header->ps3 &&
+			    segment_has_namespace (segment, segment_length,
+			                           PS3_NAMESPACE, PS3_NAMESPACE_LENGTH)) {
+				header->ps3 = (const gchar *) segment;
+				header->ps3_length = segment_length;
+			}
+		} else if (marker == MARKER_COM) {
+			header->comment = (const gchar *) segment;
+			header->comment_length = segment_length;
+		} else if (marker == MARKER_SOS) {
+			/* Entropy coded data follows, metadata
+			 * segments are not expected past this point */
+			break;
+		}
+
+		pos += segment_length + 2;
+	}
+
+	/* libjpeg refuses images with a height defined by a DNL marker */
+	return have_sof && header->width > 0 && header->height > 0;
+}
+
+/* The header segments point into a window of @reader, they are valid
+ * until it is closed */
+gboolean
+tracker_jpeg_scan_file (TrackerFileReader *reader,
+                        TrackerJpegHeader *header)
+{
+	gconstpointer data;
+	gsize length;
+
+	g_return_val_if_fail (reader != NULL, FALSE);
+	g_return_val_if_fail (header != NULL, FALSE);
+
+	data = tracker_file_reader_get_head (reader,
+	                                     tracker_file_reader_get_size (reader),
+	                                     &length);
+
+	if (!data) {
+		return FALSE;
+	}
+
+	return tracker_jpeg_scan (data, length, header);
+}
@@ -0,0 +1,62 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_JPEG_SCANNER_H__
+#define __TRACKER_JPEG_SCANNER_H__
+
+#include <glib.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+G_BEGIN_DECLS
+
+/* Segments point into the scanned data, they are not copied */
+typedef struct {
+	guint width;
+	guint height;
+
+	/* From the JFIF APP0 segment, density_unit is 0 if absent */
+	guint density_unit;
+	guint x_density;
+	guint y_density;
+
+	/* COM, the last one wins as with libjpeg */
+	const gchar *comment;
+	gsize comment_length;
+
+	/* APP1, starting with the "Exif" namespace */
+	const gchar *exif;
+	gsize exif_length;
+
+	/* APP1, after the XMP namespace */
+	const gchar *xmp;
+	gsize xmp_length;
+
+	/* APP13, starting with the "Photoshop 3.0" namespace */
+	const gchar *ps3;
+	gsize ps3_length;
+} TrackerJpegHeader;
+
+gboolean tracker_jpeg_scan      (const guchar      *data,
+                                 gsize              length,
+                                 TrackerJpegHeader *header);
+gboolean tracker_jpeg_scan_file (TrackerFileReader *reader,
+                                 TrackerJpegHeader *header);
+
+G_END_DECLS
+
+#endif /* __TRACKER_JPEG_SCANNER_H__ */
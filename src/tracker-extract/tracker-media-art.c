@@ -41,8 +41,6 @@
 #include <libtracker-common/tracker-media-art.h>
 
 #include "tracker-media-art.h"
-#include "tracker-extract.h"
-#include "tracker-marshal.h"
 #include "tracker-media-art-generic.h"
 
 #define ALBUMARTER_SERVICE    "com.nokia.albumart"
@@ -75,51 +73,214 @@ typedef enum {
 	IMAGE_MATCH_TYPE_COUNT
 } ImageMatchType;
 
+/* Modification time in microseconds, so changes within the same
+ * second aren't missed, size and inode of a cached file */
+typedef struct {
+	guint64 mtime;
+	goffset size;
+	guint64 inode;
+} FileStamp;
+
+typedef struct {
+	FileStamp stamp;
+	GPtrArray *images;
+} DirectoryCacheEntry;
+
+typedef struct {
+	GChecksumType checksum_type;
+	FileStamp stamp;
+	gboolean is_jpeg;
+	gchar *sum;
+} ChecksumCacheEntry;
+
+/* Both caches are flushed when full */
+#define DIRECTORY_CACHE_SIZE 64
+#define CHECKSUM_CACHE_SIZE  256
+
 static gboolean initialized = FALSE;
 static gboolean disable_requests;
 static TrackerStorage *media_art_storage;
 static GHashTable *media_art_cache;
+static GHashTable *album_art_cache;
+static GHashTable *directory_cache;
+static GHashTable *checksum_cache;
 static GDBusConnection *connection;
 
+/* Extractor modules may run in different threads */
+G_LOCK_DEFINE_STATIC (media_art_caches);
+
 static void
 media_art_queue_cb (GObject      *source_object,
                    GAsyncResult *res,
                    gpointer      user_data);
 
 
-static GDir *
-get_parent_g_dir (const gchar  *uri,
-                  gchar       **dirname,
-                  GError      **error)
+static gchar *
+get_parent_dirname (const gchar  *uri,
+                    GError      **error)
 {
 	GFile *file, *dirf;
-	GDir *dir;
-
-	g_return_val_if_fail (dirname != NULL, NULL);
-
-	*dirname = NULL;
+	gchar *dirname = NULL;
 
 	file = g_file_new_for_uri (uri);
 	dirf = g_file_get_parent (file);
 	if (dirf) {
-		*dirname = g_file_get_path (dirf);
+		dirname = g_file_get_path (dirf);
 		g_object_unref (dirf);
 	}
 	g_object_unref (file);
 
-	if (*dirname == NULL) {
-		*error = g_error_new (G_FILE_ERROR,
-		                      G_FILE_ERROR_EXIST,
-		                      "No parent directory found for '%s'",
-		                      uri);
-		return NULL;
+	if (dirname == NULL) {
+		g_set_error (error,
+		             G_FILE_ERROR,
+		             G_FILE_ERROR_EXIST,
+		             "No parent directory found for '%s'",
+		             uri);
 	}
 
-	dir = g_dir_open (*dirname, 0, error);
+	return dirname;
+}
 
-	return dir;
+static gboolean
+file_get_stamp (const gchar  *path,
+                FileStamp    *stamp,
+                GError      **error)
+{
+	GFileInfo *info;
+	GFile *file;
+
+	file = g_file_new_for_path (path);
+	info = g_file_query_info (file,
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+	                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+	                          G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+	                          G_FILE_ATTRIBUTE_UNIX_INODE,
+	                          G_FILE_QUERY_INFO_NONE,
+	                          NULL,
+	                          error);
+	g_object_unref (file);
+
+	if (!info) {
+		return FALSE;
+	}
+
+	stamp->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+		g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	stamp->size = g_file_info_get_size (info);
+	stamp->inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+
+	g_object_unref (info);
+
+	return TRUE;
 }
 
+static gboolean
+file_stamp_equal (const FileStamp *a,
+                  const FileStamp *b)
+{
+	return (a->mtime == b->mtime &&
+	        a->size == b->size &&
+	        a->inode == b->inode);
+}
+
+static void
+directory_cache_entry_free (DirectoryCacheEntry *entry)
+{
+	g_ptr_array_unref (entry->images);
+	g_slice_free (DirectoryCacheEntry, entry);
+}
+
+/* Returns the lowercase names of the image files in @dirname, every
+ * track in an album looks into the same directory, so the listing is
+ * kept as long as the directory doesn't change.
+ */
+static GPtrArray *
+get_directory_images (const gchar  *dirname,
+                      GError      **error)
+{
+	DirectoryCacheEntry *entry;
+	GPtrArray *images = NULL;
+	FileStamp stamp;
+	const gchar *name;
+	GDir *dir;
+
+	if (!file_get_stamp (dirname, &stamp, error)) {
+		return NULL;
+	}
+
+	G_LOCK (media_art_caches);
+
+	if (directory_cache) {
+		entry = g_hash_table_lookup (directory_cache, dirname);
+
+		if (entry && file_stamp_equal (&entry->stamp, &stamp)) {
+			images = g_ptr_array_ref (entry->images);
+		}
+	}
+
+	G_UNLOCK (media_art_caches);
+
+	if (images) {
+		return images;
+	}
+
+	dir = g_dir_open (dirname, 0, error);
+
+	if (!dir) {
+		return NULL;
+	}
+
+	images = g_ptr_array_new_with_free_func (g_free);
+
+	for (name = g_dir_read_name (dir);
+	     name != NULL;
+	     name = g_dir_read_name (dir)) {
+		gchar *name_utf8, *name_strdown;
+
+		name_utf8 = g_filename_to_utf8 (name, -1, NULL, NULL, NULL);
+
+		if (!name_utf8) {
+			g_debug ("Could not convert filename '%s' to UTF-8", name);
+			continue;
+		}
+
+		name_strdown = g_utf8_strdown (name_utf8, -1);
+
+		if (g_str_has_suffix (name_strdown, "jpeg") ||
+		    g_str_has_suffix (name_strdown, "jpg") ||
+		    g_str_has_suffix (name_strdown, "png")) {
+			g_ptr_array_add (images, name_strdown);
+		} else {
+			g_free (name_strdown);
+		}
+
+		g_free (name_utf8);
+	}
+
+	g_dir_close (dir);
+
+	entry = g_slice_new (DirectoryCacheEntry);
+	entry->stamp = stamp;
+	entry->images = g_ptr_array_ref (images);
+
+	G_LOCK (media_art_caches);
+
+	if (!directory_cache) {
+		directory_cache = g_hash_table_new_full (g_str_hash,
+		                                         g_str_equal,
+		                                         (GDestroyNotify) g_free,
+		                                         (GDestroyNotify) directory_cache_entry_free);
+	} else if (g_hash_table_size (directory_cache) >= DIRECTORY_CACHE_SIZE) {
+		/* Directories are mostly crawled once, start over */
+		g_hash_table_remove_all (directory_cache);
+	}
+
+	g_hash_table_insert (directory_cache, g_strdup (dirname), entry);
+
+	G_UNLOCK (media_art_caches);
+
+	return images;
+}
 
 static gchar *
 checksum_for_data (GChecksumType  checksum_type,
@@ -142,81 +303,139 @@ checksum_for_data (GChecksumType  checksum_type,
 }
 
 static gboolean
-file_get_checksum_if_exists (GChecksumType   checksum_type,
-                             const gchar    *path,
-                             gchar         **md5,
-                             gboolean        check_jpeg,
-                             gboolean       *is_jpeg)
+file_compute_checksum (GChecksumType   checksum_type,
+                       const gchar    *path,
+                       gchar         **sum,
+                       gboolean       *is_jpeg)
 {
 	GFile *file = g_file_new_for_path (path);
 	GFileInputStream *stream;
 	GChecksum *checksum;
-	gboolean retval;
+	gsize rsize;
+	guchar buffer[1024];
+	gboolean first = TRUE;
+
+	stream = g_file_read (file, NULL, NULL);
+	g_object_unref (file);
+
+	if (!stream) {
+		g_debug ("%s isn't readable while calculating MD5 checksum", path);
+		/* File doesn't exist or isn't readable */
+		return FALSE;
+	}
 
 	checksum = g_checksum_new (checksum_type);
 
 	if (!checksum) {
 		g_debug ("Can't create checksum engine");
-		g_object_unref (file);
+		g_object_unref (stream);
 		return FALSE;
 	}
 
-	stream = g_file_read (file, NULL, NULL);
+	*is_jpeg = FALSE;
 
-	if (stream) {
-		gssize rsize;
-		guchar buffer[1024];
+	while (g_input_stream_read_all (G_INPUT_STREAM (stream), buffer, sizeof (buffer), &rsize, NULL, NULL) &&
+	       rsize > 0) {
+		if (first) {
+			*is_jpeg = (rsize >= 3 && buffer[0] == 0xff && buffer[1] == 0xd8 && buffer[2] == 0xff);
+			first = FALSE;
+		}
 
-		/* File exists & readable always means true retval */
-		retval = TRUE;
+		g_checksum_update (checksum, buffer, rsize);
+	}
 
-		if (check_jpeg) {
-			if (g_input_stream_read_all (G_INPUT_STREAM (stream), buffer, 3, &rsize, NULL, NULL)) {
-				if (rsize >= 3 && buffer[0] == 0xff && buffer[1] == 0xd8 && buffer[2] == 0xff) {
-					if (is_jpeg) {
-						*is_jpeg = TRUE;
-					}
-					/* Add the read bytes to the checksum */
-					g_checksum_update (checksum, buffer, rsize);
-				} else {
-					/* Larger than 3 bytes but incorrect jpeg header */
-					if (is_jpeg) {
-						*is_jpeg = FALSE;
-					}
-					goto end;
-				}
-			} else {
-				/* Smaller than 3 bytes, not a jpeg */
-				if (is_jpeg) {
-					*is_jpeg = FALSE;
-				}
-				goto end;
-			}
+	*sum = g_strdup (g_checksum_get_string (checksum));
+
+	g_checksum_free (checksum);
+	g_object_unref (stream);
+
+	return TRUE;
+}
+
+static void
+checksum_cache_entry_free (ChecksumCacheEntry *entry)
+{
+	g_free (entry->sum);
+	g_slice_free (ChecksumCacheEntry, entry);
+}
+
+/* Cover images are shared by all the tracks in an album, and so are the
+ * album-space-md5.jpg files they are compared to, so checksums are kept
+ * as long as the file doesn't change.
+ */
+static gboolean
+file_get_checksum_if_exists (GChecksumType   checksum_type,
+                             const gchar    *path,
+                             gchar         **md5,
+                             gboolean        check_jpeg,
+                             gboolean       *is_jpeg)
+{
+	ChecksumCacheEntry *entry;
+	FileStamp stamp;
+	gboolean jpeg = FALSE;
+	gchar *sum = NULL;
+
+	if (!file_get_stamp (path, &stamp, NULL)) {
+		g_debug ("%s isn't readable while calculating MD5 checksum", path);
+		/* File doesn't exist or isn't readable */
+		return FALSE;
+	}
+
+	G_LOCK (media_art_caches);
+
+	if (checksum_cache) {
+		entry = g_hash_table_lookup (checksum_cache, path);
+
+		if (entry &&
+		    entry->checksum_type == checksum_type &&
+		    file_stamp_equal (&entry->stamp, &stamp)) {
+			sum = g_strdup (entry->sum);
+			jpeg = entry->is_jpeg;
 		}
+	}
+
+	G_UNLOCK (media_art_caches);
 
-		while ((rsize = g_input_stream_read (G_INPUT_STREAM (stream), buffer, 1024, NULL, NULL)) > 0) {
-			g_checksum_update (checksum, buffer, rsize);
+	if (!sum) {
+		if (!file_compute_checksum (checksum_type, path, &sum, &jpeg)) {
+			return FALSE;
 		}
 
-		if (md5) {
-			*md5 = g_strdup (g_checksum_get_string (checksum));
+		entry = g_slice_new (ChecksumCacheEntry);
+		entry->checksum_type = checksum_type;
+		entry->stamp = stamp;
+		entry->is_jpeg = jpeg;
+		entry->sum = g_strdup (sum);
+
+		G_LOCK (media_art_caches);
+
+		if (!checksum_cache) {
+			checksum_cache = g_hash_table_new_full (g_str_hash,
+			                                        g_str_equal,
+			                                        (GDestroyNotify) g_free,
+			                                        (GDestroyNotify) checksum_cache_entry_free);
+		} else if (g_hash_table_size (checksum_cache) >= CHECKSUM_CACHE_SIZE) {
+			g_hash_table_remove_all (checksum_cache);
 		}
 
-	} else {
-		g_debug ("%s isn't readable while calculating MD5 checksum", path);
-		/* File doesn't exist or isn't readable */
-		retval = FALSE;
+		g_hash_table_insert (checksum_cache, g_strdup (path), entry);
+
+		G_UNLOCK (media_art_caches);
 	}
 
-end:
+	if (check_jpeg && is_jpeg) {
+		*is_jpeg = jpeg;
+	}
 
-	if (stream) {
-		g_object_unref (stream);
+	if (md5 && (!check_jpeg || jpeg)) {
+		*md5 = sum;
+	} else {
+		/* Not a jpeg, the checksum isn't given */
+		g_free (sum);
 	}
-	g_checksum_free (checksum);
-	g_object_unref (file);
 
-	return retval;
+	/* File exists & readable always means true retval */
+	return TRUE;
 }
 
 static gboolean
@@ -377,24 +596,23 @@ tracker_media_art_find_by_artist_and_title (const gchar         *uri,
                                             const gchar         *title)
 {
 	TrackerMediaArtSearch *search;
-	GDir *dir;
+	GPtrArray *images;
 	GError *error = NULL;
-	gchar *dirname = NULL;
-	const gchar *name;
-	gchar *name_utf8, *name_strdown;
-	guint i;
-	gchar *art_file_name;
+	gchar *dirname;
+	const gchar *art_file_name;
 	gchar *art_file_path;
 	gint priority;
+	guint i;
 
 	GList *image_list[IMAGE_MATCH_TYPE_COUNT] = { NULL, };
 
 	g_return_val_if_fail (type > TRACKER_MEDIA_ART_NONE && type < TRACKER_MEDIA_ART_TYPE_COUNT, FALSE);
 	g_return_val_if_fail (title != NULL, FALSE);
 
-	dir = get_parent_g_dir (uri, &dirname, &error);
+	dirname = get_parent_dirname (uri, &error);
+	images = dirname ? get_directory_images (dirname, &error) : NULL;
 
-	if (!dir) {
+	if (!images) {
 		g_debug ("Media art directory could not be opened: %s",
 		         error ? error->message : "no error given");
 
@@ -404,37 +622,18 @@ tracker_media_art_find_by_artist_and_title (const gchar         *uri,
 		return NULL;
 	}
 
-	/* First, classify each file in the directory as either an image, relevant
+	/* First, classify each image in the directory as either relevant
 	 * to the media object in question, or irrelevant. We use this information
 	 * to decide if the image is a cover or if the file is in a random directory.
 	 */
 
 	search = tracker_media_art_search_new (uri, type, artist, title);
 
-	for (name = g_dir_read_name (dir);
-	     name != NULL;
-	     name = g_dir_read_name (dir)) {
+	for (i = 0; i < images->len; i++) {
+		const gchar *name_strdown = g_ptr_array_index (images, i);
 
-		name_utf8 = g_filename_to_utf8 (name, -1, NULL, NULL, NULL);
-
-		if (!name_utf8) {
-			g_debug ("Could not convert filename '%s' to UTF-8", name);
-			continue;
-		}
-
-		name_strdown = g_utf8_strdown (name_utf8, -1);
-
-		if (g_str_has_suffix (name_strdown, "jpeg") ||
-			g_str_has_suffix (name_strdown, "jpg") ||
-			g_str_has_suffix (name_strdown, "png")) {
-
-			priority = classify_image_file (search, name_strdown);
-			image_list[priority] = g_list_prepend (image_list[priority], name_strdown);
-		} else {
-			g_free (name_strdown);
-		}
-
-		g_free (name_utf8);
+		priority = classify_image_file (search, name_strdown);
+		image_list[priority] = g_list_prepend (image_list[priority], (gpointer) name_strdown);
 	}
 
 	/* Use the results to pick a media art image */
@@ -443,30 +642,28 @@ tracker_media_art_find_by_artist_and_title (const gchar         *uri,
 	art_file_path = NULL;
 
 	if (g_list_length (image_list[IMAGE_MATCH_EXACT]) > 0) {
-		art_file_name = g_strdup (image_list[IMAGE_MATCH_EXACT]->data);
+		art_file_name = image_list[IMAGE_MATCH_EXACT]->data;
 	} else if (g_list_length (image_list[IMAGE_MATCH_EXACT_SMALL]) > 0) {
-		art_file_name = g_strdup (image_list[IMAGE_MATCH_EXACT_SMALL]->data);
+		art_file_name = image_list[IMAGE_MATCH_EXACT_SMALL]->data;
 	} else {
 		if (type == TRACKER_MEDIA_ART_VIDEO && g_list_length (image_list[IMAGE_MATCH_SAME_DIRECTORY]) == 1) {
-			art_file_name = g_strdup (image_list[IMAGE_MATCH_SAME_DIRECTORY]->data);
+			art_file_name = image_list[IMAGE_MATCH_SAME_DIRECTORY]->data;
 		}
 	}
 
-	for (i = 0; i < IMAGE_MATCH_TYPE_COUNT; i ++) {
-		g_list_foreach (image_list[i], (GFunc)g_free, NULL);
-		g_list_free (image_list[i]);
-	}
-
 	if (art_file_name) {
 		art_file_path = g_build_filename (dirname, art_file_name, NULL);
-		g_free (art_file_name);
 	} else {
 		g_debug ("Album art NOT found in same directory");
 		art_file_path = NULL;
 	}
 
+	for (i = 0; i < IMAGE_MATCH_TYPE_COUNT; i ++) {
+		g_list_free (image_list[i]);
+	}
+
 	tracker_media_art_search_free (search);
-	g_dir_close (dir);
+	g_ptr_array_unref (images);
 	g_free (dirname);
 
 	return art_file_path;
@@ -946,12 +1143,18 @@ tracker_media_art_init (void)
 
 	media_art_storage = tracker_storage_new ();
 
-	/* Cache to know if we have already handled uris */
+	/* Cache to know if we have already handled albums in a directory */
 	media_art_cache = g_hash_table_new_full (g_str_hash,
 	                                         g_str_equal,
 	                                         (GDestroyNotify) g_free,
 	                                         NULL);
 
+	/* Art paths of the albums the heuristic found art for */
+	album_art_cache = g_hash_table_new_full (g_str_hash,
+	                                         g_str_equal,
+	                                         (GDestroyNotify) g_free,
+	                                         (GDestroyNotify) g_free);
+
 	/* Signal handler for new album art from the extractor */
 	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
 
@@ -980,6 +1183,24 @@ tracker_media_art_shutdown (void)
 		g_hash_table_unref (media_art_cache);
 	}
 
+	if (album_art_cache) {
+		g_hash_table_unref (album_art_cache);
+	}
+
+	G_LOCK (media_art_caches);
+
+	if (directory_cache) {
+		g_hash_table_unref (directory_cache);
+		directory_cache = NULL;
+	}
+
+	if (checksum_cache) {
+		g_hash_table_unref (checksum_cache);
+		checksum_cache = NULL;
+	}
+
+	G_UNLOCK (media_art_caches);
+
 	if (media_art_storage) {
 		g_object_unref (media_art_storage);
 	}
@@ -1055,33 +1276,64 @@ tracker_media_art_process (const unsigned char *buffer,
 	}
 
 	if ((!created) && ((!a_exists) || (a_exists && mtime > a_mtime))) {
-		/* If not, we perform a heuristic on the dir */
-		gchar *key;
-		gchar *dirname = NULL;
-		GFile *file, *dirf;
-
-		file = g_file_new_for_uri (uri);
-		dirf = g_file_get_parent (file);
-		if (dirf) {
-			dirname = g_file_get_path (dirf);
-			g_object_unref (dirf);
-		}
-		g_object_unref (file);
+		/* If not, we perform a heuristic on the dir. The tracks of
+		 * an album in the same directory find the same image, so this
+		 * is only done for the first one, whichever thread it's
+		 * extracted from. Other directories may have the image the
+		 * first one lacked, they are only looked into until art is
+		 * found for the album.
+		 */
+		gchar *dirname, *album_key, *key, *album_art_path;
+		gboolean handled;
 
-		key = g_strdup_printf ("%i-%s-%s-%s",
-		                       type,
-		                       artist ? artist : "",
-		                       title ? title : "",
-		                       dirname ? dirname : "");
+		album_key = g_strdup_printf ("%i-%s-%s",
+		                             type,
+		                             artist ? artist : "",
+		                             title ? title : "");
 
+		dirname = get_parent_dirname (uri, NULL);
+		key = g_strdup_printf ("%s-%s",
+		                       album_key,
+		                       dirname ? dirname : "");
 		g_free (dirname);
 
-		if (!g_hash_table_lookup (media_art_cache, key)) {
-			if (!media_art_heuristic (artist,
-			                          title,
-			                          type,
-			                          uri,
-			                          local_art_uri)) {
+		G_LOCK (media_art_caches);
+		album_art_path = g_strdup (g_hash_table_lookup (album_art_cache, album_key));
+		G_UNLOCK (media_art_caches);
+
+		handled = (album_art_path && g_file_test (album_art_path, G_FILE_TEST_EXISTS));
+		g_free (album_art_path);
+
+		if (!handled) {
+			G_LOCK (media_art_caches);
+
+			handled = g_hash_table_lookup (media_art_cache, key) != NULL;
+
+			if (!handled) {
+				g_hash_table_insert (media_art_cache,
+				                     key,
+				                     GINT_TO_POINTER (TRUE));
+				key = NULL;
+			}
+
+			G_UNLOCK (media_art_caches);
+		}
+
+		g_free (key);
+
+		if (!handled) {
+			if (media_art_heuristic (artist,
+			                         title,
+			                         type,
+			                         uri,
+			                         local_art_uri)) {
+				G_LOCK (media_art_caches);
+				g_hash_table_replace (album_art_cache,
+				                      album_key,
+				                      g_strdup (art_path));
+				album_key = NULL;
+				G_UNLOCK (media_art_caches);
+			} else {
 				/* If the heuristic failed, we
 				 * request the download the
 				 * media-art to the media-art
@@ -1096,13 +1348,9 @@ tracker_media_art_process (const unsigned char *buffer,
 			}
 
 			set_mtime (art_path, mtime);
-
-			g_hash_table_insert (media_art_cache,
-			                     key,
-			                     GINT_TO_POINTER(TRUE));
-		} else {
-			g_free (key);
 		}
+
+		g_free (album_key);
 	} else {
 		if (!created) {
 			g_debug ("Album art already exists for uri:'%s' as '%s'",
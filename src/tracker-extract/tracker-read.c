@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -33,68 +34,255 @@
 /* Size of the buffer to use when reading, in bytes */
 #define BUFFER_SIZE 65535
 
-static gchar *
-get_string_from_guessed_encoding (const gchar *str,
-                                  gsize        str_len,
-                                  gsize       *utf8_len)
+/* Maximum number of bytes of a character which may be cut at the end
+ * of a chunk and carried over to the next one */
+#define MAX_PENDING_BYTES 8
+
+/* Text is decoded chunk by chunk as it is read, so only the resulting
+ * UTF-8 string is kept around, never the raw file contents. The
+ * encoding is decided on the first chunk, UTF-8 if it is valid UTF-8
+ * or a guessed one otherwise, and then used for the whole file. As
+ * long as the text is plain ASCII any encoding fits it, so a first
+ * chunk with no other characters leaves the decision to the next. */
+typedef struct {
+	GString *output;
+	GIConv converter;
+	gboolean started;
+	gboolean utf8;
+} TextDecoder;
+
+static void
+text_decoder_init (TextDecoder *decoder)
+{
+	decoder->output = NULL;
+	decoder->converter = (GIConv) -1;
+	decoder->started = FALSE;
+	decoder->utf8 = FALSE;
+}
+
+static gboolean
+is_ascii (const gchar *data,
+          gsize        length)
+{
+	gsize i;
+
+	for (i = 0; i < length; i++) {
+		if (data[i] & 0x80) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* Converts @data to UTF-8 with @converter and appends it to @output,
+ * returns the number of trailing bytes which could not be converted
+ * because a character was cut, or -1 if @data is not valid in the
+ * source encoding. */
+static gssize
+convert_chunk (GIConv       converter,
+               const gchar *data,
+               gsize        length,
+               GString     *output)
+{
+	gchar *inbuf = (gchar *) data;
+	gsize inbytes_left = length;
+
+	while (inbytes_left > 0) {
+		gchar buf[4096];
+		gchar *outbuf = buf;
+		gsize outbytes_left = sizeof (buf);
+		gsize retval;
+
+		retval = g_iconv (converter, &inbuf, &inbytes_left, &outbuf, &outbytes_left);
+		g_string_append_len (output, buf, outbuf - buf);
+
+		if (retval == (gsize) -1) {
+			if (errno == E2BIG) {
+				continue;
+			} else if (errno == EINVAL) {
+				/* Incomplete character at the end */
+				return inbytes_left;
+			}
+
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static gboolean
+text_decoder_open (TextDecoder *decoder,
+                   const gchar *data,
+                   gsize        length,
+                   gssize      *pending)
+{
+	const gchar *candidates[3] = { NULL, NULL, NULL };
+	gchar *guessed = NULL;
+	const gchar *current;
+	gsize output_length;
+	gint i = 0;
+
+	/* Support also UTF-16 encoded text files, as the ones generated in
+	 * Windows OS. We will only accept text files in UTF-16 which come
+	 * with a proper BOM. */
+	if (!decoder->started && length > 2) {
+		if (memcmp (data, "\xFF\xFE", 2) == 0) {
+			g_debug ("String comes in UTF-16LE, converting");
+			candidates[i++] = "UTF-16LE";
+		} else if (memcmp (data, "\xFE\xFF", 2) == 0) {
+			g_debug ("String comes in UTF-16BE, converting");
+			candidates[i++] = "UTF-16BE";
+		}
+	}
+
+	if (i == 0) {
+		if (memchr (data, '\0', length)) {
+			/* If we have embedded NULs try UTF-16 directly */
+			candidates[i++] = "UTF-16";
+		} else {
+			if (tracker_encoding_can_guess () &&
+			    (guessed = tracker_encoding_guess (data, length)) != NULL) {
+				candidates[i++] = guessed;
+			}
+
+			/* If locale charset is UTF-8, try with windows-1252.
+			 * NOTE: g_get_charset() returns TRUE if locale charset is UTF-8 */
+			if (!g_get_charset (&current)) {
+				candidates[i++] = current;
+			} else {
+				candidates[i++] = "windows-1252";
+			}
+		}
+	}
+
+	if (!decoder->output) {
+		decoder->output = g_string_new ("");
+	}
+
+	output_length = decoder->output->len;
+
+	for (i = 0; i < G_N_ELEMENTS (candidates) && candidates[i]; i++) {
+		GIConv converter;
+		const gchar *chunk = data;
+		gsize chunk_length = length;
+
+		converter = g_iconv_open ("UTF-8", candidates[i]);
+
+		if (converter == (GIConv) -1) {
+			continue;
+		}
+
+		if (strncmp (candidates[i], "UTF-16", 6) == 0 &&
+		    candidates[i][6] != '\0') {
+			/* Skip the BOM */
+			chunk += 2;
+			chunk_length -= 2;
+		}
+
+		*pending = convert_chunk (converter, chunk, chunk_length, decoder->output);
+
+		if (*pending >= 0) {
+			g_debug ("Converting text from '%s' codeset to UTF-8", candidates[i]);
+			decoder->converter = converter;
+			g_free (guessed);
+			return TRUE;
+		}
+
+		g_debug ("Text not in '%s' encoding", candidates[i]);
+		g_string_truncate (decoder->output, output_length);
+		g_iconv_close (converter);
+	}
+
+	g_free (guessed);
+
+	return FALSE;
+}
+
+/* Appends the UTF-8 text of @data to the decoder output. Returns the
+ * number of trailing bytes to carry over to the next chunk, or -1 if
+ * the text can't be decoded further. */
+static gssize
+text_decoder_feed (TextDecoder *decoder,
+                   const gchar *data,
+                   gsize        length)
 {
-	const gchar *current = NULL;
-
-	/* If we have embedded NULs try UTF-16 directly */
-	if (memchr (str, '\0', str_len))
-		current = "UTF-16";
-	/* If locale charset is UTF-8, try with windows-1252.
-	 * NOTE: g_get_charset() returns TRUE if locale charset is UTF-8 */
-	else if (g_get_charset (&current))
-		current = "windows-1252";
-
-	while (current) {
-		gchar *utf8_str;
-		gsize bytes_read = 0;
-		gsize bytes_written = 0;
-
-		utf8_str = g_convert (str,
-		                      str_len,
-		                      "UTF-8",
-		                      current,
-		                      &bytes_read,
-		                      &bytes_written,
-		                      NULL);
-		if (utf8_str &&
-		    str_len == bytes_read) {
-			g_debug ("Converted %" G_GSIZE_FORMAT " bytes in '%s' codeset "
-			         "to %" G_GSIZE_FORMAT " bytes in UTF-8",
-			         bytes_read,
-			         current,
-			         bytes_written);
-			*utf8_len = bytes_written;
-			return utf8_str;
+	gssize pending = 0;
+
+	if (decoder->converter != (GIConv) -1) {
+		pending = convert_chunk (decoder->converter, data, length, decoder->output);
+	} else {
+		gsize n_valid_utf8_bytes = 0;
+
+		/* Get number of valid UTF-8 bytes found */
+		tracker_text_validate_utf8 (data, length, NULL, &n_valid_utf8_bytes);
+
+		/* A valid UTF-8 chunk will be that where all read bytes are
+		 * valid, with a margin of 3 bytes for the last UTF-8 character
+		 * which might have been cut. */
+		if (decoder->utf8 || length - n_valid_utf8_bytes <= 3) {
+			if (!decoder->output) {
+				decoder->output = g_string_sized_new (n_valid_utf8_bytes);
+			}
+
+			g_string_append_len (decoder->output, data, n_valid_utf8_bytes);
+			pending = length - n_valid_utf8_bytes;
+
+			if (!decoder->utf8) {
+				decoder->utf8 = !is_ascii (data, n_valid_utf8_bytes);
+			} else if (pending > 3) {
+				/* Not UTF-8 after all, keep the text before */
+				g_debug ("  Invalid UTF-8 after %" G_GSIZE_FORMAT " bytes",
+				         decoder->output->len);
+				pending = -1;
+			}
+		} else if (!text_decoder_open (decoder, data, length, &pending)) {
+			pending = -1;
 		}
-		g_free (utf8_str);
-
-		g_debug ("Text not in '%s' encoding", current);
-
-		if (!strcmp (current, "windows-1252") ||
-		    !strcmp (current, "UTF-16"))
-			/* If we tried windows-1252 or UTF-16, don't try anything else */
-			current = NULL;
-		else
-			/* If we tried a locale encoding and didn't work, retry with
-			 * windows-1252 */
-			current = "windows-1252";
 	}
 
-	return NULL;
+	decoder->started = TRUE;
+
+	if (pending > MAX_PENDING_BYTES) {
+		pending = -1;
+	}
+
+	return pending;
 }
 
-/* Returns %TRUE if read operation should continue, %FALSE otherwise */
+static gchar *
+text_decoder_finish (TextDecoder *decoder)
+{
+	if (decoder->converter != (GIConv) -1) {
+		g_iconv_close (decoder->converter);
+	}
+
+	if (!decoder->output) {
+		return NULL;
+	}
+
+	if (decoder->output->len < 1) {
+		g_string_free (decoder->output, TRUE);
+		return NULL;
+	}
+
+	return g_string_free (decoder->output, FALSE);
+}
+
+/* Returns %TRUE if read operation should continue, %FALSE otherwise.
+ * @buffer holds the @n_pending bytes left over from the previous chunk
+ * followed by the @read_size bytes just read. */
 static gboolean
-process_chunk (const gchar  *read_bytes,
+process_chunk (TextDecoder  *decoder,
+               gchar        *buffer,
+               gsize        *n_pending,
                gsize         read_size,
                gsize         buffer_size,
-               gsize        *remaining_size,
-               GString     **s)
+               gsize        *remaining_size)
 {
+	gssize pending;
+
 	/* If no more bytes to read, halt loop */
 	if (read_size == 0) {
 		return FALSE;
@@ -114,32 +302,19 @@ process_chunk (const gchar  *read_bytes,
 	 * UTF-16LE), so we can't rely on methods which assume
 	 * NUL-terminated strings, as g_strstr_len().
 	 */
-	if (*s == NULL) {
+	if (!decoder->started) {
 		if (read_size <= 3) {
 			g_debug ("  File has less than 3 characters in it, "
 			         "not indexing file");
 			return FALSE;
 		}
 
-		if (read_size == buffer_size) {
-			const gchar *i;
-			gboolean eol_found = FALSE;
-
-			i = read_bytes;
-			while (i != &read_bytes[read_size - 1]) {
-				if (*i == '\n') {
-					eol_found = TRUE;
-					break;
-				}
-				i++;
-			}
-
-			if (!eol_found) {
-				g_debug ("  No '\\n' in the first %" G_GSSIZE_FORMAT " bytes, "
-				         "not indexing file",
-				         read_size);
-				return FALSE;
-			}
+		if (read_size == buffer_size &&
+		    !memchr (buffer, '\n', read_size - 1)) {
+			g_debug ("  No '\\n' in the first %" G_GSSIZE_FORMAT " bytes, "
+			         "not indexing file",
+			         read_size);
+			return FALSE;
 		}
 	}
 
@@ -152,100 +327,18 @@ process_chunk (const gchar  *read_bytes,
 	         read_size,
 	         *remaining_size);
 
-	/* Append non-NIL terminated bytes */
-	*s = (*s ?
-	      g_string_append_len (*s, read_bytes, read_size) :
-	      g_string_new_len (read_bytes, read_size));
-
-	return TRUE;
-}
-
-static gchar *
-process_whole_string (GString  *s)
-{
-	gchar *utf8 = NULL;
-	gsize  utf8_len = 0;
-	gsize n_valid_utf8_bytes = 0;
-
-	/* Support also UTF-16 encoded text files, as the ones generated in
-	 * Windows OS. We will only accept text files in UTF-16 which come
-	 * with a proper BOM. */
-	if (s->len > 2) {
-		GError *error = NULL;
-
-		if (memcmp (s->str, "\xFF\xFE", 2) == 0) {
-			g_debug ("String comes in UTF-16LE, converting");
-			utf8 = g_convert (&(s->str[2]),
-			                  s->len - 2,
-			                  "UTF-8",
-			                  "UTF-16LE",
-			                  NULL,
-			                  &utf8_len,
-			                  &error);
-
-		} else if (memcmp (s->str, "\xFE\xFF", 2) == 0) {
-			g_debug ("String comes in UTF-16BE, converting");
-			utf8 = g_convert (&(s->str[2]),
-			                  s->len - 2,
-			                  "UTF-8",
-			                  "UTF-16BE",
-			                  NULL,
-			                  &utf8_len,
-			                  &error);
-		}
+	pending = text_decoder_feed (decoder, buffer, *n_pending + read_size);
 
-		if (error) {
-			g_warning ("Couldn't convert string from UTF-16 to UTF-8...: %s",
-			           error->message);
-			g_error_free (error);
-			g_string_free (s, TRUE);
-			return NULL;
-		}
-	}
-
-	if (!utf8) {
-		utf8_len = s->len;
-		utf8 = g_string_free (s, FALSE);
-	}
-
-	/* Get number of valid UTF-8 bytes found */
-	tracker_text_validate_utf8 (utf8,
-	                            utf8_len,
-	                            NULL,
-	                            &n_valid_utf8_bytes);
-
-	/* A valid UTF-8 file will be that where all read bytes are valid,
-	 *  with a margin of 3 bytes for the last UTF-8 character which might
-	 *  have been cut. */
-	if (utf8_len - n_valid_utf8_bytes > 3) {
-		gchar *from_guessed_str;
-		gsize  from_guessed_str_len;
-
-		/* If not UTF-8, try to get contents in guessed encoding
-		 *  (returns valid UTF-8) */
-		from_guessed_str = get_string_from_guessed_encoding (utf8,
-		                                                     utf8_len,
-		                                                     &from_guessed_str_len);
-		g_free (utf8);
-		if (!from_guessed_str)
-			return NULL;
-		utf8 = from_guessed_str;
-		utf8_len = from_guessed_str_len;
-	} else if (n_valid_utf8_bytes < utf8_len) {
-		g_debug ("  Truncating to last valid UTF-8 character "
-		         "(%" G_GSSIZE_FORMAT "/%" G_GSSIZE_FORMAT " bytes)",
-		         n_valid_utf8_bytes,
-		         utf8_len);
-		utf8[n_valid_utf8_bytes] = '\0';
-		utf8_len = n_valid_utf8_bytes;
+	if (pending < 0) {
+		g_debug ("  Could not decode text any further, stopping");
+		return FALSE;
 	}
 
-	if (utf8_len < 1) {
-		g_free (utf8);
-		return NULL;
-	}
+	/* Move the cut character to the beginning of the buffer */
+	memmove (buffer, buffer + *n_pending + read_size - pending, pending);
+	*n_pending = pending;
 
-	return utf8;
+	return TRUE;
 }
 
 /**
@@ -265,12 +358,16 @@ gchar *
 tracker_read_text_from_stream (GInputStream *stream,
                                gsize         max_bytes)
 {
-	GString *s = NULL;
+	TextDecoder decoder;
+	gchar buf[MAX_PENDING_BYTES + BUFFER_SIZE];
+	gsize n_pending = 0;
 	gsize n_bytes_remaining = max_bytes;
 
 	g_return_val_if_fail (stream, NULL);
 	g_return_val_if_fail (max_bytes > 0, NULL);
 
+	text_decoder_init (&decoder);
+
 	/* Reading in chunks of BUFFER_SIZE
 	 *   Loop is halted whenever one of this conditions is met:
 	 *     a) Read bytes reached the maximum allowed (max_bytes)
@@ -278,15 +375,15 @@ tracker_read_text_from_stream (GInputStream *stream,
 	 *     c) Error reading
 	 *     d) Stream has less than 3 bytes
 	 *     e) Stream has a single line of BUFFER_SIZE bytes with no EOL
+	 *     f) Text can't be decoded
 	 */
 	while (n_bytes_remaining > 0) {
-		gchar buf[BUFFER_SIZE];
 		GError *error = NULL;
 		gsize n_bytes_read;
 
 		/* Read bytes from stream */
 		if (!g_input_stream_read_all (stream,
-		                              buf,
+		                              buf + n_pending,
 		                              MIN (BUFFER_SIZE, n_bytes_remaining),
 		                              &n_bytes_read,
 		                              NULL,
@@ -298,17 +395,18 @@ tracker_read_text_from_stream (GInputStream *stream,
 		}
 
 		/* Process read bytes, and halt loop if needed */
-		if (!process_chunk (buf,
+		if (!process_chunk (&decoder,
+		                    buf,
+		                    &n_pending,
 		                    n_bytes_read,
 		                    BUFFER_SIZE,
-		                    &n_bytes_remaining,
-		                    &s)) {
+		                    &n_bytes_remaining)) {
 			break;
 		}
 	}
 
-	/* Validate UTF-8 if something was read, and return it */
-	return s ? process_whole_string (s) : NULL;
+	/* Return the text decoded so far, if any */
+	return text_decoder_finish (&decoder);
 }
 
 
@@ -330,7 +428,9 @@ tracker_read_text_from_fd (gint  fd,
                            gsize max_bytes)
 {
 	FILE *fz;
-	GString *s = NULL;
+	TextDecoder decoder;
+	gchar buf[MAX_PENDING_BYTES + BUFFER_SIZE];
+	gsize n_pending = 0;
 	gsize n_bytes_remaining = max_bytes;
 
 	g_return_val_if_fail (max_bytes > 0, NULL);
@@ -341,6 +441,8 @@ tracker_read_text_from_fd (gint  fd,
 		return NULL;
 	}
 
+	text_decoder_init (&decoder);
+
 	/* Reading in chunks of BUFFER_SIZE
 	 *   Loop is halted whenever one of this conditions is met:
 	 *     a) Read bytes reached the maximum allowed (max_bytes)
@@ -348,23 +450,24 @@ tracker_read_text_from_fd (gint  fd,
 	 *     c) Error reading
 	 *     d) Stream has less than 3 bytes
 	 *     e) Stream has a single line of BUFFER_SIZE bytes with no EOL
+	 *     f) Text can't be decoded
 	 */
 	while (n_bytes_remaining > 0) {
-		gchar buf[BUFFER_SIZE];
 		gsize n_bytes_read;
 
 		/* Read bytes */
-		n_bytes_read = fread (buf,
+		n_bytes_read = fread (buf + n_pending,
 		                      1,
 		                      MIN (BUFFER_SIZE, n_bytes_remaining),
 		                      fz);
 
 		/* Process read bytes, and halt loop if needed */
-		if (!process_chunk (buf,
+		if (!process_chunk (&decoder,
+		                    buf,
+		                    &n_pending,
 		                    n_bytes_read,
 		                    BUFFER_SIZE,
-		                    &n_bytes_remaining,
-		                    &s)) {
+		                    &n_bytes_remaining)) {
 			break;
 		}
 	}
@@ -375,6 +478,6 @@ tracker_read_text_from_fd (gint  fd,
 #endif /* HAVE_POSIX_FADVISE */
 	fclose (fz);
 
-	/* Validate UTF-8 if something was read, and return it */
-	return s ? process_whole_string (s) : NULL;
+	/* Return the text decoded so far, if any */
+	return text_decoder_finish (&decoder);
 }
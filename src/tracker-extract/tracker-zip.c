@@ -0,0 +1,431 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <zlib.h>
+
+#include <gio/gio.h>
+
+#include "tracker-zip.h"
+
+/* Reads XML members of ZIP archives (OOXML, ODF) straight from the
+ * file reader window. The central directory is read once per archive, stored
+ * members are handed to the parser without copies and deflated ones are
+ * inflated a buffer at a time, so that nothing past the point where the
+ * parser gives up (i.e. the text limit was reached) is decompressed.
+ */
+
+/* Size of the buffer to use */
+#define XML_BUFFER_SIZE            8192         /* bytes */
+/* Note: 20 MBytes of max size is really assumed to be a safe limit. */
+#define XML_MAX_BYTES_READ         (20u << 20)  /* bytes */
+
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034b50
+#define ZIP_LOCAL_HEADER_SIZE      30
+#define ZIP_CENTRAL_SIGNATURE      0x02014b50
+#define ZIP_CENTRAL_SIZE           46
+#define ZIP_END_SIGNATURE          0x06054b50
+#define ZIP_END_SIZE               22
+#define ZIP_MAX_COMMENT            0xffff
+
+#define ZIP_METHOD_STORED          0
+#define ZIP_METHOD_DEFLATED        8
+
+#define READ_UINT16(p) (((guint) (p)[1] << 8) | (p)[0])
+#define READ_UINT32(p) (((guint32) (p)[3] << 24) | ((guint32) (p)[2] << 16) | \
+                        ((guint32) (p)[1] << 8) | (p)[0])
+
+typedef struct {
+	guint method;
+	guint32 compressed_size;
+	guint32 uncompressed_size;
+	guint32 offset;
+} ZipMember;
+
+struct _TrackerZip {
+	TrackerFileReader *reader;
+	const guchar *data;
+	gsize length;
+	GHashTable *members;
+};
+
+static gboolean
+zip_read_central_directory (TrackerZip *zip)
+{
+	const guchar *end = NULL, *entry;
+	gsize pos, start, cd_offset, cd_size;
+	guint n_entries, i;
+
+	if (zip->length < ZIP_END_SIZE) {
+		return FALSE;
+	}
+
+	/* The end of central directory record is followed by a
+	 * comment of up to 64KB.
+	 */
+	start = zip->length > ZIP_END_SIZE + ZIP_MAX_COMMENT ?
+		zip->length - ZIP_END_SIZE - ZIP_MAX_COMMENT : 0;
+
+	for (pos = zip->length - ZIP_END_SIZE + 1; pos-- > start; ) {
+		if (zip->data[pos] == 'P' &&
+		    READ_UINT32 (zip->data + pos) == ZIP_END_SIGNATURE) {
+			end = zip->data + pos;
+			break;
+		}
+	}
+
+	if (!end) {
+		return FALSE;
+	}
+
+	/* ZIP64 archives are not expected for documents */
+	n_entries = READ_UINT16 (end + 10);
+	cd_size = READ_UINT32 (end + 12);
+	cd_offset = READ_UINT32 (end + 16);
+
+	if (cd_offset > zip->length || cd_size > zip->length - cd_offset) {
+		return FALSE;
+	}
+
+	entry = zip->data + cd_offset;
+
+	for (i = 0; i < n_entries; i++) {
+		ZipMember *member;
+		guint name_length, extra_length, comment_length;
+		gsize entry_length;
+
+		if (cd_size < ZIP_CENTRAL_SIZE ||
+		    READ_UINT32 (entry) != ZIP_CENTRAL_SIGNATURE) {
+			return FALSE;
+		}
+
+		name_length = READ_UINT16 (entry + 28);
+		extra_length = READ_UINT16 (entry + 30);
+		comment_length = READ_UINT16 (entry + 32);
+		entry_length = ZIP_CENTRAL_SIZE + name_length + extra_length + comment_length;
+
+		if (entry_length > cd_size) {
+			return FALSE;
+		}
+
+		member = g_slice_new (ZipMember);
+		member->method = READ_UINT16 (entry + 10);
+		member->compressed_size = READ_UINT32 (entry + 20);
+		member->uncompressed_size = READ_UINT32 (entry + 24);
+		member->offset = READ_UINT32 (entry + 42);
+
+		g_hash_table_replace (zip->members,
+		                      g_strndup ((const gchar *) entry + ZIP_CENTRAL_SIZE, name_length),
+		                      member);
+
+		entry += entry_length;
+		cd_size -= entry_length;
+	}
+
+	return TRUE;
+}
+
+static void
+zip_member_free (ZipMember *member)
+{
+	g_slice_free (ZipMember, member);
+}
+
+/**
+ * tracker_zip_new_from_data:
+ * @data: contents of the ZIP archive
+ * @length: length of @data
+ *
+ * Reads the central directory of a ZIP archive held in memory. @data
+ * must stay valid until the archive is closed.
+ *
+ * Returns: the archive, or %NULL if @data is not a ZIP archive.
+ */
+TrackerZip *
+tracker_zip_new_from_data (const guchar *data,
+                           gsize         length)
+{
+	TrackerZip *zip;
+
+	g_return_val_if_fail (data != NULL || length == 0, NULL);
+
+	zip = g_slice_new0 (TrackerZip);
+	zip->data = data;
+	zip->length = length;
+	zip->members = g_hash_table_new_full (g_str_hash,
+	                                      g_str_equal,
+	                                      g_free,
+	                                      (GDestroyNotify) zip_member_free);
+
+	if (!zip_read_central_directory (zip)) {
+		tracker_zip_close (zip);
+		return NULL;
+	}
+
+	return zip;
+}
+
+/**
+ * tracker_zip_open:
+ * @info: a #TrackerExtractInfo for the ZIP archive
+ *
+ * Opens the ZIP archive through a #TrackerFileReader and reads its
+ * central directory, members can then be parsed with
+ * tracker_zip_parse_xml() without reopening it.
+ *
+ * Returns: the archive, or %NULL if the file could not be read or is
+ * not a ZIP archive.
+ */
+TrackerZip *
+tracker_zip_open (TrackerExtractInfo *info)
+{
+	TrackerFileReader *reader;
+	TrackerZip *zip;
+	GError *error = NULL;
+	gconstpointer data;
+	gchar *uri;
+	gsize length;
+
+	g_return_val_if_fail (info != NULL, NULL);
+
+	uri = g_file_get_uri (tracker_extract_info_get_file (info));
+	reader = tracker_file_reader_open (info, &error);
+
+	if (!reader) {
+		g_warning ("Can't open file from uri '%s': %s",
+		           uri, error ? error->message : "no error given");
+		g_clear_error (&error);
+		g_free (uri);
+		return NULL;
+	}
+
+	/* Only the central directory at the end and the members
+	 * parsed are paged in */
+	data = tracker_file_reader_get_head (reader,
+	                                     tracker_file_reader_get_size (reader),
+	                                     &length);
+	zip = data ? tracker_zip_new_from_data (data, length) : NULL;
+
+	if (!zip) {
+		g_warning ("'%s' Not a zip file", uri);
+		tracker_file_reader_close (reader);
+		g_free (uri);
+		return NULL;
+	}
+
+	zip->reader = reader;
+	g_free (uri);
+
+	return zip;
+}
+
+void
+tracker_zip_close (TrackerZip *zip)
+{
+	g_return_if_fail (zip != NULL);
+
+	g_hash_table_unref (zip->members);
+
+	if (zip->reader) {
+		tracker_file_reader_close (zip->reader);
+	}
+
+	g_slice_free (TrackerZip, zip);
+}
+
+gboolean
+tracker_zip_has_member (TrackerZip  *zip,
+                        const gchar *member_name)
+{
+	g_return_val_if_fail (zip != NULL, FALSE);
+	g_return_val_if_fail (member_name != NULL, FALSE);
+
+	return g_hash_table_lookup (zip->members, member_name) != NULL;
+}
+
+static const guchar *
+zip_member_get_data (TrackerZip *zip,
+                     ZipMember  *member)
+{
+	const guchar *header;
+	gsize data_offset;
+
+	if (member->offset > zip->length ||
+	    zip->length - member->offset < ZIP_LOCAL_HEADER_SIZE) {
+		return NULL;
+	}
+
+	header = zip->data + member->offset;
+
+	if (READ_UINT32 (header) != ZIP_LOCAL_HEADER_SIGNATURE) {
+		return NULL;
+	}
+
+	/* Sizes in the local header may be deferred to a data
+	 * descriptor, the central directory ones are used instead.
+	 */
+	data_offset = (gsize) member->offset + ZIP_LOCAL_HEADER_SIZE +
+		READ_UINT16 (header + 26) + READ_UINT16 (header + 28);
+
+	if (data_offset > zip->length ||
+	    zip->length - data_offset < member->compressed_size) {
+		return NULL;
+	}
+
+	return zip->data + data_offset;
+}
+
+static gboolean
+zip_parse_stored (const guchar         *data,
+                  gsize                 length,
+                  GMarkupParseContext  *context,
+                  GError              **error)
+{
+	gsize pos = 0;
+
+	length = MIN (length, XML_MAX_BYTES_READ);
+
+	while (pos < length) {
+		gsize chunk_size = MIN (length - pos, XML_BUFFER_SIZE);
+
+		if (!g_markup_parse_context_parse (context,
+		                                   (const gchar *) data + pos,
+		                                   chunk_size,
+		                                   error)) {
+			return FALSE;
+		}
+
+		pos += chunk_size;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+zip_parse_deflated (const guchar         *data,
+                    gsize                 length,
+                    GMarkupParseContext  *context,
+                    GError              **error)
+{
+	guchar buf[XML_BUFFER_SIZE];
+	gboolean retval = TRUE;
+	gsize accum = 0;
+	z_stream stream;
+	gint status;
+
+	memset (&stream, 0, sizeof (z_stream));
+
+	/* Raw deflate data, no zlib header */
+	if (inflateInit2 (&stream, -MAX_WBITS) != Z_OK) {
+		return FALSE;
+	}
+
+	stream.next_in = (Bytef *) data;
+	stream.avail_in = length;
+
+	do {
+		gsize chunk_size;
+
+		stream.next_out = buf;
+		stream.avail_out = sizeof (buf);
+
+		status = inflate (&stream, Z_NO_FLUSH);
+
+		if (status != Z_OK && status != Z_STREAM_END) {
+			g_set_error (error,
+			             G_IO_ERROR,
+			             G_IO_ERROR_INVALID_DATA,
+			             "Could not inflate ZIP member: %s",
+			             stream.msg ? stream.msg : "no error given");
+			retval = FALSE;
+			break;
+		}
+
+		chunk_size = sizeof (buf) - stream.avail_out;
+		accum += chunk_size;
+
+		/* Stop inflating as soon as the parser gives up */
+		if (chunk_size > 0 &&
+		    !g_markup_parse_context_parse (context, (const gchar *) buf, chunk_size, error)) {
+			retval = FALSE;
+			break;
+		}
+	} while (status != Z_STREAM_END && accum <= XML_MAX_BYTES_READ);
+
+	inflateEnd (&stream);
+
+	return retval;
+}
+
+/**
+ * tracker_zip_parse_xml:
+ * @zip: a #TrackerZip
+ * @member_name: Name of the XML file stored inside the ZIP archive
+ * @context: Markup context to be used when parsing the XML
+ * @error: return location for the inflate and parser errors
+ *
+ * Feeds an XML file stored inside the ZIP archive to @context. As
+ * with tracker_gsf_parse_xml_in_zip(), at most 20MBytes are parsed.
+ * Parsing stops, and so does decompression, as soon as @context
+ * fails, which extractors use to stop once they have enough text.
+ *
+ * Returns: %FALSE if the member could not be read or inflated, or
+ * @context failed.
+ */
+gboolean
+tracker_zip_parse_xml (TrackerZip           *zip,
+                       const gchar          *member_name,
+                       GMarkupParseContext  *context,
+                       GError              **error)
+{
+	const guchar *data;
+	ZipMember *member;
+
+	g_return_val_if_fail (zip != NULL, FALSE);
+	g_return_val_if_fail (member_name != NULL, FALSE);
+	g_return_val_if_fail (context != NULL, FALSE);
+
+	g_debug ("Parsing '%s' XML file from zip archive...", member_name);
+
+	member = g_hash_table_lookup (zip->members, member_name);
+
+	if (!member) {
+		g_debug ("No member '%s' in zip file", member_name);
+		return FALSE;
+	}
+
+	data = zip_member_get_data (zip, member);
+
+	if (!data) {
+		g_message ("Member '%s' is out of the zip file bounds", member_name);
+		return FALSE;
+	}
+
+	switch (member->method) {
+	case ZIP_METHOD_STORED:
+		return zip_parse_stored (data, member->compressed_size, context, error);
+	case ZIP_METHOD_DEFLATED:
+		return zip_parse_deflated (data, member->compressed_size, context, error);
+	default:
+		g_message ("Member '%s' uses unsupported compression method %u",
+		           member_name, member->method);
+		return FALSE;
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __TRACKER_ZIP_H__
+#define __TRACKER_ZIP_H__
+
+#include <glib.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+G_BEGIN_DECLS
+
+typedef struct _TrackerZip TrackerZip;
+
+TrackerZip *tracker_zip_open          (TrackerExtractInfo   *info);
+TrackerZip *tracker_zip_new_from_data (const guchar         *data,
+                                       gsize                 length);
+void        tracker_zip_close         (TrackerZip           *zip);
+
+gboolean    tracker_zip_has_member    (TrackerZip           *zip,
+                                       const gchar          *member_name);
+gboolean    tracker_zip_parse_xml     (TrackerZip           *zip,
+                                       const gchar          *member_name,
+                                       GMarkupParseContext  *context,
+                                       GError              **error);
+
+G_END_DECLS
+
+#endif /* __TRACKER_ZIP_H__ */
@@ -22,6 +22,15 @@
 public class Tracker.Backup : Object {
 	public const string PATH = "/org/freedesktop/Tracker1/Backup";
 
+	static void resume_updates (Resources? resources) {
+		if (resources != null) {
+			Tracker.Events.init ();
+			resources.enable_signals ();
+		}
+
+		Tracker.Store.resume ();
+	}
+
 	public async void save (BusName sender, string destination_uri) throws Error {
 		var resources = (Resources) Tracker.DBus.get_object (typeof (Resources));
 		if (resources != null) {
@@ -29,6 +38,8 @@ public class Tracker.Backup : Object {
 			Tracker.Events.shutdown ();
 		}
 
+		bool resumed = false;
+
 		var request = DBusRequest.begin (sender, "D-Bus request to save backup into '%s'", destination_uri);
 		try {
 			var destination = File.new_for_uri (destination_uri);
@@ -40,10 +51,18 @@ public class Tracker.Backup : Object {
 			yield Tracker.Store.pause ();
 
 			Error backup_error = null;
-			Data.backup_save (destination, error => {
+			bool state_fixed = Data.backup_save (destination, error => {
 				backup_error = error;
 				save.callback ();
 			});
+
+			if (state_fixed) {
+				// Later updates are not part of the backup, no need
+				// to hold them back while it's being copied
+				resume_updates (resources);
+				resumed = true;
+			}
+
 			yield;
 
 			if (backup_error != null) {
@@ -55,12 +74,9 @@ public class Tracker.Backup : Object {
 			request.end (e);
 			throw e;
 		} finally {
-			if (resources != null) {
-				Tracker.Events.init ();
-				resources.enable_signals ();
+			if (!resumed) {
+				resume_updates (resources);
 			}
-
-			Tracker.Store.resume ();
 		}
 	}
 
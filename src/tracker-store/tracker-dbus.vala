@@ -26,6 +26,8 @@ public class Tracker.DBus {
 	static uint name_owner_changed_id;
 	static Tracker.Statistics statistics;
 	static uint statistics_id;
+	static Tracker.Profile profile;
+	static uint profile_id;
 	static Tracker.Resources resources;
 	static uint resources_id;
 	static Tracker.Steroids steroids;
@@ -144,6 +146,12 @@ public class Tracker.DBus {
 			backup_id = 0;
 		}
 
+		if (profile != null) {
+			connection.unregister_object (profile_id);
+			profile = null;
+			profile_id = 0;
+		}
+
 		if (notifier != null) {
 			connection.unregister_object (notifier_id);
 			notifier = null;
@@ -188,6 +196,12 @@ public class Tracker.DBus {
 
 		statistics_id = register_object (connection, statistics, Tracker.Statistics.PATH);
 
+		/* Add org.freedesktop.Tracker1.Profile */
+		if (profile == null) {
+			profile = new Tracker.Profile ();
+			profile_id = register_object (connection, profile, Tracker.Profile.PATH);
+		}
+
 		/* Add org.freedesktop.Tracker1.Resources */
 		resources = new Tracker.Resources (connection, config);
 		if (resources == null) {
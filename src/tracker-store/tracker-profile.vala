@@ -0,0 +1,402 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Per query shape counters for the queries and updates run by the store.
+ * A shape is the SPARQL text with literals and IRIs blanked out, so that
+ * the same query issued with different arguments is accounted together.
+ * Recording is a couple of clock reads and a hash table lookup per task,
+ * cheap enough to be always enabled. WAL checkpoints and the WAL size
+ * are accounted here as well. */
+[DBus (name = "org.freedesktop.Tracker1.Profile")]
+public class Tracker.Profile : Object {
+	public const string PATH = "/org/freedesktop/Tracker1/Profile";
+
+	/* bound memory use when clients generate query text on the fly */
+	const int MAX_SHAPES = 256;
+	const int MAX_SHAPE_LENGTH = 1024;
+	const string OTHER_SHAPE = "(other)";
+
+	/* bucket 0 counts tasks below 1 ms, bucket n tasks below 2^n ms,
+	   the last bucket everything else */
+	const int N_BUCKETS = 16;
+
+	enum Phase {
+		PREPARE,
+		EXECUTE,
+		SERIALIZE,
+		N_PHASES
+	}
+
+	const string[] PHASE_NAMES = { "prepare", "execute", "serialize" };
+
+	class Entry {
+		public string shape;
+		public string sql;
+		public bool update;
+		public uint count;
+		public uint errors;
+		public uint64 rows;
+		public uint64 vm_steps;
+		public int64[] time = new int64[Phase.N_PHASES];
+		public uint[] histogram = new uint[Phase.N_PHASES * N_BUCKETS];
+
+		public int64 get_total_time () {
+			return time[Phase.PREPARE] + time[Phase.EXECUTE] + time[Phase.SERIALIZE];
+		}
+	}
+
+	const string[] CHECKPOINT_MODE_NAMES = { "passive", "full", "restart" };
+
+	class CheckpointEntry {
+		public uint count;
+		public uint64 pages;
+		public int64 time;
+		public int64 max_time;
+		public uint[] histogram = new uint[N_BUCKETS];
+	}
+
+	static Mutex mutex;
+	static HashTable<string,Entry> entries;
+
+	static CheckpointEntry[] checkpoints;
+	static int wal_pages;
+	static int max_wal_pages;
+	static uint deferred_checkpoints;
+
+	static string get_shape (string query) {
+		var shape = new StringBuilder ();
+		bool space = false;
+		int i = 0;
+
+		while (i < query.length && shape.len < MAX_SHAPE_LENGTH) {
+			char c = query[i];
+
+			if (c.isspace ()) {
+				space = true;
+				i++;
+				continue;
+			} else if (c == '#') {
+				// comment
+				while (i < query.length && query[i] != '\n') {
+					i++;
+				}
+				continue;
+			}
+
+			if (space && shape.len > 0) {
+				shape.append_c (' ');
+			}
+			space = false;
+
+			if (c == '"' || c == '\'') {
+				// string literal, short or long form
+				int quotes = (i + 2 < query.length && query[i + 1] == c && query[i + 2] == c) ? 3 : 1;
+
+				i += quotes;
+				while (i < query.length) {
+					if (query[i] == '\\') {
+						i += 2;
+					} else if (query[i] == c &&
+					           (quotes == 1 || (i + 2 < query.length && query[i + 1] == c && query[i + 2] == c))) {
+						i += quotes;
+						break;
+					} else {
+						i++;
+					}
+				}
+
+				shape.append_c ('?');
+			} else if (c.isdigit () && (i == 0 || !(query[i - 1].isalnum () || query[i - 1] == '_' || query[i - 1] == ':'))) {
+				// numeric literal
+				while (i < query.length && (query[i].isalnum () || query[i] == '.')) {
+					i++;
+				}
+
+				shape.append_c ('?');
+			} else if (c == '<') {
+				// IRI reference, anything else is the less than operator
+				int j = i + 1;
+				while (j < query.length && !query[j].isspace () && "<>\"{}|^`\\".index_of_char (query[j]) < 0) {
+					j++;
+				}
+
+				if (j < query.length && query[j] == '>') {
+					shape.append ("<?>");
+					i = j + 1;
+				} else {
+					shape.append_c (c);
+					i++;
+				}
+			} else {
+				shape.append_c (c);
+				i++;
+			}
+		}
+
+		return shape.str;
+	}
+
+	static int get_bucket (int64 usec) {
+		int bucket = 0;
+
+		for (int64 ms = usec / 1000; ms > 0 && bucket < N_BUCKETS - 1; ms >>= 1) {
+			bucket++;
+		}
+
+		return bucket;
+	}
+
+	static unowned Entry lookup_entry (string query, bool update) {
+		string shape = get_shape (query);
+
+		unowned Entry entry = entries.lookup (shape);
+		if (entry == null) {
+			if (entries.size () >= MAX_SHAPES) {
+				shape = OTHER_SHAPE;
+				entry = entries.lookup (shape);
+			}
+
+			if (entry == null) {
+				var new_entry = new Entry ();
+				new_entry.shape = shape;
+				new_entry.update = update;
+				entry = new_entry;
+				entries.insert (shape, (owned) new_entry);
+			}
+		}
+
+		return entry;
+	}
+
+	static void add_time (Entry entry, Phase phase, int64 usec) {
+		entry.time[phase] += usec;
+		entry.histogram[phase * N_BUCKETS + get_bucket (usec)]++;
+	}
+
+	/* Called from the query thread once the task is done. prepare_end is 0
+	   if the query could not be translated. */
+	public static void record_query (string query, DBCursor? cursor, int64 start, int64 prepare_end, bool failed) {
+		int64 end = get_monotonic_time ();
+
+		mutex.lock ();
+
+		if (entries == null) {
+			entries = new HashTable<string,Entry> (str_hash, str_equal);
+		}
+
+		unowned Entry entry = lookup_entry (query, false);
+
+		entry.count++;
+		if (failed) {
+			entry.errors++;
+		}
+
+		if (prepare_end == 0) {
+			add_time (entry, Phase.PREPARE, end - start);
+		} else {
+			int64 step_time = 0;
+
+			add_time (entry, Phase.PREPARE, prepare_end - start);
+
+			if (cursor != null) {
+				step_time = cursor.get_step_time ();
+				entry.rows += cursor.get_n_rows ();
+				entry.vm_steps += cursor.get_vm_steps ();
+
+				if (entry.sql == null && cursor.get_sql () != null) {
+					entry.sql = cursor.get_sql ();
+				}
+			}
+
+			add_time (entry, Phase.EXECUTE, step_time);
+			add_time (entry, Phase.SERIALIZE, end - prepare_end - step_time);
+		}
+
+		mutex.unlock ();
+	}
+
+	/* Called from the update thread once the task is done, updates are
+	   accounted as a single execute phase. */
+	public static void record_update (string query, int64 start, bool failed) {
+		int64 end = get_monotonic_time ();
+
+		mutex.lock ();
+
+		if (entries == null) {
+			entries = new HashTable<string,Entry> (str_hash, str_equal);
+		}
+
+		unowned Entry entry = lookup_entry (query, true);
+
+		entry.count++;
+		if (failed) {
+			entry.errors++;
+		}
+
+		add_time (entry, Phase.EXECUTE, end - start);
+
+		mutex.unlock ();
+	}
+
+	/* Called from the update thread on every commit with the number of
+	   pages in the WAL. */
+	public static void record_wal_size (int n_pages) {
+		mutex.lock ();
+
+		wal_pages = n_pages;
+		if (n_pages > max_wal_pages) {
+			max_wal_pages = n_pages;
+		}
+
+		mutex.unlock ();
+	}
+
+	public static void record_checkpoint_deferred () {
+		mutex.lock ();
+		deferred_checkpoints++;
+		mutex.unlock ();
+	}
+
+	/* Called from the thread running the checkpoint once it's done,
+	   checkpointed is the number of WAL pages copied back. */
+	public static void record_checkpoint (Store.CheckpointMode mode, int log_pages, int checkpointed, int64 start) {
+		int64 usec = get_monotonic_time () - start;
+
+		mutex.lock ();
+
+		if (checkpoints == null) {
+			checkpoints = new CheckpointEntry[Store.CheckpointMode.N_MODES];
+			for (int i = 0; i < Store.CheckpointMode.N_MODES; i++) {
+				checkpoints[i] = new CheckpointEntry ();
+			}
+		}
+
+		unowned CheckpointEntry entry = checkpoints[mode];
+
+		entry.count++;
+		entry.pages += checkpointed;
+		entry.time += usec;
+		entry.histogram[get_bucket (usec)]++;
+		if (usec > entry.max_time) {
+			entry.max_time = usec;
+		}
+
+		mutex.unlock ();
+	}
+
+	static int compare_entries (Entry a, Entry b) {
+		int64 diff = b.get_total_time () - a.get_total_time ();
+
+		return (diff > 0) ? 1 : ((diff < 0) ? -1 : 0);
+	}
+
+	[DBus (signature = "aa{sv}")]
+	public new Variant get (BusName sender) throws GLib.Error {
+		var request = DBusRequest.begin (sender, "Profile.Get");
+		var list = new List<Entry> ();
+
+		mutex.lock ();
+
+		if (entries != null) {
+			foreach (var entry in entries.get_values ()) {
+				list.prepend (entry);
+			}
+		}
+
+		list.sort (compare_entries);
+
+		var builder = new VariantBuilder ((VariantType) "aa{sv}");
+
+		foreach (var entry in list) {
+			builder.open ((VariantType) "a{sv}");
+			builder.add ("{sv}", "shape", new Variant.string (entry.shape));
+			if (entry.sql != null) {
+				builder.add ("{sv}", "sql", new Variant.string (entry.sql));
+			}
+			builder.add ("{sv}", "update", new Variant.boolean (entry.update));
+			builder.add ("{sv}", "count", new Variant.uint32 (entry.count));
+			builder.add ("{sv}", "errors", new Variant.uint32 (entry.errors));
+			builder.add ("{sv}", "rows", new Variant.uint64 (entry.rows));
+			builder.add ("{sv}", "vm-steps", new Variant.uint64 (entry.vm_steps));
+
+			for (int phase = 0; phase < Phase.N_PHASES; phase++) {
+				builder.add ("{sv}", "%s-time".printf (PHASE_NAMES[phase]), new Variant.int64 (entry.time[phase]));
+
+				var histogram = new VariantBuilder ((VariantType) "au");
+				for (int i = 0; i < N_BUCKETS; i++) {
+					histogram.add ("u", entry.histogram[phase * N_BUCKETS + i]);
+				}
+				builder.add ("{sv}", "%s-histogram".printf (PHASE_NAMES[phase]), histogram.end ());
+			}
+
+			builder.close ();
+		}
+
+		mutex.unlock ();
+
+		request.end ();
+
+		return builder.end ();
+	}
+
+	[DBus (signature = "a{sv}")]
+	public Variant get_checkpoints (BusName sender) throws GLib.Error {
+		var request = DBusRequest.begin (sender, "Profile.GetCheckpoints");
+		var builder = new VariantBuilder ((VariantType) "a{sv}");
+
+		mutex.lock ();
+
+		builder.add ("{sv}", "wal-pages", new Variant.int32 (wal_pages));
+		builder.add ("{sv}", "max-wal-pages", new Variant.int32 (max_wal_pages));
+		builder.add ("{sv}", "deferred", new Variant.uint32 (deferred_checkpoints));
+
+		for (int mode = 0; checkpoints != null && mode < Store.CheckpointMode.N_MODES; mode++) {
+			unowned CheckpointEntry entry = checkpoints[mode];
+			unowned string name = CHECKPOINT_MODE_NAMES[mode];
+
+			builder.add ("{sv}", "%s-count".printf (name), new Variant.uint32 (entry.count));
+			builder.add ("{sv}", "%s-pages".printf (name), new Variant.uint64 (entry.pages));
+			builder.add ("{sv}", "%s-time".printf (name), new Variant.int64 (entry.time));
+			builder.add ("{sv}", "%s-max-time".printf (name), new Variant.int64 (entry.max_time));
+
+			var histogram = new VariantBuilder ((VariantType) "au");
+			for (int i = 0; i < N_BUCKETS; i++) {
+				histogram.add ("u", entry.histogram[i]);
+			}
+			builder.add ("{sv}", "%s-histogram".printf (name), histogram.end ());
+		}
+
+		mutex.unlock ();
+
+		request.end ();
+
+		return builder.end ();
+	}
+
+	public void reset (BusName sender) throws GLib.Error {
+		var request = DBusRequest.begin (sender, "Profile.Reset");
+
+		mutex.lock ();
+		entries = null;
+		checkpoints = null;
+		max_wal_pages = wal_pages;
+		deferred_checkpoints = 0;
+		mutex.unlock ();
+
+		request.end ();
+	}
+}
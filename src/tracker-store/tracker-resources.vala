@@ -200,6 +200,42 @@ public class Tracker.Resources : Object {
 		/* no longer needed, just return */
 	}
 
+	public async void update_uri_prefix (BusName sender, string old_prefix, string new_prefix, string update) throws Error {
+		var request = DBusRequest.begin (sender, "Resources.UpdateUriPrefix (old_prefix: '%s', new_prefix: '%s')", old_prefix, new_prefix);
+		try {
+			yield Tracker.Store.update_uri_prefix (old_prefix, new_prefix, update != "" ? update : null, Tracker.Store.Priority.HIGH, sender);
+
+			request.end ();
+		} catch (DBInterfaceError.NO_SPACE ie) {
+			throw new Sparql.Error.NO_SPACE (ie.message);
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
+
+	public async void delete_descendants (BusName sender, string url) throws Error {
+		var request = DBusRequest.begin (sender, "Resources.DeleteDescendants (url: '%s')", url);
+		try {
+			yield Tracker.Store.delete_descendants (url, Tracker.Store.Priority.HIGH, sender);
+
+			request.end ();
+		} catch (DBInterfaceError.NO_SPACE ie) {
+			throw new Sparql.Error.NO_SPACE (ie.message);
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
+
 	bool emit_graph_updated (Class cl) {
 		if (cl.has_insert_events () || cl.has_delete_events ()) {
 			var builder = new VariantBuilder ((VariantType) "a(iiii)");
@@ -24,11 +24,18 @@ public class Tracker.Steroids : Object {
 
 	public const int BUFFER_SIZE = 65536;
 
-	public async string[] query (BusName sender, string query, UnixOutputStream output_stream) throws Error {
-		var request = DBusRequest.begin (sender, "Steroids.Query");
+	async string[] query_internal (BusName sender, string query, uint timeout, UnixOutputStream output_stream) throws Error {
+		var request = DBusRequest.begin (sender,
+			"Steroids.Query%s",
+			timeout > 0 ? "WithTimeout" : "");
 		request.debug ("query: %s", query);
 		try {
 			string[] variable_names = null;
+			int64 deadline = 0;
+
+			if (timeout > 0) {
+				deadline = get_monotonic_time () + (int64) timeout * 1000;
+			}
 
 			yield Tracker.Store.sparql_query (query, Tracker.Store.Priority.HIGH, cursor => {
 				var data_output_stream = new DataOutputStream (new BufferedOutputStream.sized (output_stream, BUFFER_SIZE));
@@ -74,7 +81,7 @@ public class Tracker.Steroids : Object {
 						data_output_stream.put_byte (0);
 					}
 				}
-			}, sender);
+			}, sender, deadline);
 
 			request.end ();
 
@@ -89,6 +96,16 @@ public class Tracker.Steroids : Object {
 		}
 	}
 
+	public async string[] query (BusName sender, string query, UnixOutputStream output_stream) throws Error {
+		return yield query_internal (sender, query, 0, output_stream);
+	}
+
+	/* Like Query, the query is dropped if it can't be started within
+	   timeout milliseconds, and cancelled if it's still running then. */
+	public async string[] query_with_timeout (BusName sender, string query, uint timeout, UnixOutputStream output_stream) throws Error {
+		return yield query_internal (sender, query, timeout, output_stream);
+	}
+
 	async Variant? update_internal (BusName sender, Tracker.Store.Priority priority, bool blank, UnixInputStream input_stream) throws Error {
 		var request = DBusRequest.begin (sender,
 			"Steroids.%sUpdate%s",
@@ -155,6 +172,101 @@ public class Tracker.Steroids : Object {
 		return yield update_internal (sender, Tracker.Store.Priority.LOW, true, input_stream);
 	}
 
+	async void update_uri_prefix_internal (BusName sender, Tracker.Store.Priority priority, UnixInputStream input_stream) throws Error {
+		var request = DBusRequest.begin (sender,
+			"Steroids.%sUpdateUriPrefix",
+			priority != Tracker.Store.Priority.HIGH ? "Batch" : "");
+		try {
+			var data_input_stream = new DataInputStream (input_stream);
+			data_input_stream.set_buffer_size (BUFFER_SIZE);
+			data_input_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+
+			// old prefix, new prefix and the update run along, if any
+			string[] strings = new string[3];
+
+			for (int i = 0; i < 3; i++) {
+				size_t bytes_read;
+
+				int string_size = data_input_stream.read_int32 ();
+
+				/* We malloc one more char to ensure string is 0 terminated */
+				strings[i] = (string) new uint8[string_size + 1];
+
+				data_input_stream.read_all (((uint8[]) strings[i])[0:string_size], out bytes_read);
+			}
+
+			data_input_stream = null;
+
+			request.debug ("old prefix: %s, new prefix: %s", strings[0], strings[1]);
+
+			yield Tracker.Store.update_uri_prefix (strings[0], strings[1], strings[2] != "" ? strings[2] : null, priority, sender);
+
+			request.end ();
+		} catch (DBInterfaceError.NO_SPACE ie) {
+			throw new Sparql.Error.NO_SPACE (ie.message);
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
+
+	public async void update_uri_prefix (BusName sender, UnixInputStream input_stream) throws Error {
+		yield update_uri_prefix_internal (sender, Tracker.Store.Priority.HIGH, input_stream);
+	}
+
+	public async void batch_update_uri_prefix (BusName sender, UnixInputStream input_stream) throws Error {
+		yield update_uri_prefix_internal (sender, Tracker.Store.Priority.LOW, input_stream);
+	}
+
+	async void delete_descendants_internal (BusName sender, Tracker.Store.Priority priority, UnixInputStream input_stream) throws Error {
+		var request = DBusRequest.begin (sender,
+			"Steroids.%sDeleteDescendants",
+			priority != Tracker.Store.Priority.HIGH ? "Batch" : "");
+		try {
+			size_t bytes_read;
+
+			var data_input_stream = new DataInputStream (input_stream);
+			data_input_stream.set_buffer_size (BUFFER_SIZE);
+			data_input_stream.set_byte_order (DataStreamByteOrder.HOST_ENDIAN);
+
+			int url_size = data_input_stream.read_int32 ();
+
+			/* We malloc one more char to ensure string is 0 terminated */
+			string url = (string) new uint8[url_size + 1];
+
+			data_input_stream.read_all (((uint8[]) url)[0:url_size], out bytes_read);
+
+			data_input_stream = null;
+
+			request.debug ("url: %s", url);
+
+			yield Tracker.Store.delete_descendants (url, priority, sender);
+
+			request.end ();
+		} catch (DBInterfaceError.NO_SPACE ie) {
+			throw new Sparql.Error.NO_SPACE (ie.message);
+		} catch (Error e) {
+			request.end (e);
+			if (e is Sparql.Error) {
+				throw e;
+			} else {
+				throw new Sparql.Error.INTERNAL (e.message);
+			}
+		}
+	}
+
+	public async void delete_descendants (BusName sender, UnixInputStream input_stream) throws Error {
+		yield delete_descendants_internal (sender, Tracker.Store.Priority.HIGH, input_stream);
+	}
+
+	public async void batch_delete_descendants (BusName sender, UnixInputStream input_stream) throws Error {
+		yield delete_descendants_internal (sender, Tracker.Store.Priority.LOW, input_stream);
+	}
+
 	[DBus (signature = "as")]
 	public async Variant update_array (BusName sender, UnixInputStream input_stream) throws Error {
 		var request = DBusRequest.begin (sender, "Steroids.UpdateArray");
@@ -24,6 +24,22 @@ public class Tracker.Store {
 
 	const int MAX_TASK_TIME = 30;
 
+	/* WAL checkpointing policy, in WAL pages. Passive checkpoints never
+	   block readers or writers, they run whenever the store goes idle and
+	   once the WAL grows past PASSIVE_CHECKPOINT_PAGES, unless all query
+	   threads are busy. Only a larger WAL escalates to full checkpoints,
+	   waiting for readers to finish so the whole WAL gets copied back,
+	   and then to restart checkpoints, blocking updates until the WAL
+	   can be reused from the start. Both wait for CHECKPOINT_TIMEOUT ms
+	   at most, as readers may be held for long, e.g. by a backup; if
+	   that wasn't enough, the WAL must grow by as much again before
+	   they are retried. */
+	const int IDLE_CHECKPOINT_PAGES = 100;
+	const int PASSIVE_CHECKPOINT_PAGES = 1000;
+	const int FULL_CHECKPOINT_PAGES = 5000;
+	const int RESTART_CHECKPOINT_PAGES = 10000;
+	const int CHECKPOINT_TIMEOUT = 500;
+
 	static Queue<Task> query_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
 	static Queue<Task> update_queues[3 /* TRACKER_STORE_N_PRIORITIES */];
 	static int n_queries_running;
@@ -43,11 +59,22 @@ public class Tracker.Store {
 		N_PRIORITIES
 	}
 
+	public enum CheckpointMode {
+		PASSIVE,
+		FULL,
+		RESTART,
+		N_MODES
+	}
+
+	const string[] CHECKPOINT_MODE_NAMES = { "PASSIVE", "FULL", "RESTART" };
+
 	enum TaskType {
 		QUERY,
 		UPDATE,
 		UPDATE_BLANK,
 		TURTLE,
+		URI_PREFIX,
+		DELETE_DESCENDANTS,
 	}
 
 	public delegate void SparqlQueryInThread (DBCursor cursor) throws Error;
@@ -63,12 +90,22 @@ public class Tracker.Store {
 		public string query;
 		public Cancellable cancellable;
 		public uint watchdog_id;
+		public int64 deadline;
+		public uint deadline_id;
 		public unowned SparqlQueryInThread in_thread;
 
 		~QueryTask () {
 			if (watchdog_id > 0) {
 				Source.remove (watchdog_id);
 			}
+			clear_deadline ();
+		}
+
+		public void clear_deadline () {
+			if (deadline_id > 0) {
+				Source.remove (deadline_id);
+				deadline_id = 0;
+			}
 		}
 	}
 
@@ -82,6 +119,72 @@ public class Tracker.Store {
 		public string path;
 	}
 
+	class BulkTask : Task {
+		public Priority priority;
+	}
+
+	class UriPrefixTask : BulkTask {
+		public string old_prefix;
+		public string new_prefix;
+		public string? update;
+	}
+
+	class DeleteDescendantsTask : BulkTask {
+		public string url;
+	}
+
+	static int n_running_for_client (string client_id) {
+		int n = 0;
+
+		for (int i = 0; i < running_tasks.length; i++) {
+			if (running_tasks[i].client_id == client_id) {
+				n++;
+			}
+		}
+
+		return n;
+	}
+
+	static Task? pop_fair (Queue<Task> queue) {
+		int best = -1, best_running = int.MAX, i = 0;
+
+		// within a priority, serve first the client with the fewest
+		// queries running, so a burst from one client does not starve
+		// the others; FIFO among clients with the same number
+		for (unowned List<Task> l = queue.head; l != null; l = l.next, i++) {
+			int running = n_running_for_client (l.data.client_id);
+
+			if (running < best_running) {
+				best = i;
+				best_running = running;
+
+				if (running == 0) {
+					break;
+				}
+			}
+		}
+
+		if (best < 0) {
+			return null;
+		}
+
+		return queue.pop_nth (best);
+	}
+
+	static void expire_task (QueryTask task) {
+		for (int i = 0; i < Priority.N_PRIORITIES; i++) {
+			int index = query_queues[i].index (task);
+
+			if (index >= 0) {
+				query_queues[i].pop_nth (index);
+
+				task.error = new DBusError.TIMED_OUT ("Query could not be started before its deadline");
+				task.callback ();
+				return;
+			}
+		}
+	}
+
 	static void sched () {
 		Task task = null;
 
@@ -91,7 +194,7 @@ public class Tracker.Store {
 
 		while (n_queries_running < MAX_CONCURRENT_QUERIES) {
 			for (int i = 0; i < Priority.N_PRIORITIES; i++) {
-				task = query_queues[i].pop_head ();
+				task = pop_fair (query_queues[i]);
 				if (task != null) {
 					break;
 				}
@@ -102,15 +205,27 @@ public class Tracker.Store {
 			}
 			running_tasks.add (task);
 
-			if (max_task_time != 0) {
-				var query_task = (QueryTask) task;
+			var query_task = (QueryTask) task;
+			query_task.clear_deadline ();
+
+			if (query_task.deadline > 0) {
+				// cancel at the deadline, or after the maximum task time if sooner
+				int64 timeout = (query_task.deadline - get_monotonic_time ()) / 1000;
+				if (max_task_time != 0) {
+					timeout = int64.min (timeout, max_task_time * 1000);
+				}
+				query_task.watchdog_id = Timeout.add ((uint) int64.max (timeout, 0), () => {
+					query_task.cancellable.cancel ();
+					return false;
+				});
+			} else if (max_task_time != 0) {
 				query_task.watchdog_id = Timeout.add_seconds (max_task_time, () => {
 					query_task.cancellable.cancel ();
 					return false;
 				});
 			}
 
-			n_queries_running++;
+			AtomicInt.inc (ref n_queries_running);
 			try {
 				query_pool.push (task);
 			} catch (Error e) {
@@ -147,6 +262,15 @@ public class Tracker.Store {
 				} else {
 					return Tracker.Data.CommitType.BATCH_LAST;
 				}
+			case TaskType.URI_PREFIX:
+			case TaskType.DELETE_DESCENDANTS:
+				if (((BulkTask) task).priority == Priority.HIGH) {
+					return Tracker.Data.CommitType.REGULAR;
+				} else if (update_queues[Priority.LOW].get_length () > 0) {
+					return Tracker.Data.CommitType.BATCH;
+				} else {
+					return Tracker.Data.CommitType.BATCH_LAST;
+				}
 			case TaskType.TURTLE:
 				if (update_queues[Priority.TURTLE].get_length () > 0) {
 					return Tracker.Data.CommitType.BATCH;
@@ -175,8 +299,9 @@ public class Tracker.Store {
 			task.error = null;
 
 			running_tasks.remove (task);
-			n_queries_running--;
-		} else if (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK) {
+			AtomicInt.add (ref n_queries_running, -1);
+		} else if (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK || task.type == TaskType.URI_PREFIX ||
+		           task.type == TaskType.DELETE_DESCENDANTS) {
 			if (task.error == null) {
 				Tracker.Data.notify_transaction (commit_type (task));
 			}
@@ -196,8 +321,21 @@ public class Tracker.Store {
 			update_running = false;
 		}
 
-		if (n_queries_running == 0 && !update_running && active_callback != null) {
-			active_callback ();
+		if (n_queries_running == 0 && !update_running) {
+			if (active_callback != null) {
+				active_callback ();
+			} else {
+				if (Tracker.Data.statistics_outdated ()) {
+					// write the planner statistics of the class counts
+					// changed by all updates since the last time
+					Tracker.Data.update_statistics ();
+				}
+
+				if (AtomicInt.get (ref wal_pages) >= IDLE_CHECKPOINT_PAGES) {
+					// nothing else to do, copy the WAL back meanwhile
+					request_checkpoint (CheckpointMode.PASSIVE);
+				}
+			}
 		}
 
 		sched ();
@@ -206,11 +344,16 @@ public class Tracker.Store {
 	}
 
 	static void pool_dispatch_cb (Task task) {
+		int64 start = get_monotonic_time ();
+		int64 prepare_end = 0;
+		DBCursor cursor = null;
+
 		try {
 			if (task.type == TaskType.QUERY) {
 				var query_task = (QueryTask) task;
 
-				var cursor = Tracker.Data.query_sparql_cursor (query_task.query);
+				cursor = Tracker.Data.query_sparql_cursor (query_task.query);
+				prepare_end = get_monotonic_time ();
 
 				query_task.in_thread (cursor);
 			} else {
@@ -225,6 +368,14 @@ public class Tracker.Store {
 					var update_task = (UpdateTask) task;
 
 					update_task.blank_nodes = Tracker.Data.update_sparql_blank (update_task.query);
+				} else if (task.type == TaskType.URI_PREFIX) {
+					var uri_prefix_task = (UriPrefixTask) task;
+
+					Tracker.Data.update_uri_prefix (uri_prefix_task.old_prefix, uri_prefix_task.new_prefix, uri_prefix_task.update);
+				} else if (task.type == TaskType.DELETE_DESCENDANTS) {
+					var delete_task = (DeleteDescendantsTask) task;
+
+					Tracker.Data.delete_descendants (delete_task.url);
 				} else if (task.type == TaskType.TURTLE) {
 					var turtle_task = (TurtleTask) task;
 
@@ -242,43 +393,91 @@ public class Tracker.Store {
 			task.error = e;
 		}
 
+		if (task.type == TaskType.QUERY) {
+			Profile.record_query (((QueryTask) task).query, cursor, start, prepare_end, task.error != null);
+		} else if (task.type == TaskType.UPDATE || task.type == TaskType.UPDATE_BLANK) {
+			Profile.record_update (((UpdateTask) task).query, start, task.error != null);
+		}
+
 		Idle.add (() => {
 			task_finish_cb (task);
 			return false;
 		});
 	}
 
-	public static void wal_checkpoint () {
+	public static void wal_checkpoint (CheckpointMode mode = CheckpointMode.PASSIVE) {
+		int64 start = get_monotonic_time ();
+		int log_pages = 0, checkpointed = 0;
+
 		try {
-			debug ("Checkpointing database...");
+			debug ("Checkpointing database (%s)...", CHECKPOINT_MODE_NAMES[mode]);
 			var iface = DBManager.get_db_interface ();
-			iface.execute_query ("PRAGMA wal_checkpoint");
-			debug ("Checkpointing complete...");
+			bool complete = iface.sqlite_wal_checkpoint ((DBCheckpointMode) mode, CHECKPOINT_TIMEOUT,
+			                                             out log_pages, out checkpointed);
+
+			if (complete && checkpointed == log_pages) {
+				// the WAL will be reused from the start on the next commit
+				AtomicInt.set (ref wal_pages, 0);
+			} else if (!complete && mode != CheckpointMode.PASSIVE) {
+				// readers are still there, don't wait on them again soon
+				AtomicInt.set (ref escalation_pages, log_pages);
+			}
+
+			debug ("Checkpointing complete, %d of %d pages copied back...", checkpointed, log_pages);
 		} catch (Error e) {
 			warning (e.message);
 		}
+
+		Profile.record_checkpoint (mode, log_pages, checkpointed, start);
 	}
 
 	static int checkpointing;
+	static int checkpoint_mode;
+	static int wal_pages;
+	// WAL size at the last escalated checkpoint that couldn't complete
+	static int escalation_pages;
+
+	static void request_checkpoint (CheckpointMode mode) {
+		if (AtomicInt.compare_and_exchange (ref checkpointing, 0, 1)) {
+			// initiate asynchronous checkpointing (not blocking updates)
+			AtomicInt.set (ref checkpoint_mode, mode);
+			try {
+				checkpoint_pool.push (true);
+			} catch (Error e) {
+				warning (e.message);
+				AtomicInt.set (ref checkpointing, 0);
+			}
+		}
+	}
 
 	static void wal_hook (int n_pages) {
 		// run in update thread
 
 		debug ("WAL: %d pages", n_pages);
 
-		if (n_pages >= 10000) {
+		AtomicInt.set (ref wal_pages, n_pages);
+		Profile.record_wal_size (n_pages);
+
+		int escalated = AtomicInt.get (ref escalation_pages);
+		if (n_pages < escalated) {
+			// the WAL was reused from the start since
+			AtomicInt.compare_and_exchange (ref escalation_pages, escalated, 0);
+			escalated = 0;
+		}
+
+		if (n_pages - escalated >= RESTART_CHECKPOINT_PAGES) {
 			// do immediate checkpointing (blocking updates)
 			// to prevent excessive wal file growth
-			wal_checkpoint ();
-		} else if (n_pages >= 1000) {
-			if (AtomicInt.compare_and_exchange (ref checkpointing, 0, 1)) {
-				// initiate asynchronous checkpointing (not blocking updates)
-				try {
-					checkpoint_pool.push (true);
-				} catch (Error e) {
-					warning (e.message);
-					AtomicInt.set (ref checkpointing, 0);
-				}
+			wal_checkpoint (CheckpointMode.RESTART);
+		} else if (n_pages - escalated >= FULL_CHECKPOINT_PAGES) {
+			request_checkpoint (CheckpointMode.FULL);
+		} else if (n_pages >= PASSIVE_CHECKPOINT_PAGES) {
+			if (AtomicInt.get (ref n_queries_running) >= MAX_CONCURRENT_QUERIES) {
+				// queries would compete with the checkpoint for I/O,
+				// retry on the next commit or once the store is idle
+				Profile.record_checkpoint_deferred ();
+			} else {
+				request_checkpoint (CheckpointMode.PASSIVE);
 			}
 		}
 	}
@@ -286,7 +485,7 @@ public class Tracker.Store {
 	static void checkpoint_dispatch_cb (bool task) {
 		// run in checkpoint thread
 
-		wal_checkpoint ();
+		wal_checkpoint ((CheckpointMode) AtomicInt.get (ref checkpoint_mode));
 		AtomicInt.set (ref checkpointing, 0);
 	}
 
@@ -331,7 +530,9 @@ public class Tracker.Store {
 		}
 	}
 
-	public static async void sparql_query (string sparql, Priority priority, SparqlQueryInThread in_thread, string client_id) throws Error {
+	/* deadline is in monotonic time, 0 for none. Queries still queued
+	   at their deadline are dropped, running ones are cancelled. */
+	public static async void sparql_query (string sparql, Priority priority, SparqlQueryInThread in_thread, string client_id, int64 deadline = 0) throws Error {
 		var task = new QueryTask ();
 		task.type = TaskType.QUERY;
 		task.query = sparql;
@@ -339,6 +540,16 @@ public class Tracker.Store {
 		task.in_thread = in_thread;
 		task.callback = sparql_query.callback;
 		task.client_id = client_id;
+		task.deadline = deadline;
+
+		if (deadline > 0) {
+			int64 timeout = (deadline - get_monotonic_time ()) / 1000;
+			task.deadline_id = Timeout.add ((uint) int64.max (timeout, 0), () => {
+				task.deadline_id = 0;
+				expire_task (task);
+				return false;
+			});
+		}
 
 		query_queues[priority].push_tail (task);
 
@@ -391,6 +602,46 @@ public class Tracker.Store {
 		return task.blank_nodes;
 	}
 
+	public static async void update_uri_prefix (string old_prefix, string new_prefix, string? update, Priority priority, string client_id) throws Error {
+		var task = new UriPrefixTask ();
+		task.type = TaskType.URI_PREFIX;
+		task.old_prefix = old_prefix;
+		task.new_prefix = new_prefix;
+		task.update = update;
+		task.priority = priority;
+		task.callback = update_uri_prefix.callback;
+		task.client_id = client_id;
+
+		update_queues[priority].push_tail (task);
+
+		sched ();
+
+		yield;
+
+		if (task.error != null) {
+			throw task.error;
+		}
+	}
+
+	public static async void delete_descendants (string url, Priority priority, string client_id) throws Error {
+		var task = new DeleteDescendantsTask ();
+		task.type = TaskType.DELETE_DESCENDANTS;
+		task.url = url;
+		task.priority = priority;
+		task.callback = delete_descendants.callback;
+		task.client_id = client_id;
+
+		update_queues[priority].push_tail (task);
+
+		sched ();
+
+		yield;
+
+		if (task.error != null) {
+			throw task.error;
+		}
+	}
+
 	public static async void queue_turtle_import (File file, string client_id) throws Error {
 		var task = new TurtleTask ();
 		task.type = TaskType.TURTLE;
@@ -441,6 +692,7 @@ public class Tracker.Store {
 				if (task != null && task.client_id == client_id) {
 					queue.delete_link (cur);
 
+					((QueryTask) task).clear_deadline ();
 					task.error = new DBusError.FAILED ("Client disappeared");
 					task.callback ();
 				}
@@ -0,0 +1,110 @@
+#!/usr/bin/python
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+"""
+Check that queued queries are shared fairly between clients: a burst of
+queries from one client doesn't hold back the query of another one.
+"""
+import dbus
+import gobject
+from dbus.mainloop.glib import DBusGMainLoop
+
+from common.utils import configuration as cfg
+import unittest2 as ut
+from common.utils.storetest import CommonTrackerStoreTest as CommonTrackerStoreTest
+
+AMOUNT_OF_ALBUMS = 200
+AMOUNT_OF_BURST_QUERIES = 8
+
+# Takes long enough for the whole burst to be queued meanwhile
+SLOW_QUERY = "SELECT COUNT (?a) WHERE { ?a a nmm:MusicAlbum . ?b a nmm:MusicAlbum . ?c a nmm:MusicAlbum }"
+FAST_QUERY = "SELECT ?a WHERE { ?a a nmm:MusicAlbum } LIMIT 1"
+
+class TestQueryFairness (CommonTrackerStoreTest):
+
+    def setUp (self):
+        self.main_loop = gobject.MainLoop ()
+        self.replies = []
+        self.errors = []
+
+        query = "INSERT {\n"
+        for i in range (0, AMOUNT_OF_ALBUMS):
+            query += "<test-18:album-%d> a nmm:MusicAlbum .\n" % (i)
+        query += "}"
+        self.tracker.update (query)
+
+    def tearDown (self):
+        query = "DELETE {\n"
+        for i in range (0, AMOUNT_OF_ALBUMS):
+            query += "<test-18:album-%d> a rdfs:Resource .\n" % (i)
+        query += "}"
+        self.tracker.update (query)
+
+    def get_client (self):
+        """
+        Each private connection has its own unique name, the store sees
+        it as a separate client
+        """
+        bus = dbus.SessionBus (mainloop=DBusGMainLoop (), private=True)
+        tracker = bus.get_object (cfg.TRACKER_BUSNAME, cfg.TRACKER_OBJ_PATH)
+        return dbus.Interface (tracker, dbus_interface=cfg.RESOURCES_IFACE)
+
+    def send_query (self, client, query, name):
+        client.SparqlQuery (query,
+                            reply_handler=lambda results: self.reply_cb (name),
+                            error_handler=self.error_cb,
+                            timeout=60)
+
+    def reply_cb (self, name):
+        self.replies.append (name)
+        if len (self.replies) == AMOUNT_OF_BURST_QUERIES + 1:
+            self.main_loop.quit ()
+
+    def error_cb (self, error):
+        self.errors.append (error)
+        self.main_loop.quit ()
+
+    def timeout_cb (self):
+        self.timeout_id = 0
+        self.main_loop.quit ()
+        return False
+
+    def test_query_fairness_01_burst (self):
+        busy_client = self.get_client ()
+        other_client = self.get_client ()
+
+        for i in range (0, AMOUNT_OF_BURST_QUERIES):
+            self.send_query (busy_client, SLOW_QUERY, "burst")
+
+        self.send_query (other_client, FAST_QUERY, "other")
+
+        self.timeout_id = gobject.timeout_add_seconds (120, self.timeout_cb)
+        self.main_loop.run ()
+
+        if self.timeout_id:
+            gobject.source_remove (self.timeout_id)
+
+        self.assertEquals (self.errors, [])
+        self.assertEquals (len (self.replies), AMOUNT_OF_BURST_QUERIES + 1)
+
+        # Two queries run at once, the other client goes next as
+        # soon as one of the burst finishes, not after all of them
+        self.assertLess (self.replies.index ("other"), AMOUNT_OF_BURST_QUERIES / 2)
+
+
+if __name__ == "__main__":
+    ut.main ()
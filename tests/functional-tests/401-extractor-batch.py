@@ -0,0 +1,103 @@
+#!/usr/bin/python
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+"""
+Check GetMetadataBatch: every item of a batch gets exactly one result
+written to the pipe, failed items don't hold back the others, and the
+call only returns once all of them are done.
+"""
+from common.utils import configuration as cfg
+from common.utils.helpers import ExtractorHelper
+import unittest2 as ut
+import os
+
+STATUS_OK = 0
+STATUS_ERROR = 1
+
+if os.path.exists (os.path.join (os.getcwd (), "test-extraction-data")):
+    # Use local directory if available
+    TEST_DATA_PATH = os.path.join (os.getcwd (), "test-extraction-data")
+else:
+    TEST_DATA_PATH = os.path.join (cfg.DATADIR, "tracker-tests",
+                                   "test-extraction-data")
+
+def test_file_uri (name):
+    return "file://" + os.path.join (TEST_DATA_PATH, name)
+
+
+class ExtractorBatchTest (ut.TestCase):
+
+    def setUp (self):
+        self.extractor = ExtractorHelper ()
+        self.extractor.start ()
+
+    def tearDown (self):
+        self.extractor.stop ()
+
+    def test_batch_01_results (self):
+        files = [(test_file_uri ("images/test-image-1.jpg"), "image/jpeg"),
+                 (test_file_uri ("images/roi.jpg"), "image/jpeg"),
+                 (test_file_uri ("images/test-iptcdata-records.jpg"), "image/jpeg")]
+
+        results = self.extractor.get_metadata_batch (files)
+
+        self.assertEquals (sorted (results.keys ()), range (len (files)))
+
+        for item_id in results:
+            status, strings = results[item_id]
+            self.assertEquals (status, STATUS_OK)
+            self.assertEquals (len (strings), 4)
+            self.assertIn ("nfo:Image", strings[2])
+
+    def test_batch_02_errors (self):
+        """
+        Items failing to extract get an error record, the other ones
+        are extracted as usual
+        """
+        files = [(test_file_uri ("images/test-image-1.jpg"), "image/jpeg"),
+                 (test_file_uri ("images/does-not-exist.jpg"), ""),
+                 (test_file_uri ("images/roi.jpg"), "image/jpeg"),
+                 (test_file_uri ("images/does-not-exist-either"), "")]
+
+        results = self.extractor.get_metadata_batch (files)
+
+        self.assertEquals (sorted (results.keys ()), range (len (files)))
+
+        for item_id in [0, 2]:
+            self.assertEquals (results[item_id][0], STATUS_OK)
+
+        for item_id in [1, 3]:
+            status, strings = results[item_id]
+            self.assertEquals (status, STATUS_ERROR)
+            self.assertEquals (len (strings), 1)
+
+    def test_batch_03_large (self):
+        """
+        A batch larger than what is extracted at once, the items
+        waiting in the queue don't trip the per item watchdog
+        """
+        files = [(test_file_uri ("images/test-image-1.jpg"), "image/jpeg")] * 64
+
+        results = self.extractor.get_metadata_batch (files)
+
+        self.assertEquals (len (results), len (files))
+        for status, strings in results.values ():
+            self.assertEquals (status, STATUS_OK)
+
+
+if __name__ == "__main__":
+    ut.main ()
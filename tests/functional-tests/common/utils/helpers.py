@@ -23,7 +23,9 @@ import gobject
 import commands
 import os
 import signal
+import struct
 import subprocess
+import threading
 import time
 from dbus.mainloop.glib import DBusGMainLoop
 import re
@@ -420,7 +422,54 @@ class ExtractorHelper (Helper):
             return metadata
         except dbus.DBusException, e:
             raise NoMetadataException ()
-            
+
+    def get_metadata_batch (self, files):
+        """
+        Calls GetMetadataBatch for a list of (uri, mime) pairs, the id of
+        each item being its position in the list. Returns a dictionary of
+        id -> (status, strings), as written by the extractor to the pipe:
+        status is 0 and the strings are the preupdate, postupdate,
+        statements and where parts (or none if nothing was extracted), or
+        status is 1 and the only string is the error message.
+        """
+        items = dbus.Array ([(dbus.UInt32 (i), uri, mime, "")
+                             for i, (uri, mime) in enumerate (files)],
+                            signature = "(usss)")
+        read_fd, write_fd = os.pipe ()
+        chunks = []
+
+        # Results are written while the call runs, read them meanwhile
+        # so the extractor never blocks on a full pipe
+        def read_all ():
+            while True:
+                chunk = os.read (read_fd, 65536)
+                if not chunk:
+                    break
+                chunks.append (chunk)
+
+        reader = threading.Thread (target = read_all)
+        reader.start ()
+
+        try:
+            self.extractor.GetMetadataBatch (items, dbus.types.UnixFd (write_fd),
+                                             timeout = REASONABLE_TIMEOUT * len (files))
+        finally:
+            os.close (write_fd)
+            reader.join ()
+            os.close (read_fd)
+
+        data = "".join (chunks)
+        results = {}
+        offset = 0
+
+        while offset < len (data):
+            item_id, status, length = struct.unpack_from ("=III", data, offset)
+            offset += struct.calcsize ("=III")
+            results[item_id] = (status, data[offset:offset + length].split ("\0")[:-1])
+            offset += length
+
+        return results
+
     def __process_lines (self, embedded):
         """
         Translate each line in a "prop value" string, handling anonymous nodes.
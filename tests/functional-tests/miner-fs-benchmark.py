@@ -0,0 +1,439 @@
+#!/usr/bin/env python
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+#
+"""
+Measure tracker-miner-fs throughput on a generated directory tree.
+
+The tree is indexed in a sandbox (see utils/sandbox/tracker-sandbox.py),
+with its own D-Bus session, configuration and databases, by running
+tracker-miner-fs once per scenario:
+
+  initial   first crawl of the tree, on an empty index
+  recrawl   crawl again without changes
+  modify    crawl after modifying a fraction of the files
+  move      rename every top level directory while the miner runs
+
+For each scenario the files/s rate is reported together with the time
+spent per stage, as reported by the miner (crawling, querying the store
+for the known files, notifying and processing them) and by the store
+profile (committing updates and checkpointing the WAL).
+
+Modifications are found by mtime checks on the next crawl, like after a
+restart, as monitors are disabled in the sandbox. They are enabled for
+moves, which are only handled as such when seen by a monitor: the miner
+is started as a daemon, the directories are renamed once it's done
+crawling, and the time until the store has all the new URLs is
+measured. The miner only reports its stages for its first crawl, so
+only the store ones are given for moves.
+
+Usage:
+  miner-fs-benchmark.py --files 10000 --mix txt:50,html:30,png:20
+"""
+
+import ConfigParser
+import dbus
+import imp
+import optparse
+import os
+import random
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import urllib
+import zlib
+
+DEFAULT_SANDBOX = os.path.join (os.path.dirname (os.path.abspath (__file__)),
+                                "..", "..", "utils", "sandbox", "tracker-sandbox.py")
+
+TRACKER_BUSNAME = "org.freedesktop.Tracker1"
+TRACKER_OBJ_PATH = "/org/freedesktop/Tracker1/Resources"
+RESOURCES_IFACE = "org.freedesktop.Tracker1.Resources"
+TRACKER_PROFILE_OBJ_PATH = "/org/freedesktop/Tracker1/Profile"
+PROFILE_IFACE = "org.freedesktop.Tracker1.Profile"
+
+# Longest time the miner is waited for while running as a daemon
+MINER_TIMEOUT = 3600
+
+SCENARIOS = ["initial", "recrawl", "modify", "move"]
+
+# Miner stages, parsed from the miner-fs output at verbosity 1
+MINER_STAGES = [
+    ("crawl", re.compile (r"Finished crawling files after\s+([0-9.]+) seconds")),
+    ("query", re.compile (r"Queried files after\s+([0-9.]+) seconds")),
+    ("notify", re.compile (r"Notified files after\s+([0-9.]+) seconds")),
+    ("process", re.compile (r"Total time\s+:\s+[0-9.]+ seconds \(([0-9.]+) processing\)")),
+]
+
+STORE_STAGES = ["commit", "checkpoint"]
+
+WORDS = ["tracker", "miner", "crawler", "notifier", "store", "journal",
+         "ontology", "resource", "sparql", "extract", "metadata", "index",
+         "query", "update", "commit", "batch", "monitor", "directory"]
+
+
+def random_text (rand, n_words):
+    return " ".join ([rand.choice (WORDS) for i in range (n_words)])
+
+def generate_txt (rand):
+    return random_text (rand, rand.randint (50, 2000)) + "\n"
+
+def generate_html (rand):
+    return ("<html><head><title>%s</title></head><body><p>%s</p></body></html>\n"
+            % (random_text (rand, 4), random_text (rand, rand.randint (50, 2000))))
+
+def generate_png (rand):
+    width = rand.randint (1, 64)
+    height = rand.randint (1, 64)
+
+    def chunk (chunk_type, data):
+        return (struct.pack (">I", len (data)) + chunk_type + data +
+                struct.pack (">I", zlib.crc32 (chunk_type + data) & 0xffffffff))
+
+    # 8 bit greyscale, each scanline prefixed by filter type 0
+    raw = "".join (["\0" + chr (rand.randint (0, 255)) * width for i in range (height)])
+
+    return ("\x89PNG\r\n\x1a\n" +
+            chunk ("IHDR", struct.pack (">IIBBBBB", width, height, 8, 0, 0, 0, 0)) +
+            chunk ("IDAT", zlib.compress (raw)) +
+            chunk ("IEND", ""))
+
+GENERATORS = {
+    "txt": generate_txt,
+    "html": generate_html,
+    "png": generate_png,
+}
+
+
+def parse_mix (mix):
+    result = []
+
+    for item in mix.split (","):
+        extension, weight = item.split (":")
+        if extension not in GENERATORS:
+            raise ValueError ("Unknown file type '%s', expected one of %s"
+                              % (extension, ", ".join (GENERATORS.keys ())))
+        result.append ((extension, int (weight)))
+
+    return result
+
+def generate_tree (content_dir, opts):
+    """
+    Creates opts.files files spread over a tree of opts.dirs top level
+    directories, each opts.depth levels deep. Returns the list of files.
+    """
+    rand = random.Random (opts.seed)
+    mix = parse_mix (opts.mix)
+    total_weight = sum ([weight for (extension, weight) in mix])
+
+    directories = []
+    for i in range (opts.dirs):
+        path = os.path.join (content_dir, "dir-%d" % i)
+        for level in range (opts.depth):
+            directories.append (path)
+            path = os.path.join (path, "level-%d" % (level + 1))
+
+    for directory in directories:
+        os.makedirs (directory)
+
+    files = []
+    for i in range (opts.files):
+        pick = rand.randint (1, total_weight)
+        for (extension, weight) in mix:
+            pick -= weight
+            if pick <= 0:
+                break
+
+        path = os.path.join (directories[i % len (directories)], "file-%d.%s" % (i, extension))
+        f = open (path, "wb")
+        f.write (GENERATORS[extension] (rand))
+        f.close ()
+
+        files.append (path)
+
+    return files
+
+def modify_files (files, opts):
+    rand = random.Random (opts.seed)
+    modified = rand.sample (files, int (len (files) * opts.modify_ratio))
+
+    # Move mtimes forward, so changes are seen within the same second
+    mtime = time.time () + 2
+
+    for path in modified:
+        f = open (path, "ab")
+        f.write ("\n")
+        f.close ()
+        os.utime (path, (mtime, mtime))
+
+    return len (modified)
+
+def move_directories (content_dir, files, opts):
+    for i in range (opts.dirs):
+        os.rename (os.path.join (content_dir, "dir-%d" % i),
+                   os.path.join (content_dir, "moved-%d" % i))
+
+    return len (files)
+
+
+class StoreProfile:
+    """
+    Accumulated store time, read from the org.freedesktop.Tracker1.Profile
+    interface of the sandboxed tracker-store.
+    """
+    def __init__ (self):
+        bus = dbus.SessionBus ()
+        obj = bus.get_object (TRACKER_BUSNAME, TRACKER_PROFILE_OBJ_PATH)
+        self.iface = dbus.Interface (obj, PROFILE_IFACE)
+
+    def reset (self):
+        self.iface.Reset ()
+
+    def get (self):
+        stages = dict ([(stage, 0.0) for stage in STORE_STAGES])
+
+        for entry in self.iface.Get ():
+            if entry["update"]:
+                stages["commit"] += entry["execute-time"] / 1000000.0
+
+        checkpoints = self.iface.GetCheckpoints ()
+        for key, value in checkpoints.iteritems ():
+            if key.endswith ("-time") and not key.endswith ("-max-time"):
+                stages["checkpoint"] += value / 1000000.0
+
+        return stages
+
+
+def count_urls (prefix):
+    """
+    Number of files and directories the store knows under prefix
+    """
+    bus = dbus.SessionBus ()
+    obj = bus.get_object (TRACKER_BUSNAME, TRACKER_OBJ_PATH)
+    iface = dbus.Interface (obj, RESOURCES_IFACE)
+
+    results = iface.SparqlQuery ("SELECT COUNT (?u) WHERE { ?u a nfo:FileDataObject ; nie:url ?url . "
+                                 "FILTER (fn:starts-with (?url, '%s')) }" % prefix)
+
+    return int (results[0][0])
+
+def set_monitors_enabled (enabled):
+    """
+    Changes the sandbox configuration, applied to the next miner run
+    """
+    config_filename = os.path.join (os.environ["XDG_CONFIG_HOME"], "tracker",
+                                    "tracker-miner-fs.cfg")
+
+    config = ConfigParser.ConfigParser ()
+    config.optionxform = str
+    config.read (config_filename)
+    config.set ("Monitors", "EnableMonitors", enabled and "true" or "false")
+
+    with open (config_filename, "wb") as f:
+        config.write (f)
+
+def parse_miner_stages (output):
+    stages = dict ([(stage, 0.0) for (stage, regex) in MINER_STAGES])
+    for (stage, regex) in MINER_STAGES:
+        for match in regex.finditer (output):
+            stages[stage] += float (match.group (1))
+
+    return stages
+
+def run_miner (binary, log):
+    start = time.time ()
+    output = subprocess.check_output ([binary, "--no-daemon",
+                                       "--disable-miner=applications"],
+                                      stderr = subprocess.STDOUT)
+    elapsed = time.time () - start
+
+    log.write (output)
+
+    return elapsed, parse_miner_stages (output)
+
+def wait_for_miner (process, condition):
+    deadline = time.time () + MINER_TIMEOUT
+
+    while not condition ():
+        if process.poll () is not None:
+            raise Exception ("tracker-miner-fs exited with status %d" % process.returncode)
+        if time.time () > deadline:
+            raise Exception ("tracker-miner-fs took more than %d seconds" % MINER_TIMEOUT)
+        time.sleep (0.1)
+
+def run_miner_monitored (binary, log, action, done):
+    """
+    Runs the miner as a daemon, calls action () once it's done crawling,
+    and returns how long it takes until done () is true.
+    """
+    output = tempfile.TemporaryFile ()
+    process = subprocess.Popen ([binary, "--disable-miner=applications"],
+                                stdout = output, stderr = subprocess.STDOUT)
+
+    def crawled ():
+        output.seek (0)
+        return MINER_STAGES[-1][1].search (output.read ()) is not None
+
+    try:
+        # The totals are printed once the initial crawl is processed
+        wait_for_miner (process, crawled)
+
+        # Only what the miner does from here on is accounted
+        output.seek (0, os.SEEK_END)
+        offset = output.tell ()
+
+        action ()
+
+        start = time.time ()
+        wait_for_miner (process, done)
+        elapsed = time.time () - start
+    finally:
+        if process.poll () is None:
+            process.terminate ()
+            process.wait ()
+
+    output.seek (0)
+    log.write (output.read ())
+    output.seek (offset)
+    stages = parse_miner_stages (output.read ())
+    output.close ()
+
+    return elapsed, stages
+
+def run_scenarios (sandbox, content_dir, files, opts):
+    binary = sandbox.index_miner_fs_binary ()
+    log = open (os.path.join (sandbox.index_location_abs, "miner-fs-benchmark.log"), "w")
+    profile = StoreProfile ()
+    results = []
+
+    for scenario in SCENARIOS:
+        if scenario == "modify":
+            n_files = modify_files (files, opts)
+        else:
+            n_files = len (files)
+
+        log.write ("-- %s\n" % scenario)
+
+        if scenario == "move":
+            set_monitors_enabled (True)
+
+            # The store profile is reset once the miner is done
+            # crawling, so its startup crawl is not accounted
+            def move ():
+                profile.reset ()
+                move_directories (content_dir, files, opts)
+
+            # Every file and directory gets a new URL
+            moved_prefix = "file://" + urllib.quote (os.path.join (content_dir, "moved-"))
+            n_moved = len (files) + opts.dirs * opts.depth
+
+            elapsed, stages = run_miner_monitored (binary, log, move,
+                                                   lambda: count_urls (moved_prefix) == n_moved)
+            set_monitors_enabled (False)
+        else:
+            # Also activates the store, so its startup is not accounted
+            profile.reset ()
+            elapsed, stages = run_miner (binary, log)
+
+        stages.update (profile.get ())
+
+        results.append ((scenario, n_files, elapsed, stages))
+        print_result (scenario, n_files, elapsed, stages)
+
+    log.close ()
+
+    return results
+
+def print_header ():
+    columns = [stage for (stage, regex) in MINER_STAGES] + STORE_STAGES
+    print "%-10s %8s %9s %9s " % ("scenario", "files", "time (s)", "files/s") + \
+        " ".join (["%10s" % column for column in columns])
+
+def print_result (scenario, n_files, elapsed, stages):
+    columns = [stage for (stage, regex) in MINER_STAGES] + STORE_STAGES
+    print "%-10s %8d %9.2f %9.1f " % (scenario, n_files, elapsed, n_files / elapsed) + \
+        " ".join (["%10.2f" % stages[column] for column in columns])
+    sys.stdout.flush ()
+
+
+def load_sandbox (opts, index_dir, content_dir):
+    sandbox = imp.load_source ("tracker_sandbox", opts.sandbox)
+    sandbox.opts = optparse.Values ({ "index_location": index_dir,
+                                      "content_location": content_dir,
+                                      "update": 1,
+                                      "prefix": opts.prefix,
+                                      "debug": None })
+    sandbox.environment_set ()
+
+    # Show the miner info messages the stage times are parsed from
+    os.environ["TRACKER_VERBOSITY"] = "1"
+
+    return sandbox
+
+if __name__ == "__main__":
+    popt = optparse.OptionParser (usage = "%prog [OPTION...]")
+    popt.add_option ("-n", "--files", type = "int", default = 1000,
+                     help = "number of files to generate (default=%default)")
+    popt.add_option ("--dirs", type = "int", default = 10,
+                     help = "number of top level directories (default=%default)")
+    popt.add_option ("--depth", type = "int", default = 3,
+                     help = "depth of each top level directory (default=%default)")
+    popt.add_option ("-m", "--mix", default = "txt:60,html:25,png:15",
+                     help = "file types and their weights (default=%default)")
+    popt.add_option ("--modify-ratio", type = "float", default = 0.2,
+                     help = "fraction of files modified (default=%default)")
+    popt.add_option ("--seed", type = "int", default = 0,
+                     help = "random seed used to generate the tree (default=%default)")
+    popt.add_option ("-p", "--prefix", default = "/usr",
+                     help = "prefix Tracker is installed in (default=%default)")
+    popt.add_option ("--sandbox", default = DEFAULT_SANDBOX,
+                     help = "location of tracker-sandbox.py")
+    popt.add_option ("-d", "--directory",
+                     help = "where to create the tree and index, kept afterwards "
+                            "(default is a temporary directory in the current one)")
+
+    (opts, args) = popt.parse_args ()
+
+    if opts.directory:
+        base_dir = os.path.abspath (opts.directory)
+        if os.path.exists (base_dir):
+            print "'%s' already exists" % base_dir
+            sys.exit (1)
+        os.makedirs (base_dir)
+    else:
+        # Not in /tmp, the miner refuses to index it
+        base_dir = tempfile.mkdtemp (prefix = "tracker-benchmark-", dir = os.getcwd ())
+
+    index_dir = os.path.join (base_dir, "index")
+    content_dir = os.path.join (base_dir, "content")
+
+    print "Generating %d files in '%s'..." % (opts.files, content_dir)
+    files = generate_tree (content_dir, opts)
+
+    sandbox = load_sandbox (opts, index_dir, content_dir)
+
+    try:
+        print_header ()
+        run_scenarios (sandbox, content_dir, files, opts)
+    finally:
+        sandbox.environment_unset ()
+
+        if not opts.directory:
+            shutil.rmtree (base_dir)
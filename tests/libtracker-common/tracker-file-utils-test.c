@@ -415,8 +415,13 @@ test_file_utils_lock ()
         g_assert (tracker_file_lock (f));
         g_assert (tracker_file_is_locked (f));
 
+        /* Known file types skip the type query, only regular files are checked */
+        g_assert (tracker_file_is_locked_with_type (f, G_FILE_TYPE_REGULAR));
+        g_assert (!tracker_file_is_locked_with_type (f, G_FILE_TYPE_DIRECTORY));
+
         g_assert (tracker_file_unlock (f));
         g_assert (!tracker_file_is_locked (f));
+        g_assert (!tracker_file_is_locked_with_type (f, G_FILE_TYPE_REGULAR));
 
         /* Unlock not-locked file */
         g_assert (tracker_file_unlock (no_f));
@@ -0,0 +1,184 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libtracker-common/tracker-common.h>
+
+static void
+add_samples (TrackerMimeCosts *costs,
+             const gchar      *mime_type,
+             guint             n_samples,
+             guint64           time,
+             guint64           bytes)
+{
+	guint i;
+
+	for (i = 0; i < n_samples; i++) {
+		tracker_mime_costs_add (costs, mime_type, time, bytes);
+	}
+}
+
+static void
+test_mime_costs_add (void)
+{
+	TrackerMimeCosts *costs;
+	const TrackerMimeCost *cost;
+
+	costs = tracker_mime_costs_new ();
+
+	g_assert (tracker_mime_costs_lookup (costs, "text/plain") == NULL);
+
+	tracker_mime_costs_add (costs, "text/plain", 100, 1000);
+	tracker_mime_costs_add (costs, "text/plain", 300, 3000);
+
+	cost = tracker_mime_costs_lookup (costs, "text/plain");
+	g_assert (cost != NULL);
+	g_assert_cmpuint (cost->count, ==, 2);
+	g_assert_cmpuint (cost->time, ==, 400);
+	g_assert_cmpuint (cost->bytes, ==, 4000);
+
+	/* Old samples are decayed, keeping the average */
+	add_samples (costs, "text/plain", 2000, 200, 2000);
+
+	cost = tracker_mime_costs_lookup (costs, "text/plain");
+	g_assert_cmpuint (cost->count, <=, 1000);
+	g_assert_cmpuint (cost->time / cost->count, ==, 200);
+	g_assert_cmpuint (cost->bytes / cost->count, ==, 2000);
+
+	tracker_mime_costs_free (costs);
+}
+
+static void
+test_mime_costs_expensive (void)
+{
+	TrackerMimeCosts *costs;
+	GList *mime_types;
+
+	costs = tracker_mime_costs_new ();
+
+	add_samples (costs, "text/plain", 10, 1000, 1000);
+	add_samples (costs, "video/mp4", 10, 2 * G_USEC_PER_SEC, 1000000);
+	add_samples (costs, "video/x-matroska", 2, 5 * G_USEC_PER_SEC, 1000000);
+
+	g_assert (!tracker_mime_costs_is_expensive (costs, "text/plain"));
+	g_assert (tracker_mime_costs_is_expensive (costs, "video/mp4"));
+	g_assert (!tracker_mime_costs_is_expensive (costs, "image/png"));
+
+	/* Not enough samples yet */
+	g_assert (!tracker_mime_costs_is_expensive (costs, "video/x-matroska"));
+
+	mime_types = tracker_mime_costs_get_mime_types (costs);
+	g_assert_cmpuint (g_list_length (mime_types), ==, 3);
+	g_assert_cmpstr (g_list_nth_data (mime_types, 0), ==, "video/x-matroska");
+	g_assert_cmpstr (g_list_nth_data (mime_types, 1), ==, "video/mp4");
+	g_assert_cmpstr (g_list_nth_data (mime_types, 2), ==, "text/plain");
+	g_list_free (mime_types);
+
+	tracker_mime_costs_free (costs);
+}
+
+static void
+test_mime_costs_copy (void)
+{
+	TrackerMimeCosts *costs, *copy;
+	const TrackerMimeCost *cost;
+
+	costs = tracker_mime_costs_new ();
+	add_samples (costs, "video/mp4", 10, 2 * G_USEC_PER_SEC, 1000000);
+
+	copy = tracker_mime_costs_copy (costs);
+
+	/* Later samples don't reach the copy */
+	tracker_mime_costs_add (costs, "video/mp4", 1000, 1000);
+	tracker_mime_costs_add (costs, "text/plain", 1000, 1000);
+	tracker_mime_costs_free (costs);
+
+	g_assert (tracker_mime_costs_lookup (copy, "text/plain") == NULL);
+
+	cost = tracker_mime_costs_lookup (copy, "video/mp4");
+	g_assert (cost != NULL);
+	g_assert_cmpuint (cost->count, ==, 10);
+	g_assert_cmpuint (cost->time, ==, 20 * G_USEC_PER_SEC);
+	g_assert_cmpuint (cost->bytes, ==, 10000000);
+
+	tracker_mime_costs_free (copy);
+}
+
+static void
+test_mime_costs_save_load (void)
+{
+	TrackerMimeCosts *costs;
+	const TrackerMimeCost *cost;
+	GError *error = NULL;
+	gchar *filename;
+
+	filename = g_build_filename (g_get_tmp_dir (), "tracker-mime-costs-test", NULL);
+
+	costs = tracker_mime_costs_new ();
+	add_samples (costs, "video/mp4", 10, 2 * G_USEC_PER_SEC, 1000000);
+	g_assert (tracker_mime_costs_save (costs, filename, &error));
+	g_assert_no_error (error);
+	tracker_mime_costs_free (costs);
+
+	costs = tracker_mime_costs_new ();
+	tracker_mime_costs_add (costs, "text/plain", 1000, 1000);
+	g_assert (tracker_mime_costs_load (costs, filename, &error));
+	g_assert_no_error (error);
+
+	/* Loading replaces previous contents */
+	g_assert (tracker_mime_costs_lookup (costs, "text/plain") == NULL);
+
+	cost = tracker_mime_costs_lookup (costs, "video/mp4");
+	g_assert (cost != NULL);
+	g_assert_cmpuint (cost->count, ==, 10);
+	g_assert_cmpuint (cost->time, ==, 20 * G_USEC_PER_SEC);
+	g_assert_cmpuint (cost->bytes, ==, 10000000);
+	g_assert (tracker_mime_costs_is_expensive (costs, "video/mp4"));
+
+	tracker_mime_costs_free (costs);
+	g_unlink (filename);
+
+	/* Missing file */
+	costs = tracker_mime_costs_new ();
+	g_assert (!tracker_mime_costs_load (costs, filename, &error));
+	g_assert (error != NULL);
+	g_clear_error (&error);
+	tracker_mime_costs_free (costs);
+
+	g_free (filename);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-common/mime-costs/add",
+	                 test_mime_costs_add);
+	g_test_add_func ("/libtracker-common/mime-costs/expensive",
+	                 test_mime_costs_expensive);
+	g_test_add_func ("/libtracker-common/mime-costs/copy",
+	                 test_mime_costs_copy);
+	g_test_add_func ("/libtracker-common/mime-costs/save-load",
+	                 test_mime_costs_save_load);
+
+	return g_test_run ();
+}
@@ -88,7 +88,8 @@ check_content_in_db (gint expected_instances, gint expected_relations)
  * Run again the queries
  */
 static void
-test_backup_and_restore_helper (gboolean journal)
+test_backup_and_restore_helper (gboolean journal,
+                                gboolean directory)
 {
 	gchar  *data_prefix, *data_filename, *backup_location, *backup_filename, *db_location, *meta_db;
 	GError *error = NULL;
@@ -133,7 +134,12 @@ test_backup_and_restore_helper (gboolean journal)
 
 	backup_location = g_build_filename (db_location, "backup", NULL);
 	g_mkdir (backup_location, 0777);
-	backup_filename = g_build_filename (backup_location, "tracker.dump", NULL);
+	if (directory) {
+		/* Journal files are copied into existing directories */
+		backup_filename = g_strdup (backup_location);
+	} else {
+		backup_filename = g_build_filename (backup_location, "tracker.dump", NULL);
+	}
 	backup_file = g_file_new_for_path (backup_filename);
 	g_free (backup_filename);
 	g_free (backup_location);
@@ -200,16 +206,25 @@ test_backup_and_restore_helper (gboolean journal)
 static void
 test_backup_and_restore (void)
 {
-	test_backup_and_restore_helper (FALSE);
+	test_backup_and_restore_helper (FALSE, FALSE);
 	backup_calls = 0;
 }
 
 static void
 test_journal_then_backup_and_restore (void)
 {
-	test_backup_and_restore_helper (TRUE);
+	test_backup_and_restore_helper (TRUE, FALSE);
+	backup_calls = 0;
+}
+
+#ifndef DISABLE_JOURNAL
+static void
+test_backup_and_restore_directory (void)
+{
+	test_backup_and_restore_helper (FALSE, TRUE);
 	backup_calls = 0;
 }
+#endif /* DISABLE_JOURNAL */
 
 int
 main (int argc, char **argv)
@@ -233,6 +248,11 @@ main (int argc, char **argv)
 	g_test_add_func ("/tracker/libtracker-data/backup/save_and_restore",
 	                 test_backup_and_restore);
 
+#ifndef DISABLE_JOURNAL
+	g_test_add_func ("/tracker/libtracker-data/backup/save_and_restore_directory",
+	                 test_backup_and_restore_directory);
+#endif /* DISABLE_JOURNAL */
+
 	/* run tests */
 	result = g_test_run ();
 
@@ -0,0 +1,158 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <glib/gstdio.h>
+
+#include <libtracker-common/tracker-locale.h>
+
+#include <libtracker-data/tracker-db-interface-sqlite.h>
+
+/* Much less than the busy timeout of the connections, which is 100s */
+#define CHECKPOINT_TIMEOUT 100
+#define MAX_CHECKPOINT_TIME (10 * G_TIME_SPAN_SECOND)
+
+static void
+execute (TrackerDBInterface *iface,
+         const gchar        *query)
+{
+	GError *error = NULL;
+
+	tracker_db_interface_execute_query (iface, &error, "%s", query);
+	g_assert_no_error (error);
+}
+
+static void
+insert_rows (TrackerDBInterface *iface,
+             guint               n_rows)
+{
+	guint i;
+
+	for (i = 0; i < n_rows; i++) {
+		execute (iface, "INSERT INTO t (v) VALUES (randomblob (1000))");
+	}
+}
+
+static gboolean
+checkpoint (TrackerDBInterface      *iface,
+            TrackerDBCheckpointMode  mode,
+            gint                    *log_pages,
+            gint                    *checkpointed)
+{
+	GError *error = NULL;
+	gboolean complete;
+	gint64 start;
+
+	start = g_get_monotonic_time ();
+	complete = tracker_db_interface_sqlite_wal_checkpoint (iface, mode,
+	                                                       CHECKPOINT_TIMEOUT,
+	                                                       log_pages,
+	                                                       checkpointed,
+	                                                       &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (g_get_monotonic_time () - start, <, MAX_CHECKPOINT_TIME);
+
+	return complete;
+}
+
+static void
+test_wal_checkpoint_bounded (gconstpointer data)
+{
+	const gchar *tmpdir = data;
+	TrackerDBInterface *writer, *reader;
+	GError *error = NULL;
+	gint log_pages, checkpointed, restarted_pages;
+	gchar *path;
+
+	path = g_build_filename (tmpdir, "checkpoint.db", NULL);
+
+	writer = tracker_db_interface_sqlite_new (path, &error);
+	g_assert_no_error (error);
+
+	execute (writer, "PRAGMA journal_mode = WAL");
+	execute (writer, "PRAGMA wal_autocheckpoint = 0");
+	execute (writer, "CREATE TABLE t (v BLOB)");
+	insert_rows (writer, 10);
+
+	/* A long lived read transaction, like the one held by backups */
+	reader = tracker_db_interface_sqlite_new (path, &error);
+	g_assert_no_error (error);
+
+	execute (reader, "BEGIN");
+	execute (reader, "SELECT COUNT (*) FROM t");
+
+	insert_rows (writer, 10);
+
+	/* Passive checkpoints copy back what they can without waiting */
+	g_assert (checkpoint (writer, TRACKER_DB_CHECKPOINT_PASSIVE, &log_pages, &checkpointed));
+	g_assert_cmpint (log_pages, >, 0);
+	g_assert_cmpint (checkpointed, <, log_pages);
+
+	/* Full and restart ones give up on the reader after the timeout */
+	g_assert (!checkpoint (writer, TRACKER_DB_CHECKPOINT_FULL, &log_pages, &checkpointed));
+	g_assert_cmpint (checkpointed, <, log_pages);
+
+	g_assert (!checkpoint (writer, TRACKER_DB_CHECKPOINT_RESTART, &log_pages, &checkpointed));
+	g_assert_cmpint (checkpointed, <, log_pages);
+
+	/* And complete once the reader is gone */
+	execute (reader, "COMMIT");
+
+	g_assert (checkpoint (writer, TRACKER_DB_CHECKPOINT_FULL, &log_pages, &checkpointed));
+	g_assert_cmpint (checkpointed, ==, log_pages);
+
+	g_assert (checkpoint (writer, TRACKER_DB_CHECKPOINT_RESTART, &log_pages, &checkpointed));
+	g_assert_cmpint (checkpointed, ==, log_pages);
+
+	/* The next commit writes the WAL from the start */
+	insert_rows (writer, 1);
+
+	g_assert (checkpoint (writer, TRACKER_DB_CHECKPOINT_PASSIVE, &restarted_pages, &checkpointed));
+	g_assert_cmpint (restarted_pages, <, log_pages);
+
+	g_object_unref (reader);
+	g_object_unref (writer);
+
+	g_unlink (path);
+	g_free (path);
+}
+
+int
+main (int argc, char **argv)
+{
+	gchar *tmpdir;
+	gint result;
+
+	g_test_init (&argc, &argv, NULL);
+
+	tracker_locale_init ();
+
+	tmpdir = g_dir_make_tmp ("tracker-db-interface-test-XXXXXX", NULL);
+	g_assert (tmpdir != NULL);
+
+	g_test_add_data_func ("/libtracker-data/tracker-db-interface/wal-checkpoint-bounded",
+	                      tmpdir,
+	                      test_wal_checkpoint_bounded);
+
+	result = g_test_run ();
+
+	g_rmdir (tmpdir);
+	g_free (tmpdir);
+
+	return result;
+}
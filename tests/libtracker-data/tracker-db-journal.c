@@ -138,6 +138,17 @@ test_write_functions (void)
 	g_assert_no_error (error);
 	g_assert_cmpint (result, ==, TRUE);
 
+	/* Test uri prefix update */
+	result = tracker_db_journal_start_transaction (time (NULL));
+	g_assert_cmpint (result, ==, TRUE);
+	result = tracker_db_journal_append_uri_prefix ("file:///old/", "file:///new/");
+	g_assert_cmpint (result, ==, TRUE);
+	result = tracker_db_journal_append_delete_descendants ("file:///new");
+	g_assert_cmpint (result, ==, TRUE);
+	result = tracker_db_journal_commit_db_transaction (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (result, ==, TRUE);
+
 	/* Test fsync */
 	result = tracker_db_journal_fsync ();
 	g_assert_cmpint (result, ==, TRUE);
@@ -350,6 +361,44 @@ test_read_functions (void)
 	type = tracker_db_journal_reader_get_type ();
 	g_assert_cmpint (type, ==, TRACKER_DB_JOURNAL_END_TRANSACTION);
 
+	/* Fourth transaction */
+	result = tracker_db_journal_reader_next (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (result, ==, TRUE);
+
+	type = tracker_db_journal_reader_get_type ();
+	g_assert_cmpint (type, ==, TRACKER_DB_JOURNAL_START_TRANSACTION);
+
+	result = tracker_db_journal_reader_next (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (result, ==, TRUE);
+
+	type = tracker_db_journal_reader_get_type ();
+	g_assert_cmpint (type, ==, TRACKER_DB_JOURNAL_UPDATE_URI_PREFIX);
+
+	result = tracker_db_journal_reader_get_uri_prefix (&uri, &str);
+	g_assert_cmpint (result, ==, TRUE);
+	g_assert_cmpstr (uri, ==, "file:///old/");
+	g_assert_cmpstr (str, ==, "file:///new/");
+
+	result = tracker_db_journal_reader_next (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (result, ==, TRUE);
+
+	type = tracker_db_journal_reader_get_type ();
+	g_assert_cmpint (type, ==, TRACKER_DB_JOURNAL_DELETE_DESCENDANTS);
+
+	result = tracker_db_journal_reader_get_descendants (&uri);
+	g_assert_cmpint (result, ==, TRUE);
+	g_assert_cmpstr (uri, ==, "file:///new");
+
+	result = tracker_db_journal_reader_next (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (result, ==, TRUE);
+
+	type = tracker_db_journal_reader_get_type ();
+	g_assert_cmpint (type, ==, TRACKER_DB_JOURNAL_END_TRANSACTION);
+
 	/* Shutdown */
 	result = tracker_db_journal_reader_shutdown ();
 	g_assert_cmpint (result, ==, TRUE);
@@ -357,6 +406,66 @@ test_read_functions (void)
 	g_free (path);
 }
 
+static void
+test_skip_to (void)
+{
+	GError *error = NULL;
+	gchar *path;
+	gboolean result;
+	gsize offset;
+	gint id;
+	const gchar *uri;
+
+	path = g_build_filename (TOP_BUILDDIR, "tests", "libtracker-db", "tracker-store.journal", NULL);
+
+	/* Find the end of the first transaction from the write tests */
+	result = tracker_db_journal_reader_init (path, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (result, ==, TRUE);
+
+	do {
+		result = tracker_db_journal_reader_next (&error);
+		g_assert_no_error (error);
+		g_assert_cmpint (result, ==, TRUE);
+	} while (tracker_db_journal_reader_get_type () != TRACKER_DB_JOURNAL_END_TRANSACTION);
+
+	offset = tracker_db_journal_reader_get_size_of_correct ();
+	tracker_db_journal_reader_shutdown ();
+
+	/* Reading resumes with the second transaction */
+	result = tracker_db_journal_reader_init (path, &error);
+	g_assert_no_error (error);
+	result = tracker_db_journal_reader_skip_to (offset, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (result, ==, TRUE);
+
+	result = tracker_db_journal_reader_next (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (tracker_db_journal_reader_get_type (), ==, TRACKER_DB_JOURNAL_START_TRANSACTION);
+
+	result = tracker_db_journal_reader_next (&error);
+	g_assert_no_error (error);
+	g_assert_cmpint (tracker_db_journal_reader_get_type (), ==, TRACKER_DB_JOURNAL_RESOURCE);
+
+	tracker_db_journal_reader_get_resource (&id, &uri);
+	g_assert_cmpint (id, ==, 15);
+	g_assert_cmpstr (uri, ==, "http://resource");
+
+	tracker_db_journal_reader_shutdown ();
+
+	/* Offsets past the end are refused */
+	result = tracker_db_journal_reader_init (path, &error);
+	g_assert_no_error (error);
+	result = tracker_db_journal_reader_skip_to (G_MAXSIZE, &error);
+	g_assert_cmpint (result, ==, FALSE);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	tracker_db_journal_reader_shutdown ();
+
+	g_free (path);
+}
+
 #endif /* DISABLE_JOURNAL */
 
 int
@@ -375,6 +484,8 @@ main (int argc, char **argv)
 	                 test_write_functions);
 	g_test_add_func ("/libtracker-db/tracker-db-journal/read-functions",
 	                 test_read_functions);
+	g_test_add_func ("/libtracker-db/tracker-db-journal/skip-to",
+	                 test_skip_to);
 #endif /* DISABLE_JOURNAL */
 
 	result = g_test_run ();
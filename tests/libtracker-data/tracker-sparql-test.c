@@ -88,6 +88,15 @@ const TestInfo tests[] = {
 	{ "functions/functions-property-1", "functions/data-1", FALSE },
 	{ "functions/functions-tracker-1", "functions/data-1", FALSE },
 	{ "functions/functions-tracker-2", "functions/data-2", FALSE },
+	{ "functions/functions-tracker-3", "functions/data-4", FALSE },
+	{ "functions/functions-tracker-4", "functions/data-4", FALSE },
+	{ "functions/functions-tracker-5", "functions/data-1", FALSE },
+	{ "functions/functions-tracker-6", "functions/data-4", FALSE },
+	{ "functions/functions-tracker-7", "functions/data-4", FALSE },
+	{ "functions/functions-tracker-8", "functions/data-5", FALSE },
+	{ "functions/functions-tracker-9", "functions/data-5", FALSE },
+	{ "functions/functions-tracker-10", "functions/data-5", FALSE },
+	{ "functions/functions-tracker-11", "functions/data-5", FALSE },
 	{ "functions/functions-tracker-loc-1", "functions/data-3", FALSE },
 	{ "functions/functions-xpath-1", "functions/data-1", FALSE },
 	{ "functions/functions-xpath-2", "functions/data-1", FALSE },
@@ -107,6 +116,12 @@ const TestInfo tests[] = {
 	{ "optional/simple-optional-triple", "optional/simple-optional-triple", FALSE },
 	{ "regex/regex-query-001", "regex/regex-data-01", FALSE },
 	{ "regex/regex-query-002", "regex/regex-data-01", FALSE },
+	{ "regex/regex-query-003", "regex/regex-data-01", FALSE },
+	{ "regex/regex-query-004", "regex/regex-data-01", FALSE },
+	{ "regex/regex-query-005", "regex/regex-data-01", FALSE },
+	{ "regex/regex-query-006", "regex/regex-data-02", FALSE },
+	{ "regex/regex-query-007", "regex/regex-data-02", FALSE },
+	{ "regex/regex-query-008", "regex/regex-data-02", FALSE },
 	{ "sort/query-sort-1", "sort/data-sort-1", FALSE },
 	{ "sort/query-sort-2", "sort/data-sort-1", FALSE },
 	{ "sort/query-sort-3", "sort/data-sort-3", FALSE },
@@ -317,6 +332,74 @@ test_sparql_query (gconstpointer test_data)
 	tracker_data_manager_shutdown ();
 }
 
+static void
+assert_join_order (const gchar *query_string,
+                   const gchar *first_table,
+                   const gchar *second_table)
+{
+	TrackerSparqlQuery *query;
+	GError *error = NULL;
+	gchar *sql;
+	const gchar *from, *first, *second;
+
+	query = tracker_sparql_query_new (query_string);
+	sql = tracker_sparql_query_get_select_sql (query, &error);
+	g_assert_no_error (error);
+
+	from = strstr (sql, " FROM ");
+	g_assert (from != NULL);
+
+	first = strstr (from, first_table);
+	second = strstr (from, second_table);
+	g_assert (first != NULL);
+	g_assert (second != NULL);
+	g_assert (first < second);
+
+	g_free (sql);
+	g_object_unref (query);
+}
+
+static void
+test_sparql_join_order (void)
+{
+	GError *error = NULL;
+	gchar *prefix, *data_filename;
+	const gchar *test_schemas[2] = { NULL, NULL };
+
+	prefix = g_build_filename (TOP_SRCDIR, "tests", "libtracker-data", "planner", "planner-data", NULL);
+	test_schemas[0] = prefix;
+
+	tracker_db_journal_set_rotating (FALSE, G_MAXSIZE, NULL);
+
+	tracker_data_manager_init (TRACKER_DB_MANAGER_FORCE_REINDEX,
+	                           test_schemas,
+	                           NULL, FALSE, FALSE,
+	                           100, 100, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+
+	/* 1 example:Small with 150 example:tag values, 12 example:Big */
+	data_filename = g_strconcat (prefix, ".ttl", NULL);
+	tracker_turtle_reader_load (data_filename, &error);
+	g_assert_no_error (error);
+
+	/* smaller classes first */
+	assert_join_order ("SELECT ?b ?s WHERE { ?b a example:Big . ?s a example:Small } ORDER BY ?b ?s",
+	                   "\"example:Small\"", "\"example:Big\"");
+
+	/* without ORDER BY, the join order is the order of the results */
+	assert_join_order ("SELECT ?b ?s WHERE { ?b a example:Big . ?s a example:Small }",
+	                   "\"example:Big\"", "\"example:Small\"");
+
+	/* multi-valued property tables are estimated by their values */
+	assert_join_order ("SELECT ?s ?t ?b WHERE { ?s example:tag ?t . ?b a example:Big } ORDER BY ?t ?b",
+	                   "\"example:Big\"", "\"example:Small_example:tag\"");
+
+	g_free (data_filename);
+	g_free (prefix);
+
+	tracker_data_manager_shutdown ();
+}
+
 int
 main (int argc, char **argv)
 {
@@ -356,6 +439,8 @@ main (int argc, char **argv)
 		g_free (testpath);
 	}
 
+	g_test_add_func ("/libtracker-data/sparql/planner/join-order", test_sparql_join_order);
+
 	/* run tests */
 	result = g_test_run ();
 
@@ -0,0 +1,235 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Compares the time spent reading the tags of FLAC, Ogg and MP4 files
+ * with the GStreamer discoverer, as tracker-extract-gstreamer does, and
+ * with the native header parser. Not run as part of make check, use:
+ *
+ *   ./tracker-audio-tags-bench [-n ITERATIONS] DIRECTORY...
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <gst/gst.h>
+#include <gst/pbutils/pbutils.h>
+
+#include <tracker-extract/tracker-audio-tags.h>
+
+static gint iterations = 10;
+static gchar **directories;
+
+static GOptionEntry entries[] = {
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+	  "Number of times each file is scanned (default=10)",
+	  "ITERATIONS" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &directories,
+	  "Directories holding the audio files",
+	  "DIRECTORY..." },
+	{ NULL }
+};
+
+static gboolean
+read_tags_discoverer (GstDiscoverer *discoverer,
+                      const gchar   *filename,
+                      gchar        **title,
+                      guint64       *duration)
+{
+	GstDiscovererInfo *info;
+	const GstTagList *tags;
+	gchar *uri;
+
+	uri = g_filename_to_uri (filename, NULL, NULL);
+	info = gst_discoverer_discover_uri (discoverer, uri, NULL);
+	g_free (uri);
+
+	if (!info) {
+		return FALSE;
+	}
+
+	*duration = gst_discoverer_info_get_duration (info) / GST_SECOND;
+
+	tags = gst_discoverer_info_get_tags (info);
+	if (tags) {
+		g_free (*title);
+		*title = NULL;
+		gst_tag_list_get_string (tags, GST_TAG_TITLE, title);
+	}
+
+	gst_discoverer_info_unref (info);
+
+	return TRUE;
+}
+
+static gboolean
+read_tags_native (const gchar  *filename,
+                  gchar       **title,
+                  guint64      *duration)
+{
+	TrackerAudioTags tags;
+	GMappedFile *mapped_file;
+	gboolean retval;
+
+	mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+	if (!mapped_file) {
+		return FALSE;
+	}
+
+	retval = tracker_audio_tags_scan ((const guchar *) g_mapped_file_get_contents (mapped_file),
+	                                  g_mapped_file_get_length (mapped_file),
+	                                  &tags);
+
+	if (retval) {
+		g_free (*title);
+		*title = g_strdup (tags.title);
+		*duration = tags.duration;
+		tracker_audio_tags_clear (&tags);
+	}
+
+	g_mapped_file_unref (mapped_file);
+
+	return retval;
+}
+
+static void
+collect_files (const gchar *path,
+               GPtrArray   *files)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir) {
+		g_printerr ("Could not open directory '%s'\n", path);
+		return;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *filename = g_build_filename (path, name, NULL);
+
+		if (g_file_test (filename, G_FILE_TEST_IS_DIR)) {
+			collect_files (filename, files);
+			g_free (filename);
+		} else if (g_str_has_suffix (name, ".flac") ||
+		           g_str_has_suffix (name, ".ogg") ||
+		           g_str_has_suffix (name, ".oga") ||
+		           g_str_has_suffix (name, ".opus") ||
+		           g_str_has_suffix (name, ".m4a")) {
+			g_ptr_array_add (files, filename);
+		} else {
+			g_free (filename);
+		}
+	}
+
+	g_dir_close (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GstDiscoverer *discoverer;
+	GPtrArray *files;
+	GTimer *timer;
+	gdouble discoverer_time = 0, native_time = 0;
+	gint mismatches = 0;
+	gchar **dir;
+	guint i;
+
+	context = g_option_context_new ("- Benchmark audio tag parsing");
+	g_option_context_add_main_entries (context, entries, NULL);
+	g_option_context_parse (context, &argc, &argv, NULL);
+	g_option_context_free (context);
+
+	if (!directories) {
+		g_printerr ("No directory given\n");
+		return EXIT_FAILURE;
+	}
+
+	files = g_ptr_array_new_with_free_func (g_free);
+
+	for (dir = directories; *dir; dir++) {
+		collect_files (*dir, files);
+	}
+
+	if (files->len == 0) {
+		g_printerr ("No audio files found\n");
+		return EXIT_FAILURE;
+	}
+
+	gst_init (&argc, &argv);
+
+	discoverer = gst_discoverer_new (5 * GST_SECOND, NULL);
+	timer = g_timer_new ();
+
+	for (i = 0; i < files->len; i++) {
+		const gchar *filename = g_ptr_array_index (files, i);
+		gchar *discoverer_title = NULL, *native_title = NULL;
+		guint64 discoverer_duration = 0, native_duration = 0;
+		gboolean discoverer_ok = FALSE, native_ok = FALSE;
+		gdouble elapsed;
+		gint n;
+
+		g_timer_start (timer);
+		for (n = 0; n < iterations; n++) {
+			discoverer_ok = read_tags_discoverer (discoverer, filename,
+			                                      &discoverer_title, &discoverer_duration);
+		}
+		elapsed = g_timer_elapsed (timer, NULL);
+		discoverer_time += elapsed;
+
+		g_print ("%s\n  discoverer: %10.2f us", filename, elapsed * 1000000 / iterations);
+
+		g_timer_start (timer);
+		for (n = 0; n < iterations; n++) {
+			native_ok = read_tags_native (filename, &native_title, &native_duration);
+		}
+		elapsed = g_timer_elapsed (timer, NULL);
+		native_time += elapsed;
+
+		g_print ("  native: %10.2f us\n", elapsed * 1000000 / iterations);
+
+		/* Durations are truncated differently, allow a second off */
+		if (discoverer_ok != native_ok ||
+		    g_strcmp0 (discoverer_title, native_title) != 0 ||
+		    discoverer_duration > native_duration + 1 ||
+		    native_duration > discoverer_duration + 1) {
+			g_print ("  MISMATCH: discoverer %s '%s' %" G_GUINT64_FORMAT "s, "
+			         "native %s '%s' %" G_GUINT64_FORMAT "s\n",
+			         discoverer_ok ? "ok" : "failed", discoverer_title, discoverer_duration,
+			         native_ok ? "ok" : "failed", native_title, native_duration);
+			mismatches++;
+		}
+
+		g_free (discoverer_title);
+		g_free (native_title);
+	}
+
+	g_print ("\n%u files, %d iterations\n", files->len, iterations);
+	g_print ("discoverer: %.3f s\n", discoverer_time);
+	g_print ("native:     %.3f s (%.1fx)\n",
+	         native_time,
+	         native_time > 0 ? discoverer_time / native_time : 0);
+
+	g_timer_destroy (timer);
+	g_object_unref (discoverer);
+	g_ptr_array_unref (files);
+
+	return mismatches > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
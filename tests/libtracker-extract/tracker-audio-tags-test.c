@@ -0,0 +1,635 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <tracker-extract/tracker-audio-tags.h>
+
+/* The files are built in memory, the test data holds no audio files */
+
+static void
+append_uint16_be (GByteArray *array,
+                  guint       value)
+{
+	guint8 bytes[2] = { value >> 8, value };
+
+	g_byte_array_append (array, bytes, 2);
+}
+
+static void
+append_uint24_be (GByteArray *array,
+                  guint32     value)
+{
+	guint8 bytes[3] = { value >> 16, value >> 8, value };
+
+	g_byte_array_append (array, bytes, 3);
+}
+
+static void
+append_uint32_be (GByteArray *array,
+                  guint32     value)
+{
+	guint8 bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+
+	g_byte_array_append (array, bytes, 4);
+}
+
+static void
+append_uint32_le (GByteArray *array,
+                  guint32     value)
+{
+	guint8 bytes[4] = { value, value >> 8, value >> 16, value >> 24 };
+
+	g_byte_array_append (array, bytes, 4);
+}
+
+static void
+append_uint64_le (GByteArray *array,
+                  guint64     value)
+{
+	append_uint32_le (array, value);
+	append_uint32_le (array, value >> 32);
+}
+
+static void
+append_string (GByteArray  *array,
+               const gchar *str)
+{
+	g_byte_array_append (array, (const guint8 *) str, strlen (str));
+}
+
+static void
+append_zeros (GByteArray *array,
+              guint       n)
+{
+	while (n-- > 0) {
+		guint8 zero = 0;
+		g_byte_array_append (array, &zero, 1);
+	}
+}
+
+static GByteArray *
+vorbis_comment_new (const gchar * const *comments)
+{
+	GByteArray *array = g_byte_array_new ();
+
+	append_uint32_le (array, 6);
+	append_string (array, "tester");
+	append_uint32_le (array, g_strv_length ((gchar **) comments));
+
+	for (; *comments; comments++) {
+		append_uint32_le (array, strlen (*comments));
+		append_string (array, *comments);
+	}
+
+	return array;
+}
+
+static const gchar *comments[] = {
+	"TITLE=A title",
+	"artist=An artist",
+	"ARTIST=Another artist",
+	"ALBUM=An album",
+	"TRACKNUMBER=3/12",
+	"DATE=2012",
+	"NOTATAG",
+	NULL
+};
+
+static void
+check_comments (TrackerAudioTags *tags)
+{
+	g_assert_cmpstr (tags->title, ==, "A title");
+	/* Names are case insensitive, the first value wins */
+	g_assert_cmpstr (tags->artist, ==, "An artist");
+	g_assert_cmpstr (tags->album, ==, "An album");
+	g_assert_cmpstr (tags->track_number, ==, "3");
+	g_assert_cmpstr (tags->track_count, ==, "12");
+	g_assert_cmpstr (tags->date, ==, "2012");
+	g_assert (tags->genre == NULL);
+}
+
+static void
+test_audio_tags_flac (void)
+{
+	TrackerAudioTags tags;
+	GByteArray *file, *comment;
+	guint8 streaminfo[34] = { 0 };
+
+	/* 44100Hz, 2 channels, 16 bits, 441000 samples */
+	streaminfo[10] = 44100 >> 12;
+	streaminfo[11] = (44100 >> 4) & 0xff;
+	streaminfo[12] = ((44100 & 0x0f) << 4) | (1 << 1) | 0;
+	streaminfo[13] = 0xf0;
+	streaminfo[14] = 441000 >> 24;
+	streaminfo[15] = (441000 >> 16) & 0xff;
+	streaminfo[16] = (441000 >> 8) & 0xff;
+	streaminfo[17] = 441000 & 0xff;
+
+	file = g_byte_array_new ();
+	append_string (file, "fLaC");
+
+	g_byte_array_append (file, (const guint8 *) "\x00", 1);
+	append_uint24_be (file, sizeof (streaminfo));
+	g_byte_array_append (file, streaminfo, sizeof (streaminfo));
+
+	comment = vorbis_comment_new (comments);
+	g_byte_array_append (file, (const guint8 *) "\x04", 1);
+	append_uint24_be (file, comment->len);
+	g_byte_array_append (file, comment->data, comment->len);
+	g_byte_array_unref (comment);
+
+	/* Picture, a back cover (4) */
+	g_byte_array_append (file, (const guint8 *) "\x86", 1);
+	append_uint24_be (file, 4 + 4 + 9 + 4 + 16 + 4 + 3);
+	append_uint32_be (file, 4);
+	append_uint32_be (file, 9);
+	append_string (file, "image/png");
+	append_uint32_be (file, 0);
+	append_zeros (file, 16);
+	append_uint32_be (file, 3);
+	append_string (file, "PNG");
+
+	append_zeros (file, 1000);
+
+	g_assert_cmpint (tracker_audio_tags_detect (file->data, file->len), ==, TRACKER_AUDIO_FORMAT_FLAC);
+	g_assert (tracker_audio_tags_scan (file->data, file->len, &tags));
+
+	g_assert_cmpstr (tags.codec, ==, "FLAC");
+	g_assert_cmpuint (tags.sample_rate, ==, 44100);
+	g_assert_cmpuint (tags.channels, ==, 2);
+	g_assert_cmpuint (tags.duration, ==, 10);
+	g_assert_cmpuint (tags.bitrate, ==, 800);
+	check_comments (&tags);
+
+	g_assert_cmpuint (tags.cover_length, ==, 3);
+	g_assert (memcmp (tags.cover, "PNG", 3) == 0);
+	g_assert_cmpstr (tags.cover_mime, ==, "image/png");
+
+	tracker_audio_tags_clear (&tags);
+	g_assert (tags.title == NULL);
+
+	/* Truncate within the comment block */
+	g_assert (tracker_audio_tags_scan (file->data, 4 + 4 + 34 + 20, &tags));
+	g_assert_cmpuint (tags.sample_rate, ==, 44100);
+	g_assert (tags.title == NULL);
+	tracker_audio_tags_clear (&tags);
+
+	/* Truncate within STREAMINFO */
+	g_assert (!tracker_audio_tags_scan (file->data, 4 + 4 + 10, &tags));
+
+	g_byte_array_unref (file);
+}
+
+/* If the packet is not complete, length must be a multiple of 255 */
+static void
+append_ogg_page (GByteArray   *file,
+                 guint32       serial,
+                 guint32       sequence,
+                 guint64       granule,
+                 const guint8 *data,
+                 gsize         length,
+                 gboolean      complete)
+{
+	guint8 n_segments, i;
+
+	n_segments = complete ? length / 255 + 1 : length / 255;
+
+	append_string (file, "OggS");
+	append_zeros (file, 2);
+	append_uint64_le (file, granule);
+	append_uint32_le (file, serial);
+	append_uint32_le (file, sequence);
+	append_zeros (file, 4);
+
+	g_byte_array_append (file, &n_segments, 1);
+
+	for (i = 0; i < n_segments; i++) {
+		guint8 lacing = (complete && i == n_segments - 1) ? length % 255 : 255;
+		g_byte_array_append (file, &lacing, 1);
+	}
+
+	g_byte_array_append (file, data, length);
+}
+
+static GByteArray *
+ogg_file_new (gboolean opus)
+{
+	GByteArray *file, *packet, *comment;
+	const gchar *padded[9];
+	gchar *padding;
+	guint i;
+
+	file = g_byte_array_new ();
+	packet = g_byte_array_new ();
+
+	if (opus) {
+		append_string (packet, "OpusHead");
+		g_byte_array_append (packet, (const guint8 *) "\x01\x02", 2);
+		/* Pre-skip 312, input rate 44100 */
+		g_byte_array_append (packet, (const guint8 *) "\x38\x01", 2);
+		append_uint32_le (packet, 44100);
+		append_zeros (packet, 3);
+	} else {
+		g_byte_array_append (packet, (const guint8 *) "\x01", 1);
+		append_string (packet, "vorbis");
+		append_uint32_le (packet, 0);
+		g_byte_array_append (packet, (const guint8 *) "\x02", 1);
+		append_uint32_le (packet, 44100);
+		append_uint32_le (packet, 0);
+		append_uint32_le (packet, 128000);
+		append_uint32_le (packet, 0);
+		g_byte_array_append (packet, (const guint8 *) "\xb8\x01", 2);
+	}
+
+	append_ogg_page (file, 1234, 0, 0, packet->data, packet->len, TRUE);
+	g_byte_array_set_size (packet, 0);
+
+	/* Make the comment packet span two pages */
+	padding = g_strnfill (300, 'x');
+	for (i = 0; comments[i]; i++) {
+		padded[i] = comments[i];
+	}
+	padded[i++] = padding;
+	padded[i] = NULL;
+
+	if (opus) {
+		append_string (packet, "OpusTags");
+	} else {
+		g_byte_array_append (packet, (const guint8 *) "\x03", 1);
+		append_string (packet, "vorbis");
+	}
+
+	comment = vorbis_comment_new (padded);
+	g_byte_array_append (packet, comment->data, comment->len);
+	g_byte_array_unref (comment);
+	g_free (padding);
+
+	append_ogg_page (file, 1234, 1, G_MAXUINT64, packet->data, 255, FALSE);
+	append_ogg_page (file, 1234, 2, 0, packet->data + 255, packet->len - 255, TRUE);
+	g_byte_array_unref (packet);
+
+	/* A page from another stream, then the last page */
+	append_ogg_page (file, 5678, 0, 99999999, (const guint8 *) "data", 4, TRUE);
+	append_ogg_page (file, 1234, 3, opus ? 312 + 48000 * 5 : 44100 * 5,
+	                 (const guint8 *) "data", 4, TRUE);
+
+	return file;
+}
+
+/* Scans a FLAC file whose last block is a PICTURE block holding
+ * @picture. The file ends right after it, so reading past the block
+ * is reading past the data. */
+static void
+scan_flac_picture (const guint8     *picture,
+                   gsize             picture_length,
+                   TrackerAudioTags *tags)
+{
+	GByteArray *file;
+	guint8 streaminfo[34] = { 0 };
+	guchar *data;
+
+	file = g_byte_array_new ();
+	append_string (file, "fLaC");
+
+	g_byte_array_append (file, (const guint8 *) "\x00", 1);
+	append_uint24_be (file, sizeof (streaminfo));
+	g_byte_array_append (file, streaminfo, sizeof (streaminfo));
+
+	g_byte_array_append (file, (const guint8 *) "\x86", 1);
+	append_uint24_be (file, picture_length);
+	g_byte_array_append (file, picture, picture_length);
+
+	data = g_memdup (file->data, file->len);
+	g_assert (tracker_audio_tags_scan (data, file->len, tags));
+
+	if (tags->cover) {
+		g_assert (tags->cover >= data);
+		g_assert (tags->cover + tags->cover_length <= data + file->len);
+	}
+
+	g_free (data);
+	g_byte_array_unref (file);
+}
+
+static void
+test_audio_tags_flac_picture (void)
+{
+	TrackerAudioTags tags;
+	GByteArray *picture, *lying;
+	gsize length;
+
+	picture = g_byte_array_new ();
+	append_uint32_be (picture, 3);
+	append_uint32_be (picture, 10);
+	append_string (picture, "image/jpeg");
+	append_uint32_be (picture, 5);
+	append_string (picture, "Front");
+	append_zeros (picture, 16);
+	append_uint32_be (picture, 4);
+	append_string (picture, "JPEG");
+
+	scan_flac_picture (picture->data, picture->len, &tags);
+	g_assert_cmpuint (tags.cover_length, ==, 4);
+	g_assert_cmpstr (tags.cover_mime, ==, "image/jpeg");
+	tracker_audio_tags_clear (&tags);
+
+	/* Every truncation of the block is ignored */
+	for (length = 0; length < picture->len; length++) {
+		scan_flac_picture (picture->data, length, &tags);
+		g_assert (tags.cover == NULL);
+		g_assert (tags.cover_mime == NULL);
+		tracker_audio_tags_clear (&tags);
+	}
+
+	/* And so are lengths pointing past the block: MIME type */
+	lying = g_byte_array_new ();
+	append_uint32_be (lying, 3);
+	append_uint32_be (lying, G_MAXUINT32);
+	append_string (lying, "image/jpeg");
+	scan_flac_picture (lying->data, lying->len, &tags);
+	g_assert (tags.cover == NULL);
+	tracker_audio_tags_clear (&tags);
+	g_byte_array_unref (lying);
+
+	/* MIME type up to the end of the block, no description length */
+	lying = g_byte_array_new ();
+	append_uint32_be (lying, 3);
+	append_uint32_be (lying, 10);
+	append_string (lying, "image/jpeg");
+	scan_flac_picture (lying->data, lying->len, &tags);
+	g_assert (tags.cover == NULL);
+	tracker_audio_tags_clear (&tags);
+	g_byte_array_unref (lying);
+
+	/* Description */
+	lying = g_byte_array_new ();
+	append_uint32_be (lying, 3);
+	append_uint32_be (lying, 0);
+	append_uint32_be (lying, G_MAXUINT32 - 3);
+	append_zeros (lying, 20);
+	scan_flac_picture (lying->data, lying->len, &tags);
+	g_assert (tags.cover == NULL);
+	tracker_audio_tags_clear (&tags);
+	g_byte_array_unref (lying);
+
+	/* Picture */
+	lying = g_byte_array_new ();
+	append_uint32_be (lying, 3);
+	append_uint32_be (lying, 0);
+	append_uint32_be (lying, 0);
+	append_zeros (lying, 16);
+	append_uint32_be (lying, 5);
+	append_string (lying, "JPEG");
+	scan_flac_picture (lying->data, lying->len, &tags);
+	g_assert (tags.cover == NULL);
+	tracker_audio_tags_clear (&tags);
+	g_byte_array_unref (lying);
+
+	g_byte_array_unref (picture);
+}
+
+static void
+test_audio_tags_ogg (void)
+{
+	TrackerAudioTags tags;
+	GByteArray *file;
+
+	file = ogg_file_new (FALSE);
+
+	g_assert_cmpint (tracker_audio_tags_detect (file->data, file->len), ==, TRACKER_AUDIO_FORMAT_OGG);
+	g_assert (tracker_audio_tags_scan (file->data, file->len, &tags));
+
+	g_assert_cmpstr (tags.codec, ==, "Vorbis");
+	g_assert_cmpuint (tags.sample_rate, ==, 44100);
+	g_assert_cmpuint (tags.channels, ==, 2);
+	g_assert_cmpuint (tags.bitrate, ==, 128000);
+	g_assert_cmpuint (tags.duration, ==, 5);
+	check_comments (&tags);
+
+	tracker_audio_tags_clear (&tags);
+	g_byte_array_unref (file);
+
+	file = ogg_file_new (TRUE);
+
+	g_assert (tracker_audio_tags_scan (file->data, file->len, &tags));
+
+	g_assert_cmpstr (tags.codec, ==, "Opus");
+	g_assert_cmpuint (tags.channels, ==, 2);
+	g_assert_cmpuint (tags.duration, ==, 5);
+	check_comments (&tags);
+
+	tracker_audio_tags_clear (&tags);
+
+	/* Theora is left to the other extractors */
+	memcpy (file->data + 28, "\x80theora", 7);
+	g_assert (!tracker_audio_tags_scan (file->data, file->len, &tags));
+
+	g_byte_array_unref (file);
+}
+
+static guint
+begin_box (GByteArray  *file,
+           const gchar *type)
+{
+	guint start = file->len;
+
+	append_uint32_be (file, 0);
+	g_byte_array_append (file, (const guint8 *) type, 4);
+
+	return start;
+}
+
+static void
+end_box (GByteArray *file,
+         guint       start)
+{
+	guint32 size = file->len - start;
+
+	file->data[start] = size >> 24;
+	file->data[start + 1] = size >> 16;
+	file->data[start + 2] = size >> 8;
+	file->data[start + 3] = size;
+}
+
+static void
+append_mp4_item (GByteArray   *file,
+                 const gchar  *type,
+                 guint32       data_type,
+                 const guint8 *value,
+                 gsize         length)
+{
+	guint item, data;
+
+	item = begin_box (file, type);
+	data = begin_box (file, "data");
+	append_uint32_be (file, data_type);
+	append_uint32_be (file, 0);
+	g_byte_array_append (file, value, length);
+	end_box (file, data);
+	end_box (file, item);
+}
+
+static GByteArray *
+mp4_file_new (const gchar *handler)
+{
+	GByteArray *file;
+	guint moov, box, trak, mdia, minf, stbl, stsd, udta, meta, ilst;
+
+	file = g_byte_array_new ();
+
+	box = begin_box (file, "ftyp");
+	append_string (file, "M4A ");
+	append_uint32_be (file, 0);
+	end_box (file, box);
+
+	box = begin_box (file, "mdat");
+	append_zeros (file, 1000);
+	end_box (file, box);
+
+	moov = begin_box (file, "moov");
+
+	box = begin_box (file, "mvhd");
+	append_uint32_be (file, 0);
+	append_zeros (file, 8);
+	append_uint32_be (file, 1000);
+	append_uint32_be (file, 8000);
+	end_box (file, box);
+
+	trak = begin_box (file, "trak");
+	mdia = begin_box (file, "mdia");
+	box = begin_box (file, "hdlr");
+	append_uint32_be (file, 0);
+	append_uint32_be (file, 0);
+	append_string (file, handler);
+	append_zeros (file, 12);
+	end_box (file, box);
+	minf = begin_box (file, "minf");
+	stbl = begin_box (file, "stbl");
+	stsd = begin_box (file, "stsd");
+	append_uint32_be (file, 0);
+	append_uint32_be (file, 1);
+	box = begin_box (file, "mp4a");
+	append_zeros (file, 16);
+	append_uint16_be (file, 2);
+	append_uint16_be (file, 16);
+	append_zeros (file, 4);
+	append_uint16_be (file, 48000);
+	append_uint16_be (file, 0);
+	end_box (file, box);
+	end_box (file, stsd);
+	end_box (file, stbl);
+	end_box (file, minf);
+	end_box (file, mdia);
+	end_box (file, trak);
+
+	udta = begin_box (file, "udta");
+	meta = begin_box (file, "meta");
+	append_uint32_be (file, 0);
+	box = begin_box (file, "hdlr");
+	append_zeros (file, 8);
+	append_string (file, "mdir");
+	end_box (file, box);
+	ilst = begin_box (file, "ilst");
+	append_mp4_item (file, "\xa9nam", 1, (const guint8 *) "A title", 7);
+	append_mp4_item (file, "\xa9" "ART", 1, (const guint8 *) "An artist", 9);
+	append_mp4_item (file, "\xa9" "alb", 1, (const guint8 *) "An album", 8);
+	append_mp4_item (file, "\xa9" "day", 1, (const guint8 *) "2012", 4);
+	append_mp4_item (file, "trkn", 0, (const guint8 *) "\0\0\0\3\0\14\0\0", 8);
+	append_mp4_item (file, "disk", 0, (const guint8 *) "\0\0\0\1\0\2", 6);
+	append_mp4_item (file, "covr", 13, (const guint8 *) "JPEG", 4);
+	end_box (file, ilst);
+	end_box (file, meta);
+	end_box (file, udta);
+
+	end_box (file, moov);
+
+	return file;
+}
+
+static void
+test_audio_tags_mp4 (void)
+{
+	TrackerAudioTags tags;
+	GByteArray *file;
+
+	file = mp4_file_new ("soun");
+
+	g_assert_cmpint (tracker_audio_tags_detect (file->data, file->len), ==, TRACKER_AUDIO_FORMAT_MP4);
+	g_assert (tracker_audio_tags_scan (file->data, file->len, &tags));
+
+	g_assert_cmpstr (tags.codec, ==, "AAC");
+	g_assert_cmpuint (tags.sample_rate, ==, 48000);
+	g_assert_cmpuint (tags.channels, ==, 2);
+	g_assert_cmpuint (tags.duration, ==, 8);
+	g_assert_cmpuint (tags.bitrate, ==, file->len);
+	check_comments (&tags);
+	g_assert_cmpstr (tags.disc_number, ==, "1");
+
+	g_assert_cmpuint (tags.cover_length, ==, 4);
+	g_assert (memcmp (tags.cover, "JPEG", 4) == 0);
+	g_assert_cmpstr (tags.cover_mime, ==, "image/jpeg");
+
+	tracker_audio_tags_clear (&tags);
+	g_byte_array_unref (file);
+
+	/* Videos are left to the other extractors */
+	file = mp4_file_new ("vide");
+	g_assert (!tracker_audio_tags_scan (file->data, file->len, &tags));
+	g_byte_array_unref (file);
+}
+
+static void
+test_audio_tags_invalid (void)
+{
+	TrackerAudioTags tags;
+	const guchar id3[] = { 'I', 'D', '3', 4, 0, 0, 0, 0, 0, 2, 0, 0, 'f', 'L', 'a', 'C' };
+	const guchar mp3[] = { 0xff, 0xfb, 0x90, 0x00, 0, 0, 0, 0, 0, 0, 0, 0 };
+	const guchar box_overflow[] = { 0, 0, 0, 12, 'f', 't', 'y', 'p', 'M', '4', 'A', ' ',
+	                                0xff, 0xff, 0xff, 0xff, 'm', 'o', 'o', 'v' };
+
+	/* FLAC with an ID3v2 tag in front, but no STREAMINFO */
+	g_assert_cmpint (tracker_audio_tags_detect (id3, sizeof (id3)), ==, TRACKER_AUDIO_FORMAT_FLAC);
+	g_assert (!tracker_audio_tags_scan (id3, sizeof (id3), &tags));
+
+	g_assert_cmpint (tracker_audio_tags_detect (mp3, sizeof (mp3)), ==, TRACKER_AUDIO_FORMAT_UNKNOWN);
+	g_assert (!tracker_audio_tags_scan (mp3, sizeof (mp3), &tags));
+
+	g_assert (!tracker_audio_tags_scan (box_overflow, sizeof (box_overflow), &tags));
+	g_assert (!tracker_audio_tags_scan (NULL, 0, &tags));
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-extract/tracker-audio-tags/flac",
+	                 test_audio_tags_flac);
+	g_test_add_func ("/libtracker-extract/tracker-audio-tags/flac-picture",
+	                 test_audio_tags_flac_picture);
+	g_test_add_func ("/libtracker-extract/tracker-audio-tags/ogg",
+	                 test_audio_tags_ogg);
+	g_test_add_func ("/libtracker-extract/tracker-audio-tags/mp4",
+	                 test_audio_tags_mp4);
+	g_test_add_func ("/libtracker-extract/tracker-audio-tags/invalid",
+	                 test_audio_tags_invalid);
+
+	return g_test_run ();
+}
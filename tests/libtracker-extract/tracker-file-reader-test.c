@@ -0,0 +1,169 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libtracker-extract/tracker-extract.h>
+
+/* Spans a few pages so windows start at unaligned offsets */
+#define FILE_SIZE 20000
+
+typedef struct {
+	gchar *filename;
+	gchar *contents;
+	TrackerExtractInfo *info;
+} Fixture;
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+	GFile *file;
+	guint i;
+
+	fixture->filename = g_build_filename (g_get_tmp_dir (),
+	                                      "tracker-file-reader-test",
+	                                      NULL);
+	fixture->contents = g_malloc (FILE_SIZE);
+
+	for (i = 0; i < FILE_SIZE; i++) {
+		fixture->contents[i] = i % 251;
+	}
+
+	g_assert (g_file_set_contents (fixture->filename,
+	                               fixture->contents,
+	                               FILE_SIZE, NULL));
+
+	file = g_file_new_for_path (fixture->filename);
+	fixture->info = tracker_extract_info_new (file, "application/octet-stream", NULL);
+	g_object_unref (file);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  user_data)
+{
+	tracker_extract_info_unref (fixture->info);
+	g_unlink (fixture->filename);
+	g_free (fixture->filename);
+	g_free (fixture->contents);
+}
+
+static void
+test_file_reader_windows (Fixture       *fixture,
+                          gconstpointer  user_data)
+{
+	TrackerFileReader *reader;
+	GError *error = NULL;
+	const gchar *data;
+	gsize length;
+
+	reader = tracker_file_reader_open (fixture->info, &error);
+	g_assert_no_error (error);
+	g_assert (reader != NULL);
+	g_assert_cmpint (tracker_file_reader_get_size (reader), ==, FILE_SIZE);
+
+	data = tracker_file_reader_get_head (reader, 100, &length);
+	g_assert_cmpuint (length, ==, 100);
+	g_assert (memcmp (data, fixture->contents, length) == 0);
+
+	data = tracker_file_reader_get_window (reader, 5000, 300, &length);
+	g_assert_cmpuint (length, ==, 300);
+	g_assert (memcmp (data, fixture->contents + 5000, length) == 0);
+
+	data = tracker_file_reader_get_tail (reader, 128, &length);
+	g_assert_cmpuint (length, ==, 128);
+	g_assert (memcmp (data, fixture->contents + FILE_SIZE - 128, length) == 0);
+
+	/* Windows are clipped to the file size */
+	data = tracker_file_reader_get_window (reader, FILE_SIZE - 10, 100, &length);
+	g_assert_cmpuint (length, ==, 10);
+	g_assert (memcmp (data, fixture->contents + FILE_SIZE - 10, length) == 0);
+
+	data = tracker_file_reader_get_tail (reader, 2 * FILE_SIZE, &length);
+	g_assert_cmpuint (length, ==, FILE_SIZE);
+	g_assert (memcmp (data, fixture->contents, length) == 0);
+
+	data = tracker_file_reader_get_window (reader, FILE_SIZE, 100, &length);
+	g_assert (data == NULL);
+	g_assert_cmpuint (length, ==, 0);
+
+	g_assert_cmpuint (tracker_file_reader_get_bytes_read (reader), ==,
+	                  100 + 300 + 128 + 10 + FILE_SIZE);
+
+	tracker_file_reader_close (reader);
+
+	/* Bytes read are accounted in the extract info */
+	g_assert_cmpuint (tracker_extract_info_get_bytes_read (fixture->info), ==,
+	                  100 + 300 + 128 + 10 + FILE_SIZE);
+}
+
+static void
+test_file_reader_empty (Fixture       *fixture,
+                        gconstpointer  user_data)
+{
+	TrackerFileReader *reader;
+	gsize length;
+
+	g_assert (g_file_set_contents (fixture->filename, "", 0, NULL));
+
+	reader = tracker_file_reader_open (fixture->info, NULL);
+	g_assert (reader != NULL);
+	g_assert_cmpint (tracker_file_reader_get_size (reader), ==, 0);
+	g_assert (tracker_file_reader_get_head (reader, 100, &length) == NULL);
+	g_assert (tracker_file_reader_get_tail (reader, 100, &length) == NULL);
+	g_assert_cmpuint (length, ==, 0);
+	tracker_file_reader_close (reader);
+
+	g_assert_cmpuint (tracker_extract_info_get_bytes_read (fixture->info), ==, 0);
+}
+
+static void
+test_file_reader_missing (Fixture       *fixture,
+                          gconstpointer  user_data)
+{
+	TrackerFileReader *reader;
+	GError *error = NULL;
+
+	g_unlink (fixture->filename);
+
+	reader = tracker_file_reader_open (fixture->info, &error);
+	g_assert (reader == NULL);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+	g_error_free (error);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add ("/libtracker-extract/tracker-file-reader/windows",
+	            Fixture, NULL,
+	            fixture_setup, test_file_reader_windows, fixture_teardown);
+	g_test_add ("/libtracker-extract/tracker-file-reader/empty",
+	            Fixture, NULL,
+	            fixture_setup, test_file_reader_empty, fixture_teardown);
+	g_test_add ("/libtracker-extract/tracker-file-reader/missing",
+	            Fixture, NULL,
+	            fixture_setup, test_file_reader_missing, fixture_teardown);
+
+	return g_test_run ();
+}
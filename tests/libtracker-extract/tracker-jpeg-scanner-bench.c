@@ -0,0 +1,245 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+/* Compares the time spent reaching the metadata segments of JPEG files
+ * with libjpeg, as tracker-extract-jpeg used to do, and with the marker
+ * scanner. Not run as part of make check, use:
+ *
+ *   ./tracker-jpeg-scanner-bench [-n ITERATIONS] [DIRECTORY...]
+ *
+ * Defaults to the images of the functional tests extraction data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+
+#include <jpeglib.h>
+
+#include <glib.h>
+
+#include <tracker-extract/tracker-jpeg-scanner.h>
+
+struct tej_error_mgr {
+	struct jpeg_error_mgr jpeg;
+	jmp_buf setjmp_buffer;
+};
+
+static gint iterations = 1000;
+static gchar **directories;
+
+static GOptionEntry entries[] = {
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+	  "Number of times each file is scanned (default=1000)",
+	  "ITERATIONS" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &directories,
+	  "Directories holding the JPEG files",
+	  "[DIRECTORY...]" },
+	{ NULL }
+};
+
+static void
+bench_jpeg_error_exit (j_common_ptr cinfo)
+{
+	struct tej_error_mgr *h = (struct tej_error_mgr *) cinfo->err;
+
+	longjmp (h->setjmp_buffer, 1);
+}
+
+static gboolean
+read_header_libjpeg (const gchar *filename,
+                     guint       *width,
+                     guint       *height)
+{
+	struct jpeg_decompress_struct cinfo;
+	struct tej_error_mgr tejerr;
+	FILE *f;
+
+	f = fopen (filename, "rb");
+	if (!f) {
+		return FALSE;
+	}
+
+	cinfo.err = jpeg_std_error (&tejerr.jpeg);
+	tejerr.jpeg.error_exit = bench_jpeg_error_exit;
+	if (setjmp (tejerr.setjmp_buffer)) {
+		jpeg_destroy_decompress (&cinfo);
+		fclose (f);
+		return FALSE;
+	}
+
+	jpeg_create_decompress (&cinfo);
+
+	jpeg_save_markers (&cinfo, JPEG_COM, 0xFFFF);
+	jpeg_save_markers (&cinfo, JPEG_APP0 + 1, 0xFFFF);
+	jpeg_save_markers (&cinfo, JPEG_APP0 + 13, 0xFFFF);
+
+	jpeg_stdio_src (&cinfo, f);
+	jpeg_read_header (&cinfo, TRUE);
+
+	*width = cinfo.image_width;
+	*height = cinfo.image_height;
+
+	jpeg_destroy_decompress (&cinfo);
+	fclose (f);
+
+	return TRUE;
+}
+
+static gboolean
+read_header_scanner (const gchar *filename,
+                     guint       *width,
+                     guint       *height)
+{
+	TrackerJpegHeader header;
+	GMappedFile *mapped_file;
+	gboolean success;
+
+	/* Not through a TrackerFileReader, which drops the file from
+	 * the page cache when closed, libjpeg gets it cached too */
+	mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+	if (!mapped_file) {
+		return FALSE;
+	}
+
+	success = tracker_jpeg_scan ((const guchar *) g_mapped_file_get_contents (mapped_file),
+	                             g_mapped_file_get_length (mapped_file),
+	                             &header);
+
+	if (success) {
+		*width = header.width;
+		*height = header.height;
+	}
+
+	g_mapped_file_unref (mapped_file);
+
+	return success;
+}
+
+static void
+collect_files (const gchar *path,
+               GPtrArray   *files)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir) {
+		g_printerr ("Could not open directory '%s'\n", path);
+		return;
+	}
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *filename = g_build_filename (path, name, NULL);
+
+		if (g_file_test (filename, G_FILE_TEST_IS_DIR)) {
+			collect_files (filename, files);
+			g_free (filename);
+		} else if (g_str_has_suffix (name, ".jpg") ||
+		           g_str_has_suffix (name, ".jpeg") ||
+		           g_str_has_suffix (name, ".JPG")) {
+			g_ptr_array_add (files, filename);
+		} else {
+			g_free (filename);
+		}
+	}
+
+	g_dir_close (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GPtrArray *files;
+	GTimer *timer;
+	gdouble libjpeg_time = 0, scanner_time = 0;
+	gint mismatches = 0;
+	guint i;
+
+	context = g_option_context_new ("- Benchmark JPEG header parsing");
+	g_option_context_add_main_entries (context, entries, NULL);
+	g_option_context_parse (context, &argc, &argv, NULL);
+	g_option_context_free (context);
+
+	files = g_ptr_array_new_with_free_func (g_free);
+
+	if (directories) {
+		gchar **dir;
+
+		for (dir = directories; *dir; dir++) {
+			collect_files (*dir, files);
+		}
+	} else {
+		collect_files (TOP_SRCDIR "/tests/functional-tests/test-extraction-data", files);
+		collect_files (TOP_SRCDIR "/tests/libtracker-extract", files);
+	}
+
+	if (files->len == 0) {
+		g_printerr ("No JPEG files found\n");
+		return EXIT_FAILURE;
+	}
+
+	timer = g_timer_new ();
+
+	for (i = 0; i < files->len; i++) {
+		const gchar *filename = g_ptr_array_index (files, i);
+		guint libjpeg_width = 0, libjpeg_height = 0;
+		guint scanner_width = 0, scanner_height = 0;
+		gboolean libjpeg_ok = FALSE, scanner_ok = FALSE;
+		gdouble elapsed;
+		gint n;
+
+		g_timer_start (timer);
+		for (n = 0; n < iterations; n++) {
+			libjpeg_ok = read_header_libjpeg (filename, &libjpeg_width, &libjpeg_height);
+		}
+		elapsed = g_timer_elapsed (timer, NULL);
+		libjpeg_time += elapsed;
+
+		g_print ("%s\n  libjpeg: %8.2f us", filename, elapsed * 1000000 / iterations);
+
+		g_timer_start (timer);
+		for (n = 0; n < iterations; n++) {
+			scanner_ok = read_header_scanner (filename, &scanner_width, &scanner_height);
+		}
+		elapsed = g_timer_elapsed (timer, NULL);
+		scanner_time += elapsed;
+
+		g_print ("  scanner: %8.2f us\n", elapsed * 1000000 / iterations);
+
+		if (libjpeg_ok != scanner_ok ||
+		    libjpeg_width != scanner_width ||
+		    libjpeg_height != scanner_height) {
+			g_print ("  MISMATCH: libjpeg %s %ux%u, scanner %s %ux%u\n",
+			         libjpeg_ok ? "ok" : "failed", libjpeg_width, libjpeg_height,
+			         scanner_ok ? "ok" : "failed", scanner_width, scanner_height);
+			mismatches++;
+		}
+	}
+
+	g_print ("\n%u files, %d iterations\n", files->len, iterations);
+	g_print ("libjpeg: %.3f s\n", libjpeg_time);
+	g_print ("scanner: %.3f s (%.1fx)\n",
+	         scanner_time,
+	         scanner_time > 0 ? libjpeg_time / scanner_time : 0);
+
+	g_timer_destroy (timer);
+	g_ptr_array_unref (files);
+
+	return mismatches > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
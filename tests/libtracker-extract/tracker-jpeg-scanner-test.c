@@ -0,0 +1,119 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <tracker-extract/tracker-jpeg-scanner.h>
+
+static TrackerFileReader *
+open_reader (const gchar *filename)
+{
+	TrackerExtractInfo *info;
+	TrackerFileReader *reader;
+	GError *error = NULL;
+	GFile *file;
+
+	file = g_file_new_for_path (filename);
+	info = tracker_extract_info_new (file, "image/jpeg", NULL);
+	g_object_unref (file);
+
+	reader = tracker_file_reader_open (info, &error);
+	g_assert_no_error (error);
+	tracker_extract_info_unref (info);
+
+	return reader;
+}
+
+static void
+test_jpeg_scan_exif (void)
+{
+	TrackerJpegHeader header;
+	TrackerFileReader *reader;
+
+	reader = open_reader (TOP_SRCDIR "/tests/libtracker-extract/exif-img.jpg");
+	g_assert (tracker_jpeg_scan_file (reader, &header));
+
+	g_assert_cmpuint (header.width, ==, 64);
+	g_assert_cmpuint (header.height, ==, 64);
+	g_assert_cmpuint (header.density_unit, ==, 0);
+
+	g_assert (header.exif != NULL);
+	g_assert_cmpuint (header.exif_length, ==, 794);
+	g_assert (strncmp (header.exif, "Exif", 4) == 0);
+
+	g_assert (header.xmp == NULL);
+	g_assert (header.ps3 == NULL);
+	g_assert (header.comment == NULL);
+
+	tracker_file_reader_close (reader);
+}
+
+static void
+test_jpeg_scan_iptc (void)
+{
+	TrackerJpegHeader header;
+	TrackerFileReader *reader;
+
+	reader = open_reader (TOP_SRCDIR "/tests/libtracker-extract/iptc-img.jpg");
+	g_assert (tracker_jpeg_scan_file (reader, &header));
+
+	/* SOF stores the height first */
+	g_assert_cmpuint (header.width, ==, 10);
+	g_assert_cmpuint (header.height, ==, 6);
+
+	g_assert (header.ps3 != NULL);
+	g_assert_cmpuint (header.ps3_length, ==, 214);
+	g_assert (header.exif == NULL);
+
+	tracker_file_reader_close (reader);
+}
+
+static void
+test_jpeg_scan_invalid (void)
+{
+	TrackerJpegHeader header;
+	const guchar not_jpeg[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	const guchar truncated[] = { 0xFF, 0xD8, 0xFF, 0xE1, 0x10, 0x00, 'E', 'x', 'i', 'f' };
+	const guchar fill_bytes[] = { 0xFF, 0xD8, 0xFF, 0xFF, 0xFF, 0xC0, 0x00, 0x0B,
+	                              0x08, 0x00, 0x02, 0x00, 0x03, 0x01, 0x01, 0x11, 0x00,
+	                              0xFF, 0xDA };
+
+	g_assert (!tracker_jpeg_scan (not_jpeg, sizeof (not_jpeg), &header));
+	g_assert (!tracker_jpeg_scan (truncated, sizeof (truncated), &header));
+	g_assert (header.exif == NULL);
+
+	g_assert (tracker_jpeg_scan (fill_bytes, sizeof (fill_bytes), &header));
+	g_assert_cmpuint (header.width, ==, 3);
+	g_assert_cmpuint (header.height, ==, 2);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/tracker-extract/jpeg-scanner/exif",
+	                 test_jpeg_scan_exif);
+	g_test_add_func ("/tracker-extract/jpeg-scanner/iptc",
+	                 test_jpeg_scan_iptc);
+	g_test_add_func ("/tracker-extract/jpeg-scanner/invalid",
+	                 test_jpeg_scan_invalid);
+
+	return g_test_run ();
+}
@@ -0,0 +1,325 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <libtracker-common/tracker-common.h>
+
+#include <tracker-extract/tracker-media-art.h>
+#include <tracker-extract/tracker-media-art-generic.h>
+
+/* The image conversion plugin is part of tracker-extract, only JPEG
+ * covers are used here, which are copied as they are */
+void
+tracker_media_art_plugin_init (void)
+{
+}
+
+void
+tracker_media_art_plugin_shutdown (void)
+{
+}
+
+gboolean
+tracker_media_art_file_to_jpeg (const gchar *filename,
+                                const gchar *target)
+{
+	return FALSE;
+}
+
+gboolean
+tracker_media_art_buffer_to_jpeg (const unsigned char *buffer,
+                                  size_t               len,
+                                  const gchar         *buffer_mime,
+                                  const gchar         *target)
+{
+	return FALSE;
+}
+
+static void
+remove_recursively (const gchar *path)
+{
+	if (g_file_test (path, G_FILE_TEST_IS_DIR) &&
+	    !g_file_test (path, G_FILE_TEST_IS_SYMLINK)) {
+		const gchar *name;
+		GDir *dir;
+
+		dir = g_dir_open (path, 0, NULL);
+		g_assert (dir != NULL);
+
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			gchar *child;
+
+			child = g_build_filename (path, name, NULL);
+			remove_recursively (child);
+			g_free (child);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_remove (path);
+}
+
+static gchar *
+create_file (const gchar *dirname,
+             const gchar *basename,
+             const gchar *contents)
+{
+	GError *error = NULL;
+	gchar *path;
+
+	path = g_build_filename (dirname, basename, NULL);
+	g_file_set_contents (path, contents, -1, &error);
+	g_assert_no_error (error);
+
+	return path;
+}
+
+/* Rewrites the file in place, unlike g_file_set_contents() which
+ * replaces it with a new file */
+static void
+overwrite_file (const gchar *path,
+                const gchar *contents)
+{
+	FILE *file;
+
+	file = g_fopen (path, "wb");
+	g_assert (file != NULL);
+	g_assert_cmpint (fwrite (contents, 1, strlen (contents), file), ==, strlen (contents));
+	fclose (file);
+}
+
+static void
+assert_file_contents (const gchar *path,
+                      const gchar *expected)
+{
+	GError *error = NULL;
+	gchar *contents;
+
+	g_file_get_contents (path, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, expected);
+	g_free (contents);
+}
+
+static gchar *
+create_track (const gchar *dirname)
+{
+	gchar *path, *uri;
+
+	path = create_file (dirname, "track.mp3", "");
+	uri = g_filename_to_uri (path, NULL, NULL);
+	g_free (path);
+
+	return uri;
+}
+
+static gchar *
+get_album_art_path (const gchar *artist,
+                    const gchar *album)
+{
+	gchar *artist_stripped, *album_stripped, *path;
+
+	artist_stripped = tracker_media_art_strip_invalid_entities (artist);
+	album_stripped = tracker_media_art_strip_invalid_entities (album);
+
+	tracker_media_art_get_path (artist_stripped, album_stripped,
+	                            "album", NULL,
+	                            &path, NULL);
+
+	g_free (artist_stripped);
+	g_free (album_stripped);
+
+	return path;
+}
+
+static void
+test_media_art_album_directories (gconstpointer data)
+{
+	const gchar *tmpdir = data;
+	gchar *dir_a, *dir_b, *uri_a, *uri_b, *cover, *art_path;
+
+	g_assert (tracker_media_art_init ());
+
+	art_path = get_album_art_path ("Artist", "Album");
+	g_assert (art_path != NULL);
+
+	dir_a = g_build_filename (tmpdir, "a", NULL);
+	dir_b = g_build_filename (tmpdir, "b", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (dir_a, 0700), ==, 0);
+	g_assert_cmpint (g_mkdir_with_parents (dir_b, 0700), ==, 0);
+
+	/* The first track of the album has no cover next to it */
+	uri_a = create_track (dir_a);
+	tracker_media_art_process (NULL, 0, NULL,
+	                           TRACKER_MEDIA_ART_ALBUM,
+	                           "Artist", "Album",
+	                           uri_a);
+	g_assert (!g_file_test (art_path, G_FILE_TEST_EXISTS));
+
+	/* Another track of the same album, in another directory with a
+	 * cover, still has its directory looked into */
+	uri_b = create_track (dir_b);
+	cover = create_file (dir_b, "cover.jpg", "\xff\xd8\xff\xe0 not really a JPEG");
+	tracker_media_art_process (NULL, 0, NULL,
+	                           TRACKER_MEDIA_ART_ALBUM,
+	                           "Artist", "Album",
+	                           uri_b);
+	g_assert (g_file_test (art_path, G_FILE_TEST_EXISTS));
+
+	tracker_media_art_shutdown ();
+
+	g_free (cover);
+	g_free (uri_b);
+	g_free (uri_a);
+	g_free (dir_b);
+	g_free (dir_a);
+	g_free (art_path);
+}
+
+static void
+test_media_art_directory_changed (gconstpointer data)
+{
+	const gchar *tmpdir = data;
+	gchar *dir, *uri, *cover, *art_path;
+
+	g_assert (tracker_media_art_init ());
+
+	art_path = get_album_art_path ("Artist", "Second");
+	g_assert (art_path != NULL);
+
+	dir = g_build_filename (tmpdir, "changed", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (dir, 0700), ==, 0);
+
+	/* Caches the listing of the directory, without images */
+	uri = create_track (dir);
+	tracker_media_art_process (NULL, 0, NULL,
+	                           TRACKER_MEDIA_ART_ALBUM,
+	                           "Artist", "First",
+	                           uri);
+
+	/* A cover added right after, likely within the same second,
+	 * is found for another album in the directory */
+	cover = create_file (dir, "cover.jpg", "\xff\xd8\xff\xe0 added cover");
+	tracker_media_art_process (NULL, 0, NULL,
+	                           TRACKER_MEDIA_ART_ALBUM,
+	                           "Artist", "Second",
+	                           uri);
+	assert_file_contents (art_path, "\xff\xd8\xff\xe0 added cover");
+
+	tracker_media_art_shutdown ();
+
+	g_free (cover);
+	g_free (uri);
+	g_free (dir);
+	g_free (art_path);
+}
+
+static void
+test_media_art_cover_changed (gconstpointer data)
+{
+	const gchar *tmpdir = data;
+	gchar *dir, *uri, *cover, *first_art_path, *second_art_path;
+
+	g_assert (tracker_media_art_init ());
+
+	first_art_path = get_album_art_path ("First Artist", "Changed");
+	second_art_path = get_album_art_path ("Second Artist", "Changed");
+	g_assert (first_art_path != NULL);
+	g_assert (second_art_path != NULL);
+
+	dir = g_build_filename (tmpdir, "cover-changed", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (dir, 0700), ==, 0);
+
+	/* Caches the checksum of the cover, which is also copied as
+	 * the art of every album with the same title */
+	uri = create_track (dir);
+	cover = create_file (dir, "cover.jpg", "\xff\xd8\xff\xe0 old cover");
+	tracker_media_art_process (NULL, 0, NULL,
+	                           TRACKER_MEDIA_ART_ALBUM,
+	                           "First Artist", "Changed",
+	                           uri);
+	assert_file_contents (first_art_path, "\xff\xd8\xff\xe0 old cover");
+
+	/* Same size and inode, likely within the same second, the
+	 * new checksum doesn't match the old art any longer */
+	overwrite_file (cover, "\xff\xd8\xff\xe0 new cover");
+	tracker_media_art_process (NULL, 0, NULL,
+	                           TRACKER_MEDIA_ART_ALBUM,
+	                           "Second Artist", "Changed",
+	                           uri);
+	assert_file_contents (second_art_path, "\xff\xd8\xff\xe0 new cover");
+	assert_file_contents (first_art_path, "\xff\xd8\xff\xe0 old cover");
+
+	tracker_media_art_shutdown ();
+
+	g_free (cover);
+	g_free (uri);
+	g_free (dir);
+	g_free (second_art_path);
+	g_free (first_art_path);
+}
+
+int
+main (int argc, char **argv)
+{
+	GTestDBus *bus;
+	gchar *tmpdir, *cache_dir;
+	gint result;
+
+	g_test_init (&argc, &argv, NULL);
+
+	/* Media art is stored in the user cache directory, which GLib
+	 * reads once, so it's moved before anything asks for it */
+	tmpdir = g_dir_make_tmp ("tracker-media-art-test-XXXXXX", NULL);
+	g_assert (tmpdir != NULL);
+
+	cache_dir = g_build_filename (tmpdir, "cache", NULL);
+	g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+	/* Download requests go to the session bus, use a private one */
+	bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+	g_test_dbus_up (bus);
+
+	g_test_add_data_func ("/libtracker-extract/tracker-media-art/album-directories",
+	                      tmpdir,
+	                      test_media_art_album_directories);
+	g_test_add_data_func ("/libtracker-extract/tracker-media-art/directory-changed",
+	                      tmpdir,
+	                      test_media_art_directory_changed);
+	g_test_add_data_func ("/libtracker-extract/tracker-media-art/cover-changed",
+	                      tmpdir,
+	                      test_media_art_cover_changed);
+
+	result = g_test_run ();
+
+	g_test_dbus_down (bus);
+	g_object_unref (bus);
+
+	remove_recursively (tmpdir);
+
+	g_free (cache_dir);
+	g_free (tmpdir);
+
+	return result;
+}
@@ -0,0 +1,225 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <tracker-extract/tracker-read.h>
+
+/* Size of the chunks tracker-read.c reads and decodes at once */
+#define CHUNK_SIZE 65535
+
+#define MAX_BYTES (1024 * 1024)
+
+static gchar *
+read_from_fd (const gchar *data,
+              gsize        length)
+{
+	GError *error = NULL;
+	gchar *path;
+	gchar *text;
+	gint fd;
+
+	fd = g_file_open_tmp ("tracker-read-test-XXXXXX", &path, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpint (write (fd, data, length), ==, length);
+	g_assert_cmpint (lseek (fd, 0, SEEK_SET), ==, 0);
+
+	/* Closes the fd */
+	text = tracker_read_text_from_fd (fd, MAX_BYTES);
+
+	g_unlink (path);
+	g_free (path);
+
+	return text;
+}
+
+/* Reads @data both from a file and from a stream, and checks that
+ * both give the same text */
+static gchar *
+read_text (const gchar *data,
+           gsize        length)
+{
+	GInputStream *stream;
+	gchar *from_fd, *from_stream;
+
+	from_fd = read_from_fd (data, length);
+
+	stream = g_memory_input_stream_new_from_data (data, length, NULL);
+	from_stream = tracker_read_text_from_stream (stream, MAX_BYTES);
+	g_object_unref (stream);
+
+	g_assert_cmpstr (from_fd, ==, from_stream);
+	g_free (from_stream);
+
+	return from_fd;
+}
+
+/* "line\n", then ASCII filler up to where @character starts, then
+ * "\nend\n", so that @character starts at @offset */
+static GString *
+text_with_character_at (const gchar *character,
+                        gsize        offset)
+{
+	GString *text;
+
+	text = g_string_new ("line\n");
+
+	while (text->len < offset) {
+		g_string_append_c (text, 'a');
+	}
+
+	g_string_append (text, character);
+	g_string_append (text, "\nend\n");
+
+	return text;
+}
+
+static void
+test_read_split_utf8 (void)
+{
+	const gchar *characters[] = {
+		"\xC3\xA9",         /* U+00E9 */
+		"\xE2\x82\xAC",     /* U+20AC */
+		"\xF0\x9F\x98\x80"  /* U+1F600 */
+	};
+	guint i, cut;
+
+	for (i = 0; i < G_N_ELEMENTS (characters); i++) {
+		/* Cut the character after each of its bytes */
+		for (cut = 1; cut < strlen (characters[i]); cut++) {
+			GString *data;
+			gchar *text;
+
+			data = text_with_character_at (characters[i], CHUNK_SIZE - cut);
+
+			text = read_text (data->str, data->len);
+			g_assert_cmpstr (text, ==, data->str);
+
+			g_free (text);
+			g_string_free (data, TRUE);
+		}
+	}
+}
+
+static void
+test_read_split_utf16 (void)
+{
+	const gchar *characters[] = {
+		"\xC3\xA9",         /* U+00E9, a single UTF-16 unit */
+		"\xF0\x9F\x98\x80"  /* U+1F600, a surrogate pair */
+	};
+	guint i, cut;
+
+	for (i = 0; i < G_N_ELEMENTS (characters); i++) {
+		/* Every UTF-16 unit starts at an even offset after the BOM,
+		 * so with odd sized chunks the cut falls after an odd number
+		 * of bytes of the character */
+		for (cut = 1; cut < 4; cut += 2) {
+			GError *error = NULL;
+			GString *expected, *data;
+			gchar *utf16, *text;
+			gsize utf16_length;
+
+			if (cut == 3 && strlen (characters[i]) < 4) {
+				continue;
+			}
+
+			/* The character starts at CHUNK_SIZE - cut, after the
+			 * BOM and the UTF-16 units of the text before it */
+			expected = text_with_character_at (characters[i], (CHUNK_SIZE - cut - 2) / 2);
+
+			utf16 = g_convert (expected->str, expected->len,
+			                   "UTF-16LE", "UTF-8",
+			                   NULL, &utf16_length, &error);
+			g_assert_no_error (error);
+
+			data = g_string_new_len ("\xFF\xFE", 2);
+			g_string_append_len (data, utf16, utf16_length);
+
+			text = read_text (data->str, data->len);
+			g_assert_cmpstr (text, ==, expected->str);
+
+			g_free (text);
+			g_free (utf16);
+			g_string_free (data, TRUE);
+			g_string_free (expected, TRUE);
+		}
+	}
+}
+
+static void
+test_read_invalid_utf8 (void)
+{
+	GString *data;
+	gsize valid_length;
+	gchar *text;
+
+	/* The first chunk is UTF-8, so the encoding isn't guessed again
+	 * when the second one turns out not to be: only the text before
+	 * the invalid bytes is kept */
+	data = g_string_new ("line \xC3\xA9\n");
+
+	while (data->len < CHUNK_SIZE + 100) {
+		g_string_append_c (data, 'a');
+	}
+
+	valid_length = data->len;
+	g_string_append (data, "\xFF\xFE not UTF-8\n");
+
+	text = read_text (data->str, data->len);
+	g_assert_cmpint (strlen (text), ==, valid_length);
+	g_assert (strncmp (text, data->str, valid_length) == 0);
+
+	g_free (text);
+	g_string_free (data, TRUE);
+}
+
+static void
+test_read_short (void)
+{
+	gchar *text;
+
+	/* Files with less than 3 characters are not indexed */
+	text = read_text ("ab\n", 3);
+	g_assert (text == NULL);
+
+	text = read_text ("abcd\n", 5);
+	g_assert_cmpstr (text, ==, "abcd\n");
+	g_free (text);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-extract/tracker-read/split-utf8",
+	                 test_read_split_utf8);
+	g_test_add_func ("/libtracker-extract/tracker-read/split-utf16",
+	                 test_read_split_utf16);
+	g_test_add_func ("/libtracker-extract/tracker-read/invalid-utf8",
+	                 test_read_invalid_utf8);
+	g_test_add_func ("/libtracker-extract/tracker-read/short",
+	                 test_read_short);
+
+	return g_test_run ();
+}
@@ -0,0 +1,352 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <zlib.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <tracker-extract/tracker-zip.h>
+
+typedef struct {
+	GString *text;
+	gsize max_bytes;
+} ParseData;
+
+static void
+append_uint16 (GByteArray *array,
+               guint       value)
+{
+	guint8 bytes[2] = { value, value >> 8 };
+
+	g_byte_array_append (array, bytes, 2);
+}
+
+static void
+append_uint32 (GByteArray *array,
+               guint32     value)
+{
+	guint8 bytes[4] = { value, value >> 8, value >> 16, value >> 24 };
+
+	g_byte_array_append (array, bytes, 4);
+}
+
+static GByteArray *
+deflate_raw (const gchar *data,
+             gsize        length)
+{
+	GByteArray *array;
+	z_stream stream;
+	guint8 buf[4096];
+	gint status;
+
+	array = g_byte_array_new ();
+	memset (&stream, 0, sizeof (z_stream));
+	deflateInit2 (&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+	stream.next_in = (Bytef *) data;
+	stream.avail_in = length;
+
+	do {
+		stream.next_out = buf;
+		stream.avail_out = sizeof (buf);
+		status = deflate (&stream, Z_FINISH);
+		g_byte_array_append (array, buf, sizeof (buf) - stream.avail_out);
+	} while (status == Z_OK);
+
+	g_assert_cmpint (status, ==, Z_STREAM_END);
+	deflateEnd (&stream);
+
+	return array;
+}
+
+/* Builds an archive holding each member both stored and deflated, as
+ * stored/NAME and deflated/NAME */
+static GByteArray *
+zip_archive_new (const gchar * const *names,
+                 const gchar * const *contents)
+{
+	GByteArray *archive, *directory;
+	guint n_entries = 0, i, method;
+	guint32 directory_size;
+
+	archive = g_byte_array_new ();
+	directory = g_byte_array_new ();
+
+	for (i = 0; names[i]; i++) {
+		for (method = 0; method <= 8; method += 8) {
+			GByteArray *compressed = NULL;
+			const guint8 *data;
+			gsize length, raw_length;
+			gchar *name;
+			guint32 offset = archive->len;
+
+			name = g_strconcat (method ? "deflated/" : "stored/", names[i], NULL);
+			raw_length = strlen (contents[i]);
+
+			if (method) {
+				compressed = deflate_raw (contents[i], raw_length);
+				data = compressed->data;
+				length = compressed->len;
+			} else {
+				data = (const guint8 *) contents[i];
+				length = raw_length;
+			}
+
+			/* Local header, sizes deferred to the central directory */
+			append_uint32 (archive, 0x04034b50);
+			append_uint16 (archive, 20);
+			append_uint16 (archive, 0);
+			append_uint16 (archive, method);
+			append_uint32 (archive, 0);
+			append_uint32 (archive, 0);
+			append_uint32 (archive, 0);
+			append_uint32 (archive, 0);
+			append_uint16 (archive, strlen (name));
+			append_uint16 (archive, 0);
+			g_byte_array_append (archive, (const guint8 *) name, strlen (name));
+			g_byte_array_append (archive, data, length);
+
+			append_uint32 (directory, 0x02014b50);
+			append_uint16 (directory, 20);
+			append_uint16 (directory, 20);
+			append_uint16 (directory, 0);
+			append_uint16 (directory, method);
+			append_uint32 (directory, 0);
+			append_uint32 (directory, crc32 (0, (const Bytef *) contents[i], raw_length));
+			append_uint32 (directory, length);
+			append_uint32 (directory, raw_length);
+			append_uint16 (directory, strlen (name));
+			append_uint16 (directory, 0);
+			append_uint16 (directory, 0);
+			append_uint16 (directory, 0);
+			append_uint16 (directory, 0);
+			append_uint32 (directory, 0);
+			append_uint32 (directory, offset);
+			g_byte_array_append (directory, (const guint8 *) name, strlen (name));
+
+			if (compressed) {
+				g_byte_array_unref (compressed);
+			}
+
+			g_free (name);
+			n_entries++;
+		}
+	}
+
+	directory_size = directory->len;
+
+	append_uint32 (directory, 0x06054b50);
+	append_uint16 (directory, 0);
+	append_uint16 (directory, 0);
+	append_uint16 (directory, n_entries);
+	append_uint16 (directory, n_entries);
+	append_uint32 (directory, directory_size);
+	append_uint32 (directory, archive->len);
+	append_uint16 (directory, 0);
+
+	g_byte_array_append (archive, directory->data, directory->len);
+	g_byte_array_unref (directory);
+
+	return archive;
+}
+
+static void
+text_handler (GMarkupParseContext  *context,
+              const gchar          *text,
+              gsize                 text_len,
+              gpointer              user_data,
+              GError              **error)
+{
+	ParseData *data = user_data;
+
+	if (data->max_bytes > 0 && data->text->len >= data->max_bytes) {
+		g_set_error_literal (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT,
+		                     "Maximum text limit reached");
+		return;
+	}
+
+	g_string_append_len (data->text, text, text_len);
+}
+
+static gboolean
+parse_member (TrackerZip   *zip,
+              const gchar  *name,
+              gsize         max_bytes,
+              gchar       **text,
+              GError      **error)
+{
+	GMarkupParser parser = { NULL, NULL, text_handler, NULL, NULL };
+	GMarkupParseContext *context;
+	ParseData data;
+	gboolean retval;
+
+	data.text = g_string_new ("");
+	data.max_bytes = max_bytes;
+
+	context = g_markup_parse_context_new (&parser, 0, &data, NULL);
+	retval = tracker_zip_parse_xml (zip, name, context, error);
+	g_markup_parse_context_free (context);
+
+	*text = g_string_free (data.text, FALSE);
+
+	return retval;
+}
+
+static const gchar *names[] = { "meta.xml", "content.xml", NULL };
+
+static void
+test_zip_parse (void)
+{
+	const gchar *contents[] = {
+		"<meta>Title</meta>",
+		"<doc><p>Some</p><p> text</p></doc>",
+		NULL
+	};
+	GByteArray *archive;
+	TrackerZip *zip;
+	GError *error = NULL;
+	gchar *text;
+
+	archive = zip_archive_new (names, contents);
+	zip = tracker_zip_new_from_data (archive->data, archive->len);
+	g_assert (zip != NULL);
+
+	g_assert (tracker_zip_has_member (zip, "stored/meta.xml"));
+	g_assert (tracker_zip_has_member (zip, "deflated/content.xml"));
+	g_assert (!tracker_zip_has_member (zip, "content.xml"));
+
+	g_assert (parse_member (zip, "stored/meta.xml", 0, &text, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (text, ==, "Title");
+	g_free (text);
+
+	g_assert (parse_member (zip, "deflated/content.xml", 0, &text, &error));
+	g_assert_no_error (error);
+	g_assert_cmpstr (text, ==, "Some text");
+	g_free (text);
+
+	tracker_zip_close (zip);
+	g_byte_array_unref (archive);
+}
+
+static void
+test_zip_parse_limit (void)
+{
+	const gchar *contents[] = { NULL, NULL, NULL };
+	GByteArray *archive;
+	TrackerZip *zip;
+	GError *error = NULL;
+	GString *content;
+	gchar *text;
+	guint i;
+
+	/* Highly compressible, much larger than the inflate buffer */
+	content = g_string_new ("<doc>");
+	for (i = 0; i < 100000; i++) {
+		g_string_append (content, "<p>Some text</p>");
+	}
+	g_string_append (content, "</doc>");
+
+	contents[0] = "<meta/>";
+	contents[1] = content->str;
+
+	archive = zip_archive_new (names, contents);
+	zip = tracker_zip_new_from_data (archive->data, archive->len);
+	g_assert (zip != NULL);
+
+	/* The parser error stops inflating and is propagated */
+	g_assert (!parse_member (zip, "deflated/content.xml", 20, &text, &error));
+	g_assert_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT);
+	g_assert_cmpuint (strlen (text), <, 100);
+	g_clear_error (&error);
+	g_free (text);
+
+	g_assert (!parse_member (zip, "stored/content.xml", 20, &text, &error));
+	g_assert_error (error, G_MARKUP_ERROR, G_MARKUP_ERROR_INVALID_CONTENT);
+	g_clear_error (&error);
+	g_free (text);
+
+	tracker_zip_close (zip);
+	g_byte_array_unref (archive);
+	g_string_free (content, TRUE);
+}
+
+static void
+test_zip_invalid (void)
+{
+	const gchar *contents[] = { "<meta/>", "<doc/>", NULL };
+	const guchar not_zip[] = "<?xml version=\"1.0\"?><doc/>";
+	GByteArray *archive;
+	TrackerZip *zip;
+	GError *error = NULL;
+	gsize offset;
+	gchar *text;
+
+	g_assert (tracker_zip_new_from_data (not_zip, sizeof (not_zip)) == NULL);
+	g_assert (tracker_zip_new_from_data (NULL, 0) == NULL);
+
+	archive = zip_archive_new (names, contents);
+
+	/* Corrupted local header signature, stored/meta.xml comes first */
+	archive->data[0] = 'X';
+
+	zip = tracker_zip_new_from_data (archive->data, archive->len);
+	g_assert (zip != NULL);
+
+	g_assert (!parse_member (zip, "stored/meta.xml", 0, &text, NULL));
+	g_free (text);
+
+	/* Invalid block type at the start of deflated/meta.xml, which
+	 * comes second */
+	offset = 30 + strlen ("stored/meta.xml") + strlen ("<meta/>") +
+		30 + strlen ("deflated/meta.xml");
+	archive->data[offset] = 0xff;
+
+	g_assert (!parse_member (zip, "deflated/meta.xml", 0, &text, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_clear_error (&error);
+	g_free (text);
+
+	/* Missing member */
+	g_assert (!parse_member (zip, "styles.xml", 0, &text, NULL));
+	g_free (text);
+
+	tracker_zip_close (zip);
+
+	/* End of central directory record cut off */
+	g_assert (tracker_zip_new_from_data (archive->data, archive->len - 30) == NULL);
+
+	g_byte_array_unref (archive);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/libtracker-extract/tracker-zip/parse",
+	                 test_zip_parse);
+	g_test_add_func ("/libtracker-extract/tracker-zip/parse-limit",
+	                 test_zip_parse_limit);
+	g_test_add_func ("/libtracker-extract/tracker-zip/invalid",
+	                 test_zip_invalid);
+
+	return g_test_run ();
+}
@@ -95,3 +95,84 @@ public class TrackerMockConnection : Sparql.Connection {
     }
 
 }
+
+
+/* Records the updates it gets, and holds each of them back until
+ * complete () is called on it, so tests decide in which order these
+ * are finished.
+ */
+public class TrackerMockUpdateConnection : Sparql.Connection {
+
+	class MockUpdate {
+		public string kind;
+		public int size;
+		public SourceFunc callback;
+	}
+
+	GenericArray<MockUpdate> updates = new GenericArray<MockUpdate> ();
+
+	async void hold (string kind, int size) {
+		var update = new MockUpdate ();
+
+		update.kind = kind;
+		update.size = size;
+		update.callback = hold.callback;
+		updates.add (update);
+
+		yield;
+	}
+
+	/* Number of updates received so far */
+	public uint get_n_updates () {
+		return updates.length;
+	}
+
+	/* "update", "array", "uri-prefix" or "delete-descendants" */
+	public unowned string get_update_kind (uint index) {
+		return updates[index].kind;
+	}
+
+	/* Number of SPARQL strings in an array update */
+	public int get_update_size (uint index) {
+		return updates[index].size;
+	}
+
+	public void complete (uint index)
+	requires (updates[index].callback != null) {
+		var update = updates[index];
+		SourceFunc callback = (owned) update.callback;
+
+		callback ();
+	}
+
+	public override Sparql.Cursor query (string sparql, Cancellable? cancellable = null)
+	throws Sparql.Error, IOError, DBusError {
+		throw new Sparql.Error.UNSUPPORTED ("Queries not supported");
+	}
+
+	public async override Sparql.Cursor query_async (string sparql, Cancellable? cancellable = null)
+	throws Sparql.Error, IOError, DBusError {
+		throw new Sparql.Error.UNSUPPORTED ("Queries not supported");
+	}
+
+	public async override void update_async (string sparql, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null)
+	throws Sparql.Error, IOError, DBusError {
+		yield hold ("update", 1);
+	}
+
+	public async override GenericArray<Sparql.Error?>? update_array_async (string[] sparql, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null)
+	throws Sparql.Error, IOError, DBusError {
+		yield hold ("array", sparql.length);
+		return null;
+	}
+
+	public async override void update_uri_prefix_async (string old_prefix, string new_prefix, string? sparql = null, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null)
+	throws Sparql.Error, IOError, DBusError {
+		yield hold ("uri-prefix", 0);
+	}
+
+	public async override void delete_descendants_async (string url, int priority = GLib.Priority.DEFAULT, Cancellable? cancellable = null)
+	throws Sparql.Error, IOError, DBusError {
+		yield hold ("delete-descendants", 0);
+	}
+}
@@ -943,6 +943,141 @@ test_indexing_tree_030 (TestCommonContext *fixture,
 	ASSERT_INDEXABLE (fixture, TEST_DIRECTORY_ABA);
 }
 
+/* Filters of every kind match the same basenames GPatternSpec would */
+static void
+test_indexing_tree_filters (TestCommonContext *fixture,
+                            gconstpointer      data)
+{
+	static const gchar *filters[] = {
+		"lost+found", "*~", "*.o", "#*", "foo?", "*.tmp*", "a*b", "/A/B"
+	};
+	static const struct {
+		const gchar *path;
+		gboolean filtered;
+	} files[] = {
+		{ "/A/lost+found", TRUE },
+		{ "/A/lost+found2", FALSE },
+		{ "/A/notes.txt~", TRUE },
+		{ "/A/main.o", TRUE },
+		{ "/A/.o", TRUE },
+		{ "/A/main.c", FALSE },
+		{ "/A/#autosave#", TRUE },
+		{ "/A/food", TRUE },
+		{ "/A/foo", FALSE },
+		{ "/A/x.tmp1", TRUE },
+		{ "/A/acb", TRUE },
+		{ "/A/acbd", FALSE },
+		{ "/A/B", TRUE },
+		{ "/A/B/C", TRUE },
+		{ "/A/BC", FALSE },
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (filters); i++) {
+		tracker_indexing_tree_add_filter (fixture->tree,
+		                                  TRACKER_FILTER_FILE,
+		                                  filters[i]);
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (files); i++) {
+		GFile *file;
+
+		file = g_file_new_for_path (files[i].path);
+		g_assert_cmpint (tracker_indexing_tree_file_matches_filter (fixture->tree,
+		                                                            TRACKER_FILTER_FILE,
+		                                                            file), ==,
+		                 files[i].filtered);
+		g_assert (!tracker_indexing_tree_file_matches_filter (fixture->tree,
+		                                                      TRACKER_FILTER_DIRECTORY,
+		                                                      file));
+		g_object_unref (file);
+	}
+
+	/* Filters changing after a match are picked up */
+	tracker_indexing_tree_clear_filters (fixture->tree, TRACKER_FILTER_FILE);
+	tracker_indexing_tree_add_filter (fixture->tree,
+	                                  TRACKER_FILTER_FILE,
+	                                  "*.c");
+
+	for (i = 0; i < G_N_ELEMENTS (files); i++) {
+		GFile *file;
+
+		file = g_file_new_for_path (files[i].path);
+		g_assert_cmpint (tracker_indexing_tree_file_matches_filter (fixture->tree,
+		                                                            TRACKER_FILTER_FILE,
+		                                                            file), ==,
+		                 g_str_has_suffix (files[i].path, ".c"));
+		g_object_unref (file);
+	}
+}
+
+/* Microbenchmark, run with -m perf */
+static void
+test_indexing_tree_filters_perf (TestCommonContext *fixture,
+                                 gconstpointer      data)
+{
+	static const gchar *extensions[] = {
+		"o", "la", "lo", "loT", "in", "m4", "rej", "orig", "pc", "omf",
+		"aux", "tmp", "po", "vmdk", "vm*", "nvram", "part", "bak", "swp", "pyc"
+	};
+	GFile *files[1000];
+	gdouble elapsed;
+	guint i, j, matches = 0;
+
+	if (!g_test_perf ()) {
+		return;
+	}
+
+	/* Around 60 filters, as found in user configurations */
+	for (i = 0; i < G_N_ELEMENTS (extensions); i++) {
+		gchar *glob;
+
+		glob = g_strdup_printf ("*.%s", extensions[i]);
+		tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, glob);
+		g_free (glob);
+
+		glob = g_strdup_printf ("%s-*", extensions[i]);
+		tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, glob);
+		g_free (glob);
+
+		glob = g_strdup_printf ("name-%u.%s", i, extensions[i]);
+		tracker_indexing_tree_add_filter (fixture->tree, TRACKER_FILTER_FILE, glob);
+		g_free (glob);
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (files); i++) {
+		gchar *path;
+
+		path = g_strdup_printf ("/A/B/document-%u.%s", i,
+		                        (i % 10) ? "odt" : extensions[i % G_N_ELEMENTS (extensions)]);
+		files[i] = g_file_new_for_path (path);
+		g_free (path);
+	}
+
+	g_test_timer_start ();
+
+	for (j = 0; j < 1000; j++) {
+		for (i = 0; i < G_N_ELEMENTS (files); i++) {
+			if (tracker_indexing_tree_file_matches_filter (fixture->tree,
+			                                               TRACKER_FILTER_FILE,
+			                                               files[i])) {
+				matches++;
+			}
+		}
+	}
+
+	elapsed = g_test_timer_elapsed ();
+
+	g_assert_cmpuint (matches, ==, 100 * 1000);
+	g_test_minimized_result (elapsed * G_USEC_PER_SEC / (j * G_N_ELEMENTS (files)),
+	                         "%.3f usec per filter check",
+	                         elapsed * G_USEC_PER_SEC / (j * G_N_ELEMENTS (files)));
+
+	for (i = 0; i < G_N_ELEMENTS (files); i++) {
+		g_object_unref (files[i]);
+	}
+}
+
 gint
 main (gint    argc,
       gchar **argv)
@@ -981,6 +1116,8 @@ main (gint    argc,
 	test_add ("/libtracker-miner/indexing-tree/028", test_indexing_tree_028);
 	test_add ("/libtracker-miner/indexing-tree/029", test_indexing_tree_029);
 	test_add ("/libtracker-miner/indexing-tree/030", test_indexing_tree_030);
+	test_add ("/libtracker-miner/indexing-tree/filters", test_indexing_tree_filters);
+	test_add ("/libtracker-miner/indexing-tree/filters-perf", test_indexing_tree_filters_perf);
 
 	return g_test_run ();
 }
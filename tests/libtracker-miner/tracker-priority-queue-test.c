@@ -160,6 +160,28 @@ test_priority_queue_foreach (void)
         tracker_priority_queue_unref (queue);
 }
 
+static void
+test_priority_queue_foreach_n (void)
+{
+        TrackerPriorityQueue *queue;
+        gint                  counter = 0;
+
+        queue = tracker_priority_queue_new ();
+
+        tracker_priority_queue_add (queue, g_strdup ("x"), 10);
+        tracker_priority_queue_add (queue, g_strdup ("x"), 20);
+        tracker_priority_queue_add (queue, g_strdup ("x"), 30);
+
+        tracker_priority_queue_foreach_n (queue, 2, foreach_testing_cb, &counter);
+        g_assert_cmpint (counter, ==, 2);
+
+        counter = 0;
+        tracker_priority_queue_foreach_n (queue, 10, foreach_testing_cb, &counter);
+        g_assert_cmpint (counter, ==, 3);
+
+        tracker_priority_queue_unref (queue);
+}
+
 static void
 test_priority_queue_foreach_remove (void)
 {
@@ -242,6 +264,8 @@ main (int    argc,
 	                 test_priority_queue_find);
 	g_test_add_func ("/libtracker-miner/tracker-priority-queue/foreach",
 	                 test_priority_queue_foreach);
+	g_test_add_func ("/libtracker-miner/tracker-priority-queue/foreach_n",
+	                 test_priority_queue_foreach_n);
 	g_test_add_func ("/libtracker-miner/tracker-priority-queue/foreach_remove",
 	                 test_priority_queue_foreach_remove);
 
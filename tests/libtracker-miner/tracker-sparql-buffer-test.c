@@ -0,0 +1,360 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301, USA.
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+/* NOTE: We're not including tracker-miner.h here because this is private. */
+#include <libtracker-miner/tracker-sparql-buffer.h>
+
+#include "tracker-miner-mock.h"
+
+/* Gives a batch size of 4 tasks */
+#define POOL_LIMIT 8
+
+/* Longer than the update time the batch size adapts to */
+#define SLOW_UPDATE_TIME (1200 * G_TIME_SPAN_MILLISECOND)
+
+typedef struct {
+	TrackerMockUpdateConnection *connection;
+	TrackerSparqlBuffer *buffer;
+	guint n_pushed;
+
+	/* Numbers of the finished tasks, in completion order */
+	GArray *finished;
+} BufferFixture;
+
+static void
+buffer_fixture_setup (BufferFixture *fixture,
+                      gconstpointer  data)
+{
+	fixture->connection = tracker_mock_update_connection_new ();
+	fixture->buffer = tracker_sparql_buffer_new (TRACKER_SPARQL_CONNECTION (fixture->connection),
+	                                             POOL_LIMIT);
+	fixture->finished = g_array_new (FALSE, FALSE, sizeof (gint));
+}
+
+static void
+buffer_fixture_teardown (BufferFixture *fixture,
+                         gconstpointer  data)
+{
+	g_object_unref (fixture->buffer);
+	g_object_unref (fixture->connection);
+	g_array_free (fixture->finished, TRUE);
+}
+
+static void
+task_finished_cb (GObject      *object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+	BufferFixture *fixture = user_data;
+	TrackerTask *task;
+	gchar *basename;
+	gint n;
+
+	g_assert (!g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), NULL));
+
+	task = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
+	basename = g_file_get_basename (tracker_task_get_file (task));
+	n = atoi (basename);
+	g_array_append_val (fixture->finished, n);
+	g_free (basename);
+}
+
+/* Files are named after the order they are pushed in */
+static GFile *
+next_file (BufferFixture *fixture)
+{
+	GFile *file;
+	gchar *path;
+
+	path = g_strdup_printf ("/tracker-sparql-buffer-test/%u", fixture->n_pushed++);
+	file = g_file_new_for_path (path);
+	g_free (path);
+
+	return file;
+}
+
+static void
+push_task (BufferFixture *fixture,
+           TrackerTask   *task)
+{
+	tracker_sparql_buffer_push (fixture->buffer, task,
+	                            G_PRIORITY_DEFAULT,
+	                            task_finished_cb, fixture);
+	g_object_unref (tracker_task_get_file (task));
+}
+
+static void
+push_sparql (BufferFixture *fixture)
+{
+	push_task (fixture,
+	           tracker_sparql_task_new_with_sparql_str (next_file (fixture),
+	                                                    "INSERT { <urn:test> a rdfs:Resource }"));
+}
+
+static void
+push_delete_descendants (BufferFixture *fixture)
+{
+	push_task (fixture,
+	           tracker_sparql_task_new_delete_descendants (next_file (fixture)));
+}
+
+static void
+push_high_priority_sparql (BufferFixture *fixture,
+                           GFile         *file)
+{
+	TrackerTask *task;
+
+	task = tracker_sparql_task_new_with_sparql_str (file,
+	                                                "INSERT { <urn:test> a rdfs:Resource }");
+	tracker_sparql_buffer_push (fixture->buffer, task,
+	                            G_PRIORITY_HIGH,
+	                            task_finished_cb, fixture);
+	g_object_unref (file);
+}
+
+/* Pushes tasks until the buffer sends an update, returns its index */
+static guint
+push_until_update (BufferFixture *fixture)
+{
+	guint n_updates;
+
+	n_updates = tracker_mock_update_connection_get_n_updates (fixture->connection);
+
+	while (tracker_mock_update_connection_get_n_updates (fixture->connection) == n_updates) {
+		g_assert_cmpuint (fixture->n_pushed, <, 1000);
+		push_sparql (fixture);
+	}
+
+	return n_updates;
+}
+
+static void
+wait_for_tasks (BufferFixture *fixture,
+                guint          n_tasks)
+{
+	while (fixture->finished->len < n_tasks) {
+		g_main_context_iteration (NULL, TRUE);
+	}
+}
+
+static void
+assert_finished_in_order (BufferFixture *fixture)
+{
+	guint i;
+
+	for (i = 0; i < fixture->finished->len; i++) {
+		g_assert_cmpint (g_array_index (fixture->finished, gint, i), ==, i);
+	}
+}
+
+static void
+test_sparql_buffer_completion_order (BufferFixture *fixture,
+                                     gconstpointer  data)
+{
+	TrackerMockUpdateConnection *connection = fixture->connection;
+
+	/* Two full batches in flight at once */
+	g_assert_cmpuint (push_until_update (fixture), ==, 0);
+	g_assert_cmpuint (push_until_update (fixture), ==, 1);
+	g_assert_cmpint (tracker_mock_update_connection_get_update_size (connection, 0), ==, POOL_LIMIT / 2);
+	g_assert_cmpint (tracker_mock_update_connection_get_update_size (connection, 1), ==, POOL_LIMIT / 2);
+
+	/* The second update finishing first doesn't complete its tasks */
+	tracker_mock_update_connection_complete (connection, 1);
+
+	while (g_main_context_iteration (NULL, FALSE))
+		;
+
+	g_assert_cmpuint (fixture->finished->len, ==, 0);
+
+	tracker_mock_update_connection_complete (connection, 0);
+	wait_for_tasks (fixture, fixture->n_pushed);
+
+	assert_finished_in_order (fixture);
+	g_assert_cmpuint (tracker_task_pool_get_size (TRACKER_TASK_POOL (fixture->buffer)), ==, 0);
+}
+
+static void
+test_sparql_buffer_adaptive_batch (BufferFixture *fixture,
+                                   gconstpointer  data)
+{
+	TrackerMockUpdateConnection *connection = fixture->connection;
+	guint update, n_fast;
+	gint size;
+
+	update = push_until_update (fixture);
+	g_assert_cmpint (tracker_mock_update_connection_get_update_size (connection, update), ==, POOL_LIMIT / 2);
+
+	/* A slow update makes the next batches smaller */
+	g_usleep (SLOW_UPDATE_TIME);
+	tracker_mock_update_connection_complete (connection, update);
+	wait_for_tasks (fixture, fixture->n_pushed);
+
+	update = push_until_update (fixture);
+	size = tracker_mock_update_connection_get_update_size (connection, update);
+	g_assert_cmpint (size, <, POOL_LIMIT / 2);
+
+	/* Fast updates make them grow back, once the average update
+	 * time goes down enough.
+	 */
+	for (n_fast = 0; n_fast < 10; n_fast++) {
+		tracker_mock_update_connection_complete (connection, update);
+		wait_for_tasks (fixture, fixture->n_pushed);
+
+		update = push_until_update (fixture);
+
+		if (tracker_mock_update_connection_get_update_size (connection, update) > size) {
+			break;
+		}
+
+		g_assert_cmpint (tracker_mock_update_connection_get_update_size (connection, update), ==, size);
+	}
+
+	g_assert_cmpuint (n_fast, <, 10);
+	g_assert_cmpint (tracker_mock_update_connection_get_update_size (connection, update), <=, POOL_LIMIT / 2);
+
+	tracker_mock_update_connection_complete (connection, update);
+	wait_for_tasks (fixture, fixture->n_pushed);
+
+	assert_finished_in_order (fixture);
+}
+
+static void
+test_sparql_buffer_ordered_task (BufferFixture *fixture,
+                                 gconstpointer  data)
+{
+	TrackerMockUpdateConnection *connection = fixture->connection;
+
+	/* Less than a batch, so nothing is sent until flushed */
+	push_sparql (fixture);
+	push_sparql (fixture);
+	push_delete_descendants (fixture);
+
+	/* Tasks before the ordered one are sent first */
+	g_assert (tracker_sparql_buffer_flush (fixture->buffer, "test"));
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 1);
+	g_assert_cmpstr (tracker_mock_update_connection_get_update_kind (connection, 0), ==, "array");
+	g_assert_cmpint (tracker_mock_update_connection_get_update_size (connection, 0), ==, 2);
+
+	push_sparql (fixture);
+	push_sparql (fixture);
+
+	/* The ordered task waits for them to finish */
+	g_assert (!tracker_sparql_buffer_flush (fixture->buffer, "test"));
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 1);
+
+	tracker_mock_update_connection_complete (connection, 0);
+	wait_for_tasks (fixture, 2);
+
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 2);
+	g_assert_cmpstr (tracker_mock_update_connection_get_update_kind (connection, 1), ==, "delete-descendants");
+
+	/* And nothing goes past it while it's in flight */
+	g_assert (!tracker_sparql_buffer_flush (fixture->buffer, "test"));
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 2);
+
+	tracker_mock_update_connection_complete (connection, 1);
+	wait_for_tasks (fixture, 3);
+
+	/* The tasks left behind are sent without waiting for the timeout */
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 3);
+	g_assert_cmpstr (tracker_mock_update_connection_get_update_kind (connection, 2), ==, "array");
+	g_assert_cmpint (tracker_mock_update_connection_get_update_size (connection, 2), ==, 2);
+
+	tracker_mock_update_connection_complete (connection, 2);
+	wait_for_tasks (fixture, fixture->n_pushed);
+
+	assert_finished_in_order (fixture);
+}
+
+static void
+test_sparql_buffer_high_priority (BufferFixture *fixture,
+                                  gconstpointer  data)
+{
+	TrackerMockUpdateConnection *connection = fixture->connection;
+	gint expected[] = { 2, 0, 1, 3 };
+	GFile *file;
+	guint i;
+
+	push_sparql (fixture);
+	push_delete_descendants (fixture);
+
+	/* Unrelated to the container, sent right away */
+	push_high_priority_sparql (fixture, next_file (fixture));
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 1);
+	g_assert_cmpstr (tracker_mock_update_connection_get_update_kind (connection, 0), ==, "update");
+
+	/* Inside the container, waits for its contents to be deleted */
+	file = g_file_new_for_path ("/tracker-sparql-buffer-test/1/3");
+	fixture->n_pushed++;
+	push_high_priority_sparql (fixture, file);
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 1);
+
+	tracker_mock_update_connection_complete (connection, 0);
+	wait_for_tasks (fixture, 1);
+
+	g_assert (tracker_sparql_buffer_flush (fixture->buffer, "test"));
+	g_assert_cmpstr (tracker_mock_update_connection_get_update_kind (connection, 1), ==, "array");
+	tracker_mock_update_connection_complete (connection, 1);
+	wait_for_tasks (fixture, 2);
+
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 3);
+	g_assert_cmpstr (tracker_mock_update_connection_get_update_kind (connection, 2), ==, "delete-descendants");
+	tracker_mock_update_connection_complete (connection, 2);
+	wait_for_tasks (fixture, 3);
+
+	g_assert_cmpuint (tracker_mock_update_connection_get_n_updates (connection), ==, 4);
+	g_assert_cmpstr (tracker_mock_update_connection_get_update_kind (connection, 3), ==, "array");
+	tracker_mock_update_connection_complete (connection, 3);
+	wait_for_tasks (fixture, fixture->n_pushed);
+
+	for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+		g_assert_cmpint (g_array_index (fixture->finished, gint, i), ==, expected[i]);
+	}
+}
+
+#define test_add(path,fun) \
+	g_test_add (path, \
+	            BufferFixture, \
+	            NULL, \
+	            buffer_fixture_setup, \
+	            fun, \
+	            buffer_fixture_teardown)
+
+int
+main (int    argc,
+      char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_message ("Testing SPARQL buffer");
+
+	test_add ("/libtracker-miner/tracker-sparql-buffer/completion-order",
+	          test_sparql_buffer_completion_order);
+	test_add ("/libtracker-miner/tracker-sparql-buffer/adaptive-batch",
+	          test_sparql_buffer_adaptive_batch);
+	test_add ("/libtracker-miner/tracker-sparql-buffer/ordered-task",
+	          test_sparql_buffer_ordered_task);
+	test_add ("/libtracker-miner/tracker-sparql-buffer/high-priority",
+	          test_sparql_buffer_high_priority);
+
+	return g_test_run ();
+}
@@ -21,6 +21,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include <gio/gunixfdlist.h>
 
 #include <libtracker-sparql/tracker-sparql.h>
 
@@ -659,6 +662,362 @@ test_tracker_sparql_update_blank_async (void)
 	g_main_loop_unref (main_loop);
 }
 
+static void
+test_tracker_sparql_update_uri_prefix (void)
+{
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	tracker_sparql_connection_update (connection,
+	                                  "INSERT { "
+	                                  "  <urn:prefix:0> a nfo:FileDataObject ; nie:url \"file:///prefix-test/a\" . "
+	                                  "  <urn:prefix:1> a nfo:FileDataObject ; nie:url \"file:///prefix-test/a/1\" . "
+	                                  "  <urn:prefix:2> a nfo:FileDataObject ; nie:url \"file:///prefix-test/a/b/2\" . "
+	                                  "  <urn:prefix:3> a nfo:FileDataObject ; nie:url \"file:///prefix-test/ab/3\" "
+	                                  "}",
+	                                  0, NULL, &error);
+	g_assert_no_error (error);
+
+	/* Only directory prefixes are accepted */
+	tracker_sparql_connection_update_uri_prefix (connection,
+	                                             "file:///prefix-test/a",
+	                                             "file:///prefix-test/c",
+	                                             NULL, 0, NULL, &error);
+	g_assert_error (error, TRACKER_SPARQL_ERROR, TRACKER_SPARQL_ERROR_TYPE);
+	g_clear_error (&error);
+
+	/* Nothing is rewritten if the update fails, nie:url is single valued */
+	tracker_sparql_connection_update_uri_prefix (connection,
+	                                             "file:///prefix-test/a/",
+	                                             "file:///prefix-test/c/",
+	                                             "INSERT { <urn:prefix:0> nie:url \"file:///prefix-test/d\" }",
+	                                             0, NULL, &error);
+	g_assert (error != NULL);
+	g_clear_error (&error);
+
+	tracker_sparql_connection_update_uri_prefix (connection,
+	                                             "file:///prefix-test/a/",
+	                                             "file:///prefix-test/c/",
+	                                             "DELETE { <urn:prefix:0> nie:url ?u } WHERE { <urn:prefix:0> nie:url ?u } "
+	                                             "INSERT { <urn:prefix:0> nie:url \"file:///prefix-test/c\" }",
+	                                             0, NULL, &error);
+	g_assert_no_error (error);
+
+	cursor = tracker_sparql_connection_query (connection,
+	                                          "SELECT nie:url(?r) WHERE { "
+	                                          "  ?r a nfo:FileDataObject . "
+	                                          "  FILTER (?r = <urn:prefix:0> || ?r = <urn:prefix:1> || "
+	                                          "          ?r = <urn:prefix:2> || ?r = <urn:prefix:3>) "
+	                                          "} ORDER BY ?r",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+	g_assert_cmpstr (tracker_sparql_cursor_get_string (cursor, 0, NULL), ==, "file:///prefix-test/c");
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+	g_assert_cmpstr (tracker_sparql_cursor_get_string (cursor, 0, NULL), ==, "file:///prefix-test/c/1");
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+	g_assert_cmpstr (tracker_sparql_cursor_get_string (cursor, 0, NULL), ==, "file:///prefix-test/c/b/2");
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+	g_assert_cmpstr (tracker_sparql_cursor_get_string (cursor, 0, NULL), ==, "file:///prefix-test/ab/3");
+	g_assert (!tracker_sparql_cursor_next (cursor, NULL, NULL));
+
+	g_object_unref (cursor);
+}
+
+#define NFO_DOCUMENT "http://www.semanticdesktop.org/ontologies/2007/03/22/nfo#Document"
+
+typedef struct {
+	GMainLoop *main_loop;
+	GHashTable *pending_ids;
+	guint timeout_id;
+} DeleteEventsData;
+
+static void
+delete_events_cb (GDBusConnection *bus,
+                  const gchar     *sender_name,
+                  const gchar     *object_path,
+                  const gchar     *interface_name,
+                  const gchar     *signal_name,
+                  GVariant        *parameters,
+                  gpointer         user_data)
+{
+	DeleteEventsData *data = user_data;
+	GVariantIter *deletes, *inserts;
+	const gchar *class_name;
+	gint graph, subject, predicate, object;
+
+	g_variant_get (parameters, "(&sa(iiii)a(iiii))", &class_name, &deletes, &inserts);
+
+	if (g_strcmp0 (class_name, NFO_DOCUMENT) == 0) {
+		while (g_variant_iter_loop (deletes, "(iiii)", &graph, &subject, &predicate, &object)) {
+			g_hash_table_remove (data->pending_ids, GINT_TO_POINTER (subject));
+		}
+	}
+
+	g_variant_iter_free (deletes);
+	g_variant_iter_free (inserts);
+
+	if (g_hash_table_size (data->pending_ids) == 0) {
+		g_main_loop_quit (data->main_loop);
+	}
+}
+
+static gboolean
+delete_events_timeout_cb (gpointer user_data)
+{
+	DeleteEventsData *data = user_data;
+
+	data->timeout_id = 0;
+	g_main_loop_quit (data->main_loop);
+
+	return FALSE;
+}
+
+/* Checks @query returns @urn only, or nothing if @urn is %NULL */
+static void
+assert_only_resource (const gchar *query,
+                      const gchar *urn)
+{
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	cursor = tracker_sparql_connection_query (connection, query, NULL, &error);
+	g_assert_no_error (error);
+
+	if (urn) {
+		g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+		g_assert_cmpstr (tracker_sparql_cursor_get_string (cursor, 0, NULL), ==, urn);
+	}
+
+	g_assert (!tracker_sparql_cursor_next (cursor, NULL, NULL));
+
+	g_object_unref (cursor);
+}
+
+static void
+test_tracker_sparql_delete_descendants (void)
+{
+	TrackerSparqlCursor *cursor;
+	DeleteEventsData data;
+	GDBusConnection *bus;
+	GError *error = NULL;
+	guint signal_id;
+
+	tracker_sparql_connection_update (connection,
+	                                  "INSERT { "
+	                                  "  <urn:tree:a> a nfo:Folder ; nie:url \"file:///tree-test/a\" . "
+	                                  "  <urn:tree:b> a nfo:Folder ; nie:url \"file:///tree-test/a/b\" ; nfo:belongsToContainer <urn:tree:a> . "
+	                                  "  <urn:tree:1> a nfo:FileDataObject, nfo:Document ; nie:url \"file:///tree-test/a/1\" ; nfo:belongsToContainer <urn:tree:a> ; "
+	                                  "    nie:keyword \"treetestkeyword\", \"treetestother\" . "
+	                                  "  <urn:tree:2> a nfo:FileDataObject, nfo:Document ; nie:url \"file:///tree-test/a/b/2\" ; nfo:belongsToContainer <urn:tree:b> ; "
+	                                  "    nie:keyword \"treetestkeyword\" . "
+	                                  "  <urn:tree:3> a nfo:FileDataObject, nfo:Document ; nie:url \"file:///tree-test/ab/3\" ; "
+	                                  "    nie:keyword \"treetestkeyword\" "
+	                                  "}",
+	                                  0, NULL, &error);
+	g_assert_no_error (error);
+
+	/* Wait for the rdf:type deletions of the documents below the container */
+	data.main_loop = g_main_loop_new (NULL, FALSE);
+	data.pending_ids = g_hash_table_new (NULL, NULL);
+
+	cursor = tracker_sparql_connection_query (connection,
+	                                          "SELECT tracker:id(?r) WHERE { "
+	                                          "  ?r a nfo:Document . "
+	                                          "  FILTER (?r = <urn:tree:1> || ?r = <urn:tree:2>) "
+	                                          "}",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+
+	while (tracker_sparql_cursor_next (cursor, NULL, NULL)) {
+		g_hash_table_add (data.pending_ids,
+		                  GINT_TO_POINTER (tracker_sparql_cursor_get_integer (cursor, 0)));
+	}
+
+	g_object_unref (cursor);
+	g_assert_cmpuint (g_hash_table_size (data.pending_ids), ==, 2);
+
+	bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	g_assert_no_error (error);
+
+	signal_id = g_dbus_connection_signal_subscribe (bus,
+	                                                "org.freedesktop.Tracker1",
+	                                                "org.freedesktop.Tracker1.Resources",
+	                                                "GraphUpdated",
+	                                                "/org/freedesktop/Tracker1/Resources",
+	                                                NULL,
+	                                                G_DBUS_SIGNAL_FLAGS_NONE,
+	                                                delete_events_cb,
+	                                                &data,
+	                                                NULL);
+
+	tracker_sparql_connection_delete_descendants (connection,
+	                                              "file:///tree-test/a",
+	                                              0, NULL, &error);
+	g_assert_no_error (error);
+
+	data.timeout_id = g_timeout_add_seconds (10, delete_events_timeout_cb, &data);
+	g_main_loop_run (data.main_loop);
+
+	if (data.timeout_id != 0) {
+		g_source_remove (data.timeout_id);
+	}
+
+	g_assert_cmpuint (g_hash_table_size (data.pending_ids), ==, 0);
+
+	g_dbus_connection_signal_unsubscribe (bus, signal_id);
+	g_object_unref (bus);
+	g_hash_table_unref (data.pending_ids);
+	g_main_loop_unref (data.main_loop);
+
+	/* Multi-valued property rows and full text matches are gone too */
+	assert_only_resource ("SELECT ?r WHERE { ?r nie:keyword \"treetestkeyword\" }",
+	                      "urn:tree:3");
+	assert_only_resource ("SELECT ?r WHERE { ?r fts:match \"treetestkeyword\" }",
+	                      "urn:tree:3");
+	assert_only_resource ("SELECT ?r WHERE { ?r fts:match \"treetestother\" }",
+	                      NULL);
+
+	cursor = tracker_sparql_connection_query (connection,
+	                                          "SELECT ?r WHERE { "
+	                                          "  ?r a nfo:FileDataObject . "
+	                                          "  FILTER (?r = <urn:tree:a> || ?r = <urn:tree:b> || "
+	                                          "          ?r = <urn:tree:1> || ?r = <urn:tree:2> || ?r = <urn:tree:3>) "
+	                                          "} ORDER BY ?r",
+	                                          NULL, &error);
+	g_assert_no_error (error);
+
+	/* The container itself and unrelated resources are kept */
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+	g_assert_cmpstr (tracker_sparql_cursor_get_string (cursor, 0, NULL), ==, "urn:tree:3");
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+	g_assert_cmpstr (tracker_sparql_cursor_get_string (cursor, 0, NULL), ==, "urn:tree:a");
+	g_assert (!tracker_sparql_cursor_next (cursor, NULL, NULL));
+
+	g_object_unref (cursor);
+}
+
+static void
+test_tracker_sparql_query_with_timeout (void)
+{
+	TrackerSparqlCursor *cursor;
+	GError *error = NULL;
+
+	cursor = tracker_sparql_connection_query_with_timeout (connection,
+	                                                       "SELECT ?r WHERE { ?r a nfo:FileDataObject }",
+	                                                       10000, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (cursor != NULL);
+
+	g_assert (tracker_sparql_cursor_next (cursor, NULL, NULL));
+
+	g_object_unref (cursor);
+}
+
+/* Its results are far larger than the store's buffer and a pipe
+ * together, so the query can't finish while nobody reads them */
+#define BLOCKING_QUERY "SELECT ?a ?b WHERE { ?a a rdfs:Resource . ?b a rdfs:Resource }"
+
+/* As many as the store runs at once */
+#define N_BLOCKING_QUERIES 2
+
+static void
+blocking_query_cb (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+	GVariant *reply;
+	gint *n_pending = user_data;
+
+	/* Fails once the pipe is closed */
+	reply = g_dbus_connection_call_with_unix_fd_list_finish (G_DBUS_CONNECTION (source_object),
+	                                                         NULL, result, NULL);
+
+	if (reply) {
+		g_variant_unref (reply);
+	}
+
+	(*n_pending)--;
+}
+
+/* Starts BLOCKING_QUERY in the store writing to a pipe, the query
+ * keeps its slot until the returned read end is closed */
+static gint
+start_blocking_query (GDBusConnection *bus,
+                      gint            *n_pending)
+{
+	GUnixFDList *fd_list;
+	GError *error = NULL;
+	gint pipefd[2];
+
+	g_assert_cmpint (pipe (pipefd), ==, 0);
+
+	fd_list = g_unix_fd_list_new ();
+	g_unix_fd_list_append (fd_list, pipefd[1], &error);
+	g_assert_no_error (error);
+	close (pipefd[1]);
+
+	g_dbus_connection_call_with_unix_fd_list (bus,
+	                                          "org.freedesktop.Tracker1",
+	                                          "/org/freedesktop/Tracker1/Steroids",
+	                                          "org.freedesktop.Tracker1.Steroids",
+	                                          "Query",
+	                                          g_variant_new ("(sh)", BLOCKING_QUERY, 0),
+	                                          G_VARIANT_TYPE ("(as)"),
+	                                          G_DBUS_CALL_FLAGS_NONE,
+	                                          G_MAXINT,
+	                                          fd_list,
+	                                          NULL,
+	                                          blocking_query_cb,
+	                                          n_pending);
+	(*n_pending)++;
+
+	g_object_unref (fd_list);
+
+	return pipefd[0];
+}
+
+static void
+test_tracker_sparql_query_with_timeout_expired (void)
+{
+	TrackerSparqlCursor *cursor;
+	GDBusConnection *bus;
+	GError *error = NULL;
+	gint read_fds[N_BLOCKING_QUERIES];
+	gint i, n_pending = 0;
+
+	bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	g_assert_no_error (error);
+
+	/* Keep every query slot of the store taken. These go out on
+	 * the same connection as the query below, so they get there
+	 * first.
+	 */
+	for (i = 0; i < N_BLOCKING_QUERIES; i++) {
+		read_fds[i] = start_blocking_query (bus, &n_pending);
+	}
+
+	/* The query can't be started before its deadline */
+	cursor = tracker_sparql_connection_query_with_timeout (connection,
+	                                                       "SELECT ?r WHERE { ?r a nfo:FileDataObject }",
+	                                                       10, NULL, &error);
+	g_assert_error (error, G_DBUS_ERROR, G_DBUS_ERROR_TIMED_OUT);
+	g_assert (cursor == NULL);
+	g_clear_error (&error);
+
+	/* Let the blocking queries fail and free their slots */
+	for (i = 0; i < N_BLOCKING_QUERIES; i++) {
+		close (read_fds[i]);
+	}
+
+	while (n_pending > 0) {
+		g_main_context_iteration (NULL, TRUE);
+	}
+
+	g_object_unref (bus);
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -690,6 +1049,10 @@ main (gint argc, gchar **argv)
 	g_test_add_func ("/steroids/tracker/tracker_sparql_update_async_cancel", test_tracker_sparql_update_async_cancel);
 	g_test_add_func ("/steroids/tracker/tracker_sparql_update_blank_async", test_tracker_sparql_update_blank_async);
 	g_test_add_func ("/steroids/tracker/tracker_sparql_update_array_async", test_tracker_sparql_update_array_async);
+	g_test_add_func ("/steroids/tracker/tracker_sparql_update_uri_prefix", test_tracker_sparql_update_uri_prefix);
+	g_test_add_func ("/steroids/tracker/tracker_sparql_delete_descendants", test_tracker_sparql_delete_descendants);
+	g_test_add_func ("/steroids/tracker/tracker_sparql_query_with_timeout", test_tracker_sparql_query_with_timeout);
+	g_test_add_func ("/steroids/tracker/tracker_sparql_query_with_timeout_expired", test_tracker_sparql_query_with_timeout_expired);
 
 	return g_test_run ();
 }
@@ -163,19 +163,24 @@ def index_clean():
 	#tracker-control -r
 	debug ('Cleaning index')
 
+def index_miner_fs_binary():
+	binary = os.path.join(opts.prefix, 'libexec', 'tracker-miner-fs')
+	if not os.path.exists(binary):
+		binary = os.path.join(opts.prefix, 'lib', 'tracker-miner-fs')
+		if not os.path.exists(binary):
+			print 'Could not find "tracker-miner-fs" in prefix lib/libexec directories'
+			print 'Is Tracker installed properly?'
+			sys.exit(1)
+
+	return binary
+
 def index_update():
 	debug('Updating index ...')
 	debug('--')
 
 	try:
-		binary = os.path.join(opts.prefix, 'libexec', 'tracker-miner-fs')
-		if not os.path.exists(binary):
-			binary = os.path.join(opts.prefix, 'lib', 'tracker-miner-fs')
-			if not os.path.exists(binary):
-				print 'Could not find "tracker-miner-fs" in prefix lib/libexec directories'
-				print 'Is Tracker installed properly?'
-				sys.exit(1)
-		
+		binary = index_miner_fs_binary()
+
 		# Mine data WITHOUT being a daemon, exit when done. Ignore desktop files
 		subprocess.check_output([binary, "--no-daemon", "--disable-miner=applications"])
 	except subprocess.CalledProcessError, e: